@@ -0,0 +1,74 @@
+#pragma once
+
+#include "CryptoProvider.hpp"
+#include "Errors.hpp"
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+namespace tcfs {
+
+/**
+ * @brief One entry of the audit log
+ */
+struct AuditRecord {
+    uint64_t seq = 0;
+    std::string time;        // RFC3339
+    std::string action;
+    std::string capsule_id;
+    nlohmann::json details;
+    std::string prev_hash;   // Hex SHA-256 of the previous record
+    std::string hash;        // Hex SHA-256 over prev_hash and this record
+
+    nlohmann::json to_json() const;
+    static Result<AuditRecord> from_json(const nlohmann::json& json);
+};
+
+/**
+ * @brief Append-only, hash-chained audit log (one JSON record per line)
+ *
+ * Each record carries the hash of its predecessor, so removing or editing a
+ * record breaks the chain at that point. Opening the log reads only its last
+ * record. Appends hold an exclusive lock on a sibling .lock file and re-read
+ * the last record when another process has grown the log since, so the chain
+ * stays intact with several writers.
+ */
+class AuditLog {
+public:
+    static constexpr const char* FILENAME = "audit.log";
+
+    explicit AuditLog(CryptoProvider& crypto) : crypto_(crypto) {}
+
+    Result<void> open(const std::filesystem::path& path);
+
+    Result<void> append(const std::string& action, const std::string& capsule_id,
+                        const nlohmann::json& details = nlohmann::json::object());
+
+    /**
+     * @brief Read every record, checking the hash chain; fails with HashChainBroken on tampering
+     */
+    Result<std::vector<AuditRecord>> read_all() const;
+
+    uint64_t last_sequence() const { return last_seq_; }
+    const std::filesystem::path& path() const { return path_; }
+
+private:
+    CryptoProvider& crypto_;
+    std::filesystem::path path_;
+    std::ofstream out_;
+    uint64_t last_seq_ = 0;
+    std::string last_hash_;
+    uint64_t tail_offset_ = 0; // Log size after the record last_seq_/last_hash_ were read from
+
+    /**
+     * @brief Load last_seq_ and last_hash_ from the last record of the log
+     */
+    Result<void> read_tail();
+
+    std::string compute_hash(const AuditRecord& record) const;
+};
+
+} // namespace tcfs
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "CryptoProvider.hpp"
+#include "Errors.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace tcfs {
+
+/**
+ * @brief How a search term is compared with a field
+ */
+enum class BlindMatch : uint8_t {
+    Exact,
+    Prefix,
+    Contains
+};
+
+/**
+ * @brief Keyed HMAC tokens that let the catalog answer searches over encrypted fields
+ *
+ * A field value is lowercased and turned into tokens for the whole value,
+ * for each prefix up to MAX_PREFIX characters and for each trigram. A token
+ * is the first 8 bytes of HMAC-SHA256 under the index key over the kind, the
+ * field name and the text, so the catalog holds neither the text nor a hash
+ * anyone without the key could test guesses against. A query computes the
+ * same tokens for the search term; capsules holding all of them are the
+ * candidates.
+ *
+ * Tokens are deterministic: someone reading the catalog can tell that two
+ * capsules share a label, just not what it is. Prefixes longer than
+ * MAX_PREFIX and Contains queries can match candidates that only share the
+ * tokens, so callers confirm those against the decrypted value (see
+ * is_exact()).
+ */
+class BlindIndex {
+public:
+    static constexpr size_t MAX_PREFIX = 32;
+    static constexpr size_t GRAM = 3;
+
+    BlindIndex(CryptoProvider& crypto, CryptoKey key) : crypto_(crypto), key_(std::move(key)) {}
+
+    /**
+     * @brief Every token of value in field, sorted and unique; none for an empty value
+     */
+    std::vector<uint64_t> tokens(const std::string& field, const std::string& value) const;
+
+    /**
+     * @brief Tokens a capsule must hold to match term; InvalidArgument for Contains terms shorter than a trigram
+     */
+    Result<std::vector<uint64_t>> query(const std::string& field, const std::string& term, BlindMatch match) const;
+
+    /**
+     * @brief Whether holding the query tokens proves the match, with no false positives
+     */
+    static bool is_exact(const std::string& term, BlindMatch match);
+
+    /**
+     * @brief Whether value matches term, both compared lowercased
+     */
+    static bool matches(const std::string& value, const std::string& term, BlindMatch match);
+
+    static std::string normalize(const std::string& value);
+
+private:
+    CryptoProvider& crypto_;
+    CryptoKey key_;
+
+    uint64_t token(char kind, const std::string& field, const std::string& text) const;
+};
+
+} // namespace tcfs
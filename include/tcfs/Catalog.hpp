@@ -0,0 +1,324 @@
+#pragma once
+
+#include "Errors.hpp"
+#include "FileLock.hpp"
+#include "JournalGeneration.hpp"
+#include "TrigramIndex.hpp"
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+namespace tcfs {
+
+/**
+ * @brief Lifecycle state of a capsule in the catalog
+ */
+enum class CapsuleState : uint8_t {
+    Locked,
+    Released
+};
+
+/**
+ * @brief Catalog record of one capsule
+ *
+ * Holds the fields needed to schedule and query capsules without opening
+ * their .meta files.
+ */
+struct CatalogEntry {
+    std::string id;
+    std::string original_filename;
+    std::string owner;
+    std::string label;
+    std::string notes;
+    int64_t unlock_at = 0;        // Seconds since the Unix epoch
+    int64_t expire_at = 0;        // Seconds since the Unix epoch; 0 if the capsule never expires
+    uint32_t grace_seconds = 0;
+    uint64_t size = 0;            // Ciphertext bytes
+    bool has_schedule_rules = false; // Condition or recurrence present; full policy lives in .meta
+    std::vector<std::string> depends_on;
+    CapsuleState state = CapsuleState::Locked;
+    std::vector<uint64_t> blind_tokens; // Sorted BlindIndex tokens of label, filename and notes
+    std::string group;            // Group whose policy the capsule shares; empty if it has its own
+
+    nlohmann::json to_json() const;
+    static Result<CatalogEntry> from_json(const nlohmann::json& json);
+};
+
+/**
+ * @brief Catalog record of a capsule group
+ *
+ * The group's full policy lives once in the store (see Store::create_group);
+ * the catalog keeps the schedule its members share. Members take unlock_at,
+ * expire_at, grace_seconds and has_schedule_rules from here, so moving the
+ * group is one journal record however many capsules it holds.
+ */
+struct GroupEntry {
+    std::string name;
+    std::string label;
+    int64_t unlock_at = 0;        // Seconds since the Unix epoch
+    int64_t expire_at = 0;        // Seconds since the Unix epoch; 0 if members never expire
+    uint32_t grace_seconds = 0;
+    bool has_schedule_rules = false;
+
+    nlohmann::json to_json() const;
+    static Result<GroupEntry> from_json(const nlohmann::json& json);
+};
+
+/**
+ * @brief Slot-indexed columns of the fields that store statistics aggregate
+ *
+ * Kept in step with the catalog entries, so a scan over millions of capsules
+ * reads a few dense arrays instead of chasing the strings of each
+ * CatalogEntry. Labels and owners are interned; index 0 is the empty string.
+ * Removed slots keep their values with LIVE cleared.
+ */
+struct CatalogColumns {
+    static constexpr uint8_t LIVE = 1;
+    static constexpr uint8_t LOCKED = 2;
+
+    std::vector<int64_t> unlock_at;
+    std::vector<uint64_t> size;
+    std::vector<uint32_t> label;
+    std::vector<uint32_t> owner;
+    std::vector<uint8_t> flags;
+    std::vector<std::string> labels{""};
+    std::vector<std::string> owners{""};
+};
+
+/**
+ * @brief Effect of replaying journal records
+ */
+struct CatalogChanges {
+    std::vector<std::string> touched; // Capsules put, released or removed
+    std::vector<std::string> added;   // Capsules put that were not in the catalog before
+    std::vector<std::string> ready;   // Locked capsules whose last pending dependency went away
+};
+
+/**
+ * @brief Complete in-memory state of a catalog, with slots compacted
+ *
+ * What a snapshot stores: restoring an image and replaying the journal past
+ * journal_offset gives the same catalog as replaying the whole journal.
+ */
+struct CatalogImage {
+    std::vector<CatalogEntry> entries;
+    std::vector<std::vector<uint32_t>> dependents; // Indices into entries
+    std::vector<uint32_t> pending_dependencies;
+    std::vector<GroupEntry> groups;
+    uint64_t journal_offset = 0;
+    uint64_t sequence = 0;
+};
+
+/**
+ * @brief In-memory capsule index backed by an append-only journal
+ *
+ * Every mutation is appended to the journal as one NDJSON record with a
+ * monotonically increasing sequence number; loading replays the journal.
+ * Entries live in dense slots so per-capsule side structures can be plain
+ * arrays. Dependency edges form a DAG: each slot keeps its dependents and a
+ * count of dependencies not yet released, so releasing a capsule touches
+ * only its out-edges.
+ *
+ * Several processes may share a journal. Mutations hold an exclusive lock on
+ * a sibling .lock file from the refresh that validates them to the append,
+ * and then publish the new end of the journal through a JournalGeneration
+ * header (.gen). Readers take no lock: refresh() consults the header and
+ * returns at once when the generation is unchanged, and otherwise replays
+ * only up to the published offset, never a commit still being written.
+ */
+class Catalog {
+public:
+    static constexpr const char* JOURNAL_FILENAME = "catalog.journal";
+
+    Catalog() = default;
+    Catalog(const Catalog&) = delete;
+    Catalog& operator=(const Catalog&) = delete;
+    Catalog(Catalog&&) = default;
+    Catalog& operator=(Catalog&&) = default;
+
+    /**
+     * @brief Replay the journal at path; a missing journal gives an empty catalog
+     */
+    Result<void> load(const std::filesystem::path& journal_path);
+
+    /**
+     * @brief Apply records committed to the journal by other processes since the last load/refresh
+     */
+    Result<CatalogChanges> refresh();
+
+    /**
+     * @brief Take the state of image, then replay the journal at path from image.journal_offset
+     *
+     * Returns the changes of the replayed tail. The caller is responsible for
+     * image matching the journal (see CatalogSnapshot).
+     */
+    Result<CatalogChanges> restore(const std::filesystem::path& journal_path, CatalogImage image);
+
+    /**
+     * @brief Copy of the current state, for snapshotting
+     */
+    CatalogImage image() const;
+
+    bool is_loaded() const { return !journal_path_.empty(); }
+    const std::filesystem::path& journal_path() const { return journal_path_; }
+    std::filesystem::path lock_path() const { return journal_path_.string() + ".lock"; }
+    std::filesystem::path generation_path() const { return journal_path_.string() + ".gen"; }
+
+    /**
+     * @brief Insert or replace a capsule; fails on unknown dependencies or cycles
+     */
+    Result<void> put(const CatalogEntry& entry);
+
+    /**
+     * @brief Insert several capsules with one journal write and one fsync (group commit)
+     *
+     * All entries are validated first; on failure nothing is written.
+     */
+    Result<void> put_all(const std::vector<CatalogEntry>& entries);
+
+    /**
+     * @brief Insert or replace several capsules as one journal record
+     *
+     * Unlike put_all, replay applies either every entry or none: a torn
+     * record is dropped whole. The record is fsynced before this returns,
+     * so it can serve as the commit point of changes made after it. Used for
+     * bulk policy updates.
+     */
+    Result<void> put_transaction(const std::vector<CatalogEntry>& entries);
+
+    /**
+     * @brief Insert or replace a group; its members take the new schedule
+     */
+    Result<void> put_group(const GroupEntry& group);
+
+    /**
+     * @brief Mark a capsule released and return dependents that became ready
+     */
+    Result<std::vector<std::string>> mark_released(const std::string& id);
+
+    /**
+     * @brief Remove a capsule; dependents waiting on it are unblocked and returned
+     */
+    Result<std::vector<std::string>> remove(const std::string& id);
+
+    const CatalogEntry* find(const std::string& id) const;
+    bool contains(const std::string& id) const { return slot_by_id_.count(id) != 0; }
+
+    /**
+     * @brief Ids of live capsules holding every token, in slot order
+     *
+     * Walks the posting list of the rarest token and checks the others
+     * against each candidate's sorted tokens.
+     */
+    std::vector<std::string> find_by_tokens(const std::vector<uint64_t>& tokens) const;
+
+    /**
+     * @brief Ids of live capsules whose label, notes or original filename contain text, ignoring case
+     *
+     * Text of at least three characters is looked up in the trigram index and
+     * only the candidates are compared; shorter text scans every entry.
+     */
+    std::vector<std::string> find_text(const std::string& text) const;
+
+    const CatalogColumns& columns() const { return columns_; }
+
+    /**
+     * @brief Ids of live capsules whose original filename matches a shell glob (*, ?, [...])
+     *
+     * Literal runs of the pattern narrow the candidates through the trigram index.
+     */
+    std::vector<std::string> find_glob(const std::string& pattern) const;
+
+    const TrigramIndex& text_index() const { return text_index_; }
+
+    const GroupEntry* find_group(const std::string& name) const;
+
+    /**
+     * @brief Groups in name order
+     */
+    std::vector<const GroupEntry*> groups() const;
+    size_t group_size(const std::string& name) const;
+
+    /**
+     * @brief Ids of a group's live members, in slot order
+     */
+    std::vector<std::string> group_members(const std::string& name) const;
+
+    /**
+     * @brief All dependencies released (or the capsule has none)
+     */
+    bool dependencies_ready(const std::string& id) const;
+    std::vector<std::string> dependents(const std::string& id) const;
+
+    /**
+     * @brief Live entries in slot order
+     */
+    std::vector<const CatalogEntry*> entries() const;
+    size_t size() const { return slot_by_id_.size(); }
+
+    uint64_t last_sequence() const { return sequence_; }
+    uint64_t journal_offset() const { return journal_offset_; }
+
+private:
+    static constexpr uint32_t NO_SLOT = UINT32_MAX;
+
+    std::filesystem::path journal_path_;
+    uint64_t journal_offset_ = 0;
+    uint64_t sequence_ = 0;
+    JournalGeneration generation_;
+    std::optional<uint64_t> seen_generation_; // Generation the in-memory state reflects
+
+    std::vector<CatalogEntry> entries_;
+    std::vector<bool> live_;
+    std::vector<std::vector<uint32_t>> dependents_;
+    std::vector<uint32_t> pending_dependencies_;
+    std::unordered_map<std::string, uint32_t> slot_by_id_;
+    std::unordered_map<uint64_t, std::vector<uint32_t>> slots_by_token_;
+    TrigramIndex text_index_; // Lowercased label, notes and filename; stale slots are filtered on query
+    std::unordered_map<std::string, GroupEntry> groups_;
+    std::unordered_map<std::string, std::vector<uint32_t>> slots_by_group_;
+    CatalogColumns columns_;
+    std::unordered_map<std::string, uint32_t> label_ids_;
+    std::unordered_map<std::string, uint32_t> owner_ids_;
+
+    uint32_t slot_of(const std::string& id) const;
+    bool reaches(uint32_t from, uint32_t target) const;
+
+    void attach(const std::filesystem::path& journal_path);
+    Result<CatalogChanges> replay(uint64_t limit);
+
+    /**
+     * @brief Take the journal lock and catch up to the end of the journal, ready to validate and commit
+     */
+    Result<FileLock> lock_for_write();
+    void publish();
+
+    Result<void> check_put(const CatalogEntry& entry) const;
+    Result<CatalogChanges> commit(nlohmann::json record);
+    Result<CatalogChanges> commit_all(std::vector<nlohmann::json> records, bool sync);
+    Result<void> apply(const nlohmann::json& record, CatalogChanges& changes);
+
+    void index_tokens(uint32_t slot);
+    void unindex_tokens(uint32_t slot);
+    void index_text(uint32_t slot);
+    void index_columns(uint32_t slot);
+    void reset_columns();
+    void join_group(uint32_t slot);
+    void leave_group(uint32_t slot);
+    std::vector<std::string> apply_group(const GroupEntry& group);
+    std::vector<std::string> matching(const std::vector<std::string>& literals,
+                                      const std::function<bool(const CatalogEntry&)>& accept) const;
+    void apply_put(const CatalogEntry& entry);
+    std::vector<std::string> apply_release(uint32_t slot);
+    std::vector<std::string> apply_remove(uint32_t slot);
+};
+
+std::string to_string(CapsuleState state);
+Result<CapsuleState> capsule_state_from_string(const std::string& str);
+
+} // namespace tcfs
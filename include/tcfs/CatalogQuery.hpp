@@ -0,0 +1,59 @@
+#pragma once
+
+#include "Catalog.hpp"
+#include "Errors.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace tcfs {
+
+/**
+ * @brief Filter over catalog fields, such as "label=Taxes,unlock<2030-01-01T00:00:00Z"
+ *
+ * Comma-separated terms that must all hold. Text fields (id, name, label,
+ * notes, owner, group) take = for an exact match, != for its negation and ~
+ * for a case-insensitive substring; name= is a shell glob. Time fields
+ * (unlock, expire) take <, <=, > and >= with an RFC 3339 time. state= is
+ * locked or released. Only catalog fields are consulted, so a query never
+ * opens .meta files, and private capsules match only on id and times.
+ */
+class CatalogQuery {
+public:
+    static Result<CatalogQuery> parse(const std::string& text);
+
+    bool empty() const { return terms_.empty(); }
+    bool matches(const CatalogEntry& entry) const;
+
+    /**
+     * @brief Matching live entries, in slot order
+     *
+     * A ~ term of three or more characters narrows the scan through the
+     * catalog's trigram index first.
+     */
+    std::vector<const CatalogEntry*> select(const Catalog& catalog) const;
+
+private:
+    enum class Op : uint8_t {
+        Equal,
+        NotEqual,
+        Contains,
+        Less,
+        LessEqual,
+        Greater,
+        GreaterEqual
+    };
+
+    struct Term {
+        std::string field;
+        Op op = Op::Equal;
+        std::string value;
+        int64_t time = 0; // Seconds since the Unix epoch, for time fields
+    };
+
+    std::vector<Term> terms_;
+
+    static const std::string* text_field(const CatalogEntry& entry, const std::string& field);
+};
+
+} // namespace tcfs
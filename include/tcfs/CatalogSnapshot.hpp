@@ -0,0 +1,62 @@
+#pragma once
+
+#include "Catalog.hpp"
+#include "Errors.hpp"
+#include "UnlockScheduler.hpp"
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+namespace tcfs {
+
+/**
+ * @brief Daemon snapshot configuration
+ */
+struct SnapshotOptions {
+    std::filesystem::path path;              // Snapshot file; empty disables snapshots
+    std::chrono::seconds interval{600};      // Rewrite at most this often while the catalog changes
+};
+
+/**
+ * @brief What a snapshot restores: the catalog and every scheduled unlock time
+ */
+struct SnapshotContents {
+    CatalogImage catalog;
+    std::vector<UnlockScheduler::Entry> schedule;
+};
+
+/**
+ * @brief Binary, checksummed image of the catalog and the unlock scheduler
+ *
+ * The file is a fixed header followed by fixed-size entry records, index
+ * arrays and a string heap, so loading maps it and copies records out
+ * instead of parsing the NDJSON journal and re-reading .meta files of
+ * capsules with schedule rules. The header records the journal offset and
+ * sequence the snapshot was taken at and a hash of the journal bytes just
+ * before that offset. A snapshot is only used if its checksum holds and the
+ * journal still has those bytes at that offset. Records appended since are
+ * replayed on top. A rewritten or truncated journal, a torn or corrupted file,
+ * or one from another version or byte order is rejected, and the caller
+ * rebuilds from the journal instead.
+ *
+ * The layout is native byte order; snapshots are a local cache, not a
+ * portable format.
+ */
+class CatalogSnapshot {
+public:
+    static constexpr uint32_t VERSION = 4;
+
+    /**
+     * @brief Write atomically (temporary file, fsync, rename)
+     */
+    static Result<void> save(const std::filesystem::path& path, const CatalogImage& catalog,
+                             const UnlockScheduler& scheduler, const std::filesystem::path& journal_path);
+
+    /**
+     * @brief Read and validate against the journal; fails if the snapshot cannot be trusted
+     */
+    static Result<SnapshotContents> load(const std::filesystem::path& path, const std::filesystem::path& journal_path);
+};
+
+} // namespace tcfs
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "Catalog.hpp"
+#include "Errors.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace tcfs {
+
+/**
+ * @brief Capsule count and ciphertext bytes of one label, owner or the whole store
+ */
+struct StatsTotal {
+    std::string key;
+    uint64_t capsules = 0;
+    uint64_t bytes = 0;
+};
+
+/**
+ * @brief Locked capsules whose unlock time falls in [start, start + bucket width)
+ */
+struct TimelineBucket {
+    int64_t start = 0; // Seconds since the Unix epoch
+    uint64_t capsules = 0;
+    uint64_t bytes = 0;
+};
+
+/**
+ * @brief Store statistics aggregated from the catalog's columns
+ *
+ * One pass over CatalogColumns fills every total. The loop body has no
+ * data-dependent branches: flags become 0/1 multipliers and out-of-range
+ * unlock times land in a spill bucket that is dropped afterwards, so the
+ * scan runs at memory speed however the capsules are distributed. No .meta
+ * file is opened; private capsules count under an empty label.
+ */
+class CatalogStats {
+public:
+    /**
+     * @brief Width in seconds of a bucket named hour, day or week
+     */
+    static Result<int64_t> bucket_seconds(const std::string& name);
+
+    /**
+     * @brief Totals of columns, with a timeline of bucket-wide buckets from from until until
+     *
+     * The timeline starts at from rounded down to a multiple of bucket; bucket 0 skips it.
+     */
+    static CatalogStats compute(const CatalogColumns& columns, int64_t from = 0, int64_t until = 0,
+                                int64_t bucket = 0);
+
+    /**
+     * @brief Sum of stats computed with the same timeline arguments, such as one per store
+     */
+    static CatalogStats combine(const std::vector<CatalogStats>& parts);
+
+    const StatsTotal& live() const { return live_; }
+    const StatsTotal& locked() const { return locked_; }
+    const StatsTotal& due() const { return due_; } // Locked capsules unlocking before from
+
+    const std::vector<TimelineBucket>& timeline() const { return timeline_; }
+
+    /**
+     * @brief Live capsules per label and per owner, largest first
+     */
+    const std::vector<StatsTotal>& by_label() const { return by_label_; }
+    const std::vector<StatsTotal>& by_owner() const { return by_owner_; }
+
+private:
+    StatsTotal live_;
+    StatsTotal locked_;
+    StatsTotal due_;
+    std::vector<TimelineBucket> timeline_;
+    std::vector<StatsTotal> by_label_;
+    std::vector<StatsTotal> by_owner_;
+};
+
+} // namespace tcfs
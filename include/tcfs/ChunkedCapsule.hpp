@@ -0,0 +1,148 @@
+#pragma once
+
+#include "CryptoProvider.hpp"
+#include "Errors.hpp"
+#include "Policy.hpp"
+#include <cstdint>
+#include <istream>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+namespace tcfs {
+
+/**
+ * @brief A contiguous plaintext range of a chunked capsule with its own key and policy
+ *
+ * Stages always start on a fresh segment, so segment k of a stage covers
+ * plaintext bytes [offset + k * segment_size, ...) and lives at
+ * file_offset + k * (segment_size + tag size) in the capsule file.
+ */
+struct CapsuleStage {
+    std::string name;
+    Policy policy;
+    uint64_t offset = 0;          // First plaintext byte
+    uint64_t length = 0;          // Plaintext bytes
+    uint64_t file_offset = 0;     // First byte of the stage's first segment
+    uint32_t first_segment = 0;   // Capsule-wide index of the stage's first segment
+    uint32_t segment_count = 0;
+    CryptoIV base_iv;
+    std::vector<uint8_t> key;     // Empty while the capsule is sealed and not opened
+};
+
+/**
+ * @brief Segment and stage table of a chunked capsule, stored in its metadata
+ */
+struct ChunkedLayout {
+    static constexpr const char* FORMAT = "chunked-v1";
+
+    uint32_t segment_size = 0;
+    uint64_t plaintext_size = 0;
+    std::vector<CapsuleStage> stages;
+    bool sealed = false;          // Stage keys are wrapped under a master key held in key slots
+
+    /**
+     * @brief Index of the stage named name
+     */
+    std::optional<size_t> find_stage(const std::string& name) const;
+
+    /**
+     * @brief Stages whose policy allows unlocking at now
+     */
+    std::vector<size_t> open_stages(const Policy::TimePoint& now) const;
+
+    /**
+     * @brief Stage table for the metadata; with a master key the stage keys are stored wrapped under it
+     */
+    nlohmann::json to_json(CryptoProvider& crypto, const CryptoKey* master = nullptr) const;
+
+    /**
+     * @brief Parse a stage table; wrapped stage keys are unwrapped with master, or left empty without one
+     */
+    static Result<ChunkedLayout> from_json(const nlohmann::json& json, CryptoProvider& crypto,
+                                           const CryptoKey* master = nullptr);
+};
+
+/**
+ * @brief Segmented AES-GCM capsule format with random access and time stages
+ *
+ * The file is an 8-byte magic followed by segments, each the ciphertext of up
+ * to segment_size plaintext bytes followed by its 16-byte tag. Every segment
+ * is sealed with its stage's key and a nonce derived from the stage base IV and
+ * the capsule-wide segment index, so segments cannot be reordered or moved
+ * between stages without failing authentication.
+ */
+class ChunkedCapsule {
+public:
+    static constexpr uint32_t DEFAULT_SEGMENT_SIZE = 64 * 1024;
+    static constexpr size_t HEADER_SIZE = 8;
+    static constexpr char MAGIC[HEADER_SIZE] = {'T', 'C', 'F', 'S', 'C', 'H', 'K', '1'};
+
+    /**
+     * @brief Requested stage; it covers plaintext from offset up to the next stage's offset
+     */
+    struct StageSpec {
+        std::string name;
+        Policy policy;
+        uint64_t offset = 0;
+    };
+
+    /**
+     * @brief Encrypt input_size bytes from input into output
+     *
+     * The first stage must start at offset 0 and offsets must increase.
+     */
+    static Result<ChunkedLayout> write(CryptoProvider& crypto, std::istream& input, uint64_t input_size,
+                                       std::ostream& output, const std::vector<StageSpec>& stages,
+                                       uint32_t segment_size = DEFAULT_SEGMENT_SIZE);
+
+    /**
+     * @brief Stage table for input_size bytes, with fresh stage keys and base IVs, before anything is written
+     */
+    static Result<ChunkedLayout> plan(CryptoProvider& crypto, uint64_t input_size, const std::vector<StageSpec>& stages,
+                                      uint32_t segment_size = DEFAULT_SEGMENT_SIZE);
+
+    /**
+     * @brief Encrypt the capsule-wide segments [first, last) of a planned layout
+     *
+     * input must be at the plaintext of segment first and output at its place
+     * in the capsule file (see segment_offsets). Since keys and nonces come
+     * from the layout, a write can stop after any segment and go on later.
+     */
+    static Result<void> write_segments(CryptoProvider& crypto, std::istream& input, std::ostream& output,
+                                       const ChunkedLayout& layout, uint32_t first, uint32_t last);
+
+    static uint32_t segment_count(const ChunkedLayout& layout);
+
+    /**
+     * @brief Plaintext offset and capsule file offset of a segment; segment_count() gives the ends
+     */
+    static std::pair<uint64_t, uint64_t> segment_offsets(const ChunkedLayout& layout, uint32_t segment);
+
+    /**
+     * @brief Decrypt length bytes starting at offset within one stage
+     *
+     * Only the segments overlapping the range are read and authenticated.
+     */
+    static Result<std::vector<uint8_t>> read(CryptoProvider& crypto, std::istream& capsule,
+                                             const ChunkedLayout& layout, size_t stage,
+                                             uint64_t offset, uint64_t length);
+
+    static Result<std::vector<uint8_t>> read_stage(CryptoProvider& crypto, std::istream& capsule,
+                                                   const ChunkedLayout& layout, size_t stage);
+
+    /**
+     * @brief Nonce of a segment: the base IV with its last 4 bytes XORed with the big-endian index
+     */
+    static CryptoIV segment_iv(const CryptoIV& base_iv, uint32_t segment_index);
+
+    /**
+     * @brief Bytes a stage occupies in the capsule file
+     */
+    static uint64_t stage_file_size(const CapsuleStage& stage);
+};
+
+} // namespace tcfs
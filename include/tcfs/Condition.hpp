@@ -0,0 +1,87 @@
+#pragma once
+
+#include "Errors.hpp"
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+namespace tcfs {
+
+/**
+ * @brief Opcodes of the compiled condition program
+ *
+ * Leaf opcodes push one boolean, And/Or pop two and push one, Not flips the top.
+ */
+enum class ConditionOp : uint8_t {
+    Const,       // push a
+    After,       // push now >= a
+    Before,      // push now < a
+    Between,     // push a <= now < b
+    Weekday,     // push bit (weekday of now) of mask a, Sunday = bit 0
+    TimeOfDay,   // push seconds-of-day of now in [a, b), wrapping past midnight if a > b
+    LabelEquals, // push label_hash == a
+    And,
+    Or,
+    Not
+};
+
+/**
+ * @brief Single instruction of a condition program
+ */
+struct ConditionInstr {
+    ConditionOp op = ConditionOp::Const;
+    int64_t a = 0;
+    int64_t b = 0;
+};
+
+/**
+ * @brief Inputs a condition program is evaluated against
+ */
+struct ConditionContext {
+    int64_t now = 0;         // Seconds since the Unix epoch (UTC)
+    uint64_t label_hash = 0; // Condition::hash_label() of the capsule label
+
+    static ConditionContext make(const std::chrono::system_clock::time_point& now, const std::string& label);
+};
+
+/**
+ * @brief Compound unlock condition compiled to a flat postfix program
+ *
+ * JSON grammar:
+ *   {"all": [c, ...]}, {"any": [c, ...]}, {"not": c}
+ *   {"after": "<RFC3339>"}, {"before": "<RFC3339>"}
+ *   {"window": {"from": "<RFC3339>", "to": "<RFC3339>"}}
+ *   {"weekdays": ["mon", "tue", ...]}
+ *   {"time_of_day": {"from": "HH:MM", "to": "HH:MM"}}   (UTC)
+ *   {"label": "<text>"}
+ *
+ * Evaluation keeps the operand stack in the bits of a single register, so a
+ * program runs without allocation and without data-dependent branches.
+ */
+class Condition {
+public:
+    static constexpr size_t MAX_STACK_DEPTH = 64;
+
+    Condition() = default;
+
+    static Result<Condition> from_json(const nlohmann::json& json);
+    nlohmann::json to_json() const { return source_; }
+
+    bool empty() const { return program_.empty(); }
+    const std::vector<ConditionInstr>& program() const { return program_; }
+
+    /**
+     * @brief Evaluate the program; an empty condition is always satisfied
+     */
+    bool evaluate(const ConditionContext& ctx) const;
+
+    static uint64_t hash_label(const std::string& label);
+
+private:
+    std::vector<ConditionInstr> program_;
+    nlohmann::json source_;
+};
+
+} // namespace tcfs
@@ -101,6 +101,28 @@ public:
     
     // Key derivation
     virtual CryptoKey deriveKey(const std::string& password, const CryptoSalt& salt, const KDFParams& params) = 0;
+    virtual CryptoKey hkdfSha256(const CryptoKey& ikm, const std::vector<uint8_t>& salt, const std::string& info,
+                                 size_t length) = 0;
+    
+    // Key agreement (X25519)
+    virtual CryptoKey generateX25519PrivateKey() = 0;
+    virtual std::vector<uint8_t> x25519PublicKey(const CryptoKey& private_key) = 0;
+    virtual CryptoKey x25519(const CryptoKey& private_key, const std::vector<uint8_t>& peer_public) = 0;
+    
+    // Signatures (Ed25519)
+    virtual CryptoKey generateEd25519PrivateKey() = 0;
+    virtual std::vector<uint8_t> ed25519PublicKey(const CryptoKey& private_key) = 0;
+    virtual std::vector<uint8_t> ed25519Sign(const CryptoKey& private_key, const std::vector<uint8_t>& message) = 0;
+    virtual bool ed25519Verify(const std::vector<uint8_t>& public_key, const std::vector<uint8_t>& message,
+                               const std::vector<uint8_t>& signature) = 0;
+    /**
+     * @brief Verify many messages signed by one key; entry i tells whether signatures[i] is valid
+     *
+     * The public key is decoded once for the whole batch. A bad key fails every entry.
+     */
+    virtual std::vector<bool> ed25519VerifyBatch(const std::vector<uint8_t>& public_key,
+                                                 const std::vector<std::vector<uint8_t>>& messages,
+                                                 const std::vector<std::vector<uint8_t>>& signatures) = 0;
     
     // Encryption/Decryption
     virtual EncryptedData encrypt(const std::vector<uint8_t>& plaintext, const CryptoKey& key, const CryptoIV& iv) = 0;
@@ -108,6 +130,7 @@ public:
     
     // Hashing
     virtual std::vector<uint8_t> sha256(const std::vector<uint8_t>& data) = 0;
+    virtual std::vector<uint8_t> hmacSha256(const CryptoKey& key, const std::vector<uint8_t>& data) = 0;
     
     // Utility
     virtual std::string toHex(const std::vector<uint8_t>& data) = 0;
@@ -121,6 +144,9 @@ public:
     static constexpr size_t AES_GCM_TAG_SIZE = 16;
     static constexpr size_t SHA256_DIGEST_SIZE = 32;
     static constexpr size_t DEFAULT_SALT_SIZE = 32;
+    static constexpr size_t X25519_KEY_SIZE = 32;
+    static constexpr size_t ED25519_KEY_SIZE = 32;
+    static constexpr size_t ED25519_SIGNATURE_SIZE = 64;
 };
 
 /**
@@ -137,11 +163,27 @@ public:
     CryptoSalt generateSalt() override;
     
     CryptoKey deriveKey(const std::string& password, const CryptoSalt& salt, const KDFParams& params) override;
+    CryptoKey hkdfSha256(const CryptoKey& ikm, const std::vector<uint8_t>& salt, const std::string& info,
+                         size_t length) override;
+    
+    CryptoKey generateX25519PrivateKey() override;
+    std::vector<uint8_t> x25519PublicKey(const CryptoKey& private_key) override;
+    CryptoKey x25519(const CryptoKey& private_key, const std::vector<uint8_t>& peer_public) override;
+    
+    CryptoKey generateEd25519PrivateKey() override;
+    std::vector<uint8_t> ed25519PublicKey(const CryptoKey& private_key) override;
+    std::vector<uint8_t> ed25519Sign(const CryptoKey& private_key, const std::vector<uint8_t>& message) override;
+    bool ed25519Verify(const std::vector<uint8_t>& public_key, const std::vector<uint8_t>& message,
+                       const std::vector<uint8_t>& signature) override;
+    std::vector<bool> ed25519VerifyBatch(const std::vector<uint8_t>& public_key,
+                                         const std::vector<std::vector<uint8_t>>& messages,
+                                         const std::vector<std::vector<uint8_t>>& signatures) override;
     
     EncryptedData encrypt(const std::vector<uint8_t>& plaintext, const CryptoKey& key, const CryptoIV& iv) override;
     std::vector<uint8_t> decrypt(const EncryptedData& encrypted, const CryptoKey& key, const CryptoIV& iv) override;
     
     std::vector<uint8_t> sha256(const std::vector<uint8_t>& data) override;
+    std::vector<uint8_t> hmacSha256(const CryptoKey& key, const std::vector<uint8_t>& data) override;
     
     std::string toHex(const std::vector<uint8_t>& data) override;
     std::vector<uint8_t> fromHex(const std::string& hex) override;
@@ -0,0 +1,150 @@
+#pragma once
+
+#include "CatalogSnapshot.hpp"
+#include "Errors.hpp"
+#include "EventServer.hpp"
+#include "InboxWatcher.hpp"
+#include "Prefetcher.hpp"
+#include "ReleaseQueue.hpp"
+#include "Store.hpp"
+#include "Sweeper.hpp"
+#include "UnlockScheduler.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace tcfs {
+
+/**
+ * @brief Daemon configuration
+ */
+struct DaemonOptions {
+    std::filesystem::path release_dir;          // When set, released capsules are decrypted here
+    std::chrono::seconds poll_interval{60};     // Longest sleep between catalog refreshes
+    std::chrono::seconds recheck_interval{60};  // Retry delay for capsules whose condition is false
+    std::function<void(const std::string&)> log; // Optional diagnostics sink
+    SweeperOptions sweeper;                     // Throttling of expired-capsule destruction
+    ReleaseQueueOptions release;                // Concurrency, priorities, jitter and I/O budget of releases
+    PrefetchOptions prefetch;                   // Page-cache warming ahead of unlock times
+    TierOptions tiers;                          // Hot/cold migration by unlock time
+    InboxOptions inbox;                         // Watch folder whose files are locked automatically
+    EventOptions events;                        // Socket pushing lock/release notifications to subscribers
+    SnapshotOptions snapshot;                   // Catalog and schedule image for fast restarts
+};
+
+/**
+ * @brief Long-running process that releases capsules when they become due
+ *
+ * Capsules are indexed by next unlock opportunity; the loop sleeps until the
+ * earliest one. Releasing a capsule walks only its dependents in the catalog
+ * DAG, and dependents that are already due are released in the same pass.
+ * Expired capsules are destroyed by a Sweeper in throttled batches. Due
+ * capsules pass through a ReleaseQueue, so a mass-unlock event is drained
+ * with bounded concurrency and I/O instead of all at once. Capsules due
+ * within the prefetch horizon have their ciphertext read ahead, and when
+ * tiering is enabled far-future capsules are moved to the cold tier. Files
+ * dropped into the inbox are locked in group-committed batches. Every lock,
+ * release and destruction is published on an EventBus, which the
+ * EventServer streams to socket subscribers. With a snapshot configured,
+ * start() restores the catalog and schedule from it and replays only the
+ * journal records written since, instead of rebuilding every timer.
+ */
+class Daemon {
+public:
+    using TimePoint = UnlockScheduler::TimePoint;
+    using ReleaseListener = std::function<void(const std::string& capsule_id)>;
+
+    Daemon(Store& store, DaemonOptions options = {});
+
+    /**
+     * @brief Load the catalog and schedule every locked capsule
+     *
+     * Uses the snapshot when it is consistent with the journal and falls back
+     * to a full rebuild otherwise.
+     */
+    Result<void> start();
+
+    /**
+     * @brief Write the catalog and schedule to the snapshot file
+     */
+    Result<void> save_snapshot();
+    bool restored_from_snapshot() const { return restored_from_snapshot_; }
+
+    /**
+     * @brief Pick up catalog changes made by other processes
+     */
+    Result<void> refresh(const TimePoint& now);
+
+    /**
+     * @brief Lock every file ready in the inbox, in batches; returns the number locked
+     *
+     * Ingested files are securely deleted once their capsule is committed.
+     */
+    size_t ingest(const TimePoint& now);
+
+    /**
+     * @brief Ingest the inbox, destroy one batch of expired capsules, then release what is due at
+     *        now as far as the release queue admits, then run one tier
+     *        migration pass; returns the number released
+     */
+    size_t tick(const TimePoint& now);
+
+    /**
+     * @brief Run until stop() is called
+     */
+    void run();
+
+    /**
+     * @brief Ask run() to return; safe to call from a signal handler
+     */
+    void stop() { stop_requested_.store(true); }
+
+    void set_release_listener(ReleaseListener listener) { on_release_ = std::move(listener); }
+
+    const UnlockScheduler& scheduler() const { return scheduler_; }
+    const Sweeper& sweeper() const { return sweeper_; }
+    const ReleaseQueue& release_queue() const { return queue_; }
+    const Prefetcher& prefetcher() const { return prefetcher_; }
+    const InboxWatcher& inbox() const { return inbox_; }
+    EventBus& events() { return events_; }
+    const EventServer& event_server() const { return event_server_; }
+
+private:
+    Store& store_;
+    DaemonOptions options_;
+    UnlockScheduler scheduler_;
+    Sweeper sweeper_;
+    ReleaseQueue queue_;
+    Prefetcher prefetcher_;
+    InboxWatcher inbox_;
+    EventBus events_;
+    EventServer event_server_;
+    ReleaseListener on_release_;
+    std::unordered_map<std::string, std::vector<size_t>> released_stages_; // Staged capsules still partly locked; in memory only
+    TimePoint next_tier_pass_{};
+    TimePoint next_snapshot_{};
+    uint64_t snapshot_sequence_ = 0;
+    bool restored_from_snapshot_ = false;
+    std::atomic<bool> stop_requested_{false};
+    std::mutex wait_mutex_;
+    std::condition_variable wait_cv_;
+
+    bool restore_snapshot(const TimePoint& now);
+    void schedule(const CatalogEntry& entry, const TimePoint& now);
+    void admit(const std::string& id, const TimePoint& due, const TimePoint& now);
+    void wait_until(const TimePoint& wake);
+    void migrate_tiers(const TimePoint& now);
+    Result<void> write_release_files(const std::string& id, const TimePoint& now);
+    Result<std::vector<std::string>> complete_release(const std::string& id, const TimePoint& now);
+    void publish(std::string type, const CatalogEntry& entry, const TimePoint& now);
+    static Result<void> write_release(const std::filesystem::path& path, const Result<std::vector<uint8_t>>& plaintext);
+    void log(const std::string& message) const;
+};
+
+} // namespace tcfs
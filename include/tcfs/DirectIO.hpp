@@ -0,0 +1,157 @@
+#pragma once
+
+#include "Errors.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <streambuf>
+#include <vector>
+
+namespace tcfs {
+
+/**
+ * @brief Reusable I/O buffers aligned for O_DIRECT
+ *
+ * Every buffer starts on an ALIGNMENT boundary and is a multiple of ALIGNMENT
+ * long, so it can go to O_DIRECT reads and writes as it is. With huge_pages
+ * the buffers are mapped from 2 MiB pages when the kernel has some reserved
+ * (MAP_HUGETLB), and otherwise advised to be backed by transparent huge
+ * pages. Buffers hold plaintext, so they are wiped on release; up to capacity
+ * of them are then kept for the next acquire(). acquire() never blocks.
+ */
+class BufferPool {
+public:
+    static constexpr size_t ALIGNMENT = 4096;
+    static constexpr size_t DEFAULT_BUFFER_SIZE = 1024 * 1024;
+    static constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+    /**
+     * @brief A buffer on loan from the pool; returned when destroyed, so it must not outlive the pool
+     */
+    class Buffer {
+    public:
+        Buffer() = default;
+        Buffer(Buffer&& other) noexcept;
+        Buffer& operator=(Buffer&& other) noexcept;
+        Buffer(const Buffer&) = delete;
+        Buffer& operator=(const Buffer&) = delete;
+        ~Buffer();
+
+        uint8_t* data() const { return data_; }
+        size_t size() const { return size_; }
+
+    private:
+        friend class BufferPool;
+        Buffer(BufferPool* pool, uint8_t* data, size_t size, bool mapped)
+            : pool_(pool), data_(data), size_(size), mapped_(mapped) {}
+
+        BufferPool* pool_ = nullptr;
+        uint8_t* data_ = nullptr;
+        size_t size_ = 0;
+        bool mapped_ = false;
+    };
+
+    /**
+     * @brief Buffers of buffer_size bytes, rounded up to ALIGNMENT (or HUGE_PAGE_SIZE with huge_pages)
+     */
+    explicit BufferPool(size_t buffer_size = DEFAULT_BUFFER_SIZE, size_t capacity = 16, bool huge_pages = false);
+    ~BufferPool();
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    Buffer acquire();
+
+    size_t buffer_size() const { return buffer_size_; }
+    bool huge_pages() const { return huge_pages_; }
+
+    /**
+     * @brief Buffers currently allocated, on loan or idle
+     */
+    size_t allocated() const;
+
+private:
+    struct Block {
+        uint8_t* data = nullptr;
+        bool mapped = false;
+    };
+
+    size_t buffer_size_;
+    size_t capacity_;
+    bool huge_pages_;
+    mutable std::mutex mutex_;
+    std::vector<Block> idle_;
+    size_t allocated_ = 0;
+
+    Block allocate() const;
+    void deallocate(const Block& block) const;
+    void release(Block block);
+};
+
+/**
+ * @brief Stream buffer that reads or writes a file around the page cache
+ *
+ * Whole pool buffers move at aligned offsets with O_DIRECT, so bulk locking
+ * neither evicts other processes' cached pages nor copies through the kernel.
+ * A writer pads its last block and truncates the file back to its length on
+ * close(). When the filesystem refuses O_DIRECT (tmpfs, some network
+ * filesystems), or direct is false, the same buffers go through ordinary
+ * reads and writes, and each range is dropped from the page cache with
+ * posix_fadvise(POSIX_FADV_DONTNEED) once done; written ranges are flushed
+ * first, since dirty pages cannot be dropped. Use it through std::istream or
+ * std::ostream; readers can seek. A writer opened at an offset keeps the
+ * file's first offset bytes and continues after them.
+ */
+class DirectFile : public std::streambuf {
+public:
+    enum class Mode {
+        Read,
+        Write
+    };
+
+    static Result<std::unique_ptr<DirectFile>> open(const std::filesystem::path& path, Mode mode, BufferPool& pool,
+                                                    bool direct = true, uint64_t offset = 0);
+    ~DirectFile() override;
+    DirectFile(const DirectFile&) = delete;
+    DirectFile& operator=(const DirectFile&) = delete;
+
+    /**
+     * @brief Whether the file really bypasses the page cache, or uses the fadvise fallback
+     */
+    bool direct() const { return direct_; }
+
+    /**
+     * @brief Bytes of a writer already handed to the file; the rest is still in the buffer
+     */
+    uint64_t flushed() const { return buffer_offset_; }
+
+    /**
+     * @brief Write out what is buffered and close; the file's length is then exactly what was written
+     */
+    Result<void> close();
+
+protected:
+    int_type underflow() override;
+    int_type overflow(int_type ch) override;
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override;
+    pos_type seekpos(pos_type pos, std::ios_base::openmode which) override;
+    int sync() override;
+
+private:
+    DirectFile(int fd, Mode mode, BufferPool::Buffer buffer, bool direct, std::filesystem::path path);
+
+    bool fill(uint64_t offset);
+    bool resume_at(uint64_t offset);
+    bool flush(bool last);
+    void drop_cached(uint64_t offset, uint64_t length, bool written);
+
+    int fd_;
+    Mode mode_;
+    BufferPool::Buffer buffer_;
+    bool direct_;
+    std::filesystem::path path_;
+    uint64_t buffer_offset_ = 0; // File offset of the buffer's first byte
+};
+
+} // namespace tcfs
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "Catalog.hpp"
+#include "Errors.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+namespace tcfs {
+
+/**
+ * @brief What happens to a subscriber whose queue is full
+ */
+enum class SlowConsumerPolicy {
+    Coalesce,   // Drop the oldest queued events and report how many were skipped
+    Disconnect  // Drop the subscriber
+};
+
+/**
+ * @brief Capsule lifecycle notification
+ */
+struct CapsuleEvent {
+    std::string type;        // "locked", "updated", "released", "destroyed" or "removed"
+    std::string capsule_id;
+    std::string label;
+    std::string owner;
+    int64_t unlock_at = 0;   // Seconds since the Unix epoch; 0 when unknown
+    int64_t time = 0;        // Seconds since the Unix epoch
+    uint64_t seq = 0;        // Assigned by the bus, increasing
+
+    static CapsuleEvent from_entry(std::string type, const CatalogEntry& entry, int64_t time);
+
+    nlohmann::json to_json() const;
+};
+
+/**
+ * @brief Subscription filter; an empty list matches anything
+ */
+struct EventFilter {
+    std::vector<std::string> types;
+    std::vector<std::string> labels;
+    std::vector<std::string> owners;
+    std::vector<std::string> capsule_ids;
+
+    bool matches(const CapsuleEvent& event) const;
+
+    nlohmann::json to_json() const;
+    static Result<EventFilter> from_json(const nlohmann::json& json);
+};
+
+/**
+ * @brief Events handed to one subscriber
+ */
+struct EventDelivery {
+    std::vector<CapsuleEvent> events;
+    uint64_t skipped = 0;      // Events coalesced away since the last delivery
+    bool disconnected = false; // The subscriber was dropped for falling behind
+};
+
+/**
+ * @brief Fans capsule events out to filtered subscribers
+ *
+ * Each subscriber has its own queue of at most max_buffered events, so one
+ * consumer that stops reading costs bounded memory and never holds up the
+ * publisher or the other subscribers. Publishing only appends to the queues
+ * of matching subscribers; the notify hook tells the reader side to drain.
+ * Thread-safe.
+ */
+class EventBus {
+public:
+    using SubscriberId = uint64_t;
+
+    explicit EventBus(size_t max_buffered = 1024, SlowConsumerPolicy policy = SlowConsumerPolicy::Coalesce);
+
+    EventBus(const EventBus&) = delete;
+    EventBus& operator=(const EventBus&) = delete;
+
+    SubscriberId subscribe(EventFilter filter);
+    void set_filter(SubscriberId id, EventFilter filter);
+    void unsubscribe(SubscriberId id);
+
+    /**
+     * @brief Queue event for every matching subscriber; returns its sequence number
+     */
+    uint64_t publish(CapsuleEvent event);
+
+    /**
+     * @brief Remove up to max queued events of a subscriber
+     */
+    EventDelivery take(SubscriberId id, size_t max);
+
+    /**
+     * @brief Called after a publish queued an event for at least one subscriber
+     *
+     * Runs on the publishing thread with no lock held.
+     */
+    void set_notify(std::function<void()> notify);
+
+    size_t subscribers() const;
+    size_t pending(SubscriberId id) const;
+    uint64_t last_seq() const;
+    size_t max_buffered() const { return max_buffered_; }
+
+private:
+    struct Subscriber {
+        EventFilter filter;
+        std::deque<CapsuleEvent> queue;
+        uint64_t skipped = 0;
+        bool disconnected = false;
+    };
+
+    size_t max_buffered_;
+    SlowConsumerPolicy policy_;
+    mutable std::mutex mutex_;
+    std::unordered_map<SubscriberId, Subscriber> subscribers_;
+    SubscriberId next_id_ = 1;
+    uint64_t seq_ = 0;
+    std::function<void()> notify_;
+};
+
+} // namespace tcfs
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "Errors.hpp"
+#include "EventBus.hpp"
+#include <atomic>
+#include <cstddef>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <thread>
+#include <nlohmann/json.hpp>
+
+namespace tcfs {
+
+/**
+ * @brief Event subscription configuration
+ */
+struct EventOptions {
+    std::filesystem::path socket;                 // Unix socket to serve subscriptions on; empty disables it
+    size_t max_buffered = 1024;                   // Events queued per subscriber before slow_consumers applies
+    SlowConsumerPolicy slow_consumers = SlowConsumerPolicy::Coalesce;
+    size_t max_subscribers = 64;                  // Further connections are closed on accept
+    size_t max_pending_bytes = 1024 * 1024;       // Unsent replies and events per client before it is disconnected
+    std::function<void(const std::string&)> log;  // Optional diagnostics sink
+};
+
+/**
+ * @brief Serves an EventBus to clients of a Unix socket
+ *
+ * A client sends one NDJSON line {"subscribe": {"types": [...], "labels":
+ * [...], "owners": [...], "ids": [...]}} and gets {"type": "subscribed",
+ * "seq": n} back, followed by one line per matching event with a sequence
+ * number above n. Sending another subscribe line replaces the filter. When
+ * the client falls behind, skipped events are reported as {"type":
+ * "overflow", "skipped": k}, or the connection ends with {"type":
+ * "disconnected"} under SlowConsumerPolicy::Disconnect. A client that keeps
+ * sending requests without reading the replies is disconnected once more
+ * than max_pending_bytes of output wait for it.
+ *
+ * One thread runs an epoll loop over the listening socket, the clients and an
+ * eventfd the bus signals on publish, so the publisher never touches a socket
+ * and never waits for a reader. Linux only; start() fails elsewhere.
+ */
+class EventServer {
+public:
+    static constexpr size_t MAX_REQUEST_LINE = 64 * 1024;
+    static constexpr size_t EVENTS_PER_WRITE = 256;
+
+    EventServer(EventBus& bus, EventOptions options);
+    ~EventServer();
+
+    EventServer(const EventServer&) = delete;
+    EventServer& operator=(const EventServer&) = delete;
+
+    /**
+     * @brief Bind the socket (replacing a stale one) and start the event loop
+     */
+    Result<void> start();
+
+    /**
+     * @brief Close every connection, stop the loop and remove the socket
+     */
+    void stop();
+
+    bool is_running() const { return running_.load(); }
+    size_t connections() const { return connections_.load(); }
+    const std::filesystem::path& socket_path() const { return options_.socket; }
+
+private:
+    EventBus& bus_;
+    EventOptions options_;
+    int listen_fd_ = -1;
+    int epoll_fd_ = -1;
+    int wake_fd_ = -1;
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+    std::atomic<bool> stopping_{false};
+    std::atomic<size_t> connections_{0};
+
+    void loop();
+    void wake();
+    void close_descriptors();
+    void log(const std::string& message) const;
+};
+
+/**
+ * @brief Subscribe to a daemon's event socket and hand every line to on_event
+ *
+ * Blocks until on_event returns false (success) or the daemon closes the
+ * connection (error).
+ */
+Result<void> subscribe_events(const std::filesystem::path& socket, const EventFilter& filter,
+                              const std::function<bool(const nlohmann::json&)>& on_event);
+
+} // namespace tcfs
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "Errors.hpp"
+#include <cstddef>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <queue>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace tcfs {
+
+/**
+ * @brief Several stores queried as one
+ *
+ * A federation is named either by a list of store directories separated by
+ * SEPARATOR, as in PATH (':', or ';' on Windows; a drive letter such as
+ * C:\caps is never split), or by a JSON config file {"stores": [...]} whose
+ * relative entries are taken from the file's directory. Queries run against
+ * every store at once, and each store's ordered results are k-way merged
+ * under a global limit, so no store contributes more than limit rows.
+ */
+class Federation {
+public:
+#ifdef _WIN32
+    static constexpr char SEPARATOR = ';';
+#else
+    static constexpr char SEPARATOR = ':';
+#endif
+    static constexpr const char* STORES_FIELD = "stores";
+
+    /**
+     * @brief Store roots named by spec: a SEPARATOR-joined list, a config file, or a single store
+     */
+    static Result<std::vector<std::filesystem::path>> resolve(const std::string& spec);
+    static Result<std::vector<std::filesystem::path>> read_config(const std::filesystem::path& path);
+
+    /**
+     * @brief fn(root) for every root, one thread per store; results in root order
+     *
+     * An exception thrown by fn is rethrown here after every store has finished.
+     */
+    template <typename Fn>
+    static auto fan_out(const std::vector<std::filesystem::path>& roots, Fn fn)
+        -> std::vector<decltype(fn(std::declval<const std::filesystem::path&>()))> {
+        using T = decltype(fn(std::declval<const std::filesystem::path&>()));
+        std::vector<std::future<T>> pending;
+        pending.reserve(roots.size());
+        for (const auto& root : roots) {
+            pending.push_back(std::async(std::launch::async, [&fn, &root] { return fn(root); }));
+        }
+        for (auto& future : pending) {
+            future.wait();
+        }
+        std::vector<T> results;
+        results.reserve(roots.size());
+        for (auto& future : pending) {
+            results.push_back(future.get());
+        }
+        return results;
+    }
+
+    /**
+     * @brief K-way merge of runs each sorted by less, as (run index, item); at most limit items (0 for all)
+     *
+     * Ties keep run order, so equal items from the first store come first.
+     */
+    template <typename T, typename Less>
+    static std::vector<std::pair<size_t, T>> merge(std::vector<std::vector<T>> runs, Less less, size_t limit = 0) {
+        using Cursor = std::pair<size_t, size_t>; // Run and position
+        auto later = [&runs, &less](const Cursor& a, const Cursor& b) {
+            const auto& x = runs[a.first][a.second];
+            const auto& y = runs[b.first][b.second];
+            if (less(y, x)) {
+                return true;
+            }
+            return !less(x, y) && b.first < a.first;
+        };
+        std::priority_queue<Cursor, std::vector<Cursor>, decltype(later)> heads(later);
+        for (size_t run = 0; run < runs.size(); ++run) {
+            if (!runs[run].empty()) {
+                heads.emplace(run, 0);
+            }
+        }
+        std::vector<std::pair<size_t, T>> merged;
+        while (!heads.empty() && (limit == 0 || merged.size() < limit)) {
+            auto [run, position] = heads.top();
+            heads.pop();
+            merged.emplace_back(run, std::move(runs[run][position]));
+            if (position + 1 < runs[run].size()) {
+                heads.emplace(run, position + 1);
+            }
+        }
+        return merged;
+    }
+};
+
+} // namespace tcfs
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "Errors.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+namespace tcfs {
+
+/**
+ * @brief Exclusive advisory lock, held until the object is destroyed or released
+ *
+ * Every acquisition opens the lock file anew and locks that open file
+ * description (flock for whole files, OFD byte-range locks on Linux), so a
+ * lock excludes other threads of the same process as well as other
+ * processes, and the kernel drops it if the holder dies. Byte-range locks on
+ * different offsets of one file do not contend, which gives cheap sharded
+ * locking from a single file. On platforms without these primitives locking
+ * succeeds without excluding anyone.
+ */
+class FileLock {
+public:
+    FileLock() = default;
+    ~FileLock();
+
+    FileLock(FileLock&& other) noexcept;
+    FileLock& operator=(FileLock&& other) noexcept;
+    FileLock(const FileLock&) = delete;
+    FileLock& operator=(const FileLock&) = delete;
+
+    /**
+     * @brief Block until the whole file (created if missing) is locked
+     */
+    static Result<FileLock> exclusive(const std::filesystem::path& path);
+
+    /**
+     * @brief Block until the single byte at offset is locked
+     */
+    static Result<FileLock> range(const std::filesystem::path& path, uint64_t offset);
+
+    bool is_held() const { return fd_ >= 0; }
+    void release();
+
+private:
+    int fd_ = -1;
+
+    explicit FileLock(int fd) : fd_(fd) {}
+};
+
+/**
+ * @brief Shard of key among shards, stable across processes and runs
+ */
+size_t lock_shard(const std::string& key, size_t shards);
+
+} // namespace tcfs
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <filesystem>
+
+namespace tcfs {
+
+/**
+ * @brief Flush a file, or on POSIX a directory's entries, to stable storage
+ *
+ * Returns false if the path cannot be opened or the flush fails. A no-op that
+ * succeeds on platforms without fsync.
+ */
+bool sync_path(const std::filesystem::path& path);
+
+} // namespace tcfs
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "Errors.hpp"
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace tcfs {
+
+/**
+ * @brief Watch-folder ingestion configuration
+ */
+struct InboxOptions {
+    std::filesystem::path dir;                       // Directory to watch; empty disables ingestion
+    std::chrono::seconds lock_for{30 * 24 * 3600};   // Unlock time of ingested files, relative to ingestion
+    std::string label;                               // Label given to ingested capsules
+    size_t batch_size = 512;                         // Files locked per group commit
+    std::chrono::milliseconds coalesce{50};          // Keep gathering events this long before locking
+    size_t workers = 4;                              // Files encrypted in parallel
+};
+
+/**
+ * @brief Reports files in a directory once their writers have finished
+ *
+ * On Linux this is inotify: a file is ready on IN_CLOSE_WRITE, or on
+ * IN_MOVED_TO when it is renamed into place, so nothing is picked up
+ * half-written and no polling loop runs. Repeated events for one file are
+ * coalesced. Elsewhere the directory is rescanned on each wait and a file is
+ * ready once its size and modification time hold still between two scans.
+ * Hidden files (leading dot) are ignored so writers can stage under a
+ * temporary name.
+ */
+class InboxWatcher {
+public:
+    explicit InboxWatcher(std::filesystem::path dir);
+    ~InboxWatcher();
+
+    InboxWatcher(const InboxWatcher&) = delete;
+    InboxWatcher& operator=(const InboxWatcher&) = delete;
+
+    /**
+     * @brief Create the directory, start watching and queue files already in it
+     */
+    Result<void> start();
+    void stop();
+
+    bool is_running() const { return running_; }
+    bool uses_notifications() const { return fd_ >= 0; }
+    const std::filesystem::path& dir() const { return dir_; }
+
+    /**
+     * @brief Block up to timeout for files to become ready; returns true if any are pending
+     */
+    bool wait(std::chrono::milliseconds timeout);
+
+    /**
+     * @brief Ready files in arrival order, at most max of them
+     */
+    std::vector<std::filesystem::path> take(size_t max);
+    size_t pending() const { return pending_.size(); }
+
+private:
+    std::filesystem::path dir_;
+    int fd_ = -1;
+    int watch_ = -1;
+    bool running_ = false;
+
+    std::deque<std::filesystem::path> pending_;
+    std::unordered_set<std::string> queued_;
+
+    // Scan fallback: last size/mtime seen per name, and the signature already queued
+    struct Signature {
+        uintmax_t size = 0;
+        std::filesystem::file_time_type mtime;
+        bool operator==(const Signature& other) const { return size == other.size && mtime == other.mtime; }
+    };
+    std::unordered_map<std::string, Signature> seen_;
+    std::unordered_map<std::string, Signature> reported_;
+
+    void enqueue(const std::string& name);
+    void drain_events();
+    void scan(bool require_stable);
+};
+
+} // namespace tcfs
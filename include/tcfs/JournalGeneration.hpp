@@ -0,0 +1,60 @@
+#pragma once
+
+#include "Errors.hpp"
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+
+namespace tcfs {
+
+/**
+ * @brief Seqlock header shared by every process using a journal
+ *
+ * A small file mapped MAP_SHARED holds a generation counter and the end
+ * offset and sequence number of the last complete commit. Writers update it
+ * while holding the journal lock: the generation is odd during the update and
+ * moves to the next even value once the new offset is visible. Readers take
+ * no lock. They read the generation, the fields, then the generation again,
+ * and retry if it was odd or moved. So a reader never replays half of a
+ * group commit, and when nothing was committed, finding that out costs two
+ * loads from shared memory.
+ */
+class JournalGeneration {
+public:
+    struct State {
+        uint64_t generation = 0;
+        uint64_t committed_offset = 0;
+        uint64_t sequence = 0;
+    };
+
+    JournalGeneration() = default;
+    ~JournalGeneration();
+
+    JournalGeneration(const JournalGeneration&) = delete;
+    JournalGeneration& operator=(const JournalGeneration&) = delete;
+    JournalGeneration(JournalGeneration&& other) noexcept;
+    JournalGeneration& operator=(JournalGeneration&& other) noexcept;
+
+    /**
+     * @brief Map the header file, creating it if missing
+     */
+    Result<void> open(const std::filesystem::path& path);
+    void close();
+    bool is_open() const { return header_ != nullptr; }
+
+    /**
+     * @brief Consistent view of the header; nullopt if a writer stays mid-update (e.g. it crashed)
+     */
+    std::optional<State> read() const;
+
+    /**
+     * @brief Announce a new committed end; call with the journal lock held
+     */
+    void publish(uint64_t committed_offset, uint64_t sequence);
+
+private:
+    struct Header;
+    Header* header_ = nullptr;
+};
+
+} // namespace tcfs
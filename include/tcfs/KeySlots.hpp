@@ -0,0 +1,147 @@
+#pragma once
+
+#include "CryptoProvider.hpp"
+#include "Errors.hpp"
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+namespace tcfs {
+
+/**
+ * @brief Who is opening a capsule: a passphrase, or the X25519 private key for public-key slots
+ */
+struct RecipientCredential {
+    std::string recipient;
+    std::string passphrase;
+    std::vector<uint8_t> private_key{};
+};
+
+/**
+ * @brief A recipient known only by their X25519 public key
+ */
+struct PublicRecipient {
+    std::string name;
+    std::vector<uint8_t> public_key;
+};
+
+/**
+ * @brief One recipient's copy of a capsule master key
+ *
+ * The master key is sealed with AES-256-GCM under a key-encryption key,
+ * derived either from the recipient's passphrase with PBKDF2-SHA256 or from
+ * an X25519 agreement with an ephemeral key (see SealContext).
+ */
+struct KeySlot {
+    enum class Kind : uint8_t {
+        Passphrase,
+        X25519
+    };
+
+    Kind kind = Kind::Passphrase;
+    uint32_t iterations = 0;               // Passphrase slots
+    CryptoSalt salt;                       // Passphrase slots
+    std::vector<uint8_t> ephemeral_public; // X25519 slots
+    std::vector<uint8_t> wrapped;          // IV, ciphertext and tag of the master key
+};
+
+/**
+ * @brief Sender side of an HPKE-style seal to one X25519 public key
+ *
+ * Creating a context generates an ephemeral key pair and performs the one
+ * key agreement; the shared secret goes through HKDF-SHA256, bound to both
+ * public keys, to give a key-encryption key. wrap() then costs one AES-GCM
+ * operation with a fresh random IV, so a batch locking thousands of capsules
+ * for the same recipient pays for a single agreement. All capsules wrapped by
+ * one context share its ephemeral key, and therefore stand or fall together
+ * if that key-encryption key leaks; a context lives for one batch only.
+ */
+class SealContext {
+public:
+    static constexpr const char* INFO = "tcfs x25519 key slot v1";
+
+    static Result<SealContext> create(CryptoProvider& crypto, const PublicRecipient& recipient);
+
+    const std::string& recipient() const { return recipient_; }
+    const std::vector<uint8_t>& ephemeral_public() const { return ephemeral_public_; }
+
+    std::vector<uint8_t> wrap(CryptoProvider& crypto, const CryptoKey& key) const;
+
+    /**
+     * @brief Recipient side: key-encryption key for a slot sealed with ephemeral_public
+     */
+    static Result<CryptoKey> open(CryptoProvider& crypto, const CryptoKey& private_key,
+                                  const std::vector<uint8_t>& ephemeral_public);
+
+private:
+    std::string recipient_;
+    std::vector<uint8_t> ephemeral_public_;
+    CryptoKey kek_;
+};
+
+/**
+ * @brief LUKS-style key slots of a capsule, indexed by recipient
+ *
+ * A sealed capsule keeps its stage keys wrapped under one random master key,
+ * and every recipient holds a slot with their own wrapping of that master
+ * key. Opening looks up the caller's slot directly instead of trying a
+ * passphrase against every slot. Because slots only wrap the master key,
+ * adding or removing a recipient rewrites the capsule metadata and never
+ * touches the ciphertext.
+ */
+class KeySlots {
+public:
+    static constexpr uint32_t DEFAULT_ITERATIONS = 200000;
+    static constexpr const char* KDF = "pbkdf2-sha256";
+
+    bool empty() const { return slots_.empty(); }
+    size_t size() const { return slots_.size(); }
+    bool contains(const std::string& recipient) const { return slots_.count(recipient) != 0; }
+
+    /**
+     * @brief Recipients in name order
+     */
+    std::vector<std::string> recipients() const;
+
+    /**
+     * @brief Add (or replace) the slot of recipient, wrapping master under passphrase
+     */
+    Result<void> add(CryptoProvider& crypto, const std::string& recipient, const std::string& passphrase,
+                     const CryptoKey& master, uint32_t iterations = DEFAULT_ITERATIONS);
+
+    /**
+     * @brief Add (or replace) a public-key slot for the recipient of context
+     */
+    Result<void> add_sealed(CryptoProvider& crypto, const SealContext& context, const CryptoKey& master);
+
+    /**
+     * @brief Drop the slot of recipient; false if there was none
+     */
+    bool remove(const std::string& recipient);
+
+    /**
+     * @brief Master key from the credential's slot; InvalidKey for unknown recipients or wrong secrets
+     */
+    Result<CryptoKey> open(CryptoProvider& crypto, const RecipientCredential& credential) const;
+
+    nlohmann::json to_json(CryptoProvider& crypto) const;
+    static Result<KeySlots> from_json(const nlohmann::json& json, CryptoProvider& crypto);
+
+private:
+    std::unordered_map<std::string, KeySlot> slots_;
+};
+
+/**
+ * @brief Seal key under kek with AES-256-GCM; the result carries IV, ciphertext and tag
+ */
+std::vector<uint8_t> wrap_key(CryptoProvider& crypto, const std::vector<uint8_t>& key, const CryptoKey& kek);
+
+/**
+ * @brief Inverse of wrap_key; InvalidKey if kek is wrong or the blob was altered
+ */
+Result<std::vector<uint8_t>> unwrap_key(CryptoProvider& crypto, const std::vector<uint8_t>& wrapped,
+                                        const CryptoKey& kek);
+
+} // namespace tcfs
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "Errors.hpp"
+#include <cstdint>
+#include <filesystem>
+
+namespace tcfs {
+
+/**
+ * @brief Ask the kernel to start reading a file range into the page cache
+ *
+ * Uses posix_fadvise(POSIX_FADV_WILLNEED), which returns immediately and reads
+ * in the background. Where fadvise is unavailable the range is read once. A
+ * length of 0 means to the end of the file.
+ */
+Result<void> advise_willneed(const std::filesystem::path& path, uint64_t offset = 0, uint64_t length = 0);
+
+/**
+ * @brief Let the kernel drop a file range from the page cache
+ *
+ * A hint only: a no-op where fadvise is unavailable.
+ */
+Result<void> advise_dontneed(const std::filesystem::path& path, uint64_t offset = 0, uint64_t length = 0);
+
+} // namespace tcfs
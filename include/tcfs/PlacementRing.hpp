@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace tcfs {
+
+/**
+ * @brief Consistent-hash ring that places capsules on data directories
+ *
+ * Every member owns VIRTUAL_NODES points on a 64-bit ring, and a key belongs
+ * to the first point at or after its own hash. Adding a member takes over
+ * only the keys falling just before its points, about 1/(n+1) of them, and
+ * moves nothing between the existing members. Placement depends only on the
+ * member names and the key, so every process agrees on it.
+ */
+class PlacementRing {
+public:
+    static constexpr size_t VIRTUAL_NODES = 128;
+
+    explicit PlacementRing(std::vector<std::string> members = {});
+
+    bool empty() const { return members_.empty(); }
+    const std::vector<std::string>& members() const { return members_; }
+
+    /**
+     * @brief Member that owns key; the ring must not be empty
+     */
+    const std::string& locate(const std::string& key) const;
+
+private:
+    std::vector<std::string> members_;
+    std::vector<std::pair<uint64_t, uint32_t>> points_; // Ring position and member index, sorted
+
+    static uint64_t hash(const std::string& key);
+};
+
+} // namespace tcfs
@@ -1,8 +1,12 @@
 #pragma once
 
 #include "Errors.hpp"
+#include "Condition.hpp"
+#include "Recurrence.hpp"
 #include <chrono>
+#include <optional>
 #include <string>
+#include <vector>
 #include <nlohmann/json.hpp>
 
 namespace tcfs {
@@ -40,6 +44,10 @@ public:
     void set_grace_seconds(uint32_t seconds) { grace_seconds_ = seconds; }
     void set_algorithm(CryptoAlgorithm algo) { algorithm_ = algo; }
     void set_kdf(KDFType kdf) { kdf_ = kdf; }
+    void set_condition(Condition condition) { condition_ = std::move(condition); }
+    void set_recurrence(std::optional<Recurrence> recurrence) { recurrence_ = std::move(recurrence); }
+    void set_depends_on(std::vector<std::string> capsule_ids) { depends_on_ = std::move(capsule_ids); }
+    void set_expire_at(std::optional<TimePoint> time) { expire_at_ = time; }
     
     // Getters
     const TimePoint& unlock_time() const { return unlock_at_; }
@@ -49,6 +57,11 @@ public:
     uint32_t grace_seconds() const { return grace_seconds_; }
     CryptoAlgorithm algorithm() const { return algorithm_; }
     KDFType kdf() const { return kdf_; }
+    const Condition& condition() const { return condition_; }
+    bool has_condition() const { return !condition_.empty(); }
+    const std::optional<Recurrence>& recurrence() const { return recurrence_; }
+    const std::vector<std::string>& depends_on() const { return depends_on_; }
+    const std::optional<TimePoint>& expire_at() const { return expire_at_; }
     
     // Test API compatibility methods
     void setUnlockTime(const TimePoint& time) { set_unlock_time(time); }
@@ -73,6 +86,27 @@ public:
     bool isUnlockTimeReached() const { return is_unlock_time_reached(); }
     std::chrono::seconds time_remaining() const;
     
+    /**
+     * @brief The capsule has reached its expiry time and must be destroyed
+     */
+    bool is_expired(const TimePoint& now) const { return expire_at_ && now >= *expire_at_; }
+    
+    /**
+     * @brief Unlock time reached, recurring window (if any) open, the
+     *        compound condition (if any) satisfied and the capsule not expired
+     */
+    bool is_unlock_allowed() const;
+    bool is_unlock_allowed(const TimePoint& now) const;
+    
+    /**
+     * @brief Earliest time >= now at which the unlock time is reached and the
+     *        recurring window is open; nullopt if that never happens again
+     *
+     * The compound condition is not folded in: callers re-check
+     * is_unlock_allowed() at the returned time.
+     */
+    std::optional<TimePoint> next_unlock_time(const TimePoint& now) const;
+    
     // Validation
     Result<void> validate() const;
     bool isValid() const { 
@@ -108,6 +142,10 @@ private:
     uint32_t grace_seconds_ = 0;
     CryptoAlgorithm algorithm_ = CryptoAlgorithm::AES_256_GCM;
     KDFType kdf_ = KDFType::PBKDF2;
+    Condition condition_;
+    std::optional<Recurrence> recurrence_;
+    std::vector<std::string> depends_on_; // Capsules that must be released first
+    std::optional<TimePoint> expire_at_;  // Destroy the capsule at this time
 };
 
 /**
@@ -128,6 +166,11 @@ namespace time_utils {
      * @brief Get current system time
      */
     Policy::TimePoint now();
+    
+    /**
+     * @brief Parse a duration such as "90s", "15m", "12h", "30d" or "2w"
+     */
+    Result<std::chrono::seconds> parse_duration(const std::string& text);
 }
 
 /**
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "ReleaseQueue.hpp"
+#include "Store.hpp"
+#include "UnlockScheduler.hpp"
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+namespace tcfs {
+
+/**
+ * @brief Prefetch configuration
+ */
+struct PrefetchOptions {
+    std::chrono::seconds horizon{0};               // Prefetch capsules due within this window; 0 disables
+    uint64_t bytes_per_second = 64 * 1024 * 1024;  // Readahead budget; 0 = unlimited
+    uint64_t max_resident_bytes = 1024ull * 1024 * 1024; // Cap on prefetched but not yet released ciphertext
+    size_t max_per_tick = 256;                     // Capsules considered per call
+    std::function<void(const std::string&)> log;   // Optional diagnostics sink
+};
+
+/**
+ * @brief Warms the page cache with ciphertext of capsules that unlock soon
+ *
+ * Driven by the unlock scheduler: capsules due within the horizon get a
+ * WILLNEED hint, metered by a byte budget and capped in total so prefetching
+ * does not push hot data out of the cache. Once a capsule is released its
+ * pages are handed back with DONTNEED.
+ */
+class Prefetcher {
+public:
+    using TimePoint = UnlockScheduler::TimePoint;
+
+    Prefetcher(Store& store, PrefetchOptions options = {});
+
+    bool enabled() const { return options_.horizon.count() > 0; }
+
+    /**
+     * @brief Prefetch capsules due before now + horizon; returns the number prefetched
+     */
+    size_t prefetch(const UnlockScheduler& scheduler, const TimePoint& now);
+
+    /**
+     * @brief Time at which the next not-yet-considered capsule enters the horizon
+     */
+    std::optional<TimePoint> next_wake(const UnlockScheduler& scheduler, const TimePoint& now) const;
+
+    /**
+     * @brief The capsule was released: drop its ciphertext from the cache
+     */
+    void release(const std::string& capsule_id);
+
+    /**
+     * @brief The capsule went away (destroyed or rescheduled) without being read: drop its ciphertext from the cache
+     */
+    void forget(const std::string& capsule_id);
+
+    /**
+     * @brief The capsule is now due at due, or no longer scheduled: forget it once it is past the horizon
+     */
+    void rescheduled(const std::string& capsule_id, const std::optional<TimePoint>& due, const TimePoint& now);
+
+    bool is_prefetched(const std::string& capsule_id) const { return prefetched_.count(capsule_id) != 0; }
+    uint64_t resident_bytes() const { return resident_bytes_; }
+
+private:
+    Store& store_;
+    PrefetchOptions options_;
+    TokenBucket budget_;
+    std::unordered_map<std::string, uint64_t> prefetched_; // Capsule id -> bytes hinted
+    uint64_t resident_bytes_ = 0;
+
+    void log(const std::string& message) const;
+};
+
+} // namespace tcfs
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "ChunkedCapsule.hpp"
+#include "Errors.hpp"
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <nlohmann/json.hpp>
+
+namespace tcfs {
+
+/**
+ * @brief Checkpoint of a long chunked lock or unlock, for continuing it after an interruption
+ *
+ * A lock checkpoint names its input by path, size and modification time and
+ * carries the capsule's stage table. The stage keys and base IVs fix the
+ * nonce of every segment, so the segments after the checkpoint encrypt
+ * exactly as they would have without the interruption. An unlock checkpoint
+ * names the capsule and the lock that produced it, the output file and the
+ * stage, if only one was asked for. The output file is synced before every save() and save() replaces
+ * the checkpoint atomically, so it never claims more than is on disk.
+ */
+struct ProgressJournal {
+    static constexpr const char* EXTENSION = ".progress";
+
+    std::string operation;            // "lock" or "unlock"
+    std::string source;               // Input path when locking, capsule id when unlocking
+    uint64_t source_size = 0;
+    int64_t source_modified = 0;      // Input's last write time in file clock ticks
+    std::string output;
+    std::string instance;             // Unlock: capsule_instance() of the capsule being decrypted
+    std::optional<size_t> stage{};
+    nlohmann::json layout{};          // Lock: stage table, with the stage keys
+    uint64_t done = 0;                // Lock: segments in the capsule file; unlock: plaintext bytes written
+
+    /**
+     * @brief Whether other checkpoints the same operation on the same files, whatever its progress
+     */
+    bool same_operation(const ProgressJournal& other) const;
+
+    /**
+     * @brief Tells apart capsules locked again under the same id: every lock draws fresh stage IVs
+     */
+    static std::string capsule_instance(const ChunkedLayout& layout);
+
+    nlohmann::json to_json() const;
+    static Result<ProgressJournal> from_json(const nlohmann::json& json);
+
+    Result<void> save(const std::filesystem::path& path) const;
+
+    /**
+     * @brief Checkpoint stored at path; FileNotFound if there is none
+     */
+    static Result<ProgressJournal> load(const std::filesystem::path& path);
+};
+
+} // namespace tcfs
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "Errors.hpp"
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <nlohmann/json.hpp>
+
+namespace tcfs {
+
+/**
+ * @brief Calendar unit of a recurrence rule
+ */
+enum class RecurrenceUnit {
+    Minutes,
+    Hours,
+    Days,
+    Weeks,
+    Months,
+    Years
+};
+
+/**
+ * @brief Recurring unlock window, e.g. "the first 7 days of every quarter"
+ *
+ * Windows open at start + k * every * unit (k >= 0) and stay open for
+ * duration. Month and year steps follow the calendar and clamp the day of
+ * month (a rule anchored on Jan 31 opens on Feb 28/29). Both is_open() and
+ * next_open() are closed-form: they never step through intermediate windows.
+ *
+ * JSON: {"start": "<RFC3339>", "every": 3, "unit": "months",
+ *        "duration_seconds": 604800, "until": "<RFC3339>"}   (until optional)
+ */
+class Recurrence {
+public:
+    using TimePoint = std::chrono::system_clock::time_point;
+
+    Recurrence() = default;
+    Recurrence(TimePoint start, uint32_t every, RecurrenceUnit unit, std::chrono::seconds duration,
+               std::optional<TimePoint> until = std::nullopt);
+
+    const TimePoint& start() const { return start_; }
+    uint32_t every() const { return every_; }
+    RecurrenceUnit unit() const { return unit_; }
+    std::chrono::seconds duration() const { return duration_; }
+    const std::optional<TimePoint>& until() const { return until_; }
+
+    /**
+     * @brief Whether a window is open at the given time
+     */
+    bool is_open(const TimePoint& now) const;
+
+    /**
+     * @brief Earliest time >= now at which a window is open
+     *
+     * Returns now itself while a window is open, and nullopt when no window
+     * opens at or after now (the rule has ended).
+     */
+    std::optional<TimePoint> next_open(const TimePoint& now) const;
+
+    Result<void> validate() const;
+
+    nlohmann::json to_json() const;
+    static Result<Recurrence> from_json(const nlohmann::json& json);
+
+private:
+    TimePoint start_;
+    uint32_t every_ = 1;
+    RecurrenceUnit unit_ = RecurrenceUnit::Days;
+    std::chrono::seconds duration_{0};
+    std::optional<TimePoint> until_;
+
+    /**
+     * @brief Start of window k (k >= 0)
+     */
+    TimePoint window_start(int64_t k) const;
+
+    /**
+     * @brief Index of the last window starting at or before t (t >= start)
+     */
+    int64_t window_index(const TimePoint& t) const;
+};
+
+std::string to_string(RecurrenceUnit unit);
+Result<RecurrenceUnit> recurrence_unit_from_string(const std::string& str);
+
+} // namespace tcfs
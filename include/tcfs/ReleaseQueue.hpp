@@ -0,0 +1,153 @@
+#pragma once
+
+#include "Catalog.hpp"
+#include "Policy.hpp"
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace tcfs {
+
+/**
+ * @brief Release priority classes, served in this order
+ */
+enum class ReleasePriority : uint8_t {
+    High,    // Labels listed in ReleaseQueueOptions::high_priority_labels
+    Normal,
+    Bulk     // Capsules at or above ReleaseQueueOptions::bulk_size_bytes
+};
+
+/**
+ * @brief Admission control for mass-unlock events
+ */
+struct ReleaseQueueOptions {
+    size_t max_concurrency = 4;                // Releases decrypted in parallel
+    uint64_t io_bytes_per_second = 0;          // Ciphertext read budget; 0 = unlimited
+    uint64_t io_burst_bytes = 64 * 1024 * 1024; // Bucket size of the read budget
+    std::chrono::milliseconds max_jitter{0};   // Spread releases due at the same instant over this window
+    std::vector<std::string> high_priority_labels;
+    uint64_t bulk_size_bytes = 256 * 1024 * 1024;
+};
+
+/**
+ * @brief Token bucket metering bytes per second
+ */
+class TokenBucket {
+public:
+    using TimePoint = Policy::TimePoint;
+
+    TokenBucket() = default;
+    TokenBucket(uint64_t rate_per_second, uint64_t burst);
+
+    bool unlimited() const { return rate_ == 0; }
+
+    /**
+     * @brief Take cost tokens if available at now
+     *
+     * A cost larger than the bucket is admitted when the bucket is full, so
+     * oversized requests are throttled rather than starved.
+     */
+    bool try_consume(uint64_t cost, const TimePoint& now);
+
+    /**
+     * @brief Earliest time at which try_consume(cost) can succeed
+     */
+    TimePoint ready_at(uint64_t cost, const TimePoint& now);
+
+private:
+    uint64_t rate_ = 0;
+    double burst_ = 0;
+    double tokens_ = 0;
+    std::optional<TimePoint> last_;
+
+    void refill(const TimePoint& now);
+};
+
+/**
+ * @brief Summary of recent release lag (completion time minus due time)
+ */
+struct ReleaseLagStats {
+    size_t count = 0;           // Releases recorded since start
+    std::chrono::milliseconds p50{0};
+    std::chrono::milliseconds p99{0};
+    std::chrono::milliseconds max{0};
+};
+
+/**
+ * @brief Pending releases ordered by priority class, then eligibility time
+ *
+ * Each class is a time-ordered map, so taking a batch of k costs O(k log n)
+ * however many capsules became due at once. Jitter is derived from the
+ * capsule id, so a restart spreads the same capsules the same way.
+ */
+class ReleaseQueue {
+public:
+    using TimePoint = Policy::TimePoint;
+
+    struct Request {
+        std::string capsule_id;
+        uint64_t size = 0;
+        ReleasePriority priority = ReleasePriority::Normal;
+        TimePoint due;          // When the capsule became releasable
+        TimePoint not_before;   // due plus jitter
+    };
+
+    static constexpr size_t LAG_WINDOW = 4096;
+
+    explicit ReleaseQueue(ReleaseQueueOptions options = {});
+
+    /**
+     * @brief Queue a capsule; ignored if it is already queued
+     */
+    bool push(const CatalogEntry& entry, const TimePoint& due);
+
+    /**
+     * @brief Remove and return up to max_concurrency requests eligible at now within the I/O budget
+     */
+    std::vector<Request> take_batch(const TimePoint& now);
+
+    /**
+     * @brief Put a taken request back, e.g. after a failed release
+     */
+    void requeue(Request request, const TimePoint& not_before);
+
+    /**
+     * @brief Earliest time a queued request can be taken; nullopt when empty
+     */
+    std::optional<TimePoint> next_eligible(const TimePoint& now);
+
+    void record_completion(const Request& request, const TimePoint& finished);
+    ReleaseLagStats lag() const;
+
+    ReleasePriority classify(const CatalogEntry& entry) const;
+    bool contains(const std::string& capsule_id) const { return queued_.count(capsule_id) != 0; }
+    size_t size() const { return queued_.size(); }
+    bool empty() const { return queued_.empty(); }
+    const ReleaseQueueOptions& options() const { return options_; }
+
+private:
+    static constexpr size_t CLASS_COUNT = 3;
+    using ClassQueue = std::multimap<TimePoint, Request>;
+
+    ReleaseQueueOptions options_;
+    std::array<ClassQueue, CLASS_COUNT> classes_;
+    std::unordered_set<std::string> queued_;
+    TokenBucket io_budget_;
+
+    // Ring buffer of the most recent lags, in milliseconds
+    std::vector<int64_t> lags_;
+    size_t lag_count_ = 0;
+    int64_t lag_max_ = 0;
+
+    TimePoint::duration jitter_for(const std::string& capsule_id) const;
+};
+
+std::string to_string(ReleasePriority priority);
+
+} // namespace tcfs
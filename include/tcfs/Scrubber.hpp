@@ -0,0 +1,80 @@
+#pragma once
+
+#include "Errors.hpp"
+#include "Store.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace tcfs {
+
+/**
+ * @brief Scrubber configuration
+ */
+struct ScrubberOptions {
+    size_t workers = 4;                                 // Threads reading and verifying headers
+    size_t batch_size = 512;                            // Headers per verification batch
+    std::vector<std::vector<uint8_t>> trusted_signers;  // Ed25519 public keys; empty trusts the store's host key
+    bool require_signatures = false;                    // Count unsigned headers as failures
+    std::function<void(const std::string&)> log;        // Optional diagnostics sink
+};
+
+/**
+ * @brief Outcome of scrubbing capsule headers
+ */
+struct ScrubReport {
+    size_t verified = 0;
+    std::vector<std::string> unsigned_ids;                      // Headers written before the store had a host key
+    std::vector<std::pair<std::string, std::string>> failed;    // Capsule id and reason, in input order
+
+    bool clean() const { return failed.empty(); }
+};
+
+/**
+ * @brief Checks the Ed25519 signatures of capsule headers
+ *
+ * Capsule ids are cut into batches that workers take in turn. A worker reads
+ * the headers of its batch, groups them by signer and hands each group to
+ * CryptoProvider::ed25519VerifyBatch, which decodes the signer's key once for
+ * the whole group. Only signatures by trusted signers count as verified.
+ *
+ * Group files hold their members' policy and are signed the same way. Each
+ * is verified once per scrub; a signed member of a group whose file is
+ * unsigned, missing or fails verification is reported as failed.
+ */
+class Scrubber {
+public:
+    Scrubber(Store& store, ScrubberOptions options = {});
+
+    /**
+     * @brief Verify the headers of ids; fails only if there is no signer to trust
+     */
+    Result<ScrubReport> scrub(const std::vector<std::string>& ids);
+
+    /**
+     * @brief Verify every capsule in the store
+     */
+    Result<ScrubReport> scrub_all() { return scrub(store_.scan_capsule_ids()); }
+
+    const ScrubberOptions& options() const { return options_; }
+
+private:
+    Store& store_;
+    ScrubberOptions options_;
+
+    ScrubReport scrub_batch(const std::vector<std::string>& ids, size_t begin, size_t end,
+                            const std::vector<std::string>& trusted,
+                            const std::map<std::string, std::string>& group_status);
+
+    /**
+     * @brief Failure reason of every group file by group name, empty for those that verify
+     */
+    std::map<std::string, std::string> check_groups(const std::vector<std::string>& trusted) const;
+    void log(const std::string& message) const;
+};
+
+} // namespace tcfs
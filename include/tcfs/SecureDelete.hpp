@@ -0,0 +1,17 @@
+#pragma once
+
+#include "Errors.hpp"
+#include <filesystem>
+
+namespace tcfs {
+
+/**
+ * @brief Overwrite a file with zeros, flush it to disk and unlink it
+ *
+ * On copy-on-write filesystems and SSDs the old blocks may survive the
+ * overwrite; destroying a capsule's metadata (which holds its keys) is what
+ * makes the ciphertext unrecoverable.
+ */
+Result<void> secure_delete(const std::filesystem::path& path);
+
+} // namespace tcfs
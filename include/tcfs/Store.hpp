@@ -0,0 +1,563 @@
+#pragma once
+
+#include "AuditLog.hpp"
+#include "BlindIndex.hpp"
+#include "Catalog.hpp"
+#include "CatalogQuery.hpp"
+#include "ChunkedCapsule.hpp"
+#include "CryptoProvider.hpp"
+#include "DirectIO.hpp"
+#include "Errors.hpp"
+#include "FileLock.hpp"
+#include "KeySlots.hpp"
+#include "PlacementRing.hpp"
+#include "Policy.hpp"
+#include "ProgressJournal.hpp"
+#include "TierManager.hpp"
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+namespace tcfs {
+
+/**
+ * @brief Outcome of locking several files at once
+ */
+struct BatchLockResult {
+    std::vector<std::string> locked;                                    // Capsule ids, in input order
+    std::vector<std::pair<std::filesystem::path, std::string>> failed;  // Input and reason
+};
+
+/**
+ * @brief How far to move unlock times: by a fixed amount, or to an absolute time
+ */
+struct UnlockExtension {
+    std::chrono::seconds by{0};
+    std::optional<Policy::TimePoint> to{};
+};
+
+/**
+ * @brief Outcome of a bulk policy update
+ */
+struct UpdateResult {
+    std::vector<std::string> updated;                           // Capsule ids, in catalog order
+    std::vector<std::pair<std::string, std::string>> skipped;   // Id and why it was left alone
+    std::vector<std::pair<std::string, std::string>> failed;    // Id and reason; the catalog already has the new times
+};
+
+/**
+ * @brief Outcome of moving capsules between data directories
+ */
+struct RebalanceResult {
+    size_t moved = 0;                                           // Capsules copied to their new directory
+    uint64_t bytes = 0;
+    std::vector<std::pair<std::string, std::string>> failed;    // Id and reason
+};
+
+/**
+ * @brief How often long locks and unlocks record their progress, and whether to continue from it
+ *
+ * Every interval segments the output file is synced and a ProgressJournal is
+ * saved; an interval of 0 turns checkpoints off. With resume, an operation
+ * whose journal matches continues after its last checkpoint. Locks sealed to
+ * recipients are never checkpointed: the journal would hold their stage keys
+ * in the clear.
+ */
+struct CheckpointOptions {
+    static constexpr uint32_t DEFAULT_INTERVAL = 1024; // 64 MiB of default-size segments
+
+    uint32_t interval = 0;
+    bool resume = false;
+};
+
+/**
+ * @brief Descriptive fields of a capsule, decrypted if the capsule keeps them private
+ */
+struct CapsuleDescription {
+    std::string label;
+    std::string notes;
+    std::string original_filename;
+    bool encrypted = false;
+};
+
+/**
+ * @brief A TCFS store directory: capsules, their metadata and the catalog
+ *
+ * A capsule with id "report.pdf" is stored as report.pdf.tcfs with its
+ * metadata in report.pdf.tcfs.meta. The ciphertext of far-future capsules may
+ * live in a cold-tier pack instead; reads bring it back transparently.
+ *
+ * Ciphertext may also be striped over several data directories, typically one
+ * per disk, listed in the config's data_dirs. A PlacementRing picks each
+ * capsule's directory, so parallel writers spread over the disks; metadata,
+ * the catalog and the locks stay in the store directory.
+ *
+ * Several processes may use one store at once. Writing or destroying a
+ * capsule holds a byte-range lock on its shard of shards.lock, so work on
+ * unrelated capsules proceeds in parallel; the catalog journal has its own
+ * lock, taken only for the append (see Catalog).
+ */
+class Store {
+public:
+    static constexpr const char* CONFIG_FILENAME = "config.json";
+    static constexpr const char* CAPSULE_EXTENSION = ".tcfs";
+    static constexpr const char* METADATA_EXTENSION = ".meta";
+    static constexpr const char* TOOL_VERSION = "0.1.0";
+    static constexpr const char* FIRST_STAGE_NAME = "part1";
+    static constexpr const char* SHARD_LOCK_FILENAME = "shards.lock";
+    static constexpr size_t LOCK_SHARDS = 256;
+    static constexpr const char* SIGNING_KEY_FILENAME = "host.key";
+    static constexpr const char* SIGNING_PUBLIC_KEY_FILENAME = "host.pub";
+    static constexpr const char* SIGNATURE_FIELD = "signature";
+    static constexpr const char* METADATA_KEY_FILENAME = "metadata.key";
+    static constexpr const char* PRIVATE_FIELD = "private";
+    static constexpr const char* GROUPS_DIRNAME = "groups";
+    static constexpr const char* GROUP_FIELD = "group";
+    static constexpr const char* DATA_DIRS_FIELD = "data_dirs";
+
+    explicit Store(std::filesystem::path root);
+    Store(std::filesystem::path root, std::unique_ptr<CryptoProvider> crypto);
+
+    const std::filesystem::path& root() const { return root_; }
+    bool exists() const;
+
+    /**
+     * @brief Create the store directory, its config file, its Ed25519 host key and its metadata key
+     */
+    Result<void> init(const std::string& owner, const std::string& kdf);
+
+    /**
+     * @brief Store configuration; an empty object when the store has no config
+     */
+    Result<nlohmann::json> config() const;
+    std::string default_owner() const;
+
+    // Capsule layout
+    /**
+     * @brief Where the ciphertext of id lives: the store directory, or its data directory on the ring
+     */
+    std::filesystem::path capsule_path(const std::string& id) const;
+    std::filesystem::path metadata_path(const std::string& id) const;
+    static std::string capsule_id_for(const std::filesystem::path& input);
+
+    /**
+     * @brief Id lock() gives input: its file name, or a keyed hash of it while metadata is private
+     */
+    Result<std::string> id_for(const std::filesystem::path& input) const;
+
+    /**
+     * @brief Resolve a user-supplied name ("report.pdf" or "report.pdf.tcfs") to a capsule id
+     */
+    Result<std::string> resolve(const std::string& name) const;
+
+    /**
+     * @brief Capsule ids found by listing the store directory, hot or cold
+     */
+    std::vector<std::string> scan_capsule_ids() const;
+
+    /**
+     * @brief Data directories in ring order; empty when ciphertext lives in the store directory
+     */
+    std::vector<std::filesystem::path> data_dirs() const;
+
+    /**
+     * @brief Add a data directory to the ring and move the capsules it now owns
+     *
+     * Holds every shard lock, so locks and destroys wait. Capsules moving to
+     * dir are copied and synced first; then the config names dir, which is
+     * the commit point; then the old copies are deleted. A crash at any step
+     * leaves every capsule readable, and rebalance() finishes the job. The
+     * first data directory joins the store directory itself ("."), so the
+     * existing capsules are split rather than all moved.
+     */
+    Result<RebalanceResult> add_data_dir(const std::filesystem::path& dir, size_t workers = 4);
+
+    /**
+     * @brief Move every hot capsule to the directory the ring gives it and drop copies left elsewhere
+     */
+    Result<RebalanceResult> rebalance(size_t workers = 4);
+
+    // Metadata
+    Result<nlohmann::json> read_metadata(const std::string& id) const;
+    /**
+     * @brief Atomically replace a capsule's metadata, signed with the host key if the store has one
+     */
+    Result<void> write_metadata(const std::string& id, const nlohmann::json& metadata) const;
+    Result<Policy> read_policy(const std::string& id) const;
+
+    /**
+     * @brief Bytes covered by a header signature: the metadata without its signature, compact, keys sorted
+     */
+    static std::vector<uint8_t> header_bytes(const nlohmann::json& metadata);
+
+    /**
+     * @brief Public half of the host key that signs this store's capsule headers
+     */
+    Result<std::vector<uint8_t>> signer_public_key() const;
+
+    /**
+     * @brief Encrypt label, notes and original filename of capsules locked from now on
+     *
+     * They move into an AES-256-GCM blob under the store's metadata key, the
+     * capsule id becomes a keyed hash of the file name, and the catalog keeps
+     * only blind-index tokens of them. resolve() still accepts the file name.
+     */
+    void set_private_metadata(bool enabled) { private_metadata_ = enabled; }
+
+    /**
+     * @brief Label, notes and original filename of a capsule
+     */
+    Result<CapsuleDescription> describe(const std::string& id) const;
+
+    /**
+     * @brief Capsules whose field ("label", "notes" or "filename") matches term, from catalog tokens alone
+     *
+     * Covers every capsule locked since the store had a metadata key, private
+     * or not. Only matches the tokens cannot prove (see BlindIndex::is_exact)
+     * are confirmed by decrypting the candidates' metadata.
+     */
+    Result<std::vector<std::string>> search(const std::string& field, const std::string& term, BlindMatch match);
+
+    /**
+     * @brief Encrypt a file into the store; the input file is left in place
+     *
+     * The capsule is written in the chunked format. policy governs the first
+     * stage and the capsule as a whole; later_stages split off the rest of the
+     * file under their own policies. Dependencies named by the policy must
+     * already be in the catalog. Returns the capsule id.
+     */
+    Result<std::string> lock(const std::filesystem::path& input, const Policy& policy,
+                             const std::vector<ChunkedCapsule::StageSpec>& later_stages = {});
+
+    /**
+     * @brief Encrypt size bytes read from input as if they were a file called name
+     *
+     * As lock() for data that is not in a file: name gives the capsule id and
+     * the original file name. Stream locks are not checkpointed, since there
+     * is no file to resume reading from.
+     */
+    Result<std::string> lock(std::istream& input, uint64_t size, const std::string& name, const Policy& policy,
+                             const std::vector<ChunkedCapsule::StageSpec>& later_stages = {});
+
+    /**
+     * @brief Lock many files under one policy
+     *
+     * Files are encrypted and fsynced by up to workers threads, then all
+     * catalog entries are committed with a single journal write and fsync.
+     * A file that fails is reported in the result and does not stop the rest.
+     */
+    Result<BatchLockResult> lock_batch(const std::vector<std::filesystem::path>& inputs, const Policy& policy,
+                                       size_t workers = 4);
+
+    /**
+     * @brief Create a capsule group whose members all share policy
+     *
+     * The policy is written once, to groups/<name>.json. Members' metadata
+     * name the group instead of carrying a copy of it, and the catalog keeps
+     * the group's schedule in one record. The file is written before the
+     * record, so running a create again with the same policy finishes one
+     * interrupted in between. Fails if the group exists.
+     */
+    Result<void> create_group(const std::string& name, const Policy& policy);
+    std::filesystem::path group_path(const std::string& name) const;
+
+    /**
+     * @brief Shared policy of a group, parsed once and reused until the group file changes
+     *
+     * Group files are signed with the host key like capsule headers. In a
+     * store that has one, a group file that is unsigned or does not verify
+     * is refused, so its members cannot be unlocked early by editing it.
+     */
+    Result<Policy> group_policy(const std::string& name) const;
+
+    /**
+     * @brief Group file as stored, signature included
+     */
+    Result<nlohmann::json> read_group(const std::string& name) const;
+
+    /**
+     * @brief Move a group's unlock time later; an expiry moves by the same amount
+     *
+     * Rewrites the group file, then appends one catalog record; no member's
+     * metadata is touched. Unlock times only move forward. Extending to the
+     * time the file already has succeeds and brings the catalog up to it, so
+     * a retry finishes an update interrupted before its catalog commit.
+     */
+    Result<void> extend_group(const std::string& name, const Policy::TimePoint& unlock_at);
+
+    /**
+     * @brief Lock files as members of an existing group, as lock_batch() does under the group's policy
+     */
+    Result<BatchLockResult> lock_group(const std::string& name, const std::vector<std::filesystem::path>& inputs,
+                                       size_t workers = 4);
+
+    /**
+     * @brief Move the unlock time of every capsule matching query later
+     *
+     * Each capsule's unlock and expiry times, and those of its later stages,
+     * shift by the same amount. Up to workers threads first rewrite the .meta
+     * files, each atomically; the new times of those rewritten are then
+     * committed to the catalog as one journal record. A failure or crash in
+     * between leaves capsules locked until their later .meta time while the
+     * catalog still shows the earlier one. Released capsules, group members
+     * (see extend_group) and capsules already past extension.to are skipped.
+     * The amount is measured from each capsule's metadata, and a catalog
+     * entry behind its metadata is brought up to it, so rerunning with the
+     * same query and extension.to finishes a partial update.
+     */
+    Result<UpdateResult> extend(const CatalogQuery& query, const UnlockExtension& extension, size_t workers = 4);
+
+    /**
+     * @brief Decrypt a whole capsule without checking any policy
+     */
+    Result<std::vector<uint8_t>> decrypt(const std::string& id);
+
+    /**
+     * @brief Stage table of a chunked capsule; fails for single-segment capsules
+     */
+    Result<ChunkedLayout> read_layout(const std::string& id);
+
+    /**
+     * @brief Decrypt a byte range of one stage without checking its policy
+     */
+    Result<std::vector<uint8_t>> read_range(const std::string& id, size_t stage, uint64_t offset, uint64_t length);
+    Result<std::vector<uint8_t>> read_stage(const std::string& id, size_t stage);
+
+    /**
+     * @brief Decrypt a chunked capsule, or one stage of it, into output without checking any policy
+     *
+     * Decrypts a batch of segments at a time, so memory stays bounded by the
+     * checkpoint interval whatever the capsule size. Returns the bytes written.
+     */
+    Result<uint64_t> unlock_to(const std::string& id, const std::filesystem::path& output,
+                               std::optional<size_t> stage = std::nullopt);
+
+    /**
+     * @brief Where the checkpoint of operation ("lock" or "unlock") on capsule id is kept
+     */
+    std::filesystem::path progress_path(const std::string& id, const std::string& operation) const;
+
+    /**
+     * @brief Credential used to open capsules sealed to recipients
+     *
+     * Reads of a sealed capsule fail with InvalidKey unless this names one of
+     * its recipients with the right passphrase.
+     */
+    void set_credential(std::optional<RecipientCredential> credential) { credential_ = std::move(credential); }
+
+    /**
+     * @brief Public keys that capsules locked from now on are sealed to
+     *
+     * lock() agrees a fresh ephemeral key per capsule; lock_batch() agrees one
+     * per recipient for the whole batch and only wraps per capsule.
+     */
+    void set_seal_recipients(std::vector<PublicRecipient> recipients) { seal_recipients_ = std::move(recipients); }
+
+    /**
+     * @brief Read inputs and read and write capsule files with DirectFile, through buffers from pool
+     *
+     * Bulk locks then leave the page cache to other work. Reset with nullptr
+     * to go back to ordinary buffered streams.
+     */
+    void set_direct_io(std::shared_ptr<BufferPool> pool) { buffer_pool_ = std::move(pool); }
+
+    void set_checkpoint_options(CheckpointOptions options) { checkpoints_ = options; }
+
+    /**
+     * @brief Give recipient a key slot on a chunked capsule, sealing it if it had none
+     *
+     * Sealing wraps the stage keys under a fresh master key. Adding to a sealed
+     * capsule needs the credential of an existing recipient. Only the metadata
+     * is rewritten.
+     */
+    Result<void> add_recipient(const std::string& id, const std::string& recipient, const std::string& passphrase,
+                               uint32_t iterations = KeySlots::DEFAULT_ITERATIONS);
+
+    /**
+     * @brief Drop the key slot of recipient; the last recipient cannot be removed
+     */
+    Result<void> remove_recipient(const std::string& id, const std::string& recipient);
+
+    /**
+     * @brief Recipients of a capsule; empty if it is not sealed
+     */
+    Result<std::vector<std::string>> recipients(const std::string& id);
+
+    /**
+     * @brief Record that a capsule was unlocked; returns dependents that became ready
+     */
+    Result<std::vector<std::string>> mark_released(const std::string& id);
+
+    /**
+     * @brief Securely delete a capsule and its metadata, record it in the audit log
+     *        and drop it from the catalog; returns dependents that became ready
+     */
+    Result<std::vector<std::string>> destroy(const std::string& id, const std::string& reason);
+
+    /**
+     * @brief Audit log of this store, opened on first use
+     */
+    Result<AuditLog*> audit_log();
+
+    /**
+     * @brief Hot/cold tier manager of this store, opened on first use
+     */
+    Result<TierManager*> tiers();
+
+    /**
+     * @brief Options for the tier manager; reopens it on next use
+     */
+    void set_tier_options(TierOptions options);
+
+    /**
+     * @brief Catalog of this store, loaded (or rebuilt from metadata) on first use
+     */
+    Result<Catalog*> catalog();
+    Result<void> rebuild_catalog();
+
+    /**
+     * @brief Load the catalog from a snapshot image instead of the full journal
+     *
+     * Journal records appended after the image are replayed and returned. On
+     * failure the catalog is left unloaded, so the next catalog() replays the
+     * journal from the start.
+     */
+    Result<CatalogChanges> restore_catalog(CatalogImage image);
+    std::filesystem::path catalog_journal_path() const { return root_ / Catalog::JOURNAL_FILENAME; }
+
+    CryptoProvider& crypto() { return *crypto_; }
+
+    static CatalogEntry make_catalog_entry(const std::string& id, const nlohmann::json& metadata,
+                                           const Policy& policy, uint64_t size);
+
+private:
+    std::filesystem::path root_;
+    std::unique_ptr<CryptoProvider> crypto_;
+    Catalog catalog_;
+    bool catalog_loaded_ = false;
+    std::unique_ptr<AuditLog> audit_log_;
+    TierOptions tier_options_;
+    std::unique_ptr<TierManager> tiers_;
+    std::mutex tiers_mutex_; // Release workers may bring capsules back concurrently
+    std::optional<RecipientCredential> credential_;
+    std::vector<PublicRecipient> seal_recipients_;
+    std::shared_ptr<BufferPool> buffer_pool_;
+    CheckpointOptions checkpoints_;
+    mutable std::once_flag signing_key_once_; // Loaded on first write; lock_batch writes from several threads
+    mutable std::optional<CryptoKey> signing_key_;
+    mutable std::string signing_key_public_; // Base64, as recorded in signatures
+    bool private_metadata_ = false;
+    mutable std::once_flag metadata_key_once_;
+    mutable std::optional<CryptoKey> metadata_cipher_key_;
+    mutable std::optional<BlindIndex> blind_index_;
+    mutable std::mutex placement_mutex_;
+    mutable std::shared_ptr<const PlacementRing> placement_;
+    mutable std::filesystem::file_time_type placement_config_time_{};
+    mutable std::mutex group_policies_mutex_;
+    mutable std::unordered_map<std::string, std::pair<std::filesystem::file_time_type, Policy>> group_policies_;
+
+    /**
+     * @brief Host key from SIGNING_KEY_FILENAME; nullptr for stores created before headers were signed
+     */
+    const CryptoKey* signing_key() const;
+
+    /**
+     * @brief Replace header's signature with one by the host key; leaves it unsigned without one
+     */
+    Result<void> sign_header(nlohmann::json& header) const;
+
+    /**
+     * @brief Index of METADATA_KEY_FILENAME; nullptr for stores created before it existed
+     */
+    const BlindIndex* blind_index() const;
+    const CryptoKey* metadata_cipher_key() const;
+    Result<CapsuleDescription> describe_metadata(const nlohmann::json& metadata) const;
+    std::vector<uint64_t> blind_tokens(const CapsuleDescription& description) const;
+    std::string private_id(const std::string& file_name) const;
+
+    /**
+     * @brief What a lock encrypts: the file at path, or size bytes of stream named like path
+     */
+    struct LockSource {
+        std::filesystem::path path;
+        std::istream* stream = nullptr;
+        uint64_t size = 0;
+    };
+
+    Result<std::string> lock_source(const LockSource& source, const Policy& policy,
+                                    const std::vector<ChunkedCapsule::StageSpec>& later_stages);
+
+    /**
+     * @brief Encrypt source into the store and write its metadata; the catalog is not touched
+     */
+    Result<CatalogEntry> write_capsule(const LockSource& source, const Policy& policy,
+                                       const std::vector<ChunkedCapsule::StageSpec>& later_stages, bool sync,
+                                       const std::vector<SealContext>& seals, const std::string& group = "");
+    Result<BatchLockResult> lock_many(const std::vector<std::filesystem::path>& inputs, const Policy& policy,
+                                      const std::string& group, size_t workers);
+
+    /**
+     * @brief Encrypt source into output_path; with a journal_path, checkpoint there and resume from it
+     */
+    Result<ChunkedLayout> encrypt_capsule(const LockSource& source, uint64_t input_size,
+                                          const std::filesystem::path& output_path,
+                                          const std::vector<ChunkedCapsule::StageSpec>& stages,
+                                          const std::filesystem::path& journal_path);
+
+    Result<void> write_group(const std::string& name, const Policy& policy);
+
+    /**
+     * @brief Ring of the config's data directories, reloaded when config.json changes
+     */
+    std::shared_ptr<const PlacementRing> placement() const;
+    std::filesystem::path data_dir_path(const std::string& member) const;
+    Result<void> write_config(const nlohmann::json& config);
+    Result<std::vector<FileLock>> lock_all_shards() const;
+    std::filesystem::path capsule_path_on(const PlacementRing& ring, const std::string& id) const;
+
+    /**
+     * @brief Copy capsules missing from their directory on ring there; with drop_stale, delete copies elsewhere
+     */
+    RebalanceResult place_capsules(const PlacementRing& ring, bool drop_stale, size_t workers);
+    static GroupEntry make_group_entry(const std::string& name, const Policy& policy);
+
+    /**
+     * @brief metadata with the shared policy of its group filled in where members leave it out
+     */
+    Result<nlohmann::json> with_group_policy(nlohmann::json metadata) const;
+
+    /**
+     * @brief One seal context per configured public recipient
+     */
+    Result<std::vector<SealContext>> seal_contexts();
+    Result<void> drop_stale_cold_copy(const std::string& id);
+
+    /**
+     * @brief Stage table of a capsule's metadata, opened with credential_ if it is sealed
+     */
+    Result<ChunkedLayout> layout_of(const nlohmann::json& metadata);
+
+    /**
+     * @brief Lock the shards of ids, in ascending shard order so that concurrent batches cannot deadlock
+     */
+    Result<std::vector<FileLock>> lock_capsules(const std::vector<std::string>& ids) const;
+
+    /**
+     * @brief Promote a cold capsule so its ciphertext is at capsule_path(id)
+     */
+    Result<void> ensure_hot(const std::string& id);
+
+    Result<std::vector<uint8_t>> read_range(const std::string& id, const ChunkedLayout& layout, size_t stage,
+                                            uint64_t offset, uint64_t length);
+};
+
+} // namespace tcfs
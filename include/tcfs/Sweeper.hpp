@@ -0,0 +1,86 @@
+#pragma once
+
+#include "Errors.hpp"
+#include "Store.hpp"
+#include "UnlockScheduler.hpp"
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace tcfs {
+
+/**
+ * @brief Sweeper configuration
+ */
+struct SweeperOptions {
+    size_t batch_size = 256;                      // Capsules destroyed per batch
+    std::chrono::milliseconds batch_pause{100};   // Pause between batches to bound I/O load
+    std::function<void(const std::string&)> log;  // Optional diagnostics sink
+};
+
+/**
+ * @brief Result of a sweep batch
+ */
+struct SweepResult {
+    std::vector<std::string> destroyed;
+    std::vector<std::string> ready;  // Dependents unblocked by destroyed capsules
+    size_t failed = 0;
+};
+
+/**
+ * @brief Destroys capsules past their expiry time
+ *
+ * Expiring capsules are kept in a time-ordered index, so finding the expired
+ * ones costs O(k log n) for k expired capsules instead of a scan of the store.
+ */
+class Sweeper {
+public:
+    using TimePoint = UnlockScheduler::TimePoint;
+    using DestroyListener = std::function<void(const CatalogEntry& entry)>;
+
+    Sweeper(Store& store, SweeperOptions options = {});
+
+    /**
+     * @brief Index every catalog entry that has an expiry time
+     */
+    Result<void> start();
+
+    /**
+     * @brief (Re)index one capsule after a catalog change
+     */
+    void track(const CatalogEntry& entry);
+    void forget(const std::string& capsule_id) { index_.remove(capsule_id); }
+
+    /**
+     * @brief Called with the last catalog entry of every capsule destroyed
+     */
+    void set_destroy_listener(DestroyListener listener) { on_destroy_ = std::move(listener); }
+
+    /**
+     * @brief Destroy at most batch_size capsules expired at now, earliest first
+     */
+    SweepResult sweep_batch(const TimePoint& now);
+
+    /**
+     * @brief Destroy everything expired at now, pausing between batches
+     */
+    SweepResult sweep(const TimePoint& now);
+
+    bool has_expired(const TimePoint& now) const;
+    std::optional<TimePoint> next_expiry() const { return index_.next_due(); }
+    size_t size() const { return index_.size(); }
+    const SweeperOptions& options() const { return options_; }
+
+private:
+    Store& store_;
+    SweeperOptions options_;
+    UnlockScheduler index_; // Same time-ordered index the daemon uses for unlocks, keyed by expiry
+    DestroyListener on_destroy_;
+
+    void log(const std::string& message) const;
+};
+
+} // namespace tcfs
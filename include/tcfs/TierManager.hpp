@@ -0,0 +1,162 @@
+#pragma once
+
+#include "Errors.hpp"
+#include "Policy.hpp"
+#include "ReleaseQueue.hpp"
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+namespace tcfs {
+
+class Store;
+
+/**
+ * @brief Tiering configuration
+ */
+struct TierOptions {
+    std::filesystem::path cold_dir;                  // Cold tier directory; empty means <store>/cold
+    std::chrono::seconds demote_after{0};            // Capsules unlocking further out go cold; 0 disables
+    std::chrono::seconds promote_before{30 * 24 * 3600}; // Cold capsules unlocking sooner come back
+    uint64_t bytes_per_second = 32 * 1024 * 1024;    // Migration budget; 0 = unlimited
+    uint64_t pack_target_bytes = 256 * 1024 * 1024;  // Capsules per packfile, by size
+    double compact_below = 0.5;                      // Rewrite packs whose live fraction drops below this
+    std::function<void(const std::string&)> log;     // Optional diagnostics sink
+};
+
+/**
+ * @brief Where a cold capsule's ciphertext lives
+ */
+struct ColdLocation {
+    std::string pack;     // Pack path, relative to the store root when inside it
+    uint64_t offset = 0;
+    uint64_t length = 0;
+};
+
+/**
+ * @brief Outcome of one migration pass
+ */
+struct TierPass {
+    std::vector<std::string> demoted;
+    std::vector<std::string> promoted;
+    size_t packs_compacted = 0;
+    std::vector<std::string> failed;
+};
+
+/**
+ * @brief Moves far-future capsules into packfiles on a cold tier and back
+ *
+ * Only ciphertext moves; metadata stays in the store so scheduling and policy
+ * checks never touch the cold tier. Many capsules share one packfile. A
+ * journal (tier.journal, NDJSON like the catalog) records which capsules are
+ * cold and where.
+ *
+ * Every migration is ordered so that a crash leaves at least one complete copy:
+ * - Demote: write and fsync the pack under a temporary name, rename it, append
+ *   the journal records, then unlink the hot files.
+ * - Promote: copy the range to a temporary hot file, fsync, rename, then
+ *   append the journal record.
+ * - Compact: write the live entries to a new pack, journal their new
+ *   locations, then delete the old pack.
+ * On recovery a hot file always wins over a cold record, and packs that no
+ * record references are deleted.
+ */
+class TierManager {
+public:
+    using TimePoint = Policy::TimePoint;
+
+    static constexpr const char* JOURNAL_FILENAME = "tier.journal";
+    static constexpr const char* COLD_DIRNAME = "cold";
+    static constexpr const char* PACK_EXTENSION = ".pack";
+
+    TierManager(Store& store, TierOptions options = {});
+
+    bool enabled() const { return options_.demote_after.count() > 0; }
+    const std::filesystem::path& cold_dir() const { return cold_dir_; }
+
+    /**
+     * @brief Replay the journal; a missing journal means every capsule is hot
+     */
+    Result<void> open();
+
+    /**
+     * @brief Settle interrupted migrations: drop cold records shadowed by a hot
+     *        file and delete unreferenced or temporary packs
+     *
+     * Run only by the process that migrates (the daemon), since another
+     * process may be between writing a pack and journaling it.
+     */
+    Result<void> recover();
+
+    bool is_cold(const std::string& capsule_id) const;
+    std::optional<ColdLocation> location(const std::string& capsule_id) const;
+    size_t cold_count() const;
+    uint64_t cold_bytes() const;
+
+    /**
+     * @brief Move the given hot capsules into one new packfile
+     */
+    Result<void> demote(const std::vector<std::string>& capsule_ids);
+
+    /**
+     * @brief Copy a cold capsule back into the store
+     */
+    Result<void> promote(const std::string& capsule_id);
+
+    /**
+     * @brief Forget a destroyed capsule and zero its bytes in the pack
+     */
+    Result<void> drop(const std::string& capsule_id);
+
+    /**
+     * @brief Rewrite packs whose live fraction is below compact_below; returns packs rewritten
+     */
+    Result<size_t> compact();
+
+    /**
+     * @brief One rate-limited pass over the catalog: promote what is due soon,
+     *        then demote far-future capsules, then compact
+     */
+    TierPass migrate(const TimePoint& now);
+
+private:
+    Store& store_;
+    TierOptions options_;
+    std::filesystem::path cold_dir_;
+    std::filesystem::path journal_path_;
+    uint64_t journal_offset_ = 0;
+    TokenBucket budget_;
+    mutable std::mutex mutex_;
+
+    std::unordered_map<std::string, ColdLocation> cold_;
+    std::map<std::string, uint64_t> pack_live_bytes_; // Pack -> bytes still referenced
+    uint64_t sequence_ = 0;
+
+    struct PackSource {
+        std::filesystem::path path;
+        uint64_t offset = 0;
+        uint64_t length = 0;
+    };
+
+    Result<void> refresh_locked();
+    Result<void> append_locked(std::vector<nlohmann::json> records);
+    void apply(const nlohmann::json& record);
+    std::filesystem::path pack_path(const std::string& pack) const;
+    std::string pack_key(const std::filesystem::path& path) const;
+    Result<std::string> write_pack_locked(const std::vector<PackSource>& sources, std::vector<ColdLocation>& locations);
+    Result<void> demote_locked(const std::vector<std::string>& capsule_ids);
+    Result<void> promote_locked(const std::string& capsule_id);
+    Result<size_t> compact_locked(const std::optional<TimePoint>& now);
+    void delete_pack_if_empty_locked(const std::string& pack);
+    void log(const std::string& message) const;
+};
+
+} // namespace tcfs
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace tcfs {
+
+/**
+ * @brief Inverted index from lowercased trigrams to catalog slots
+ *
+ * Each posting list is a sorted run of slots, delta-encoded as LEB128
+ * varints, so a trigram shared by a million capsules costs little more than
+ * a byte per capsule. Catalog slots only grow, so adding a new capsule
+ * appends to the compressed run; re-indexing an older slot goes to a small
+ * unsorted side list that is merged back into the run once it fills up.
+ * Removal is lazy: the catalog filters dead slots and confirms every
+ * candidate against the text itself, so stale postings only cost a check.
+ *
+ * A query intersects the posting lists of the needle's trigrams, shortest
+ * first. The intersection compares four slots at a time with SSE2 where it
+ * is available.
+ */
+class TrigramIndex {
+public:
+    static constexpr size_t GRAM = 3;
+    static constexpr size_t PENDING_LIMIT = 64;
+
+    /**
+     * @brief Index every trigram of text for slot; text shorter than a trigram adds nothing
+     */
+    void add(uint32_t slot, const std::string& text);
+    void clear() { postings_.clear(); }
+
+    /**
+     * @brief Sorted slots holding every trigram of needle (at least GRAM characters); may include false positives
+     */
+    std::vector<uint32_t> candidates(const std::string& needle) const;
+
+    size_t trigram_count() const { return postings_.size(); }
+    size_t compressed_bytes() const;
+
+    /**
+     * @brief Intersection of two sorted, duplicate-free slot lists
+     */
+    static std::vector<uint32_t> intersect(const std::vector<uint32_t>& a, const std::vector<uint32_t>& b);
+
+    /**
+     * @brief Runs of literal characters in a glob pattern, split at *, ? and [...]
+     */
+    static std::vector<std::string> glob_literals(const std::string& pattern);
+
+    /**
+     * @brief Shell-style match of text against pattern with *, ? and [...] classes
+     */
+    static bool glob_match(const std::string& pattern, const std::string& text);
+
+private:
+    struct Postings {
+        std::vector<uint8_t> bytes;    // Delta + varint encoded, ascending
+        uint32_t count = 0;
+        uint32_t last = 0;
+        std::vector<uint32_t> pending; // Slots below last, not yet merged
+    };
+
+    std::unordered_map<uint32_t, Postings> postings_;
+
+    static uint32_t key(const std::string& text, size_t at);
+    static std::vector<uint32_t> decode(const Postings& postings);
+    static void encode(Postings& postings, const std::vector<uint32_t>& slots);
+    static void append(Postings& postings, uint32_t slot);
+};
+
+} // namespace tcfs
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "Policy.hpp"
+#include <cstddef>
+#include <limits>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace tcfs {
+
+/**
+ * @brief Index of capsules ordered by the next time they can be opened
+ *
+ * Each capsule has at most one entry. Scheduling, rescheduling and removal
+ * are O(log n); popping the due prefix is O(k log n) for k due capsules, so
+ * a waiting loop never rescans capsules that are not yet due.
+ *
+ * Entries restored by load() stay in a flat array sorted by time, found by id
+ * through an open-addressing table of array positions, instead of being
+ * inserted into the tree and the id map one by one. Removing or rescheduling
+ * one leaves a tombstone there, and reads merge the array with the tree.
+ */
+class UnlockScheduler {
+public:
+    using TimePoint = Policy::TimePoint;
+
+    struct Entry {
+        std::string capsule_id;
+        TimePoint due;
+    };
+
+    UnlockScheduler() = default;
+    UnlockScheduler(const UnlockScheduler&) = delete; // The id index views strings owned by this instance
+    UnlockScheduler& operator=(const UnlockScheduler&) = delete;
+    UnlockScheduler(UnlockScheduler&&) = default;
+    UnlockScheduler& operator=(UnlockScheduler&&) = default;
+
+    /**
+     * @brief (Re)schedule a capsule at its next unlock opportunity after now
+     *
+     * Capsules whose policy can never open again are removed from the index.
+     * Returns whether the capsule is scheduled.
+     */
+    bool schedule(const std::string& capsule_id, const Policy& policy, const TimePoint& now);
+
+    /**
+     * @brief (Re)schedule a capsule at an explicit time
+     */
+    void schedule_at(const std::string& capsule_id, const TimePoint& due);
+
+    void remove(const std::string& capsule_id);
+    bool contains(const std::string& capsule_id) const;
+
+    /**
+     * @brief Remove and return capsules due at or before now, earliest first
+     *
+     * Due only means the time-based parts of the policy hold; callers check
+     * Policy::is_unlock_allowed() and reschedule capsules that are not ready.
+     */
+    std::vector<Entry> pop_due(const TimePoint& now, size_t limit = std::numeric_limits<size_t>::max());
+
+    /**
+     * @brief Capsules due at or before the horizon, earliest first, without removing them
+     */
+    std::vector<Entry> peek_until(const TimePoint& horizon, size_t limit = std::numeric_limits<size_t>::max()) const;
+
+    std::optional<TimePoint> next_due() const;
+    
+    /**
+     * @brief Earliest due time strictly after the given time
+     */
+    std::optional<TimePoint> next_due_after(const TimePoint& time) const;
+    std::optional<TimePoint> due_time(const std::string& capsule_id) const;
+
+    size_t size() const { return by_id_.size() + loaded_live_; }
+    bool empty() const { return size() == 0; }
+    void clear();
+
+    /**
+     * @brief Replace the index with entries; the earliest entry for an id wins
+     *
+     * Sorting once into the flat array is much cheaper than n schedule_at()
+     * calls when restoring a large schedule.
+     */
+    void load(std::vector<Entry> entries);
+
+private:
+    using TimeIndex = std::multimap<TimePoint, std::string>;
+    static constexpr size_t NOT_LOADED = std::numeric_limits<size_t>::max();
+
+    std::vector<Entry> loaded_;         // Sorted by due; an empty id is a tombstone
+    std::vector<uint64_t> loaded_slots_; // Hash of the id in the high half, loaded_ index + 1 in the low; 0 is free
+    size_t loaded_head_ = 0;            // First live entry of loaded_, or its size
+    size_t loaded_live_ = 0;
+    TimeIndex by_time_;                 // Everything scheduled since load()
+    std::unordered_map<std::string_view, TimeIndex::iterator> by_id_; // Views the ids held by by_time_
+
+    size_t find_loaded(std::string_view capsule_id) const;
+    void drop_loaded(size_t index);
+    size_t next_loaded(size_t index) const;
+};
+
+} // namespace tcfs
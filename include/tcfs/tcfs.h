@@ -0,0 +1,122 @@
+#pragma once
+
+/*
+ * Stable C interface to libtcfs, for services that lock and unlock in-process
+ * instead of running the tcfs binary.
+ *
+ * Stores are opaque handles. Every call returns a tcfs_status; on failure,
+ * tcfs_last_error() describes what went wrong. Data moves through buffers the
+ * caller owns: tcfs_lock_buffer() encrypts straight out of the caller's memory
+ * and tcfs_unlock_range() decrypts into it, so no allocation or copy is handed
+ * across the boundary. A handle must not be used by two threads at once; open
+ * one per thread instead. No C++ exception ever crosses this interface.
+ *
+ * Only functions are added in later versions of this ABI, and existing
+ * signatures and status values never change; check tcfs_abi_version() against
+ * TCFS_ABI_VERSION to detect an older library.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32) && defined(TCFS_SHARED)
+#if defined(TCFS_BUILDING)
+#define TCFS_API __declspec(dllexport)
+#else
+#define TCFS_API __declspec(dllimport)
+#endif
+#elif defined(__GNUC__)
+#define TCFS_API __attribute__((visibility("default")))
+#else
+#define TCFS_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TCFS_ABI_VERSION 1
+
+typedef struct tcfs_store tcfs_store;
+
+typedef enum tcfs_status {
+    TCFS_OK = 0,
+    TCFS_ERR_INVALID_ARGUMENT = 1, /* Bad name, time, range or null pointer */
+    TCFS_ERR_NOT_FOUND = 2,        /* No such store or capsule */
+    TCFS_ERR_IO = 3,               /* Reading or writing a file failed */
+    TCFS_ERR_LOCKED = 4,           /* The capsule's policy or dependencies do not allow unlocking now */
+    TCFS_ERR_KEY = 5,              /* A sealed capsule and no matching credential */
+    TCFS_ERR_CORRUPTED = 6,        /* Authentication of ciphertext or metadata failed */
+    TCFS_ERR_BUFFER_TOO_SMALL = 7, /* An output buffer cannot hold the result; nothing was done */
+    TCFS_ERR_INTERNAL = 8
+} tcfs_status;
+
+/*
+ * Called by tcfs_lock_stream() for the next bytes of its input: fill up to size
+ * bytes of buffer and return how many, 0 at the end, or -1 on error.
+ */
+typedef int64_t (*tcfs_read_fn)(void* context, void* buffer, size_t size);
+
+TCFS_API uint32_t tcfs_abi_version(void);
+
+/*
+ * Open the existing store directory at root. *store is set only on success and
+ * must be released with tcfs_store_close().
+ */
+TCFS_API tcfs_status tcfs_store_open(const char* root, tcfs_store** store);
+TCFS_API void tcfs_store_close(tcfs_store* store);
+
+/*
+ * Message of the handle's last failure, valid until its next call; "" after a
+ * success. With a null store, the message of the last failed tcfs_store_open()
+ * on this thread.
+ */
+TCFS_API const char* tcfs_last_error(const tcfs_store* store);
+
+/*
+ * Open sealed capsules as recipient with passphrase; a null recipient forgets
+ * the credential.
+ */
+TCFS_API tcfs_status tcfs_store_set_credential(tcfs_store* store, const char* recipient, const char* passphrase);
+
+/*
+ * Lock size bytes of data as a capsule of the file called name (no directory
+ * part), unlocking at unlock_at (RFC 3339). The capsule id, NUL-terminated, is
+ * written to id; id_size too small fails before anything is locked.
+ */
+TCFS_API tcfs_status tcfs_lock_buffer(tcfs_store* store, const char* name, const char* unlock_at, const void* data,
+                                      size_t size, char* id, size_t id_size);
+
+/*
+ * As tcfs_lock_buffer(), reading exactly size bytes through read.
+ */
+TCFS_API tcfs_status tcfs_lock_stream(tcfs_store* store, const char* name, const char* unlock_at, tcfs_read_fn read,
+                                      void* context, uint64_t size, char* id, size_t id_size);
+
+/*
+ * Plaintext length of capsule id, or of its stage named stage when that is not null.
+ */
+TCFS_API tcfs_status tcfs_capsule_size(tcfs_store* store, const char* id, const char* stage, uint64_t* size);
+
+/*
+ * Decrypt up to size bytes of capsule id from offset into buffer, and set
+ * *written to how many; fewer than size only at the end of the capsule. With
+ * a stage name, offset counts from the start of that stage and reading stops
+ * at its end. Every stage read from must be open under its policy and the
+ * capsule's dependencies unlocked, or the call fails with TCFS_ERR_LOCKED.
+ * Capsules in the single-segment format that predates stages are refused
+ * with TCFS_ERR_INVALID_ARGUMENT, here and by tcfs_capsule_size().
+ */
+TCFS_API tcfs_status tcfs_unlock_range(tcfs_store* store, const char* id, const char* stage, uint64_t offset,
+                                       void* buffer, size_t size, size_t* written);
+
+/*
+ * Record that capsule id was unlocked, so capsules depending on it may unlock.
+ * Fails with TCFS_ERR_LOCKED, recording nothing, unless its dependencies are
+ * unlocked and every one of its stages is open under its policy.
+ */
+TCFS_API tcfs_status tcfs_mark_released(tcfs_store* store, const char* id);
+
+#ifdef __cplusplus
+}
+#endif
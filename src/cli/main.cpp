@@ -1,14 +1,51 @@
 #include <CLI/CLI.hpp>
 #include <tcfs/Policy.hpp>
+#include <tcfs/Scrubber.hpp>
+#include <tcfs/UnlockScheduler.hpp>
+#include <tcfs/CatalogStats.hpp>
 #include <tcfs/CryptoProvider.hpp>
+#include <tcfs/Daemon.hpp>
+#include <tcfs/DirectIO.hpp>
 #include <tcfs/Errors.hpp>
+#include <tcfs/EventServer.hpp>
+#include <tcfs/Federation.hpp>
+#include <tcfs/SecureDelete.hpp>
+#include <tcfs/Store.hpp>
+#include <tcfs/Sweeper.hpp>
 #include <nlohmann/json.hpp>
+#include <algorithm>
+#include <cctype>
 #include <iostream>
 #include <filesystem>
 #include <fstream>
+#include <functional>
+#include <iomanip>
+#include <limits>
+#include <map>
+#include <memory>
+#include <csignal>
+#include <optional>
+#include <unordered_set>
+
+#ifndef _WIN32
+#include <termios.h>
+#include <unistd.h>
+#endif
 
 namespace fs = std::filesystem;
 
+namespace {
+
+tcfs::Daemon* running_daemon = nullptr;
+
+void handle_stop_signal(int) {
+    if (running_daemon) {
+        running_daemon->stop();
+    }
+}
+
+} // namespace
+
 /**
  * @brief Simple CLI application for Time Capsule File System
  */
@@ -21,8 +58,13 @@ public:
         app.require_subcommand(1);
         
         // Global options
-        app.add_option("--store", store_path_, "Path to TCFS store directory")
+        app.add_option("--store", store_path_,
+                       "Path to TCFS store directory; list, due, stats and find also take several joined by ':' "
+                       "(';' on Windows), or a federation config file")
            ->default_val(get_default_store_path());
+        app.add_flag("--direct-io", direct_io_,
+                     "Lock and unlock with O_DIRECT through aligned buffers, leaving the page cache alone");
+        app.add_flag("--huge-pages", huge_pages_, "Back --direct-io buffers with huge pages where available");
         
         // Subcommands
         setup_init_command(app);
@@ -30,6 +72,19 @@ public:
         setup_unlock_command(app);
         setup_status_command(app);
         setup_list_command(app);
+        setup_find_command(app);
+        setup_due_command(app);
+        setup_stats_command(app);
+        setup_daemon_command(app);
+        setup_sweep_command(app);
+        setup_audit_command(app);
+        setup_events_command(app);
+        setup_recipients_command(app);
+        setup_group_command(app);
+        setup_update_command(app);
+        setup_disks_command(app);
+        setup_keygen_command(app);
+        setup_verify_command(app);
         
         try {
             app.parse(argc, argv);
@@ -46,8 +101,94 @@ public:
     }
 
 private:
+    /**
+     * @brief Arguments of the lock subcommand
+     */
+    struct LockArgs {
+        std::vector<std::string> input_files;
+        size_t jobs = 4;
+        std::string output_file;
+        std::string unlock_at;
+        std::string label;
+        std::string notes;
+        std::string condition;
+        std::string recurrence;
+        std::vector<std::string> depends_on;
+        std::vector<std::string> stages;
+        std::string expire_at;
+        std::string expire_after;
+        std::vector<std::string> seal_to; // NAME=PUBLIC_KEY_FILE
+        bool private_metadata = false;
+        bool resume = false;
+    };
+    
+    /**
+     * @brief Search filters of the list subcommand
+     */
+    struct ListArgs {
+        std::string label;
+        std::string notes;
+        std::string name;
+        std::string match = "exact";
+        size_t limit = 0;
+    };
+    
+    /**
+     * @brief One output line of a query over several stores; rows merge by time, then id
+     */
+    struct FederatedRow {
+        int64_t time = 0;
+        std::string id;
+        std::string text;
+    };
+    
+    /**
+     * @brief Release admission, prefetch, tiering, inbox, event and snapshot arguments of the daemon subcommand
+     */
+    struct ReleaseArgs {
+        size_t concurrency = 4;
+        std::string io_limit;
+        std::string jitter;
+        std::vector<std::string> priority_labels;
+        std::string prefetch_horizon;
+        std::string prefetch_rate;
+        std::string cold_dir;
+        std::string demote_after;
+        std::string promote_before;
+        std::string tier_rate;
+        std::string inbox;
+        std::string inbox_lock_for;
+        std::string inbox_label;
+        bool events = false;
+        std::string events_socket;
+        size_t events_buffer = 1024;
+        bool events_disconnect_slow = false;
+        std::string snapshot;
+        std::string snapshot_interval;
+        bool no_snapshot = false;
+    };
+    
+    static constexpr const char* EVENTS_SOCKET = "events.sock";
+    static constexpr const char* SNAPSHOT_FILE = "daemon.snapshot";
+    
     std::unique_ptr<tcfs::CryptoProvider> crypto_;
     std::string store_path_;
+    bool direct_io_ = false;
+    bool huge_pages_ = false;
+    std::shared_ptr<tcfs::BufferPool> buffer_pool_;
+    
+    /**
+     * @brief Switch store to direct I/O if --direct-io was given
+     */
+    void configure_io(tcfs::Store& store) {
+        if (!direct_io_) {
+            return;
+        }
+        if (!buffer_pool_) {
+            buffer_pool_ = std::make_shared<tcfs::BufferPool>(tcfs::BufferPool::DEFAULT_BUFFER_SIZE, 16, huge_pages_);
+        }
+        store.set_direct_io(buffer_pool_);
+    }
     
     std::string get_default_store_path() {
         auto home = std::getenv("HOME");
@@ -60,6 +201,20 @@ private:
         return ".tcfs";
     }
     
+    /**
+     * @brief Stores named by --store; when there is only one, store_path_ names it directly
+     */
+    std::vector<fs::path> store_roots() {
+        auto roots = tcfs::Federation::resolve(store_path_);
+        if (!roots) {
+            throw tcfs::TCFSException(roots.error(), roots.error_message());
+        }
+        if (roots.value().size() == 1) {
+            store_path_ = roots.value().front().string();
+        }
+        return std::move(roots).value();
+    }
+    
     void setup_init_command(CLI::App& app) {
         auto init_cmd = app.add_subcommand("init", "Initialize TCFS store");
         
@@ -78,23 +233,33 @@ private:
     void setup_lock_command(CLI::App& app) {
         auto lock_cmd = app.add_subcommand("lock", "Lock a file in time capsule");
         
-        auto input_file = std::make_shared<std::string>();
-        auto output_file = std::make_shared<std::string>();
-        auto unlock_at = std::make_shared<std::string>();
-        auto label = std::make_shared<std::string>();
-        auto notes = std::make_shared<std::string>();
-        
-        lock_cmd->add_option("input", *input_file, "Input file to lock")->required();
-        lock_cmd->add_option("-o,--output", *output_file, "Output encrypted file");
-        lock_cmd->add_option("--unlock-at", *unlock_at, "Unlock time (RFC3339 format)")->required();
-        lock_cmd->add_option("--label", *label, "Label for the time capsule");
-        lock_cmd->add_option("--notes", *notes, "Notes for the time capsule");
-        
-        lock_cmd->callback([this, input_file, output_file, unlock_at, label, notes]() {
-            if (output_file->empty()) {
-                *output_file = *input_file + ".tcfs";
+        auto args = std::make_shared<LockArgs>();
+        
+        lock_cmd->add_option("input", args->input_files, "Input file(s) to lock")->required();
+        lock_cmd->add_option("-o,--output", args->output_file, "Output encrypted file");
+        lock_cmd->add_option("--unlock-at", args->unlock_at, "Unlock time (RFC3339 format)")->required();
+        lock_cmd->add_option("--label", args->label, "Label for the time capsule");
+        lock_cmd->add_option("--notes", args->notes, "Notes for the time capsule");
+        lock_cmd->add_option("--condition", args->condition, "Additional unlock condition (JSON expression)");
+        lock_cmd->add_option("--recurrence", args->recurrence, "Recurring unlock window (JSON rule)");
+        lock_cmd->add_option("--after", args->depends_on, "Capsule that must be unlocked first (repeatable)");
+        lock_cmd->add_option("--stage", args->stages, "Later stage as OFFSET@TIME, e.g. 4M@2027-01-01T00:00:00Z (repeatable)");
+        lock_cmd->add_option("--expire-at", args->expire_at, "Destroy the capsule at this time (RFC3339 format)");
+        lock_cmd->add_option("--expire-after", args->expire_after, "Destroy the capsule this long after its unlock time (e.g. 90d)");
+        lock_cmd->add_option("-j,--jobs", args->jobs, "Files encrypted in parallel when locking several");
+        lock_cmd->add_option("--seal-to", args->seal_to, "Seal to a recipient's X25519 key as NAME=PUBLIC_KEY_FILE (repeatable)");
+        lock_cmd->add_flag("--private", args->private_metadata, "Encrypt label, notes and file name in the metadata");
+        lock_cmd->add_flag("--resume", args->resume, "Continue an interrupted lock from its last checkpoint");
+        
+        lock_cmd->callback([this, args]() {
+            if (args->input_files.size() > 1) {
+                cmd_lock_batch(*args);
+                return;
             }
-            cmd_lock(*input_file, *output_file, *unlock_at, *label, *notes);
+            if (args->output_file.empty()) {
+                args->output_file = args->input_files.front() + ".tcfs";
+            }
+            cmd_lock(*args);
         });
     }
     
@@ -103,12 +268,20 @@ private:
         
         auto input_file = std::make_shared<std::string>();
         auto output_file = std::make_shared<std::string>();
+        auto stage = std::make_shared<std::string>();
+        auto as = std::make_shared<std::string>();
+        auto key_file = std::make_shared<std::string>();
+        auto resume = std::make_shared<bool>(false);
         
         unlock_cmd->add_option("input", *input_file, "Encrypted file to unlock")->required();
         unlock_cmd->add_option("-o,--output", *output_file, "Output decrypted file")->required();
+        unlock_cmd->add_option("--stage", *stage, "Unlock only this stage of a staged capsule");
+        unlock_cmd->add_option("--as", *as, "Open a sealed capsule as this recipient (asks for the passphrase)");
+        unlock_cmd->add_option("--key", *key_file, "X25519 private key file of the --as recipient, instead of a passphrase");
+        unlock_cmd->add_flag("--resume", *resume, "Continue an interrupted unlock from its last checkpoint");
         
-        unlock_cmd->callback([this, input_file, output_file]() {
-            cmd_unlock(*input_file, *output_file);
+        unlock_cmd->callback([this, input_file, output_file, stage, as, key_file, resume]() {
+            cmd_unlock(*input_file, *output_file, *stage, credential_for(*as, *key_file), *resume);
         });
     }
     
@@ -127,8 +300,318 @@ private:
     void setup_list_command(CLI::App& app) {
         auto list_cmd = app.add_subcommand("list", "List time capsule files in store");
         
+        auto args = std::make_shared<ListArgs>();
+        
+        list_cmd->add_option("--label", args->label, "Only capsules with this label");
+        list_cmd->add_option("--notes", args->notes, "Only capsules with these notes");
+        list_cmd->add_option("--name", args->name, "Only capsules with this original file name");
+        list_cmd->add_option("--match", args->match, "How filters compare: exact, prefix or contains");
+        list_cmd->add_option("--limit", args->limit, "Show at most this many capsules (0 for all)");
+        
+        list_cmd->callback([this, args]() {
+            auto roots = store_roots();
+            if (roots.size() > 1) {
+                cmd_list_federated(roots, *args);
+            } else if (args->label.empty() && args->notes.empty() && args->name.empty()) {
+                cmd_list(args->limit);
+            } else {
+                cmd_list_matching(*args);
+            }
+        });
+    }
+    
+    void setup_find_command(CLI::App& app) {
+        auto find_cmd = app.add_subcommand("find", "Search labels, notes and file names from the catalog");
+        
+        auto text = std::make_shared<std::string>();
+        auto glob = std::make_shared<std::string>();
+        auto limit = std::make_shared<size_t>(0);
+        
+        find_cmd->add_option("text", *text, "Text to look for, ignoring case");
+        find_cmd->add_option("--name", *glob, "Only capsules whose original file name matches this glob (e.g. '*.pdf')");
+        find_cmd->add_option("--limit", *limit, "Show at most this many capsules (0 for all)");
+        
+        find_cmd->callback([this, text, glob, limit]() {
+            auto roots = store_roots();
+            if (roots.size() > 1) {
+                cmd_find_federated(roots, *text, *glob, *limit);
+            } else {
+                cmd_find(*text, *glob, *limit);
+            }
+        });
+    }
+    
+    void setup_due_command(CLI::App& app) {
+        auto due_cmd = app.add_subcommand("due", "List capsules by next unlock opportunity");
+        
+        auto within = std::make_shared<std::string>();
+        auto limit = std::make_shared<size_t>(0);
+        
+        due_cmd->add_option("--within", *within, "Only show capsules opening within this duration (e.g. 7d)");
+        due_cmd->add_option("--limit", *limit, "Show at most this many capsules (0 for all)");
+        
+        due_cmd->callback([this, within, limit]() {
+            cmd_due(*within, *limit);
+        });
+    }
+    
+    void setup_stats_command(CLI::App& app) {
+        auto stats_cmd = app.add_subcommand("stats", "Show capsule counts and sizes, and when bytes unlock");
+        
+        auto timeline = std::make_shared<bool>(false);
+        auto bucket = std::make_shared<std::string>("day");
+        auto horizon = std::make_shared<std::string>("365d");
+        auto format = std::make_shared<std::string>("table");
+        auto top = std::make_shared<size_t>(10);
+        
+        stats_cmd->add_flag("--timeline", *timeline, "Also show locked bytes by unlock time");
+        stats_cmd->add_option("--bucket", *bucket, "Timeline bucket: hour, day or week");
+        stats_cmd->add_option("--horizon", *horizon, "How far ahead the timeline reaches (e.g. 365d)");
+        stats_cmd->add_option("--format", *format, "Output format: table or ndjson");
+        stats_cmd->add_option("--top", *top, "Labels and owners shown in a table (0 for all)");
+        
+        stats_cmd->callback([this, timeline, bucket, horizon, format, top]() {
+            cmd_stats(*timeline, *bucket, *horizon, *format, *top);
+        });
+    }
+    
+    void setup_daemon_command(CLI::App& app) {
+        auto daemon_cmd = app.add_subcommand("daemon", "Release capsules as they become due");
+        
+        auto release_dir = std::make_shared<std::string>();
+        auto poll_interval = std::make_shared<std::string>("60s");
+        auto once = std::make_shared<bool>(false);
+        auto release = std::make_shared<ReleaseArgs>();
+        
+        daemon_cmd->add_option("--release-dir", *release_dir, "Decrypt released capsules into this directory");
+        daemon_cmd->add_option("--poll-interval", *poll_interval, "How often to pick up newly locked capsules (e.g. 60s)");
+        daemon_cmd->add_flag("--once", *once, "Release what is due now and exit");
+        daemon_cmd->add_option("--concurrency", release->concurrency, "Capsules decrypted in parallel");
+        daemon_cmd->add_option("--io-limit", release->io_limit, "Ciphertext read budget per second (e.g. 200M)");
+        daemon_cmd->add_option("--jitter", release->jitter, "Spread releases due at the same time over this window (e.g. 30s)");
+        daemon_cmd->add_option("--priority-label", release->priority_labels, "Release capsules with this label first (repeatable)");
+        daemon_cmd->add_option("--prefetch-horizon", release->prefetch_horizon, "Read ahead capsules due within this window (e.g. 10m)");
+        daemon_cmd->add_option("--prefetch-rate", release->prefetch_rate, "Readahead budget per second (e.g. 64M)");
+        daemon_cmd->add_option("--demote-after", release->demote_after, "Move capsules unlocking further out than this to the cold tier (e.g. 365d)");
+        daemon_cmd->add_option("--promote-before", release->promote_before, "Bring cold capsules back this long before they unlock (default 30d)");
+        daemon_cmd->add_option("--cold-dir", release->cold_dir, "Cold tier directory (default <store>/cold)");
+        daemon_cmd->add_option("--tier-rate", release->tier_rate, "Migration budget per second (e.g. 32M)");
+        daemon_cmd->add_option("--inbox", release->inbox, "Lock files dropped into this directory");
+        daemon_cmd->add_option("--inbox-lock-for", release->inbox_lock_for, "Unlock inbox files this long after they arrive (default 30d)");
+        daemon_cmd->add_option("--inbox-label", release->inbox_label, "Label for capsules locked from the inbox");
+        daemon_cmd->add_flag("--events", release->events, "Serve lock/release events on <store>/events.sock");
+        daemon_cmd->add_option("--events-socket", release->events_socket, "Serve lock/release events on this Unix socket");
+        daemon_cmd->add_option("--events-buffer", release->events_buffer, "Events queued per subscriber before it counts as slow");
+        daemon_cmd->add_flag("--events-disconnect-slow", release->events_disconnect_slow, "Disconnect slow subscribers instead of skipping events");
+        daemon_cmd->add_option("--snapshot", release->snapshot, "Scheduler snapshot for fast restarts (default <store>/daemon.snapshot)");
+        daemon_cmd->add_option("--snapshot-interval", release->snapshot_interval, "Rewrite the snapshot at most this often (default 10m)");
+        daemon_cmd->add_flag("--no-snapshot", release->no_snapshot, "Always rebuild the schedule from the journal");
+        
+        daemon_cmd->callback([this, release_dir, poll_interval, once, release]() {
+            cmd_daemon(*release_dir, *poll_interval, *once, *release);
+        });
+    }
+    
+    void setup_sweep_command(CLI::App& app) {
+        auto sweep_cmd = app.add_subcommand("sweep", "Destroy capsules past their expiry time");
+        
+        auto batch_size = std::make_shared<size_t>(256);
+        
+        sweep_cmd->add_option("--batch-size", *batch_size, "Capsules destroyed per batch");
+        
+        sweep_cmd->callback([this, batch_size]() {
+            cmd_sweep(*batch_size);
+        });
+    }
+    
+    void setup_events_command(CLI::App& app) {
+        auto events_cmd = app.add_subcommand("events", "Stream lock/release events from a running daemon");
+        
+        auto filter = std::make_shared<tcfs::EventFilter>();
+        auto socket = std::make_shared<std::string>();
+        auto count = std::make_shared<size_t>(0);
+        
+        events_cmd->add_option("--type", filter->types, "Only these event types: locked, released, destroyed, removed (repeatable)");
+        events_cmd->add_option("--label", filter->labels, "Only capsules with this label (repeatable)");
+        events_cmd->add_option("--owner", filter->owners, "Only capsules of this owner (repeatable)");
+        events_cmd->add_option("--id", filter->capsule_ids, "Only this capsule (repeatable)");
+        events_cmd->add_option("--socket", *socket, "Daemon event socket (default <store>/events.sock)");
+        events_cmd->add_option("--count", *count, "Exit after this many events");
+        
+        events_cmd->callback([this, filter, socket, count]() {
+            cmd_events(*filter, *socket, *count);
+        });
+    }
+    
+    void setup_recipients_command(CLI::App& app) {
+        auto recipients_cmd = app.add_subcommand("recipients", "Manage who can open a capsule");
+        recipients_cmd->require_subcommand(1);
+        
+        auto input_file = std::make_shared<std::string>();
+        auto recipient = std::make_shared<std::string>();
+        auto as = std::make_shared<std::string>();
+        auto iterations = std::make_shared<uint32_t>(tcfs::KeySlots::DEFAULT_ITERATIONS);
+        
+        auto add_cmd = recipients_cmd->add_subcommand("add", "Give a recipient a key slot; the first one seals the capsule");
+        add_cmd->add_option("input", *input_file, "Capsule")->required();
+        add_cmd->add_option("recipient", *recipient, "Recipient name")->required();
+        auto key_file = std::make_shared<std::string>();
+        add_cmd->add_option("--as", *as, "Existing recipient authorizing the change (required once sealed)");
+        add_cmd->add_option("--key", *key_file, "X25519 private key file of the --as recipient, instead of a passphrase");
+        add_cmd->add_option("--iterations", *iterations, "PBKDF2 iterations for the new slot");
+        add_cmd->callback([this, input_file, recipient, as, key_file, iterations]() {
+            cmd_recipients_add(*input_file, *recipient, credential_for(*as, *key_file), *iterations);
+        });
+        
+        auto remove_cmd = recipients_cmd->add_subcommand("remove", "Drop a recipient's key slot");
+        remove_cmd->add_option("input", *input_file, "Capsule")->required();
+        remove_cmd->add_option("recipient", *recipient, "Recipient name")->required();
+        remove_cmd->callback([this, input_file, recipient]() {
+            cmd_recipients_remove(*input_file, *recipient);
+        });
+        
+        auto list_cmd = recipients_cmd->add_subcommand("list", "List the recipients of a capsule");
+        list_cmd->add_option("input", *input_file, "Capsule")->required();
+        list_cmd->callback([this, input_file]() {
+            cmd_recipients_list(*input_file);
+        });
+    }
+    
+    void setup_group_command(CLI::App& app) {
+        auto group_cmd = app.add_subcommand("group", "Manage capsule groups that share one policy");
+        group_cmd->require_subcommand(1);
+        
+        auto name = std::make_shared<std::string>();
+        
+        auto args = std::make_shared<LockArgs>();
+        auto create_cmd = group_cmd->add_subcommand("create", "Create a group and its shared policy");
+        create_cmd->add_option("name", *name, "Group name")->required();
+        create_cmd->add_option("--unlock-at", args->unlock_at, "Unlock time (RFC3339 format)")->required();
+        create_cmd->add_option("--label", args->label, "Label shared by the members");
+        create_cmd->add_option("--notes", args->notes, "Notes shared by the members");
+        create_cmd->add_option("--condition", args->condition, "Additional unlock condition (JSON expression)");
+        create_cmd->add_option("--recurrence", args->recurrence, "Recurring unlock window (JSON rule)");
+        create_cmd->add_option("--after", args->depends_on, "Capsule that must be unlocked first (repeatable)");
+        create_cmd->add_option("--expire-at", args->expire_at, "Destroy the members at this time (RFC3339 format)");
+        create_cmd->add_option("--expire-after", args->expire_after, "Destroy the members this long after the unlock time (e.g. 90d)");
+        create_cmd->callback([this, name, args]() {
+            cmd_group_create(*name, *args);
+        });
+        
+        auto add_cmd = group_cmd->add_subcommand("add", "Lock files as members of a group");
+        add_cmd->add_option("name", *name, "Group name")->required();
+        add_cmd->add_option("input", args->input_files, "Input file(s) to lock")->required();
+        add_cmd->add_option("-j,--jobs", args->jobs, "Files encrypted in parallel");
+        add_cmd->add_option("--seal-to", args->seal_to, "Seal to a recipient's X25519 key as NAME=PUBLIC_KEY_FILE (repeatable)");
+        add_cmd->callback([this, name, args]() {
+            cmd_group_add(*name, *args);
+        });
+        
+        auto list_cmd = group_cmd->add_subcommand("list", "List groups with their member counts");
+        list_cmd->callback([this]() {
+            cmd_group_list();
+        });
+        
+        auto status_cmd = group_cmd->add_subcommand("status", "Evaluate a group's policy once for all its members");
+        status_cmd->add_option("name", *name, "Group name")->required();
+        status_cmd->callback([this, name]() {
+            cmd_group_status(*name);
+        });
+        
+        auto to = std::make_shared<std::string>();
+        auto by = std::make_shared<std::string>();
+        auto extend_cmd = group_cmd->add_subcommand("extend", "Move a group's unlock time later");
+        extend_cmd->add_option("name", *name, "Group name")->required();
+        extend_cmd->add_option("--to", *to, "New unlock time (RFC3339 format)");
+        extend_cmd->add_option("--by", *by, "Delay the unlock time by this long (e.g. 30d)");
+        extend_cmd->callback([this, name, to, by]() {
+            cmd_group_extend(*name, *to, *by);
+        });
+    }
+    
+    void setup_update_command(CLI::App& app) {
+        auto update_cmd = app.add_subcommand("update", "Move the unlock time of every matching capsule later");
+        
+        auto where = std::make_shared<std::string>();
+        auto extend = std::make_shared<std::string>();
+        auto to = std::make_shared<std::string>();
+        auto jobs = std::make_shared<size_t>(4);
+        auto dry_run = std::make_shared<bool>(false);
+        
+        update_cmd->add_option("--where", *where, "Catalog filter, e.g. 'label~taxes,unlock<2030-01-01T00:00:00Z'")->required();
+        update_cmd->add_option("--extend", *extend, "Delay each unlock time by this long (e.g. 30d)");
+        update_cmd->add_option("--to", *to, "Move each unlock time to this time (RFC3339 format)");
+        update_cmd->add_option("-j,--jobs", *jobs, "Metadata files rewritten in parallel");
+        update_cmd->add_flag("--dry-run", *dry_run, "Only list the capsules the filter selects");
+        
+        update_cmd->callback([this, where, extend, to, jobs, dry_run]() {
+            cmd_update(*where, *extend, *to, *jobs, *dry_run);
+        });
+    }
+    
+    void setup_disks_command(CLI::App& app) {
+        auto disks_cmd = app.add_subcommand("disks", "Spread capsule ciphertext over several data directories");
+        disks_cmd->require_subcommand(1);
+        
+        auto dir = std::make_shared<std::string>();
+        auto jobs = std::make_shared<size_t>(4);
+        
+        auto add_cmd = disks_cmd->add_subcommand("add", "Add a data directory and move its share of capsules there");
+        add_cmd->add_option("dir", *dir, "Data directory, typically on its own disk")->required();
+        add_cmd->add_option("-j,--jobs", *jobs, "Capsules copied in parallel");
+        add_cmd->callback([this, dir, jobs]() {
+            cmd_disks_add(*dir, *jobs);
+        });
+        
+        auto list_cmd = disks_cmd->add_subcommand("list", "List data directories with their capsule counts and sizes");
         list_cmd->callback([this]() {
-            cmd_list();
+            cmd_disks_list();
+        });
+        
+        auto rebalance_cmd = disks_cmd->add_subcommand("rebalance", "Finish an interrupted move and remove stale copies");
+        rebalance_cmd->add_option("-j,--jobs", *jobs, "Capsules copied in parallel");
+        rebalance_cmd->callback([this, jobs]() {
+            cmd_disks_rebalance(*jobs);
+        });
+    }
+    
+    void setup_keygen_command(CLI::App& app) {
+        auto keygen_cmd = app.add_subcommand("keygen", "Create an X25519 key pair for sealed capsules");
+        
+        auto name = std::make_shared<std::string>();
+        auto dir = std::make_shared<std::string>(".");
+        
+        keygen_cmd->add_option("name", *name, "Writes NAME.key and NAME.pub")->required();
+        keygen_cmd->add_option("--dir", *dir, "Directory for the key files");
+        
+        keygen_cmd->callback([this, name, dir]() {
+            cmd_keygen(*name, *dir);
+        });
+    }
+    
+    void setup_verify_command(CLI::App& app) {
+        auto verify_cmd = app.add_subcommand("verify", "Check the host signatures of capsule headers");
+        
+        auto names = std::make_shared<std::vector<std::string>>();
+        auto trust = std::make_shared<std::vector<std::string>>();
+        auto options = std::make_shared<tcfs::ScrubberOptions>();
+        
+        verify_cmd->add_option("capsules", *names, "Capsules to verify (default: all)");
+        verify_cmd->add_option("--trust", *trust, "Ed25519 public key file of a trusted signer (default: this store's host.pub)");
+        verify_cmd->add_option("-j,--jobs", options->workers, "Headers verified in parallel");
+        verify_cmd->add_option("--batch-size", options->batch_size, "Headers per verification batch");
+        verify_cmd->add_flag("--require-signatures", options->require_signatures, "Fail on unsigned headers");
+        
+        verify_cmd->callback([this, names, trust, options]() {
+            cmd_verify(*names, *trust, *options);
+        });
+    }
+    
+    void setup_audit_command(CLI::App& app) {
+        auto audit_cmd = app.add_subcommand("audit", "Show the audit log and verify its hash chain");
+        
+        audit_cmd->callback([this]() {
+            cmd_audit();
         });
     }
     
@@ -137,249 +620,348 @@ private:
         std::cout << "Owner: " << owner << std::endl;
         std::cout << "KDF: " << kdf << std::endl;
         
-        // Create store directory
-        fs::create_directories(store_path_);
-        
-        // Create config file
-        nlohmann::json config;
-        config["version"] = "0.1.0";
-        config["owner"] = owner;
-        config["kdf"] = kdf;
-        config["created_at"] = tcfs::time_utils::format_rfc3339(tcfs::time_utils::now());
-        
-        auto config_path = fs::path(store_path_) / "config.json";
-        std::ofstream config_file(config_path);
-        if (!config_file) {
-            throw tcfs::TCFSException(tcfs::ErrorCode::FILE_ACCESS_ERROR, "Failed to create config file: " + config_path.string());
+        tcfs::Store store(store_path_);
+        auto initialized = store.init(owner, kdf);
+        if (!initialized) {
+            throw tcfs::TCFSException(initialized.error(), initialized.error_message());
         }
-        config_file << config.dump(2) << std::endl;
         
         std::cout << "TCFS store initialized successfully!" << std::endl;
     }
     
-    void cmd_lock(const std::string& input_file, const std::string& output_file,
-                  const std::string& unlock_at, const std::string& label, const std::string& notes) {
-        
-        std::cout << "Locking file: " << input_file << std::endl;
-        std::cout << "Output: " << output_file << std::endl;
-        std::cout << "Unlock at: " << unlock_at << std::endl;
+    tcfs::Policy build_policy(const LockArgs& args, const std::string& owner) {
+        tcfs::Policy policy;
+        policy.set_unlock_time(args.unlock_at);
+        policy.set_owner(owner);
+        policy.set_label(args.label);
+        policy.set_notes(args.notes);
+        policy.set_depends_on(args.depends_on);
         
-        // Check if input file exists
-        if (!fs::exists(input_file)) {
-            throw tcfs::TCFSException(tcfs::ErrorCode::FileNotFound, "Input file not found: " + input_file);
+        if (!args.expire_at.empty() && !args.expire_after.empty()) {
+            throw tcfs::TCFSException(tcfs::ErrorCode::InvalidArgument, "Use either --expire-at or --expire-after, not both");
+        }
+        if (!args.expire_at.empty()) {
+            auto expire_at = tcfs::time_utils::parse_rfc3339(args.expire_at);
+            if (!expire_at) {
+                throw tcfs::TCFSException(expire_at.error(), expire_at.error_message());
+            }
+            policy.set_expire_at(expire_at.value());
+        } else if (!args.expire_after.empty()) {
+            auto expire_after = tcfs::time_utils::parse_duration(args.expire_after);
+            if (!expire_after) {
+                throw tcfs::TCFSException(expire_after.error(), expire_after.error_message());
+            }
+            policy.set_expire_at(policy.unlock_time() + expire_after.value());
         }
         
-        // Load owner from config if store exists
-        std::string owner = "user@example.com"; // Default
-        auto config_path = fs::path(store_path_) / "config.json";
-        if (fs::exists(config_path)) {
-            std::ifstream config_file(config_path, std::ios::binary);
-            if (config_file) {
-                try {
-                    nlohmann::json config;
-                    config_file >> config;
-                    if (config.contains("owner")) {
-                        owner = config["owner"];
-                    }
-                } catch (const nlohmann::json::exception& e) {
-                    std::cerr << "Warning: Failed to parse config file: " << e.what() << std::endl;
-                }
+        if (!args.condition.empty()) {
+            nlohmann::json condition_json;
+            try {
+                condition_json = nlohmann::json::parse(args.condition);
+            } catch (const nlohmann::json::exception& e) {
+                throw tcfs::TCFSException(tcfs::ErrorCode::InvalidPolicy, "Invalid condition JSON: " + std::string(e.what()));
+            }
+            auto condition_result = tcfs::Condition::from_json(condition_json);
+            if (!condition_result) {
+                throw tcfs::TCFSException(condition_result.error(), condition_result.error_message());
             }
+            policy.set_condition(std::move(condition_result).value());
         }
         
-        // Create policy
-        tcfs::Policy policy;
-        policy.set_unlock_time(unlock_at);
-        policy.set_owner(owner);
-        policy.set_label(label);
-        policy.set_notes(notes);
+        if (!args.recurrence.empty()) {
+            nlohmann::json recurrence_json;
+            try {
+                recurrence_json = nlohmann::json::parse(args.recurrence);
+            } catch (const nlohmann::json::exception& e) {
+                throw tcfs::TCFSException(tcfs::ErrorCode::InvalidPolicy, "Invalid recurrence JSON: " + std::string(e.what()));
+            }
+            auto recurrence_result = tcfs::Recurrence::from_json(recurrence_json);
+            if (!recurrence_result) {
+                throw tcfs::TCFSException(recurrence_result.error(), recurrence_result.error_message());
+            }
+            policy.set_recurrence(std::move(recurrence_result).value());
+        }
         
         auto validation = policy.validate();
         if (!validation) {
             throw tcfs::TCFSException(validation.error(), validation.error_message());
         }
-        
-        // Read input file
-        std::ifstream file(input_file, std::ios::binary);
-        if (!file) {
-            throw tcfs::TCFSException(tcfs::ErrorCode::FILE_ACCESS_ERROR, "Failed to read input file: " + input_file);
+        return policy;
+    }
+    
+    // Byte counts accept K, M and G suffixes (powers of 1024)
+    static std::optional<uint64_t> parse_size(const std::string& text) {
+        try {
+            size_t consumed = 0;
+            uint64_t value = std::stoull(text, &consumed);
+            auto suffix = text.substr(consumed);
+            if (suffix == "K" || suffix == "k") {
+                return value << 10;
+            } else if (suffix == "M" || suffix == "m") {
+                return value << 20;
+            } else if (suffix == "G" || suffix == "g") {
+                return value << 30;
+            } else if (suffix.empty()) {
+                return value;
+            }
+        } catch (const std::exception&) {
         }
-        std::vector<uint8_t> file_data((std::istreambuf_iterator<char>(file)),
-                                       std::istreambuf_iterator<char>());
-        file.close();
-        
-        // Generate encryption materials
-        auto data_key = crypto_->generateKey();
-        auto iv = crypto_->generateIV();
-        
-        // Encrypt file data
-        auto encrypted_data = crypto_->encrypt(file_data, data_key, iv);
-        
-        // Write encrypted file to store
-        auto store_output_path = fs::path(store_path_) / (fs::path(input_file).filename().string() + ".tcfs");
-        std::ofstream output(store_output_path, std::ios::binary);
-        if (!output) {
-            throw tcfs::TCFSException(tcfs::ErrorCode::FILE_ACCESS_ERROR, "Failed to write encrypted file: " + store_output_path.string());
+        return std::nullopt;
+    }
+    
+    std::vector<tcfs::ChunkedCapsule::StageSpec> build_stages(const LockArgs& args, const tcfs::Policy& policy) {
+        std::vector<tcfs::ChunkedCapsule::StageSpec> stages;
+        for (const auto& spec : args.stages) {
+            auto at = spec.find('@');
+            if (at == std::string::npos || at == 0) {
+                throw tcfs::TCFSException(tcfs::ErrorCode::InvalidArgument, "Stage must be OFFSET@TIME: " + spec);
+            }
+            
+            auto offset = parse_size(spec.substr(0, at));
+            if (!offset) {
+                throw tcfs::TCFSException(tcfs::ErrorCode::InvalidArgument, "Invalid stage offset: " + spec);
+            }
+            
+            auto stage_policy = policy;
+            stage_policy.set_unlock_time(spec.substr(at + 1));
+            stages.push_back({"part" + std::to_string(stages.size() + 2), std::move(stage_policy), *offset});
         }
-        output.write(reinterpret_cast<const char*>(encrypted_data.ciphertext.data()), 
-                    encrypted_data.ciphertext.size());
-        output.close();
-        
-        // Create metadata file
-        nlohmann::json metadata;
-        metadata["policy"] = policy.to_json();
-        metadata["iv"] = crypto_->toBase64(encrypted_data.iv);
-        metadata["tag"] = crypto_->toBase64(encrypted_data.tag);
-        metadata["data_key_encrypted"] = crypto_->toBase64(data_key.data); // Simple storage for now
-        metadata["created_at"] = tcfs::time_utils::format_rfc3339(tcfs::time_utils::now());
-        metadata["tool_version"] = "0.1.0";
-        metadata["original_filename"] = fs::path(input_file).filename().string();
+        return stages;
+    }
+    
+    void cmd_lock(const LockArgs& args) {
+        const auto& input_file = args.input_files.front();
+        std::cout << "Locking file: " << input_file << std::endl;
+        std::cout << "Output: " << args.output_file << std::endl;
+        std::cout << "Unlock at: " << args.unlock_at << std::endl;
         
-        auto metadata_path = store_output_path.string() + ".meta";
-        std::ofstream meta_output(metadata_path, std::ios::binary);
-        if (!meta_output) {
-            throw tcfs::TCFSException(tcfs::ErrorCode::FILE_ACCESS_ERROR, "Failed to write metadata file: " + metadata_path);
+        // Check if input file exists
+        if (!fs::exists(input_file)) {
+            throw tcfs::TCFSException(tcfs::ErrorCode::FileNotFound, "Input file not found: " + input_file);
         }
         
-        try {
-            // Use dump with ensure_ascii=false to properly handle UTF-8
-            std::string json_str = metadata.dump(2, ' ', false, nlohmann::json::error_handler_t::replace);
-            meta_output << json_str << std::endl;
-        } catch (const nlohmann::json::exception& e) {
-            meta_output.close();
-            throw tcfs::TCFSException(tcfs::ErrorCode::FILE_ACCESS_ERROR, "JSON serialization error: " + std::string(e.what()));
+        tcfs::Store store(store_path_);
+        configure_io(store);
+        store.set_checkpoint_options({tcfs::CheckpointOptions::DEFAULT_INTERVAL, args.resume});
+        store.set_seal_recipients(load_seal_recipients(args.seal_to));
+        store.set_private_metadata(args.private_metadata);
+        auto policy = build_policy(args, store.default_owner());
+        auto stages = build_stages(args, policy);
+        
+        auto locked = store.lock(input_file, policy, stages);
+        if (!locked) {
+            throw tcfs::TCFSException(locked.error(), locked.error_message());
         }
-        meta_output.close();
+        const auto& id = locked.value();
         
         // Delete original file (THIS IS THE KEY PART!)
-        std::error_code ec;
-        if (!fs::remove(input_file, ec)) {
-            std::cerr << "Warning: Failed to delete original file: " << ec.message() << std::endl;
+        auto deleted = tcfs::secure_delete(input_file);
+        if (!deleted) {
+            std::cerr << "Warning: Failed to delete original file: " << deleted.error_message() << std::endl;
         }
         
         std::cout << "File locked successfully!" << std::endl;
-        std::cout << "Encrypted file: " << store_output_path << std::endl;
-        std::cout << "Metadata file: " << metadata_path << std::endl;
+        std::cout << "Encrypted file: " << store.capsule_path(id) << std::endl;
+        std::cout << "Metadata file: " << store.metadata_path(id).string() << std::endl;
+        if (policy.expire_at()) {
+            std::cout << "Expires at: " << tcfs::time_utils::format_rfc3339(*policy.expire_at()) << std::endl;
+        }
+        if (!policy.depends_on().empty()) {
+            std::cout << "Unlocks only after: " << nlohmann::json(policy.depends_on()).dump() << std::endl;
+        }
+        if (!stages.empty()) {
+            auto layout = store.read_layout(id);
+            if (layout) {
+                std::cout << "Stages:" << std::endl;
+                print_stages(layout.value());
+            }
+        }
         std::cout << "Original file deleted for security!" << std::endl;
     }
     
-    void cmd_unlock(const std::string& input_file, const std::string& output_file) {
-        std::cout << "Attempting to unlock: " << input_file << std::endl;
-        
-        // Look for the file in store (either by name or with .tcfs extension)
-        auto store_file_path = fs::path(store_path_) / (input_file + ".tcfs");
-        auto metadata_path = store_file_path.string() + ".meta";
-        
-        // If not found, try with the input_file as is
-        if (!fs::exists(store_file_path)) {
-            store_file_path = fs::path(store_path_) / input_file;
-            metadata_path = store_file_path.string() + ".meta";
-        }
-        
-        // Check if encrypted file exists
-        if (!fs::exists(store_file_path)) {
-            throw tcfs::TCFSException(tcfs::ErrorCode::FileNotFound, "Encrypted file not found in store: " + store_file_path.string());
+    void cmd_lock_batch(const LockArgs& args) {
+        if (!args.stages.empty() || !args.output_file.empty()) {
+            throw tcfs::TCFSException(tcfs::ErrorCode::InvalidArgument, "--stage and --output take a single input file");
         }
-        
-        // Check if metadata file exists
-        if (!fs::exists(metadata_path)) {
-            throw tcfs::TCFSException(tcfs::ErrorCode::FileNotFound, "Metadata file not found: " + metadata_path);
+        std::cout << "Locking " << args.input_files.size() << " files" << std::endl;
+        std::cout << "Unlock at: " << args.unlock_at << std::endl;
+        
+        tcfs::Store store(store_path_);
+        configure_io(store);
+        store.set_checkpoint_options({tcfs::CheckpointOptions::DEFAULT_INTERVAL, args.resume});
+        store.set_seal_recipients(load_seal_recipients(args.seal_to));
+        store.set_private_metadata(args.private_metadata);
+        auto policy = build_policy(args, store.default_owner());
+        std::vector<fs::path> inputs(args.input_files.begin(), args.input_files.end());
+        
+        auto result = store.lock_batch(inputs, policy, args.jobs);
+        if (!result) {
+            throw tcfs::TCFSException(result.error(), result.error_message());
         }
         
-        // Read and parse metadata
-        std::ifstream metadata_file(metadata_path, std::ios::binary);
-        if (!metadata_file) {
-            throw tcfs::TCFSException(tcfs::ErrorCode::FILE_ACCESS_ERROR, "Failed to read metadata file: " + metadata_path);
-        }
-
-        nlohmann::json metadata;
-        try {
-            metadata_file >> metadata;
-        } catch (const nlohmann::json::exception& e) {
-            metadata_file.close();
-            throw tcfs::TCFSException(tcfs::ErrorCode::InvalidMetadata, "JSON parsing error: " + std::string(e.what()));
+        for (const auto& input : inputs) {
+            auto id = store.id_for(input).value();
+            auto locked = std::find(result.value().locked.begin(), result.value().locked.end(), id);
+            if (locked == result.value().locked.end()) {
+                continue;
+            }
+            auto deleted = tcfs::secure_delete(input);
+            if (!deleted) {
+                std::cerr << "Warning: Failed to delete original file: " << deleted.error_message() << std::endl;
+            }
+            std::cout << "  locked " << input.string() << " -> " << store.capsule_path(id).string() << std::endl;
         }
-        metadata_file.close();
-        
-        // Parse policy from metadata
-        if (!metadata.contains("policy")) {
-            throw tcfs::TCFSException(tcfs::ErrorCode::InvalidMetadata, "Policy not found in metadata");
+        for (const auto& [input, reason] : result.value().failed) {
+            std::cerr << "  failed " << input.string() << ": " << reason << std::endl;
         }
-
-        auto policy_result = tcfs::Policy::from_json(metadata["policy"], true); // Skip time validation for unlock
-        if (!policy_result) {
-            std::string error_msg = "Failed to parse policy from metadata";
-            if (!policy_result.error_message().empty()) {
-                error_msg += ": " + policy_result.error_message();
-            }
-            throw tcfs::TCFSException(tcfs::ErrorCode::InvalidMetadata, error_msg);
+        std::cout << "Locked " << result.value().locked.size() << " of " << inputs.size()
+                  << " files; originals deleted for security!" << std::endl;
+        if (!result.value().failed.empty()) {
+            throw tcfs::TCFSException(tcfs::ErrorCode::FILE_ACCESS_ERROR,
+                                      std::to_string(result.value().failed.size()) + " file(s) could not be locked");
         }
-        
-        auto& policy = policy_result.value();
-        
+    }
+    
+    bool check_unlock_policy(const tcfs::Policy& policy) {
         // Check if unlock time has been reached
         if (!policy.is_unlock_time_reached()) {
             auto remaining = policy.time_remaining();
             std::cout << "Cannot unlock yet. Time remaining: " << remaining.count() << " seconds" << std::endl;
             std::cout << "Unlock time: " << policy.unlock_time_rfc3339() << std::endl;
-            return;
+            return false;
         }
         
-        std::cout << "Time check passed. Proceeding with decryption..." << std::endl;
-        
-        // Extract encryption parameters from metadata
-        if (!metadata.contains("iv") || !metadata.contains("tag") || !metadata.contains("data_key_encrypted")) {
-            throw tcfs::TCFSException(tcfs::ErrorCode::InvalidMetadata, "Missing encryption parameters in metadata");
+        if (policy.recurrence() && !policy.recurrence()->is_open(tcfs::time_utils::now())) {
+            auto next = policy.next_unlock_time(tcfs::time_utils::now());
+            std::cout << "Cannot unlock now. Recurring unlock window is closed." << std::endl;
+            if (next) {
+                std::cout << "Next window opens: " << tcfs::time_utils::format_rfc3339(*next) << std::endl;
+            } else {
+                std::cout << "The recurring unlock windows have ended." << std::endl;
+            }
+            return false;
         }
         
-        auto iv = crypto_->fromBase64(metadata["iv"].get<std::string>());
-        auto tag = crypto_->fromBase64(metadata["tag"].get<std::string>());
-        auto data_key_bytes = crypto_->fromBase64(metadata["data_key_encrypted"].get<std::string>());
-        tcfs::CryptoKey data_key(std::move(data_key_bytes));
-        
-        // Read encrypted file
-        std::ifstream encrypted_file(store_file_path, std::ios::binary);
-        if (!encrypted_file) {
-            throw tcfs::TCFSException(tcfs::ErrorCode::FILE_ACCESS_ERROR, "Failed to read encrypted file: " + store_file_path.string());
+        if (!policy.is_unlock_allowed()) {
+            std::cout << "Cannot unlock yet. Unlock condition not satisfied: "
+                      << policy.condition().to_json().dump() << std::endl;
+            return false;
         }
+        return true;
+    }
+    
+    void print_stages(const tcfs::ChunkedLayout& layout) {
+        auto now = tcfs::time_utils::now();
+        for (const auto& stage : layout.stages) {
+            std::cout << "  " << stage.name << ": bytes " << stage.offset << "-" << (stage.offset + stage.length)
+                      << ", unlocks at " << stage.policy.unlock_time_rfc3339()
+                      << (stage.policy.is_unlock_allowed(now) ? " (open)" : " (locked)") << std::endl;
+        }
+    }
+    
+    void cmd_unlock(const std::string& input_file, const std::string& output_file, const std::string& stage_name,
+                    std::optional<tcfs::RecipientCredential> credential, bool resume) {
+        std::cout << "Attempting to unlock: " << input_file << std::endl;
         
-        std::vector<uint8_t> encrypted_data((std::istreambuf_iterator<char>(encrypted_file)),
-                                           std::istreambuf_iterator<char>());
-        encrypted_file.close();
+        tcfs::Store store(store_path_);
+        configure_io(store);
+        store.set_checkpoint_options({tcfs::CheckpointOptions::DEFAULT_INTERVAL, resume});
+        auto resolved = store.resolve(input_file);
+        if (!resolved) {
+            throw tcfs::TCFSException(resolved.error(), resolved.error_message());
+        }
+        const auto& id = resolved.value();
+        store.set_credential(std::move(credential));
         
-        // Prepare encrypted data structure
-        tcfs::EncryptedData enc_data;
-        enc_data.ciphertext = encrypted_data;
-        enc_data.iv = iv;
-        enc_data.tag = tag;
+        auto policy_result = store.read_policy(id);
+        if (!policy_result) {
+            throw tcfs::TCFSException(policy_result.error(), policy_result.error_message());
+        }
+        const auto& policy = policy_result.value();
         
-        // Decrypt the data
-        auto decrypted_data = crypto_->decrypt(enc_data, data_key, iv);
+        std::optional<tcfs::ChunkedLayout> layout;
+        if (auto loaded = store.read_layout(id)) {
+            layout = std::move(loaded).value();
+        } else if (!stage_name.empty()) {
+            throw tcfs::TCFSException(loaded.error(), loaded.error_message());
+        }
         
-        // Determine output file name
-        std::string final_output = output_file;
-        if (final_output.empty()) {
-            // Use original filename from metadata if available
-            if (metadata.contains("original_filename")) {
-                final_output = metadata["original_filename"].get<std::string>();
-            } else {
-                // Fallback to input filename without .tcfs extension
-                final_output = fs::path(input_file).stem().string();
+        std::optional<size_t> stage;
+        if (!stage_name.empty()) {
+            stage = layout->find_stage(stage_name);
+            if (!stage) {
+                std::cout << "Stages of " << id << ":" << std::endl;
+                print_stages(*layout);
+                throw tcfs::TCFSException(tcfs::ErrorCode::InvalidArgument, "No stage named " + stage_name);
+            }
+            if (!check_unlock_policy(layout->stages[*stage].policy)) {
+                return;
+            }
+        } else {
+            if (!check_unlock_policy(policy)) {
+                return;
+            }
+            if (layout && layout->open_stages(tcfs::time_utils::now()).size() < layout->stages.size()) {
+                std::cout << "Cannot unlock the whole capsule yet. Stages:" << std::endl;
+                print_stages(*layout);
+                std::cout << "Use --stage <name> to unlock an open stage." << std::endl;
+                return;
             }
         }
         
-        // Write decrypted file
-        std::ofstream output(final_output, std::ios::binary);
-        if (!output) {
-            throw tcfs::TCFSException(tcfs::ErrorCode::FILE_ACCESS_ERROR, "Failed to write decrypted file: " + final_output);
+        auto catalog = store.catalog();
+        if (!catalog) {
+            throw tcfs::TCFSException(catalog.error(), catalog.error_message());
+        }
+        if (!catalog.value()->dependencies_ready(id)) {
+            std::cout << "Cannot unlock yet. Waiting for these capsules to be unlocked first: "
+                      << nlohmann::json(policy.depends_on()).dump() << std::endl;
+            return;
         }
         
-        output.write(reinterpret_cast<const char*>(decrypted_data.data()), decrypted_data.size());
-        output.close();
+        std::cout << "Time check passed. Proceeding with decryption..." << std::endl;
+        
+        if (layout) {
+            // Chunked capsules stream to the output a checkpoint interval at a time
+            auto written = store.unlock_to(id, output_file, stage);
+            if (!written) {
+                throw tcfs::TCFSException(written.error(), written.error_message());
+            }
+        } else {
+            auto decrypted = store.decrypt(id);
+            if (!decrypted) {
+                throw tcfs::TCFSException(decrypted.error(), decrypted.error_message());
+            }
+            const auto& decrypted_data = decrypted.value();
+            
+            // Write decrypted file
+            std::ofstream output(output_file, std::ios::binary);
+            if (!output) {
+                throw tcfs::TCFSException(tcfs::ErrorCode::FILE_ACCESS_ERROR, "Failed to write decrypted file: " + output_file);
+            }
+            
+            output.write(reinterpret_cast<const char*>(decrypted_data.data()), static_cast<std::streamsize>(decrypted_data.size()));
+            output.close();
+        }
         
         std::cout << "File unlocked successfully!" << std::endl;
-        std::cout << "Decrypted file: " << final_output << std::endl;
-        std::cout << "Original encrypted file remains in store: " << store_file_path << std::endl;
+        if (stage) {
+            std::cout << "Stage: " << stage_name << std::endl;
+        }
+        std::cout << "Decrypted file: " << output_file << std::endl;
+        std::cout << "Original encrypted file remains in store: " << store.capsule_path(id) << std::endl;
+        
+        // As for the daemon, a staged capsule counts as unlocked for its dependents only once every stage is open
+        if (layout && layout->open_stages(tcfs::time_utils::now()).size() < layout->stages.size()) {
+            std::cout << "The capsule stays locked for its dependents until its last stage opens." << std::endl;
+            return;
+        }
+        auto ready = store.mark_released(id);
+        if (!ready) {
+            std::cerr << "Warning: Failed to record unlock in catalog: " << ready.error_message() << std::endl;
+        } else if (!ready.value().empty()) {
+            std::cout << "Now unlockable: " << nlohmann::json(ready.value()).dump() << std::endl;
+        }
     }
     
     void cmd_status(const std::string& input_file) {
@@ -395,6 +977,16 @@ private:
             metadata_path = store_file_path.string() + ".meta";
         }
         
+        // A capsule with private metadata is found by its original name through the store
+        tcfs::Store store(store_path_);
+        if (!fs::exists(metadata_path)) {
+            auto resolved = store.resolve(input_file);
+            if (resolved) {
+                store_file_path = store.capsule_path(resolved.value());
+                metadata_path = store.metadata_path(resolved.value()).string();
+            }
+        }
+        
         if (!fs::exists(metadata_path)) {
             throw tcfs::TCFSException(tcfs::ErrorCode::FileNotFound, "Metadata file not found: " + metadata_path);
         }
@@ -415,6 +1007,22 @@ private:
         
         std::cout << "Store file: " << store_file_path << std::endl;
         std::cout << "Metadata file: " << metadata_path << std::endl;
+        if (!fs::exists(store_file_path)) {
+            auto tiers = store.tiers();
+            auto cold = tiers ? tiers.value()->location(store_file_path.stem().string()) : std::nullopt;
+            if (cold) {
+                std::cout << "Tier: cold (" << cold->pack << ", " << cold->length << " bytes)" << std::endl;
+            }
+        }
+        
+        if (metadata.contains(tcfs::Store::GROUP_FIELD)) {
+            // Members share their group's policy instead of keeping a copy
+            std::cout << "Group: " << metadata[tcfs::Store::GROUP_FIELD].get<std::string>() << std::endl;
+            auto group_policy = store.group_policy(metadata[tcfs::Store::GROUP_FIELD].get<std::string>());
+            if (group_policy) {
+                metadata["policy"] = group_policy.value().to_json();
+            }
+        }
         
         if (metadata.contains("policy")) {
             auto policy_result = tcfs::Policy::from_json(metadata["policy"]);
@@ -423,7 +1031,10 @@ private:
                 std::cout << "Policy: " << policy.to_string() << std::endl;
                 std::cout << "Unlock time: " << policy.unlock_time_rfc3339() << std::endl;
                 std::cout << "Time remaining: " << policy.time_remaining().count() << " seconds" << std::endl;
-                std::cout << "Can unlock: " << (policy.is_unlock_time_reached() ? "Yes" : "No") << std::endl;
+                std::cout << "Can unlock: " << (policy.is_unlock_allowed() ? "Yes" : "No") << std::endl;
+                if (policy.expire_at()) {
+                    std::cout << "Expires at: " << tcfs::time_utils::format_rfc3339(*policy.expire_at()) << std::endl;
+                }
             } else {
                 std::cout << "Warning: Failed to parse policy: " << policy_result.error_message() << std::endl;
                 std::cout << "Raw policy data: " << metadata["policy"].dump() << std::endl;
@@ -432,6 +1043,14 @@ private:
             std::cout << "Warning: No policy found in metadata" << std::endl;
         }
         
+        if (metadata.contains("chunked")) {
+            auto layout = tcfs::ChunkedLayout::from_json(metadata["chunked"], *crypto_);
+            if (layout && layout.value().stages.size() > 1) {
+                std::cout << "Stages:" << std::endl;
+                print_stages(layout.value());
+            }
+        }
+        
         if (metadata.contains("created_at")) {
             std::cout << "Created at: " << metadata["created_at"].get<std::string>() << std::endl;
         }
@@ -440,12 +1059,23 @@ private:
             std::cout << "Original filename: " << metadata["original_filename"].get<std::string>() << std::endl;
         }
         
+        if (metadata.contains(tcfs::Store::PRIVATE_FIELD)) {
+            auto description = store.describe(store_file_path.stem().string());
+            if (description) {
+                std::cout << "Original filename: " << description.value().original_filename << " (private)" << std::endl;
+                std::cout << "Label: " << description.value().label << " (private)" << std::endl;
+                std::cout << "Notes: " << description.value().notes << " (private)" << std::endl;
+            } else {
+                std::cout << "Private metadata: " << description.error_message() << std::endl;
+            }
+        }
+        
         if (metadata.contains("tool_version")) {
             std::cout << "Tool version: " << metadata["tool_version"].get<std::string>() << std::endl;
         }
     }
     
-    void cmd_list() {
+    void cmd_list(size_t limit) {
         std::cout << "Listing time capsules in store: " << store_path_ << std::endl;
         
         if (!fs::exists(store_path_)) {
@@ -454,66 +1084,71 @@ private:
         }
         
         bool found_any = false;
+        size_t shown = 0;
+        tcfs::Store store(store_path_);
         
         try {
-            for (const auto& entry : fs::directory_iterator(store_path_)) {
-                if (entry.is_regular_file()) {
-                    auto path = entry.path();
+            for (const auto& id : store.scan_capsule_ids()) {
+                // Ciphertext may live in any data directory; metadata stays in the store
+                auto path = store.capsule_path(id);
+                
+                if (fs::exists(path)) {
+                    if (limit != 0 && shown++ == limit) {
+                        break;
+                    }
+                    found_any = true;
+                    auto metadata_path = store.metadata_path(id);
                     
-                    // Look for .tcfs files
-                    if (path.extension() == ".tcfs") {
-                        found_any = true;
-                        auto metadata_path = path.string() + ".meta";
-                        
-                        std::cout << "\n=== " << path.filename().string() << " ===" << std::endl;
-                        std::cout << "Encrypted file: " << path.string() << std::endl;
-                        
-                        // Try to read metadata if it exists
-                        if (fs::exists(metadata_path)) {
-                            try {
-                                std::ifstream metadata_file(metadata_path, std::ios::binary);
-                                nlohmann::json metadata;
-                                metadata_file >> metadata;
-                                
-                                if (metadata.contains("original_filename")) {
-                                    std::cout << "Original filename: " << metadata["original_filename"].get<std::string>() << std::endl;
-                                }
-                                
-                                if (metadata.contains("created_at")) {
-                                    std::cout << "Created at: " << metadata["created_at"].get<std::string>() << std::endl;
-                                }
-                                
-                                if (metadata.contains("policy")) {
-                                    auto policy_result = tcfs::Policy::from_json(metadata["policy"]);
-                                    if (policy_result) {
-                                        auto& policy = policy_result.value();
-                                        std::cout << "Unlock time: " << policy.unlock_time_rfc3339() << std::endl;
-                                        std::cout << "Can unlock: " << (policy.is_unlock_time_reached() ? "Yes" : "No") << std::endl;
-                                        
-                                        if (!policy.is_unlock_time_reached()) {
-                                            auto remaining = policy.time_remaining();
-                                            std::cout << "Time remaining: " << remaining.count() << " seconds" << std::endl;
-                                        }
-                                        
-                                        if (!policy.label().empty()) {
-                                            std::cout << "Label: " << policy.label() << std::endl;
-                                        }
-                                        
-                                        if (!policy.notes().empty()) {
-                                            std::cout << "Notes: " << policy.notes() << std::endl;
-                                        }
-                                    } else {
-                                        std::cout << "Warning: Failed to parse policy: " << policy_result.error_message() << std::endl;
+                    std::cout << "\n=== " << path.filename().string() << " ===" << std::endl;
+                    std::cout << "Encrypted file: " << path.string() << std::endl;
+                    
+                    // Try to read metadata if it exists
+                    if (fs::exists(metadata_path)) {
+                        try {
+                            std::ifstream metadata_file(metadata_path, std::ios::binary);
+                            nlohmann::json metadata;
+                            metadata_file >> metadata;
+                            
+                            if (metadata.contains("original_filename")) {
+                                std::cout << "Original filename: " << metadata["original_filename"].get<std::string>() << std::endl;
+                            }
+                            
+                            if (metadata.contains("created_at")) {
+                                std::cout << "Created at: " << metadata["created_at"].get<std::string>() << std::endl;
+                            }
+                            
+                            if (metadata.contains("policy")) {
+                                auto policy_result = tcfs::Policy::from_json(metadata["policy"]);
+                                if (policy_result) {
+                                    auto& policy = policy_result.value();
+                                    std::cout << "Unlock time: " << policy.unlock_time_rfc3339() << std::endl;
+                                    std::cout << "Can unlock: " << (policy.is_unlock_allowed() ? "Yes" : "No") << std::endl;
+                                    
+                                    if (!policy.is_unlock_time_reached()) {
+                                        auto remaining = policy.time_remaining();
+                                        std::cout << "Time remaining: " << remaining.count() << " seconds" << std::endl;
+                                    }
+                                    
+                                    if (!policy.label().empty()) {
+                                        std::cout << "Label: " << policy.label() << std::endl;
+                                    }
+                                    
+                                    if (!policy.notes().empty()) {
+                                        std::cout << "Notes: " << policy.notes() << std::endl;
                                     }
                                 } else {
-                                    std::cout << "Warning: No policy found in metadata" << std::endl;
+                                    std::cout << "Warning: Failed to parse policy: " << policy_result.error_message() << std::endl;
                                 }
-                            } catch (const std::exception& e) {
-                                std::cout << "Warning: Could not read metadata: " << e.what() << std::endl;
+                            } else if (metadata.contains(tcfs::Store::GROUP_FIELD)) {
+                                std::cout << "Group: " << metadata[tcfs::Store::GROUP_FIELD].get<std::string>() << std::endl;
+                            } else {
+                                std::cout << "Warning: No policy found in metadata" << std::endl;
                             }
-                        } else {
-                            std::cout << "Warning: Metadata file not found" << std::endl;
+                        } catch (const std::exception& e) {
+                            std::cout << "Warning: Could not read metadata: " << e.what() << std::endl;
                         }
+                    } else {
+                        std::cout << "Warning: Metadata file not found" << std::endl;
                     }
                 }
             }
@@ -526,6 +1161,996 @@ private:
             std::cout << "No time capsules found in store." << std::endl;
         }
     }
+    
+    void cmd_list_matching(const ListArgs& args) {
+        tcfs::Store store(store_path_);
+        if (!store.exists()) {
+            throw tcfs::TCFSException(tcfs::ErrorCode::FileNotFound, "Store directory does not exist. Run 'tcfs init' first.");
+        }
+        auto ids = matching_ids(store, args);
+        
+        auto catalog = store.catalog();
+        if (!catalog) {
+            throw tcfs::TCFSException(catalog.error(), catalog.error_message());
+        }
+        size_t shown = args.limit == 0 ? ids.size() : std::min(args.limit, ids.size());
+        for (size_t i = 0; i < shown; ++i) {
+            const auto& id = ids[i];
+            const auto* entry = catalog.value()->find(id);
+            auto description = store.describe(id);
+            std::cout << id;
+            if (entry) {
+                std::cout << "  unlock " << tcfs::time_utils::format_rfc3339(
+                                                std::chrono::system_clock::from_time_t(static_cast<time_t>(entry->unlock_at)));
+            }
+            if (description) {
+                std::cout << "  " << description.value().original_filename;
+                if (!description.value().label.empty()) {
+                    std::cout << "  [" << description.value().label << "]";
+                }
+            }
+            std::cout << std::endl;
+        }
+        std::cout << ids.size() << " matching capsule(s)";
+        if (shown < ids.size()) {
+            std::cout << ", " << shown << " shown";
+        }
+        std::cout << std::endl;
+    }
+    
+    /**
+     * @brief Ids of capsules matching every filter of args, through the store's blind index
+     */
+    static std::vector<std::string> matching_ids(tcfs::Store& store, const ListArgs& args) {
+        tcfs::BlindMatch match;
+        if (args.match == "exact") {
+            match = tcfs::BlindMatch::Exact;
+        } else if (args.match == "prefix") {
+            match = tcfs::BlindMatch::Prefix;
+        } else if (args.match == "contains") {
+            match = tcfs::BlindMatch::Contains;
+        } else {
+            throw tcfs::TCFSException(tcfs::ErrorCode::InvalidArgument, "--match must be exact, prefix or contains");
+        }
+        
+        // Every given filter must match
+        std::optional<std::vector<std::string>> ids;
+        for (const auto& [field, term] : {std::pair<std::string, std::string>{"label", args.label},
+                                          {"notes", args.notes},
+                                          {"filename", args.name}}) {
+            if (term.empty()) {
+                continue;
+            }
+            auto found = store.search(field, term, match);
+            if (!found) {
+                throw tcfs::TCFSException(found.error(), found.error_message());
+            }
+            if (!ids) {
+                ids = std::move(found).value();
+                continue;
+            }
+            std::vector<std::string> kept;
+            for (const auto& id : *ids) {
+                if (std::find(found.value().begin(), found.value().end(), id) != found.value().end()) {
+                    kept.push_back(id);
+                }
+            }
+            ids = std::move(kept);
+        }
+        return ids ? std::move(*ids) : std::vector<std::string>{};
+    }
+    
+    void cmd_list_federated(const std::vector<fs::path>& roots, const ListArgs& args) {
+        bool filtered = !args.label.empty() || !args.notes.empty() || !args.name.empty();
+        print_federated(roots, args.limit, [&](tcfs::Store& store, tcfs::Catalog& catalog) {
+            std::vector<FederatedRow> rows;
+            if (!filtered) {
+                for (const auto* entry : catalog.entries()) {
+                    rows.push_back(catalog_row(*entry));
+                }
+                return rows;
+            }
+            for (const auto& id : matching_ids(store, args)) {
+                if (const auto* entry = catalog.find(id)) {
+                    rows.push_back(catalog_row(*entry));
+                }
+            }
+            return rows;
+        });
+    }
+    
+    void cmd_find(const std::string& text, const std::string& glob, size_t limit) {
+        if (text.empty() && glob.empty()) {
+            throw tcfs::TCFSException(tcfs::ErrorCode::InvalidArgument, "Give text to search for, --name, or both");
+        }
+        tcfs::Store store(store_path_);
+        if (!store.exists()) {
+            throw tcfs::TCFSException(tcfs::ErrorCode::FileNotFound, "Store directory does not exist. Run 'tcfs init' first.");
+        }
+        auto catalog = store.catalog();
+        if (!catalog) {
+            throw tcfs::TCFSException(catalog.error(), catalog.error_message());
+        }
+        auto ids = found_ids(*catalog.value(), text, glob);
+        
+        size_t shown = limit == 0 ? ids.size() : std::min(limit, ids.size());
+        for (size_t i = 0; i < shown; ++i) {
+            const auto* entry = catalog.value()->find(ids[i]);
+            std::cout << entry->id << "  unlock "
+                      << tcfs::time_utils::format_rfc3339(
+                             std::chrono::system_clock::from_time_t(static_cast<time_t>(entry->unlock_at)))
+                      << "  " << entry->original_filename;
+            if (!entry->label.empty()) {
+                std::cout << "  [" << entry->label << "]";
+            }
+            std::cout << std::endl;
+        }
+        std::cout << ids.size() << " matching capsule(s)";
+        if (shown < ids.size()) {
+            std::cout << ", " << shown << " shown";
+        }
+        std::cout << std::endl;
+    }
+    
+    /**
+     * @brief Text matches whose file name also matches the glob, in catalog order
+     */
+    static std::vector<std::string> found_ids(const tcfs::Catalog& catalog, const std::string& text,
+                                              const std::string& glob) {
+        if (text.empty() || glob.empty()) {
+            return text.empty() ? catalog.find_glob(glob) : catalog.find_text(text);
+        }
+        std::vector<std::string> ids;
+        auto by_text = catalog.find_text(text);
+        auto by_name = catalog.find_glob(glob);
+        std::unordered_set<std::string> named(by_name.begin(), by_name.end());
+        for (auto& id : by_text) {
+            if (named.count(id)) {
+                ids.push_back(std::move(id));
+            }
+        }
+        return ids;
+    }
+    
+    void cmd_find_federated(const std::vector<fs::path>& roots, const std::string& text, const std::string& glob,
+                            size_t limit) {
+        if (text.empty() && glob.empty()) {
+            throw tcfs::TCFSException(tcfs::ErrorCode::InvalidArgument, "Give text to search for, --name, or both");
+        }
+        print_federated(roots, limit, [&](tcfs::Store&, tcfs::Catalog& catalog) {
+            std::vector<FederatedRow> rows;
+            for (const auto& id : found_ids(catalog, text, glob)) {
+                rows.push_back(catalog_row(*catalog.find(id)));
+            }
+            return rows;
+        });
+    }
+    
+    static FederatedRow catalog_row(const tcfs::CatalogEntry& entry) {
+        FederatedRow row;
+        row.time = entry.unlock_at;
+        row.id = entry.id;
+        row.text = entry.id;
+        row.text += "  unlock ";
+        row.text += tcfs::time_utils::format_rfc3339(
+            std::chrono::system_clock::from_time_t(static_cast<time_t>(entry.unlock_at)));
+        row.text += "  ";
+        row.text += entry.original_filename;
+        if (!entry.label.empty()) {
+            row.text += "  [";
+            row.text += entry.label;
+            row.text += "]";
+        }
+        return row;
+    }
+    
+    /**
+     * @brief Run query on every store at once and print the k-way merge of the rows, earliest first
+     *
+     * Each store keeps only its first limit rows, since no later row of it can
+     * make the global cut.
+     */
+    void print_federated(const std::vector<fs::path>& roots, size_t limit,
+                         const std::function<std::vector<FederatedRow>(tcfs::Store&, tcfs::Catalog&)>& query) {
+        auto before = [](const FederatedRow& a, const FederatedRow& b) {
+            return a.time != b.time ? a.time < b.time : a.id < b.id;
+        };
+        std::vector<std::pair<size_t, std::vector<FederatedRow>>> answers =
+            tcfs::Federation::fan_out(roots, [&](const fs::path& root) {
+                tcfs::Store store(root);
+                if (!store.exists()) {
+                    throw tcfs::TCFSException(tcfs::ErrorCode::FileNotFound, "Store directory does not exist: " + root.string());
+                }
+                auto catalog = store.catalog();
+                if (!catalog) {
+                    throw tcfs::TCFSException(catalog.error(), catalog.error_message());
+                }
+                auto rows = query(store, *catalog.value());
+                size_t matched = rows.size();
+                size_t kept = limit == 0 ? rows.size() : std::min(limit, rows.size());
+                std::partial_sort(rows.begin(), rows.begin() + static_cast<std::ptrdiff_t>(kept), rows.end(), before);
+                rows.resize(kept);
+                return std::make_pair(matched, std::move(rows));
+            });
+        
+        size_t matched = 0;
+        std::vector<std::vector<FederatedRow>> runs;
+        for (auto& [count, rows] : answers) {
+            matched += count;
+            runs.push_back(std::move(rows));
+        }
+        auto merged = tcfs::Federation::merge(std::move(runs), before, limit);
+        for (const auto& [run, row] : merged) {
+            std::cout << roots[run].string() << "  " << row.text << std::endl;
+        }
+        std::cout << matched << " matching capsule(s) in " << roots.size() << " stores";
+        if (merged.size() < matched) {
+            std::cout << ", " << merged.size() << " shown";
+        }
+        std::cout << std::endl;
+    }
+    
+    void cmd_daemon(const std::string& release_dir, const std::string& poll_interval, bool once, const ReleaseArgs& release) {
+        tcfs::Store store(store_path_);
+        if (!store.exists()) {
+            throw tcfs::TCFSException(tcfs::ErrorCode::FileNotFound, "Store directory does not exist. Run 'tcfs init' first.");
+        }
+        
+        tcfs::DaemonOptions options;
+        options.release_dir = release_dir;
+        auto interval = tcfs::time_utils::parse_duration(poll_interval);
+        if (!interval) {
+            throw tcfs::TCFSException(interval.error(), interval.error_message());
+        }
+        options.poll_interval = interval.value();
+        
+        options.release.max_concurrency = release.concurrency;
+        options.release.high_priority_labels = release.priority_labels;
+        if (!release.io_limit.empty()) {
+            auto limit = parse_size(release.io_limit);
+            if (!limit) {
+                throw tcfs::TCFSException(tcfs::ErrorCode::InvalidArgument, "Invalid --io-limit: " + release.io_limit);
+            }
+            options.release.io_bytes_per_second = *limit;
+        }
+        if (!release.jitter.empty()) {
+            auto jitter = tcfs::time_utils::parse_duration(release.jitter);
+            if (!jitter) {
+                throw tcfs::TCFSException(jitter.error(), jitter.error_message());
+            }
+            options.release.max_jitter = jitter.value();
+        }
+        if (!release.prefetch_horizon.empty()) {
+            auto horizon = tcfs::time_utils::parse_duration(release.prefetch_horizon);
+            if (!horizon) {
+                throw tcfs::TCFSException(horizon.error(), horizon.error_message());
+            }
+            options.prefetch.horizon = horizon.value();
+        }
+        if (!release.prefetch_rate.empty()) {
+            auto rate = parse_size(release.prefetch_rate);
+            if (!rate) {
+                throw tcfs::TCFSException(tcfs::ErrorCode::InvalidArgument, "Invalid --prefetch-rate: " + release.prefetch_rate);
+            }
+            options.prefetch.bytes_per_second = *rate;
+        }
+        if (!release.demote_after.empty()) {
+            auto demote_after = tcfs::time_utils::parse_duration(release.demote_after);
+            if (!demote_after) {
+                throw tcfs::TCFSException(demote_after.error(), demote_after.error_message());
+            }
+            options.tiers.demote_after = demote_after.value();
+        }
+        if (!release.promote_before.empty()) {
+            auto promote_before = tcfs::time_utils::parse_duration(release.promote_before);
+            if (!promote_before) {
+                throw tcfs::TCFSException(promote_before.error(), promote_before.error_message());
+            }
+            options.tiers.promote_before = promote_before.value();
+        }
+        if (!release.tier_rate.empty()) {
+            auto rate = parse_size(release.tier_rate);
+            if (!rate) {
+                throw tcfs::TCFSException(tcfs::ErrorCode::InvalidArgument, "Invalid --tier-rate: " + release.tier_rate);
+            }
+            options.tiers.bytes_per_second = *rate;
+        }
+        options.tiers.cold_dir = release.cold_dir;
+        options.inbox.dir = release.inbox;
+        options.inbox.label = release.inbox_label;
+        if (!release.inbox_lock_for.empty()) {
+            auto lock_for = tcfs::time_utils::parse_duration(release.inbox_lock_for);
+            if (!lock_for) {
+                throw tcfs::TCFSException(lock_for.error(), lock_for.error_message());
+            }
+            options.inbox.lock_for = lock_for.value();
+        }
+        if (!release.events_socket.empty()) {
+            options.events.socket = release.events_socket;
+        } else if (release.events) {
+            options.events.socket = fs::path(store_path_) / EVENTS_SOCKET;
+        }
+        options.events.max_buffered = release.events_buffer;
+        if (release.events_disconnect_slow) {
+            options.events.slow_consumers = tcfs::SlowConsumerPolicy::Disconnect;
+        }
+        if (!release.no_snapshot) {
+            options.snapshot.path = release.snapshot.empty() ? fs::path(store_path_) / SNAPSHOT_FILE : fs::path(release.snapshot);
+        }
+        if (!release.snapshot_interval.empty()) {
+            auto snapshot_interval = tcfs::time_utils::parse_duration(release.snapshot_interval);
+            if (!snapshot_interval) {
+                throw tcfs::TCFSException(snapshot_interval.error(), snapshot_interval.error_message());
+            }
+            options.snapshot.interval = snapshot_interval.value();
+        }
+        options.log = [](const std::string& message) {
+            std::cout << "[" << tcfs::time_utils::format_rfc3339(tcfs::time_utils::now()) << "] " << message << std::endl;
+        };
+        
+        tcfs::Daemon daemon(store, options);
+        auto started = daemon.start();
+        if (!started) {
+            throw tcfs::TCFSException(started.error(), started.error_message());
+        }
+        
+        if (once) {
+            auto released = daemon.tick(tcfs::time_utils::now());
+            std::cout << "Released " << released << " capsule(s)" << std::endl;
+            if (!daemon.release_queue().empty()) {
+                std::cout << daemon.release_queue().size() << " capsule(s) held back by the release budget" << std::endl;
+            }
+            return;
+        }
+        
+        running_daemon = &daemon;
+        std::signal(SIGINT, handle_stop_signal);
+        std::signal(SIGTERM, handle_stop_signal);
+        std::cout << "TCFS daemon running on store: " << store_path_ << " (Ctrl+C to stop)" << std::endl;
+        daemon.run();
+        running_daemon = nullptr;
+        std::cout << "TCFS daemon stopped." << std::endl;
+    }
+    
+    void cmd_stats(bool timeline, const std::string& bucket, const std::string& horizon, const std::string& format,
+                   size_t top) {
+        if (format != "table" && format != "ndjson") {
+            throw tcfs::TCFSException(tcfs::ErrorCode::InvalidArgument, "--format must be table or ndjson");
+        }
+        int64_t width = 0;
+        int64_t until = 0;
+        auto now = static_cast<int64_t>(std::chrono::system_clock::to_time_t(tcfs::time_utils::now()));
+        if (timeline) {
+            auto seconds = tcfs::CatalogStats::bucket_seconds(bucket);
+            if (!seconds) {
+                throw tcfs::TCFSException(seconds.error(), seconds.error_message());
+            }
+            auto reach = tcfs::time_utils::parse_duration(horizon);
+            if (!reach) {
+                throw tcfs::TCFSException(reach.error(), reach.error_message());
+            }
+            width = seconds.value();
+            until = now + reach.value().count();
+        }
+        auto roots = store_roots();
+        auto parts = tcfs::Federation::fan_out(roots, [&](const fs::path& root) {
+            tcfs::Store store(root);
+            return tcfs::CatalogStats::compute(open_catalog(store).columns(), now, until, width);
+        });
+        auto stats = parts.size() == 1 ? std::move(parts.front()) : tcfs::CatalogStats::combine(parts);
+        auto time_of = [](int64_t seconds) {
+            return tcfs::time_utils::format_rfc3339(std::chrono::system_clock::from_time_t(static_cast<time_t>(seconds)));
+        };
+        
+        if (format == "ndjson") {
+            auto line = [](const std::string& type, const tcfs::StatsTotal& total, const char* key_field) {
+                nlohmann::json json;
+                json["type"] = type;
+                if (key_field) {
+                    json[key_field] = total.key;
+                }
+                json["capsules"] = total.capsules;
+                json["bytes"] = total.bytes;
+                std::cout << json.dump() << std::endl;
+            };
+            line(stats.live().key, stats.live(), nullptr);
+            line(stats.locked().key, stats.locked(), nullptr);
+            line(stats.due().key, stats.due(), nullptr);
+            for (const auto& total : stats.by_label()) {
+                line("label", total, "label");
+            }
+            for (const auto& total : stats.by_owner()) {
+                line("owner", total, "owner");
+            }
+            for (const auto& bucket_total : stats.timeline()) {
+                nlohmann::json json;
+                json["type"] = "timeline";
+                json["start"] = time_of(bucket_total.start);
+                json["capsules"] = bucket_total.capsules;
+                json["bytes"] = bucket_total.bytes;
+                std::cout << json.dump() << std::endl;
+            }
+            return;
+        }
+        
+        auto row = [](const std::string& name, uint64_t capsules, uint64_t bytes) {
+            std::cout << "  " << std::left << std::setw(28) << name << std::right << std::setw(10) << capsules
+                      << std::setw(16) << bytes << std::endl;
+        };
+        auto ranked = [&](const char* title, const std::vector<tcfs::StatsTotal>& totals) {
+            std::cout << std::endl << title << std::endl;
+            size_t shown = top == 0 ? totals.size() : std::min(top, totals.size());
+            for (size_t i = 0; i < shown; ++i) {
+                row(totals[i].key.empty() ? "(none)" : totals[i].key, totals[i].capsules, totals[i].bytes);
+            }
+            if (shown < totals.size()) {
+                std::cout << "  ... " << totals.size() - shown << " more" << std::endl;
+            }
+        };
+        std::cout << "  " << std::left << std::setw(28) << "" << std::right << std::setw(10) << "capsules"
+                  << std::setw(16) << "bytes" << std::endl;
+        row("live", stats.live().capsules, stats.live().bytes);
+        row("locked", stats.locked().capsules, stats.locked().bytes);
+        row("due", stats.due().capsules, stats.due().bytes);
+        ranked("By label:", stats.by_label());
+        ranked("By owner:", stats.by_owner());
+        if (timeline) {
+            // Empty buckets are left out of the table, but not out of NDJSON
+            std::cout << std::endl << "Unlocking by " << bucket << ":" << std::endl;
+            for (const auto& bucket_total : stats.timeline()) {
+                if (bucket_total.capsules != 0) {
+                    row(time_of(bucket_total.start), bucket_total.capsules, bucket_total.bytes);
+                }
+            }
+        }
+    }
+    
+    void cmd_due(const std::string& within, size_t limit) {
+        auto roots = store_roots();
+        if (roots.size() == 1 && !fs::exists(store_path_)) {
+            std::cout << "Store directory does not exist. Run 'tcfs init' first." << std::endl;
+            return;
+        }
+        
+        auto now = tcfs::time_utils::now();
+        auto horizon = tcfs::Policy::TimePoint::max();
+        if (!within.empty()) {
+            auto duration = tcfs::time_utils::parse_duration(within);
+            if (!duration) {
+                throw tcfs::TCFSException(duration.error(), duration.error_message());
+            }
+            horizon = now + duration.value();
+        }
+        
+        if (roots.size() > 1) {
+            print_federated(roots, limit, [&](tcfs::Store& store, tcfs::Catalog&) {
+                std::vector<FederatedRow> rows;
+                for (const auto& item : due_in(store, now, horizon, limit)) {
+                    FederatedRow row;
+                    row.time = static_cast<int64_t>(std::chrono::system_clock::to_time_t(item.due));
+                    row.id = item.capsule_id;
+                    row.text = tcfs::time_utils::format_rfc3339(item.due);
+                    row.text += "  ";
+                    row.text += item.capsule_id;
+                    rows.push_back(std::move(row));
+                }
+                return rows;
+            });
+            return;
+        }
+        
+        tcfs::Store store(store_path_);
+        auto due = due_in(store, now, horizon, limit);
+        if (due.empty()) {
+            std::cout << "No time capsules due." << std::endl;
+            return;
+        }
+        for (const auto& item : due) {
+            std::cout << tcfs::time_utils::format_rfc3339(item.due) << "  " << item.capsule_id << std::endl;
+        }
+    }
+    
+    /**
+     * @brief Capsules of store due by horizon, earliest first; at most limit of them (0 for all)
+     */
+    static std::vector<tcfs::UnlockScheduler::Entry> due_in(tcfs::Store& store, const tcfs::Policy::TimePoint& now,
+                                                            const tcfs::Policy::TimePoint& horizon, size_t limit) {
+        // Index every capsule by its next unlock opportunity; group members share one parsed policy
+        tcfs::UnlockScheduler scheduler;
+        for (const auto& id : store.scan_capsule_ids()) {
+            if (!fs::exists(store.capsule_path(id))) {
+                continue;
+            }
+            auto policy_result = store.read_policy(id);
+            if (policy_result) {
+                scheduler.schedule(id + ".tcfs", policy_result.value(), now);
+            } else {
+                std::cerr << "Warning: Could not read metadata " << store.metadata_path(id).string() << ": "
+                          << policy_result.error_message() << std::endl;
+            }
+        }
+        return scheduler.peek_until(horizon, limit == 0 ? std::numeric_limits<size_t>::max() : limit);
+    }
+    
+    void cmd_sweep(size_t batch_size) {
+        tcfs::Store store(store_path_);
+        if (!store.exists()) {
+            throw tcfs::TCFSException(tcfs::ErrorCode::FileNotFound, "Store directory does not exist. Run 'tcfs init' first.");
+        }
+        
+        tcfs::SweeperOptions options;
+        options.batch_size = batch_size;
+        options.log = [](const std::string& message) { std::cout << message << std::endl; };
+        
+        tcfs::Sweeper sweeper(store, options);
+        auto started = sweeper.start();
+        if (!started) {
+            throw tcfs::TCFSException(started.error(), started.error_message());
+        }
+        
+        auto result = sweeper.sweep(tcfs::time_utils::now());
+        std::cout << "Destroyed " << result.destroyed.size() << " expired capsule(s)" << std::endl;
+        if (!result.ready.empty()) {
+            std::cout << "Now unlockable: " << nlohmann::json(result.ready).dump() << std::endl;
+        }
+        if (result.failed != 0) {
+            throw tcfs::TCFSException(tcfs::ErrorCode::FILE_ACCESS_ERROR,
+                                      std::to_string(result.failed) + " expired capsule(s) could not be destroyed");
+        }
+    }
+    
+    void cmd_events(const tcfs::EventFilter& filter, const std::string& socket, size_t count) {
+        auto path = socket.empty() ? fs::path(store_path_) / EVENTS_SOCKET : fs::path(socket);
+        size_t seen = 0;
+        auto streamed = tcfs::subscribe_events(path, filter, [&](const nlohmann::json& event) {
+            if (event.value("type", "") == "subscribed") {
+                return true;
+            }
+            std::cout << event.dump() << std::endl;
+            if (event.value("type", "") == "overflow") {
+                return true; // Markers do not count towards --count
+            }
+            return count == 0 || ++seen < count;
+        });
+        if (!streamed) {
+            throw tcfs::TCFSException(streamed.error(), streamed.error_message());
+        }
+    }
+    
+    /**
+     * @brief Passphrase from TCFS_PASSPHRASE_<RECIPIENT> if set, otherwise asked for on the terminal
+     */
+    static std::string read_passphrase(const std::string& recipient) {
+        std::string variable = "TCFS_PASSPHRASE_";
+        for (char c : recipient) {
+            auto byte = static_cast<unsigned char>(c);
+            variable += std::isalnum(byte) ? static_cast<char>(std::toupper(byte)) : '_';
+        }
+        if (const char* value = std::getenv(variable.c_str())) {
+            return value;
+        }
+        
+        std::cerr << "Passphrase for " << recipient << ": " << std::flush;
+        std::string passphrase;
+#ifndef _WIN32
+        termios saved{};
+        bool hidden = ::isatty(STDIN_FILENO) && ::tcgetattr(STDIN_FILENO, &saved) == 0;
+        if (hidden) {
+            auto quiet = saved;
+            quiet.c_lflag &= ~static_cast<tcflag_t>(ECHO);
+            ::tcsetattr(STDIN_FILENO, TCSANOW, &quiet);
+        }
+        std::getline(std::cin, passphrase);
+        if (hidden) {
+            ::tcsetattr(STDIN_FILENO, TCSANOW, &saved);
+            std::cerr << std::endl;
+        }
+#else
+        std::getline(std::cin, passphrase);
+#endif
+        return passphrase;
+    }
+    
+    /**
+     * @brief Credential of recipient as, from their private key file or else their passphrase
+     */
+    std::optional<tcfs::RecipientCredential> credential_for(const std::string& as, const std::string& key_file) {
+        if (as.empty()) {
+            if (!key_file.empty()) {
+                throw tcfs::TCFSException(tcfs::ErrorCode::InvalidArgument, "--key needs --as");
+            }
+            return std::nullopt;
+        }
+        tcfs::RecipientCredential credential;
+        credential.recipient = as;
+        if (key_file.empty()) {
+            credential.passphrase = read_passphrase(as);
+        } else {
+            credential.private_key = read_key_file(key_file);
+        }
+        return credential;
+    }
+    
+    std::vector<uint8_t> read_key_file(const std::string& path, size_t key_size = tcfs::CryptoProvider::X25519_KEY_SIZE) {
+        std::ifstream in(path);
+        std::string encoded;
+        if (!in || !std::getline(in, encoded)) {
+            throw tcfs::TCFSException(tcfs::ErrorCode::FILE_ACCESS_ERROR, "Cannot read key file: " + path);
+        }
+        auto key = crypto_->fromBase64(encoded);
+        if (key.size() != key_size) {
+            throw tcfs::TCFSException(tcfs::ErrorCode::InvalidKey, "Key file has the wrong key size: " + path);
+        }
+        return key;
+    }
+    
+    std::vector<tcfs::PublicRecipient> load_seal_recipients(const std::vector<std::string>& specs) {
+        std::vector<tcfs::PublicRecipient> recipients;
+        for (const auto& spec : specs) {
+            auto separator = spec.find('=');
+            if (separator == std::string::npos || separator == 0) {
+                throw tcfs::TCFSException(tcfs::ErrorCode::InvalidArgument, "--seal-to expects NAME=PUBLIC_KEY_FILE: " + spec);
+            }
+            recipients.push_back({spec.substr(0, separator), read_key_file(spec.substr(separator + 1))});
+        }
+        return recipients;
+    }
+    
+    tcfs::Catalog& open_catalog(tcfs::Store& store) {
+        if (!store.exists()) {
+            throw tcfs::TCFSException(tcfs::ErrorCode::FileNotFound, "Store directory does not exist. Run 'tcfs init' first.");
+        }
+        auto catalog = store.catalog();
+        if (!catalog) {
+            throw tcfs::TCFSException(catalog.error(), catalog.error_message());
+        }
+        return *catalog.value();
+    }
+    
+    void cmd_group_create(const std::string& name, const LockArgs& args) {
+        tcfs::Store store(store_path_);
+        open_catalog(store);
+        auto policy = build_policy(args, store.default_owner());
+        auto created = store.create_group(name, policy);
+        if (!created) {
+            throw tcfs::TCFSException(created.error(), created.error_message());
+        }
+        std::cout << "Created group " << name << ", unlocking at " << policy.unlock_time_rfc3339() << std::endl;
+        std::cout << "Policy file: " << store.group_path(name).string() << std::endl;
+    }
+    
+    void cmd_group_add(const std::string& name, const LockArgs& args) {
+        tcfs::Store store(store_path_);
+        configure_io(store);
+        open_catalog(store);
+        store.set_seal_recipients(load_seal_recipients(args.seal_to));
+        std::vector<fs::path> inputs(args.input_files.begin(), args.input_files.end());
+        
+        auto result = store.lock_group(name, inputs, args.jobs);
+        if (!result) {
+            throw tcfs::TCFSException(result.error(), result.error_message());
+        }
+        for (const auto& input : inputs) {
+            auto id = tcfs::Store::capsule_id_for(input);
+            auto locked = std::find(result.value().locked.begin(), result.value().locked.end(), id);
+            if (locked == result.value().locked.end()) {
+                continue;
+            }
+            auto deleted = tcfs::secure_delete(input);
+            if (!deleted) {
+                std::cerr << "Warning: Failed to delete original file: " << deleted.error_message() << std::endl;
+            }
+        }
+        for (const auto& [input, reason] : result.value().failed) {
+            std::cerr << "  failed " << input.string() << ": " << reason << std::endl;
+        }
+        std::cout << "Added " << result.value().locked.size() << " of " << inputs.size() << " files to group " << name
+                  << "; originals deleted for security!" << std::endl;
+        if (!result.value().failed.empty()) {
+            throw tcfs::TCFSException(tcfs::ErrorCode::FILE_ACCESS_ERROR,
+                                      std::to_string(result.value().failed.size()) + " file(s) could not be locked");
+        }
+    }
+    
+    void cmd_group_list() {
+        tcfs::Store store(store_path_);
+        auto& catalog = open_catalog(store);
+        auto groups = catalog.groups();
+        for (const auto* group : groups) {
+            std::cout << group->name << "  " << catalog.group_size(group->name) << " member(s)  unlock "
+                      << tcfs::time_utils::format_rfc3339(
+                             std::chrono::system_clock::from_time_t(static_cast<time_t>(group->unlock_at)));
+            if (!group->label.empty()) {
+                std::cout << "  [" << group->label << "]";
+            }
+            std::cout << std::endl;
+        }
+        std::cout << groups.size() << " group(s)" << std::endl;
+    }
+    
+    void cmd_group_status(const std::string& name) {
+        tcfs::Store store(store_path_);
+        auto& catalog = open_catalog(store);
+        auto policy = store.group_policy(name);
+        if (!policy) {
+            throw tcfs::TCFSException(policy.error(), policy.error_message());
+        }
+        std::cout << "Group: " << name << std::endl;
+        std::cout << "Members: " << catalog.group_size(name) << std::endl;
+        std::cout << "Policy: " << policy.value().to_string() << std::endl;
+        std::cout << "Unlock time: " << policy.value().unlock_time_rfc3339() << std::endl;
+        std::cout << "Can unlock: " << (policy.value().is_unlock_allowed() ? "Yes" : "No") << std::endl;
+        if (policy.value().expire_at()) {
+            std::cout << "Expires at: " << tcfs::time_utils::format_rfc3339(*policy.value().expire_at()) << std::endl;
+        }
+    }
+    
+    void cmd_group_extend(const std::string& name, const std::string& to, const std::string& by) {
+        if (to.empty() == by.empty()) {
+            throw tcfs::TCFSException(tcfs::ErrorCode::InvalidArgument, "Give exactly one of --to and --by");
+        }
+        tcfs::Store store(store_path_);
+        open_catalog(store);
+        auto policy = store.group_policy(name);
+        if (!policy) {
+            throw tcfs::TCFSException(policy.error(), policy.error_message());
+        }
+        tcfs::Policy::TimePoint unlock_at;
+        if (!to.empty()) {
+            auto parsed = tcfs::time_utils::parse_rfc3339(to);
+            if (!parsed) {
+                throw tcfs::TCFSException(parsed.error(), parsed.error_message());
+            }
+            unlock_at = parsed.value();
+        } else {
+            auto delay = tcfs::time_utils::parse_duration(by);
+            if (!delay) {
+                throw tcfs::TCFSException(delay.error(), delay.error_message());
+            }
+            unlock_at = policy.value().unlock_time() + delay.value();
+        }
+        auto extended = store.extend_group(name, unlock_at);
+        if (!extended) {
+            throw tcfs::TCFSException(extended.error(), extended.error_message());
+        }
+        std::cout << "Group " << name << " now unlocks at " << tcfs::time_utils::format_rfc3339(unlock_at) << " ("
+                  << store.catalog().value()->group_size(name) << " member(s))" << std::endl;
+    }
+    
+    void cmd_update(const std::string& where, const std::string& extend, const std::string& to, size_t jobs,
+                    bool dry_run) {
+        if (extend.empty() == to.empty()) {
+            throw tcfs::TCFSException(tcfs::ErrorCode::InvalidArgument, "Give exactly one of --extend and --to");
+        }
+        auto query = tcfs::CatalogQuery::parse(where);
+        if (!query) {
+            throw tcfs::TCFSException(query.error(), query.error_message());
+        }
+        if (query.value().empty()) {
+            throw tcfs::TCFSException(tcfs::ErrorCode::InvalidArgument, "--where needs at least one term");
+        }
+        tcfs::UnlockExtension extension;
+        if (!to.empty()) {
+            auto parsed = tcfs::time_utils::parse_rfc3339(to);
+            if (!parsed) {
+                throw tcfs::TCFSException(parsed.error(), parsed.error_message());
+            }
+            extension.to = parsed.value();
+        } else {
+            auto delay = tcfs::time_utils::parse_duration(extend);
+            if (!delay) {
+                throw tcfs::TCFSException(delay.error(), delay.error_message());
+            }
+            extension.by = delay.value();
+        }
+        
+        tcfs::Store store(store_path_);
+        auto& catalog = open_catalog(store);
+        if (dry_run) {
+            auto selected = query.value().select(catalog);
+            for (const auto* entry : selected) {
+                std::cout << entry->id << "  unlock "
+                          << tcfs::time_utils::format_rfc3339(
+                                 std::chrono::system_clock::from_time_t(static_cast<time_t>(entry->unlock_at)))
+                          << std::endl;
+            }
+            std::cout << selected.size() << " matching capsule(s)" << std::endl;
+            return;
+        }
+        
+        auto updated = store.extend(query.value(), extension, jobs);
+        if (!updated) {
+            throw tcfs::TCFSException(updated.error(), updated.error_message());
+        }
+        for (const auto& id : updated.value().updated) {
+            const auto* entry = catalog.find(id);
+            std::cout << "  updated " << id << " -> unlocks "
+                      << tcfs::time_utils::format_rfc3339(
+                             std::chrono::system_clock::from_time_t(static_cast<time_t>(entry->unlock_at)))
+                      << std::endl;
+        }
+        for (const auto& [id, reason] : updated.value().skipped) {
+            std::cout << "  skipped " << id << ": " << reason << std::endl;
+        }
+        for (const auto& [id, reason] : updated.value().failed) {
+            std::cerr << "  failed " << id << ": " << reason << std::endl;
+        }
+        std::cout << "Updated " << updated.value().updated.size() << " capsule(s), skipped "
+                  << updated.value().skipped.size() << std::endl;
+        if (!updated.value().failed.empty()) {
+            throw tcfs::TCFSException(tcfs::ErrorCode::FILE_ACCESS_ERROR,
+                                      std::to_string(updated.value().failed.size()) +
+                                          " capsule(s) could not be updated; rerun with --to to finish");
+        }
+    }
+    
+    void cmd_disks_add(const std::string& dir, size_t jobs) {
+        tcfs::Store store(store_path_);
+        print_rebalance(store.add_data_dir(dir, jobs));
+        cmd_disks_list();
+    }
+    
+    void cmd_disks_list() {
+        tcfs::Store store(store_path_);
+        auto dirs = store.data_dirs();
+        if (dirs.empty()) {
+            dirs.push_back(store.root());
+        }
+        std::map<fs::path, std::pair<size_t, uintmax_t>> usage;
+        for (const auto& id : store.scan_capsule_ids()) {
+            auto path = store.capsule_path(id);
+            std::error_code ec;
+            auto size = fs::file_size(path, ec);
+            if (!ec) {
+                auto& [capsules, bytes] = usage[path.parent_path()];
+                ++capsules;
+                bytes += size;
+            }
+        }
+        for (const auto& data_dir : dirs) {
+            auto [capsules, bytes] = usage[data_dir];
+            std::cout << data_dir.string() << "  " << capsules << " capsule(s)  " << bytes << " bytes" << std::endl;
+        }
+    }
+    
+    void cmd_disks_rebalance(size_t jobs) {
+        tcfs::Store store(store_path_);
+        print_rebalance(store.rebalance(jobs));
+    }
+    
+    static void print_rebalance(const tcfs::Result<tcfs::RebalanceResult>& result) {
+        if (!result) {
+            throw tcfs::TCFSException(result.error(), result.error_message());
+        }
+        for (const auto& [id, reason] : result.value().failed) {
+            std::cerr << "  failed " << id << ": " << reason << std::endl;
+        }
+        std::cout << "Moved " << result.value().moved << " capsule(s), " << result.value().bytes << " bytes" << std::endl;
+        if (!result.value().failed.empty()) {
+            throw tcfs::TCFSException(tcfs::ErrorCode::FILE_ACCESS_ERROR,
+                                      std::to_string(result.value().failed.size()) +
+                                          " capsule(s) could not be moved; run 'tcfs disks rebalance' to finish");
+        }
+    }
+    
+    void cmd_keygen(const std::string& name, const std::string& dir) {
+        auto private_key = crypto_->generateX25519PrivateKey();
+        auto public_key = crypto_->x25519PublicKey(private_key);
+        auto key_path = fs::path(dir) / (name + ".key");
+        auto pub_path = fs::path(dir) / (name + ".pub");
+        if (fs::exists(key_path)) {
+            throw tcfs::TCFSException(tcfs::ErrorCode::InvalidArgument, "Refusing to overwrite " + key_path.string());
+        }
+        {
+            std::ofstream key_out(key_path);
+            key_out << crypto_->toBase64(private_key.data) << std::endl;
+            if (!key_out) {
+                throw tcfs::TCFSException(tcfs::ErrorCode::FILE_ACCESS_ERROR, "Failed to write " + key_path.string());
+            }
+        }
+        fs::permissions(key_path, fs::perms::owner_read | fs::perms::owner_write, fs::perm_options::replace);
+        std::ofstream(pub_path) << crypto_->toBase64(public_key) << std::endl;
+        std::cout << "Private key: " << key_path.string() << " (keep it secret)" << std::endl;
+        std::cout << "Public key: " << pub_path.string() << std::endl;
+    }
+    
+    void cmd_recipients_add(const std::string& input_file, const std::string& recipient,
+                            std::optional<tcfs::RecipientCredential> credential, uint32_t iterations) {
+        tcfs::Store store(store_path_);
+        auto resolved = store.resolve(input_file);
+        if (!resolved) {
+            throw tcfs::TCFSException(resolved.error(), resolved.error_message());
+        }
+        store.set_credential(std::move(credential));
+        auto added = store.add_recipient(resolved.value(), recipient, read_passphrase(recipient), iterations);
+        if (!added) {
+            throw tcfs::TCFSException(added.error(), added.error_message());
+        }
+        std::cout << recipient << " can now open " << resolved.value() << std::endl;
+    }
+    
+    void cmd_recipients_remove(const std::string& input_file, const std::string& recipient) {
+        tcfs::Store store(store_path_);
+        auto resolved = store.resolve(input_file);
+        if (!resolved) {
+            throw tcfs::TCFSException(resolved.error(), resolved.error_message());
+        }
+        auto removed = store.remove_recipient(resolved.value(), recipient);
+        if (!removed) {
+            throw tcfs::TCFSException(removed.error(), removed.error_message());
+        }
+        std::cout << "Removed " << recipient << " from " << resolved.value() << std::endl;
+    }
+    
+    void cmd_recipients_list(const std::string& input_file) {
+        tcfs::Store store(store_path_);
+        auto resolved = store.resolve(input_file);
+        if (!resolved) {
+            throw tcfs::TCFSException(resolved.error(), resolved.error_message());
+        }
+        auto recipients = store.recipients(resolved.value());
+        if (!recipients) {
+            throw tcfs::TCFSException(recipients.error(), recipients.error_message());
+        }
+        if (recipients.value().empty()) {
+            std::cout << resolved.value() << " is not sealed to recipients" << std::endl;
+        }
+        for (const auto& name : recipients.value()) {
+            std::cout << name << std::endl;
+        }
+    }
+    
+    void cmd_verify(const std::vector<std::string>& names, const std::vector<std::string>& trust,
+                    tcfs::ScrubberOptions options) {
+        tcfs::Store store(store_path_);
+        if (!store.exists()) {
+            throw tcfs::TCFSException(tcfs::ErrorCode::FileNotFound, "Store directory does not exist. Run 'tcfs init' first.");
+        }
+        for (const auto& path : trust) {
+            options.trusted_signers.push_back(read_key_file(path, tcfs::CryptoProvider::ED25519_KEY_SIZE));
+        }
+        std::vector<std::string> ids;
+        for (const auto& name : names) {
+            auto resolved = store.resolve(name);
+            if (!resolved) {
+                throw tcfs::TCFSException(resolved.error(), resolved.error_message());
+            }
+            ids.push_back(resolved.value());
+        }
+        
+        tcfs::Scrubber scrubber(store, options);
+        auto report = names.empty() ? scrubber.scrub_all() : scrubber.scrub(ids);
+        if (!report) {
+            throw tcfs::TCFSException(report.error(), report.error_message());
+        }
+        for (const auto& [id, reason] : report.value().failed) {
+            std::cout << "FAILED  " << id << "  " << reason << std::endl;
+        }
+        std::cout << report.value().verified << " header(s) verified, " << report.value().unsigned_ids.size()
+                  << " unsigned" << std::endl;
+        if (!report.value().clean()) {
+            throw tcfs::TCFSException(tcfs::ErrorCode::InvalidMetadata,
+                                      std::to_string(report.value().failed.size()) + " header(s) failed verification");
+        }
+    }
+    
+    void cmd_audit() {
+        tcfs::Store store(store_path_);
+        auto audit = store.audit_log();
+        if (!audit) {
+            throw tcfs::TCFSException(audit.error(), audit.error_message());
+        }
+        
+        auto records = audit.value()->read_all();
+        if (!records) {
+            throw tcfs::TCFSException(records.error(), records.error_message());
+        }
+        for (const auto& record : records.value()) {
+            std::cout << record.seq << "  " << record.time << "  " << record.action << "  " << record.capsule_id
+                      << "  " << record.details.dump() << std::endl;
+        }
+        std::cout << records.value().size() << " record(s), hash chain intact" << std::endl;
+    }
 };
 
 int main(int argc, char** argv) {
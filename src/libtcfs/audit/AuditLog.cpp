@@ -0,0 +1,190 @@
+#include "tcfs/AuditLog.hpp"
+#include "tcfs/FileLock.hpp"
+#include "tcfs/Policy.hpp"
+
+namespace fs = std::filesystem;
+
+namespace tcfs {
+
+namespace {
+
+const std::string GENESIS_HASH(64, '0');
+
+// Last non-empty line of a file, found by scanning backwards from the end
+std::string read_last_line(const fs::path& path) {
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in) {
+        return {};
+    }
+    auto end = static_cast<std::streamoff>(in.tellg());
+    std::string line;
+    for (auto pos = end - 1; pos >= 0; --pos) {
+        in.seekg(pos);
+        char c = static_cast<char>(in.get());
+        if (c == '\n') {
+            if (!line.empty()) {
+                break;
+            }
+            continue;
+        }
+        line.insert(line.begin(), c);
+    }
+    return line;
+}
+
+} // namespace
+
+nlohmann::json AuditRecord::to_json() const {
+    nlohmann::json json;
+    json["seq"] = seq;
+    json["time"] = time;
+    json["action"] = action;
+    json["capsule"] = capsule_id;
+    json["details"] = details;
+    json["prev_hash"] = prev_hash;
+    if (!hash.empty()) {
+        json["hash"] = hash;
+    }
+    return json;
+}
+
+Result<AuditRecord> AuditRecord::from_json(const nlohmann::json& json) {
+    try {
+        AuditRecord record;
+        record.seq = json.at("seq").get<uint64_t>();
+        record.time = json.at("time").get<std::string>();
+        record.action = json.at("action").get<std::string>();
+        record.capsule_id = json.at("capsule").get<std::string>();
+        record.details = json.value("details", nlohmann::json::object());
+        record.prev_hash = json.at("prev_hash").get<std::string>();
+        record.hash = json.at("hash").get<std::string>();
+        return Result<AuditRecord>(std::move(record));
+    } catch (const nlohmann::json::exception& e) {
+        return Result<AuditRecord>(ErrorCode::AUDIT_LOG_ERROR, "Invalid audit record: " + std::string(e.what()));
+    }
+}
+
+Result<void> AuditLog::open(const fs::path& path) {
+    path_ = path;
+    auto tail = read_tail();
+    if (!tail) {
+        return tail;
+    }
+
+    out_.close();
+    out_.clear();
+    out_.open(path, std::ios::binary | std::ios::app);
+    if (!out_) {
+        return Result<void>(ErrorCode::AUDIT_LOG_ERROR, "Failed to open audit log: " + path.string());
+    }
+    return Result<void>();
+}
+
+Result<void> AuditLog::append(const std::string& action, const std::string& capsule_id, const nlohmann::json& details) {
+    if (!out_.is_open()) {
+        return Result<void>(ErrorCode::AUDIT_LOG_ERROR, "Audit log is not open");
+    }
+
+    // Other processes append too: chain onto whatever record is last once nobody else can add one
+    auto lock = FileLock::exclusive(path_.string() + ".lock");
+    if (!lock) {
+        return Result<void>(ErrorCode::AUDIT_LOG_ERROR, lock.error_message());
+    }
+    std::error_code ec;
+    auto size = fs::file_size(path_, ec);
+    if (!ec && size != tail_offset_) {
+        auto tail = read_tail();
+        if (!tail) {
+            return tail;
+        }
+    }
+
+    AuditRecord record;
+    record.seq = last_seq_ + 1;
+    record.time = time_utils::format_rfc3339(time_utils::now());
+    record.action = action;
+    record.capsule_id = capsule_id;
+    record.details = details;
+    record.prev_hash = last_hash_;
+    record.hash = compute_hash(record);
+
+    out_ << record.to_json().dump() << '\n';
+    out_.flush();
+    if (!out_) {
+        return Result<void>(ErrorCode::AUDIT_LOG_ERROR, "Failed to write audit log: " + path_.string());
+    }
+    last_seq_ = record.seq;
+    last_hash_ = record.hash;
+    tail_offset_ = fs::file_size(path_, ec);
+    return Result<void>();
+}
+
+Result<void> AuditLog::read_tail() {
+    last_seq_ = 0;
+    last_hash_ = GENESIS_HASH;
+    std::error_code ec;
+    tail_offset_ = fs::file_size(path_, ec);
+    if (ec) {
+        tail_offset_ = 0;
+    }
+
+    auto last = read_last_line(path_);
+    if (last.empty()) {
+        return Result<void>();
+    }
+    try {
+        auto record = AuditRecord::from_json(nlohmann::json::parse(last));
+        if (!record) {
+            return Result<void>(record.error(), record.error_message());
+        }
+        last_seq_ = record.value().seq;
+        last_hash_ = record.value().hash;
+    } catch (const nlohmann::json::exception& e) {
+        return Result<void>(ErrorCode::AUDIT_LOG_ERROR, "Corrupted audit log tail: " + std::string(e.what()));
+    }
+    return Result<void>();
+}
+
+Result<std::vector<AuditRecord>> AuditLog::read_all() const {
+    std::vector<AuditRecord> records;
+    std::ifstream in(path_, std::ios::binary);
+    if (!in) {
+        return Result<std::vector<AuditRecord>>(std::move(records)); // No log yet
+    }
+
+    std::string expected_prev = GENESIS_HASH;
+    uint64_t expected_seq = 1;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty()) {
+            continue;
+        }
+        auto json = nlohmann::json::parse(line, nullptr, false);
+        if (json.is_discarded()) {
+            return Result<std::vector<AuditRecord>>(ErrorCode::AUDIT_LOG_ERROR,
+                                                    "Unreadable audit record after seq " + std::to_string(expected_seq - 1));
+        }
+        auto record = AuditRecord::from_json(json);
+        if (!record) {
+            return Result<std::vector<AuditRecord>>(record.error(), record.error_message());
+        }
+        const auto& r = record.value();
+        if (r.seq != expected_seq || r.prev_hash != expected_prev || r.hash != compute_hash(r)) {
+            return Result<std::vector<AuditRecord>>(ErrorCode::HashChainBroken,
+                                                    "Audit hash chain broken at seq " + std::to_string(expected_seq));
+        }
+        expected_prev = r.hash;
+        ++expected_seq;
+        records.push_back(std::move(record).value());
+    }
+    return Result<std::vector<AuditRecord>>(std::move(records));
+}
+
+std::string AuditLog::compute_hash(const AuditRecord& record) const {
+    auto unsigned_record = record;
+    unsigned_record.hash.clear();
+    auto payload = record.prev_hash + unsigned_record.to_json().dump();
+    return crypto_.toHex(crypto_.sha256(std::vector<uint8_t>(payload.begin(), payload.end())));
+}
+
+} // namespace tcfs
@@ -0,0 +1,426 @@
+#include "tcfs/tcfs.h"
+#include "tcfs/Store.hpp"
+#include <algorithm>
+#include <cstring>
+#include <istream>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+struct tcfs_store {
+    explicit tcfs_store(const fs::path& root) : store(root) {}
+
+    tcfs::Store store;
+    std::string last_error;
+};
+
+namespace {
+
+thread_local std::string open_error; // Failures of tcfs_store_open(), which has no handle yet
+
+tcfs_status status_of(tcfs::ErrorCode code) {
+    switch (code) {
+    case tcfs::ErrorCode::InvalidArgument:
+    case tcfs::ErrorCode::INVALID_FORMAT:
+    case tcfs::ErrorCode::InvalidTimeFormat:
+    case tcfs::ErrorCode::INVALID_POLICY:
+    case tcfs::ErrorCode::InvalidPolicy:
+    case tcfs::ErrorCode::NotImplemented:
+        return TCFS_ERR_INVALID_ARGUMENT;
+    case tcfs::ErrorCode::FILE_NOT_FOUND:
+    case tcfs::ErrorCode::FileNotFound:
+        return TCFS_ERR_NOT_FOUND;
+    case tcfs::ErrorCode::FILE_ACCESS_ERROR:
+    case tcfs::ErrorCode::FileAccessDenied:
+        return TCFS_ERR_IO;
+    case tcfs::ErrorCode::TIME_NOT_REACHED:
+    case tcfs::ErrorCode::TimeNotReached:
+    case tcfs::ErrorCode::POLICY_VIOLATION:
+    case tcfs::ErrorCode::PolicyViolation:
+        return TCFS_ERR_LOCKED;
+    case tcfs::ErrorCode::InvalidKey:
+        return TCFS_ERR_KEY;
+    case tcfs::ErrorCode::DecryptionFailed:
+    case tcfs::ErrorCode::CorruptedData:
+    case tcfs::ErrorCode::InvalidMetadata:
+        return TCFS_ERR_CORRUPTED;
+    default:
+        return TCFS_ERR_INTERNAL;
+    }
+}
+
+tcfs_status fail(std::string& last_error, tcfs_status status, const std::string& message) {
+    last_error = message;
+    return status;
+}
+
+template <typename T>
+tcfs_status fail(std::string& last_error, const tcfs::Result<T>& result) {
+    return fail(last_error, status_of(result.error()), result.error_message());
+}
+
+/**
+ * @brief The store's catalog, caught up with what other handles and processes have committed
+ */
+tcfs::Result<tcfs::Catalog*> current_catalog(tcfs::Store& store) {
+    auto catalog = store.catalog();
+    if (!catalog) {
+        return catalog;
+    }
+    auto refreshed = catalog.value()->refresh();
+    if (!refreshed) {
+        return tcfs::Result<tcfs::Catalog*>(refreshed.error(), refreshed.error_message());
+    }
+    return catalog;
+}
+
+/**
+ * @brief Run body, turning any exception into a status, so none reaches C callers
+ */
+template <typename Body>
+tcfs_status guarded(std::string& last_error, Body&& body) {
+    last_error.clear();
+    try {
+        return body();
+    } catch (const tcfs::TCFSException& e) {
+        return fail(last_error, status_of(e.getErrorCode()), e.getMessage());
+    } catch (const std::bad_alloc&) {
+        return fail(last_error, TCFS_ERR_INTERNAL, "Out of memory");
+    } catch (const std::exception& e) {
+        return fail(last_error, TCFS_ERR_INTERNAL, e.what());
+    } catch (...) {
+        return fail(last_error, TCFS_ERR_INTERNAL, "Unknown error");
+    }
+}
+
+/**
+ * @brief Stream buffer over the caller's memory; the segment reads copy out of it directly
+ */
+class MemoryReader : public std::streambuf {
+public:
+    MemoryReader(const void* data, size_t size) {
+        // Only read, never written through
+        auto* begin = const_cast<char*>(static_cast<const char*>(data));
+        setg(begin, begin, begin + size);
+    }
+};
+
+/**
+ * @brief Stream buffer over a tcfs_read_fn; bulk reads go straight into the reader's destination
+ */
+class CallbackReader : public std::streambuf {
+public:
+    CallbackReader(tcfs_read_fn read, void* context) : read_(read), context_(context) {}
+
+    ~CallbackReader() override {
+        std::fill(buffer_.begin(), buffer_.end(), '\0'); // Held plaintext
+    }
+
+    bool failed() const { return failed_; }
+
+protected:
+    int_type underflow() override {
+        auto got = next(buffer_.data(), buffer_.size());
+        if (got == 0) {
+            return traits_type::eof();
+        }
+        setg(buffer_.data(), buffer_.data(), buffer_.data() + got);
+        return traits_type::to_int_type(buffer_[0]);
+    }
+
+    std::streamsize xsgetn(char* destination, std::streamsize count) override {
+        // Drain what underflow() buffered first, then read into destination itself
+        auto buffered = std::min<std::streamsize>(count, egptr() - gptr());
+        if (buffered > 0) {
+            std::memcpy(destination, gptr(), static_cast<size_t>(buffered));
+            gbump(static_cast<int>(buffered));
+        }
+        std::streamsize total = std::max<std::streamsize>(buffered, 0);
+        while (total < count) {
+            auto got = next(destination + total, static_cast<size_t>(count - total));
+            if (got == 0) {
+                break;
+            }
+            total += static_cast<std::streamsize>(got);
+        }
+        return total;
+    }
+
+private:
+    size_t next(char* destination, size_t size) {
+        if (failed_) {
+            return 0;
+        }
+        auto got = read_(context_, destination, size);
+        if (got < 0 || static_cast<uint64_t>(got) > size) {
+            failed_ = true;
+            return 0;
+        }
+        return static_cast<size_t>(got);
+    }
+
+    tcfs_read_fn read_;
+    void* context_;
+    std::vector<char> buffer_ = std::vector<char>(64 * 1024);
+    bool failed_ = false;
+};
+
+tcfs_status lock_from(tcfs_store* store, const char* name, const char* unlock_at, std::istream& input, uint64_t size,
+                      char* id, size_t id_size, const CallbackReader* reader = nullptr) {
+    if (!store) {
+        return TCFS_ERR_INVALID_ARGUMENT;
+    }
+    return guarded(store->last_error, [&] {
+        if (!name || !unlock_at || !id) {
+            return fail(store->last_error, TCFS_ERR_INVALID_ARGUMENT, "name, unlock_at and id are required");
+        }
+        tcfs::Policy policy;
+        policy.set_unlock_time(std::string(unlock_at));
+        policy.set_owner(store->store.default_owner());
+
+        // The id must fit before anything is written, or the caller could not name the capsule
+        auto expected = store->store.id_for(name);
+        if (!expected) {
+            return fail(store->last_error, expected);
+        }
+        if (expected.value().size() >= id_size) {
+            return fail(store->last_error, TCFS_ERR_BUFFER_TOO_SMALL,
+                        "Capsule id needs " + std::to_string(expected.value().size() + 1) + " bytes");
+        }
+        auto locked = store->store.lock(input, size, name, policy);
+        if (!locked) {
+            if (reader && reader->failed()) {
+                return fail(store->last_error, TCFS_ERR_IO, "Read callback failed: " + locked.error_message());
+            }
+            return fail(store->last_error, locked);
+        }
+        std::memcpy(id, locked.value().c_str(), locked.value().size() + 1);
+        return TCFS_OK;
+    });
+}
+
+} // namespace
+
+extern "C" {
+
+uint32_t tcfs_abi_version(void) {
+    return TCFS_ABI_VERSION;
+}
+
+tcfs_status tcfs_store_open(const char* root, tcfs_store** store) {
+    if (!store) {
+        return fail(open_error, TCFS_ERR_INVALID_ARGUMENT, "store is required");
+    }
+    return guarded(open_error, [&] {
+        if (!root) {
+            return fail(open_error, TCFS_ERR_INVALID_ARGUMENT, "root is required");
+        }
+        auto opened = std::make_unique<tcfs_store>(root);
+        if (!opened->store.exists()) {
+            return fail(open_error, TCFS_ERR_NOT_FOUND, std::string("No TCFS store at ") + root);
+        }
+        *store = opened.release();
+        return TCFS_OK;
+    });
+}
+
+void tcfs_store_close(tcfs_store* store) {
+    delete store;
+}
+
+const char* tcfs_last_error(const tcfs_store* store) {
+    return store ? store->last_error.c_str() : open_error.c_str();
+}
+
+tcfs_status tcfs_store_set_credential(tcfs_store* store, const char* recipient, const char* passphrase) {
+    if (!store) {
+        return TCFS_ERR_INVALID_ARGUMENT;
+    }
+    return guarded(store->last_error, [&] {
+        if (!recipient) {
+            store->store.set_credential(std::nullopt);
+            return TCFS_OK;
+        }
+        store->store.set_credential(tcfs::RecipientCredential{recipient, passphrase ? passphrase : ""});
+        return TCFS_OK;
+    });
+}
+
+tcfs_status tcfs_lock_buffer(tcfs_store* store, const char* name, const char* unlock_at, const void* data,
+                             size_t size, char* id, size_t id_size) {
+    if (!data && size != 0) {
+        return store ? fail(store->last_error, TCFS_ERR_INVALID_ARGUMENT, "data is required") : TCFS_ERR_INVALID_ARGUMENT;
+    }
+    MemoryReader reader(data, size);
+    std::istream input(&reader);
+    return lock_from(store, name, unlock_at, input, size, id, id_size);
+}
+
+tcfs_status tcfs_lock_stream(tcfs_store* store, const char* name, const char* unlock_at, tcfs_read_fn read,
+                             void* context, uint64_t size, char* id, size_t id_size) {
+    if (!read) {
+        return store ? fail(store->last_error, TCFS_ERR_INVALID_ARGUMENT, "read is required") : TCFS_ERR_INVALID_ARGUMENT;
+    }
+    CallbackReader reader(read, context);
+    std::istream input(&reader);
+    return lock_from(store, name, unlock_at, input, size, id, id_size, &reader);
+}
+
+tcfs_status tcfs_capsule_size(tcfs_store* store, const char* id, const char* stage, uint64_t* size) {
+    if (!store) {
+        return TCFS_ERR_INVALID_ARGUMENT;
+    }
+    return guarded(store->last_error, [&] {
+        if (!id || !size) {
+            return fail(store->last_error, TCFS_ERR_INVALID_ARGUMENT, "id and size are required");
+        }
+        auto resolved = store->store.resolve(id);
+        if (!resolved) {
+            return fail(store->last_error, resolved);
+        }
+        auto layout = store->store.read_layout(resolved.value());
+        if (!layout) {
+            return fail(store->last_error, layout);
+        }
+        if (!stage) {
+            *size = layout.value().plaintext_size;
+            return TCFS_OK;
+        }
+        auto index = layout.value().find_stage(stage);
+        if (!index) {
+            return fail(store->last_error, TCFS_ERR_NOT_FOUND, std::string("No stage named ") + stage);
+        }
+        *size = layout.value().stages[*index].length;
+        return TCFS_OK;
+    });
+}
+
+tcfs_status tcfs_unlock_range(tcfs_store* store, const char* id, const char* stage, uint64_t offset, void* buffer,
+                              size_t size, size_t* written) {
+    if (!store) {
+        return TCFS_ERR_INVALID_ARGUMENT;
+    }
+    return guarded(store->last_error, [&] {
+        if (!id || !written || (!buffer && size != 0)) {
+            return fail(store->last_error, TCFS_ERR_INVALID_ARGUMENT, "id, buffer and written are required");
+        }
+        *written = 0;
+        auto resolved = store->store.resolve(id);
+        if (!resolved) {
+            return fail(store->last_error, resolved);
+        }
+        const auto& capsule = resolved.value();
+        auto layout = store->store.read_layout(capsule);
+        if (!layout) {
+            return fail(store->last_error, layout);
+        }
+        const auto& stages = layout.value().stages;
+
+        // Plaintext range of the whole capsule to read
+        uint64_t begin = offset;
+        uint64_t limit = layout.value().plaintext_size;
+        if (stage) {
+            auto index = layout.value().find_stage(stage);
+            if (!index) {
+                return fail(store->last_error, TCFS_ERR_NOT_FOUND, std::string("No stage named ") + stage);
+            }
+            begin = stages[*index].offset + offset;
+            limit = stages[*index].offset + stages[*index].length;
+            if (offset > stages[*index].length) {
+                return fail(store->last_error, TCFS_ERR_INVALID_ARGUMENT, "offset is past the end of the stage");
+            }
+        } else if (offset > limit) {
+            return fail(store->last_error, TCFS_ERR_INVALID_ARGUMENT, "offset is past the end of the capsule");
+        }
+        const uint64_t end = begin + std::min<uint64_t>(size, limit - begin);
+
+        auto catalog = current_catalog(store->store);
+        if (!catalog) {
+            return fail(store->last_error, catalog);
+        }
+        if (!catalog.value()->dependencies_ready(capsule)) {
+            return fail(store->last_error, TCFS_ERR_LOCKED, "Capsules that " + capsule + " depends on are not unlocked yet");
+        }
+        auto now = tcfs::time_utils::now();
+        for (const auto& current : stages) {
+            if (current.offset < end && begin < current.offset + current.length &&
+                !current.policy.is_unlock_allowed(now)) {
+                return fail(store->last_error, TCFS_ERR_LOCKED,
+                            "Stage " + current.name + " is locked until " + current.policy.unlock_time_rfc3339());
+            }
+        }
+
+        auto* output = static_cast<uint8_t*>(buffer);
+        for (size_t i = 0; i < stages.size(); ++i) {
+            auto from = std::max(begin, stages[i].offset);
+            auto to = std::min(end, stages[i].offset + stages[i].length);
+            if (from >= to) {
+                continue;
+            }
+            auto part = store->store.read_range(capsule, i, from - stages[i].offset, to - from);
+            if (!part) {
+                std::fill(output, output + *written, uint8_t{0});
+                *written = 0;
+                return fail(store->last_error, part);
+            }
+            std::memcpy(output + *written, part.value().data(), part.value().size());
+            std::fill(part.value().begin(), part.value().end(), uint8_t{0});
+            *written += part.value().size();
+        }
+        return TCFS_OK;
+    });
+}
+
+tcfs_status tcfs_mark_released(tcfs_store* store, const char* id) {
+    if (!store) {
+        return TCFS_ERR_INVALID_ARGUMENT;
+    }
+    return guarded(store->last_error, [&] {
+        if (!id) {
+            return fail(store->last_error, TCFS_ERR_INVALID_ARGUMENT, "id is required");
+        }
+        auto resolved = store->store.resolve(id);
+        if (!resolved) {
+            return fail(store->last_error, resolved);
+        }
+        const auto& capsule = resolved.value();
+
+        // The same rule as unlocking: dependencies out, and every stage open, since the release is final
+        auto catalog = current_catalog(store->store);
+        if (!catalog) {
+            return fail(store->last_error, catalog);
+        }
+        if (!catalog.value()->dependencies_ready(capsule)) {
+            return fail(store->last_error, TCFS_ERR_LOCKED, "Capsules that " + capsule + " depends on are not unlocked yet");
+        }
+        auto now = tcfs::time_utils::now();
+        if (auto layout = store->store.read_layout(capsule)) {
+            for (const auto& current : layout.value().stages) {
+                if (!current.policy.is_unlock_allowed(now)) {
+                    return fail(store->last_error, TCFS_ERR_LOCKED,
+                                "Stage " + current.name + " is locked until " + current.policy.unlock_time_rfc3339());
+                }
+            }
+        } else {
+            auto policy = store->store.read_policy(capsule);
+            if (!policy) {
+                return fail(store->last_error, policy);
+            }
+            if (!policy.value().is_unlock_allowed(now)) {
+                return fail(store->last_error, TCFS_ERR_LOCKED,
+                            capsule + " is locked until " + policy.value().unlock_time_rfc3339());
+            }
+        }
+
+        auto released = store->store.mark_released(capsule);
+        if (!released) {
+            return fail(store->last_error, released);
+        }
+        return TCFS_OK;
+    });
+}
+
+} // extern "C"
@@ -0,0 +1,292 @@
+#include "tcfs/Condition.hpp"
+#include "tcfs/Policy.hpp"
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstdio>
+
+namespace tcfs {
+
+namespace {
+
+constexpr int64_t SECONDS_PER_DAY = 86400;
+
+int64_t floor_div(int64_t a, int64_t b) {
+    int64_t q = a / b;
+    return (a % b != 0 && (a < 0) != (b < 0)) ? q - 1 : q;
+}
+
+Result<int64_t> parse_epoch_seconds(const nlohmann::json& value, const std::string& field) {
+    if (!value.is_string()) {
+        return Result<int64_t>(ErrorCode::InvalidPolicy, "Condition '" + field + "' must be an RFC3339 string");
+    }
+    auto parsed = time_utils::parse_rfc3339(value.get<std::string>());
+    if (!parsed) {
+        return Result<int64_t>(ErrorCode::InvalidPolicy, "Condition '" + field + "': " + parsed.error_message());
+    }
+    return Result<int64_t>(static_cast<int64_t>(std::chrono::system_clock::to_time_t(parsed.value())));
+}
+
+Result<int64_t> parse_time_of_day(const nlohmann::json& value, const std::string& field) {
+    if (!value.is_string()) {
+        return Result<int64_t>(ErrorCode::InvalidPolicy, "Condition '" + field + "' must be an HH:MM string");
+    }
+    const auto text = value.get<std::string>();
+    int hours = 0;
+    int minutes = 0;
+    int seconds = 0;
+    char extra = 0;
+    int fields = std::sscanf(text.c_str(), "%d:%d:%d%c", &hours, &minutes, &seconds, &extra);
+    if (fields < 2 || fields > 3 || hours < 0 || hours > 24 || minutes < 0 || minutes > 59 ||
+        seconds < 0 || seconds > 59 || (hours == 24 && (minutes != 0 || seconds != 0))) {
+        return Result<int64_t>(ErrorCode::InvalidPolicy, "Invalid time of day: " + text);
+    }
+    return Result<int64_t>(static_cast<int64_t>(hours) * 3600 + minutes * 60 + seconds);
+}
+
+Result<int64_t> parse_weekday(const std::string& name) {
+    static const std::array<const char*, 7> names = {"sun", "mon", "tue", "wed", "thu", "fri", "sat"};
+    std::string key = name.substr(0, 3);
+    std::transform(key.begin(), key.end(), key.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    for (size_t i = 0; i < names.size(); ++i) {
+        if (key == names[i]) {
+            return Result<int64_t>(static_cast<int64_t>(i));
+        }
+    }
+    return Result<int64_t>(ErrorCode::InvalidPolicy, "Unknown weekday: " + name);
+}
+
+/**
+ * @brief Recursive compiler from the JSON tree to postfix instructions
+ */
+class ConditionCompiler {
+public:
+    explicit ConditionCompiler(std::vector<ConditionInstr>& program) : program_(program) {}
+
+    Result<void> compile(const nlohmann::json& node) {
+        if (!node.is_object() || node.size() != 1) {
+            return Result<void>(ErrorCode::InvalidPolicy, "Condition node must be an object with exactly one key");
+        }
+        const auto it = node.begin();
+        const std::string key = it.key();
+        const auto& value = it.value();
+
+        if (key == "all" || key == "any") {
+            return compile_chain(value, key == "all" ? ConditionOp::And : ConditionOp::Or, key);
+        }
+        if (key == "not") {
+            auto inner = compile(value);
+            if (!inner) {
+                return inner;
+            }
+            emit({ConditionOp::Not, 0, 0});
+            return Result<void>();
+        }
+        if (key == "after" || key == "before") {
+            auto at = parse_epoch_seconds(value, key);
+            if (!at) {
+                return Result<void>(at.error(), at.error_message());
+            }
+            emit({key == "after" ? ConditionOp::After : ConditionOp::Before, at.value(), 0});
+            return Result<void>();
+        }
+        if (key == "window") {
+            if (!value.is_object() || !value.contains("from") || !value.contains("to")) {
+                return Result<void>(ErrorCode::InvalidPolicy, "Condition 'window' requires 'from' and 'to'");
+            }
+            auto from = parse_epoch_seconds(value["from"], "window.from");
+            if (!from) {
+                return Result<void>(from.error(), from.error_message());
+            }
+            auto to = parse_epoch_seconds(value["to"], "window.to");
+            if (!to) {
+                return Result<void>(to.error(), to.error_message());
+            }
+            if (to.value() <= from.value()) {
+                return Result<void>(ErrorCode::InvalidPolicy, "Condition 'window' must end after it starts");
+            }
+            emit({ConditionOp::Between, from.value(), to.value()});
+            return Result<void>();
+        }
+        if (key == "weekdays") {
+            if (!value.is_array() || value.empty()) {
+                return Result<void>(ErrorCode::InvalidPolicy, "Condition 'weekdays' must be a non-empty array");
+            }
+            int64_t mask = 0;
+            for (const auto& day : value) {
+                if (!day.is_string()) {
+                    return Result<void>(ErrorCode::InvalidPolicy, "Weekday names must be strings");
+                }
+                auto index = parse_weekday(day.get<std::string>());
+                if (!index) {
+                    return Result<void>(index.error(), index.error_message());
+                }
+                mask |= int64_t{1} << index.value();
+            }
+            emit({ConditionOp::Weekday, mask, 0});
+            return Result<void>();
+        }
+        if (key == "time_of_day") {
+            if (!value.is_object() || !value.contains("from") || !value.contains("to")) {
+                return Result<void>(ErrorCode::InvalidPolicy, "Condition 'time_of_day' requires 'from' and 'to'");
+            }
+            auto from = parse_time_of_day(value["from"], "time_of_day.from");
+            if (!from) {
+                return Result<void>(from.error(), from.error_message());
+            }
+            auto to = parse_time_of_day(value["to"], "time_of_day.to");
+            if (!to) {
+                return Result<void>(to.error(), to.error_message());
+            }
+            emit({ConditionOp::TimeOfDay, from.value(), to.value()});
+            return Result<void>();
+        }
+        if (key == "label") {
+            if (!value.is_string()) {
+                return Result<void>(ErrorCode::InvalidPolicy, "Condition 'label' must be a string");
+            }
+            emit({ConditionOp::LabelEquals, static_cast<int64_t>(Condition::hash_label(value.get<std::string>())), 0});
+            return Result<void>();
+        }
+        return Result<void>(ErrorCode::InvalidPolicy, "Unknown condition: " + key);
+    }
+
+    size_t max_depth() const { return max_depth_; }
+
+private:
+    std::vector<ConditionInstr>& program_;
+    size_t depth_ = 0;
+    size_t max_depth_ = 0;
+
+    Result<void> compile_chain(const nlohmann::json& children, ConditionOp op, const std::string& key) {
+        if (!children.is_array()) {
+            return Result<void>(ErrorCode::InvalidPolicy, "Condition '" + key + "' must be an array");
+        }
+        if (children.empty()) {
+            // Identity element: all() is true, any() is false
+            emit({ConditionOp::Const, op == ConditionOp::And ? 1 : 0, 0});
+            return Result<void>();
+        }
+        for (size_t i = 0; i < children.size(); ++i) {
+            auto child = compile(children[i]);
+            if (!child) {
+                return child;
+            }
+            if (i > 0) {
+                emit({op, 0, 0});
+            }
+        }
+        return Result<void>();
+    }
+
+    void emit(const ConditionInstr& instr) {
+        switch (instr.op) {
+            case ConditionOp::And:
+            case ConditionOp::Or:
+                --depth_;
+                break;
+            case ConditionOp::Not:
+                break;
+            default:
+                ++depth_;
+                break;
+        }
+        max_depth_ = std::max(max_depth_, depth_);
+        program_.push_back(instr);
+    }
+};
+
+} // namespace
+
+ConditionContext ConditionContext::make(const std::chrono::system_clock::time_point& now, const std::string& label) {
+    ConditionContext ctx;
+    ctx.now = static_cast<int64_t>(std::chrono::system_clock::to_time_t(now));
+    ctx.label_hash = Condition::hash_label(label);
+    return ctx;
+}
+
+Result<Condition> Condition::from_json(const nlohmann::json& json) {
+    Condition condition;
+    if (json.is_null()) {
+        return Result<Condition>(std::move(condition));
+    }
+
+    ConditionCompiler compiler(condition.program_);
+    auto compiled = compiler.compile(json);
+    if (!compiled) {
+        return Result<Condition>(compiled.error(), compiled.error_message());
+    }
+    if (compiler.max_depth() > MAX_STACK_DEPTH) {
+        return Result<Condition>(ErrorCode::InvalidPolicy, "Condition is nested too deeply");
+    }
+
+    condition.source_ = json;
+    return Result<Condition>(std::move(condition));
+}
+
+bool Condition::evaluate(const ConditionContext& ctx) const {
+    if (program_.empty()) {
+        return true;
+    }
+
+    const int64_t now = ctx.now;
+    const int64_t days = floor_div(now, SECONDS_PER_DAY);
+    const int64_t seconds_of_day = now - days * SECONDS_PER_DAY;
+    const int64_t weekday = (days % 7 + 11) % 7; // 1970-01-01 was a Thursday
+
+    // Operand stack held in the bits of one register; bit 0 is the top
+    uint64_t stack = 0;
+    for (const auto& instr : program_) {
+        uint64_t bit = 0;
+        switch (instr.op) {
+            case ConditionOp::Const:
+                bit = static_cast<uint64_t>(instr.a != 0);
+                break;
+            case ConditionOp::After:
+                bit = static_cast<uint64_t>(now >= instr.a);
+                break;
+            case ConditionOp::Before:
+                bit = static_cast<uint64_t>(now < instr.a);
+                break;
+            case ConditionOp::Between:
+                bit = static_cast<uint64_t>(now >= instr.a) & static_cast<uint64_t>(now < instr.b);
+                break;
+            case ConditionOp::Weekday:
+                bit = static_cast<uint64_t>(instr.a >> weekday) & 1u;
+                break;
+            case ConditionOp::TimeOfDay: {
+                const uint64_t lo = static_cast<uint64_t>(seconds_of_day >= instr.a);
+                const uint64_t hi = static_cast<uint64_t>(seconds_of_day < instr.b);
+                bit = instr.a > instr.b ? (lo | hi) : (lo & hi);
+                break;
+            }
+            case ConditionOp::LabelEquals:
+                bit = static_cast<uint64_t>(ctx.label_hash == static_cast<uint64_t>(instr.a));
+                break;
+            case ConditionOp::And:
+                stack = (stack >> 1) & (~uint64_t{1} | (stack & 1u));
+                continue;
+            case ConditionOp::Or:
+                stack = (stack >> 1) | (stack & 1u);
+                continue;
+            case ConditionOp::Not:
+                stack ^= 1u;
+                continue;
+        }
+        stack = (stack << 1) | bit;
+    }
+    return (stack & 1u) != 0;
+}
+
+uint64_t Condition::hash_label(const std::string& label) {
+    // FNV-1a, 64-bit
+    uint64_t hash = 14695981039346656037ULL;
+    for (char c : label) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+} // namespace tcfs
@@ -1,4 +1,5 @@
 #include "tcfs/Policy.hpp"
+#include <algorithm>
 #include <iomanip>
 #include <sstream>
 #include <regex>
@@ -35,6 +36,34 @@ std::chrono::seconds Policy::time_remaining() const {
     return std::chrono::duration_cast<std::chrono::seconds>(effective_unlock_time - now);
 }
 
+bool Policy::is_unlock_allowed() const {
+    return is_unlock_allowed(time_utils::now());
+}
+
+bool Policy::is_unlock_allowed(const TimePoint& now) const {
+    auto grace_duration = std::chrono::seconds(grace_seconds_);
+    bool time_reached = now >= (unlock_at_ - grace_duration);
+    bool window_open = !recurrence_ || recurrence_->is_open(now);
+    return time_reached && window_open && !is_expired(now) &&
+           condition_.evaluate(ConditionContext::make(now, label_));
+}
+
+std::optional<Policy::TimePoint> Policy::next_unlock_time(const TimePoint& now) const {
+    auto grace_duration = std::chrono::seconds(grace_seconds_);
+    auto candidate = std::max(now, unlock_at_ - grace_duration);
+    if (recurrence_) {
+        auto next = recurrence_->next_open(candidate);
+        if (next && is_expired(*next)) {
+            return std::nullopt;
+        }
+        return next;
+    }
+    if (is_expired(candidate)) {
+        return std::nullopt;
+    }
+    return candidate;
+}
+
 Result<void> Policy::validate() const {
     if (owner_.empty()) {
         return Result<void>(ErrorCode::InvalidPolicy, "Owner cannot be empty");
@@ -49,6 +78,10 @@ Result<void> Policy::validate() const {
         return Result<void>(ErrorCode::InvalidPolicy, "Unlock time must be in the future");
     }
     
+    if (expire_at_ && *expire_at_ <= unlock_at_) {
+        return Result<void>(ErrorCode::InvalidPolicy, "Expiry time must be after the unlock time");
+    }
+    
     return Result<void>();
 }
 
@@ -61,6 +94,18 @@ nlohmann::json Policy::to_json() const {
     json["grace_seconds"] = grace_seconds_;
     json["algorithm"] = tcfs::to_string(algorithm_);
     json["kdf"] = tcfs::to_string(kdf_);
+    if (!condition_.empty()) {
+        json["condition"] = condition_.to_json();
+    }
+    if (recurrence_) {
+        json["recurrence"] = recurrence_->to_json();
+    }
+    if (!depends_on_.empty()) {
+        json["depends_on"] = depends_on_;
+    }
+    if (expire_at_) {
+        json["expire_at"] = time_utils::format_rfc3339(*expire_at_);
+    }
     return json;
 }
 
@@ -107,6 +152,34 @@ Result<Policy> Policy::from_json(const nlohmann::json& json, bool skip_time_vali
             }
         }
         
+        if (json.contains("condition") && !json["condition"].is_null()) {
+            auto condition_result = Condition::from_json(json["condition"]);
+            if (!condition_result) {
+                return Result<Policy>(condition_result.error(), condition_result.error_message());
+            }
+            policy.set_condition(std::move(condition_result).value());
+        }
+        
+        if (json.contains("recurrence") && !json["recurrence"].is_null()) {
+            auto recurrence_result = Recurrence::from_json(json["recurrence"]);
+            if (!recurrence_result) {
+                return Result<Policy>(recurrence_result.error(), recurrence_result.error_message());
+            }
+            policy.set_recurrence(std::move(recurrence_result).value());
+        }
+        
+        if (json.contains("depends_on") && json["depends_on"].is_array()) {
+            policy.set_depends_on(json["depends_on"].get<std::vector<std::string>>());
+        }
+        
+        if (json.contains("expire_at") && json["expire_at"].is_string()) {
+            auto expire_result = time_utils::parse_rfc3339(json["expire_at"].get<std::string>());
+            if (!expire_result) {
+                return Result<Policy>(expire_result.error(), "Invalid expire_at: " + expire_result.error_message());
+            }
+            policy.set_expire_at(expire_result.value());
+        }
+        
         if (!skip_time_validation) {
             auto validation = policy.validate();
             if (!validation) {
@@ -129,6 +202,18 @@ std::string Policy::to_string() const {
     oss << ", label=" << label_;
     oss << ", algorithm=" << tcfs::to_string(algorithm_);
     oss << ", kdf=" << tcfs::to_string(kdf_);
+    if (!condition_.empty()) {
+        oss << ", condition=" << condition_.to_json().dump();
+    }
+    if (recurrence_) {
+        oss << ", recurrence=" << recurrence_->to_json().dump();
+    }
+    if (!depends_on_.empty()) {
+        oss << ", depends_on=" << nlohmann::json(depends_on_).dump();
+    }
+    if (expire_at_) {
+        oss << ", expire_at=" << time_utils::format_rfc3339(*expire_at_);
+    }
     oss << "}";
     return oss.str();
 }
@@ -204,6 +289,30 @@ Policy::TimePoint now() {
     return std::chrono::system_clock::now();
 }
 
+Result<std::chrono::seconds> parse_duration(const std::string& text) {
+    std::regex duration_regex(R"((\d+)([smhdw]))");
+    std::smatch matches;
+    
+    if (!std::regex_match(text, matches, duration_regex)) {
+        return Result<std::chrono::seconds>(ErrorCode::InvalidArgument, "Invalid duration (expected e.g. 30d): " + text);
+    }
+    
+    try {
+        int64_t amount = std::stoll(matches[1].str());
+        int64_t multiplier = 1;
+        switch (matches[2].str()[0]) {
+            case 'm': multiplier = 60; break;
+            case 'h': multiplier = 3600; break;
+            case 'd': multiplier = 86400; break;
+            case 'w': multiplier = 7 * 86400; break;
+            default: break;
+        }
+        return Result<std::chrono::seconds>(std::chrono::seconds(amount * multiplier));
+    } catch (const std::exception& e) {
+        return Result<std::chrono::seconds>(ErrorCode::InvalidArgument, std::string("Invalid duration: ") + e.what());
+    }
+}
+
 } // namespace time_utils
 
 std::string to_string(CryptoAlgorithm algo) {
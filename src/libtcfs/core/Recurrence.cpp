@@ -0,0 +1,241 @@
+#include "tcfs/Recurrence.hpp"
+#include "tcfs/Policy.hpp"
+#include <algorithm>
+
+namespace tcfs {
+
+namespace {
+
+int64_t floor_div(int64_t a, int64_t b) {
+    int64_t q = a / b;
+    return (a % b != 0 && (a < 0) != (b < 0)) ? q - 1 : q;
+}
+
+int64_t unit_seconds(RecurrenceUnit unit) {
+    switch (unit) {
+        case RecurrenceUnit::Minutes:
+            return 60;
+        case RecurrenceUnit::Hours:
+            return 3600;
+        case RecurrenceUnit::Days:
+            return 86400;
+        case RecurrenceUnit::Weeks:
+            return 7 * 86400;
+        default:
+            return 0; // Calendar units have no fixed length
+    }
+}
+
+bool is_calendar_unit(RecurrenceUnit unit) {
+    return unit == RecurrenceUnit::Months || unit == RecurrenceUnit::Years;
+}
+
+} // namespace
+
+Recurrence::Recurrence(TimePoint start, uint32_t every, RecurrenceUnit unit, std::chrono::seconds duration,
+                       std::optional<TimePoint> until)
+    : start_(start), every_(every), unit_(unit), duration_(duration), until_(until) {
+}
+
+Recurrence::TimePoint Recurrence::window_start(int64_t k) const {
+    if (!is_calendar_unit(unit_)) {
+        return start_ + std::chrono::seconds(k * static_cast<int64_t>(every_) * unit_seconds(unit_));
+    }
+
+    using namespace std::chrono;
+    const int64_t step_months = static_cast<int64_t>(every_) * (unit_ == RecurrenceUnit::Years ? 12 : 1);
+    const auto start_day = floor<days>(start_);
+    const auto time_of_day = start_ - start_day;
+    const year_month_day ymd{start_day};
+
+    const year_month ym = year_month{ymd.year(), ymd.month()} + months{k * step_months};
+    const day last = year_month_day_last{ym.year(), month_day_last{ym.month()}}.day();
+    const day clamped = std::min(ymd.day(), last);
+    return sys_days{ym / clamped} + time_of_day;
+}
+
+int64_t Recurrence::window_index(const TimePoint& t) const {
+    if (!is_calendar_unit(unit_)) {
+        const int64_t period = static_cast<int64_t>(every_) * unit_seconds(unit_);
+        const int64_t elapsed = std::chrono::duration_cast<std::chrono::seconds>(t - start_).count();
+        return floor_div(elapsed, period);
+    }
+
+    using namespace std::chrono;
+    const int64_t step_months = static_cast<int64_t>(every_) * (unit_ == RecurrenceUnit::Years ? 12 : 1);
+    const year_month_day from{floor<days>(start_)};
+    const year_month_day to{floor<days>(t)};
+    const int64_t elapsed_months = (static_cast<int64_t>(static_cast<int>(to.year())) -
+                                    static_cast<int64_t>(static_cast<int>(from.year()))) * 12 +
+                                   (static_cast<int64_t>(static_cast<unsigned>(to.month())) -
+                                    static_cast<int64_t>(static_cast<unsigned>(from.month())));
+    int64_t k = floor_div(elapsed_months, step_months);
+    // Same month as t but a later day or time of day: the previous window is the current one
+    if (window_start(k) > t) {
+        --k;
+    }
+    return k;
+}
+
+bool Recurrence::is_open(const TimePoint& now) const {
+    if (now < start_) {
+        return false;
+    }
+    const auto opened = window_start(window_index(now));
+    if (until_ && opened >= *until_) {
+        return false;
+    }
+    return now < opened + duration_;
+}
+
+std::optional<Recurrence::TimePoint> Recurrence::next_open(const TimePoint& now) const {
+    TimePoint candidate = start_;
+    if (now >= start_) {
+        const int64_t k = window_index(now);
+        const auto opened = window_start(k);
+        if (now < opened + duration_ && (!until_ || opened < *until_)) {
+            return now;
+        }
+        candidate = window_start(k + 1);
+    }
+    if (until_ && candidate >= *until_) {
+        return std::nullopt;
+    }
+    return candidate;
+}
+
+Result<void> Recurrence::validate() const {
+    if (start_ == TimePoint{}) {
+        return Result<void>(ErrorCode::InvalidPolicy, "Recurrence start must be set");
+    }
+    if (every_ == 0) {
+        return Result<void>(ErrorCode::InvalidPolicy, "Recurrence interval must be at least 1");
+    }
+    if (duration_.count() <= 0) {
+        return Result<void>(ErrorCode::InvalidPolicy, "Recurrence window duration must be positive");
+    }
+
+    // Windows must not overlap, otherwise the rule degenerates to "always open"
+    int64_t shortest_period = static_cast<int64_t>(every_) * unit_seconds(unit_);
+    if (unit_ == RecurrenceUnit::Months) {
+        shortest_period = static_cast<int64_t>(every_) * 28 * 86400;
+    } else if (unit_ == RecurrenceUnit::Years) {
+        shortest_period = static_cast<int64_t>(every_) * 365 * 86400;
+    }
+    if (duration_.count() > shortest_period) {
+        return Result<void>(ErrorCode::InvalidPolicy, "Recurrence window is longer than its period");
+    }
+
+    if (until_ && *until_ <= start_) {
+        return Result<void>(ErrorCode::InvalidPolicy, "Recurrence must end after it starts");
+    }
+    return Result<void>();
+}
+
+nlohmann::json Recurrence::to_json() const {
+    nlohmann::json json;
+    json["start"] = time_utils::format_rfc3339(start_);
+    json["every"] = every_;
+    json["unit"] = tcfs::to_string(unit_);
+    json["duration_seconds"] = duration_.count();
+    if (until_) {
+        json["until"] = time_utils::format_rfc3339(*until_);
+    }
+    return json;
+}
+
+Result<Recurrence> Recurrence::from_json(const nlohmann::json& json) {
+    if (!json.is_object()) {
+        return Result<Recurrence>(ErrorCode::InvalidPolicy, "Recurrence must be an object");
+    }
+    if (!json.contains("start") || !json["start"].is_string()) {
+        return Result<Recurrence>(ErrorCode::InvalidPolicy, "Recurrence requires a start time");
+    }
+    auto start = time_utils::parse_rfc3339(json["start"].get<std::string>());
+    if (!start) {
+        return Result<Recurrence>(ErrorCode::InvalidPolicy, "Recurrence start: " + start.error_message());
+    }
+
+    if (!json.contains("unit") || !json["unit"].is_string()) {
+        return Result<Recurrence>(ErrorCode::InvalidPolicy, "Recurrence requires a unit");
+    }
+    auto unit = recurrence_unit_from_string(json["unit"].get<std::string>());
+    if (!unit) {
+        return Result<Recurrence>(ErrorCode::InvalidPolicy, unit.error_message());
+    }
+
+    uint32_t every = 1;
+    if (json.contains("every")) {
+        if (!json["every"].is_number_unsigned()) {
+            return Result<Recurrence>(ErrorCode::InvalidPolicy, "Recurrence 'every' must be a positive integer");
+        }
+        every = json["every"].get<uint32_t>();
+    }
+
+    if (!json.contains("duration_seconds") || !json["duration_seconds"].is_number_integer()) {
+        return Result<Recurrence>(ErrorCode::InvalidPolicy, "Recurrence requires duration_seconds");
+    }
+    std::chrono::seconds duration(json["duration_seconds"].get<int64_t>());
+
+    std::optional<TimePoint> until;
+    if (json.contains("until") && !json["until"].is_null()) {
+        if (!json["until"].is_string()) {
+            return Result<Recurrence>(ErrorCode::InvalidPolicy, "Recurrence 'until' must be an RFC3339 string");
+        }
+        auto until_result = time_utils::parse_rfc3339(json["until"].get<std::string>());
+        if (!until_result) {
+            return Result<Recurrence>(ErrorCode::InvalidPolicy, "Recurrence until: " + until_result.error_message());
+        }
+        until = until_result.value();
+    }
+
+    Recurrence recurrence(start.value(), every, unit.value(), duration, until);
+    auto validation = recurrence.validate();
+    if (!validation) {
+        return Result<Recurrence>(validation.error(), validation.error_message());
+    }
+    return Result<Recurrence>(std::move(recurrence));
+}
+
+std::string to_string(RecurrenceUnit unit) {
+    switch (unit) {
+        case RecurrenceUnit::Minutes:
+            return "minutes";
+        case RecurrenceUnit::Hours:
+            return "hours";
+        case RecurrenceUnit::Days:
+            return "days";
+        case RecurrenceUnit::Weeks:
+            return "weeks";
+        case RecurrenceUnit::Months:
+            return "months";
+        case RecurrenceUnit::Years:
+            return "years";
+        default:
+            return "unknown";
+    }
+}
+
+Result<RecurrenceUnit> recurrence_unit_from_string(const std::string& str) {
+    if (str == "minutes") {
+        return Result<RecurrenceUnit>(RecurrenceUnit::Minutes);
+    }
+    if (str == "hours") {
+        return Result<RecurrenceUnit>(RecurrenceUnit::Hours);
+    }
+    if (str == "days") {
+        return Result<RecurrenceUnit>(RecurrenceUnit::Days);
+    }
+    if (str == "weeks") {
+        return Result<RecurrenceUnit>(RecurrenceUnit::Weeks);
+    }
+    if (str == "months") {
+        return Result<RecurrenceUnit>(RecurrenceUnit::Months);
+    }
+    if (str == "years") {
+        return Result<RecurrenceUnit>(RecurrenceUnit::Years);
+    }
+    return Result<RecurrenceUnit>(ErrorCode::InvalidArgument, "Unknown recurrence unit: " + str);
+}
+
+} // namespace tcfs
@@ -3,6 +3,7 @@
 
 #if TCFS_HAS_OPENSSL
 #include <openssl/evp.h>
+#include <openssl/hmac.h>
 #include <openssl/rand.h>
 #include <openssl/kdf.h>
 #include <openssl/err.h>
@@ -91,6 +92,142 @@ CryptoKey OpenSSLCryptoProvider::deriveKey(const std::string& password, const Cr
     return derived_key;
 }
 
+CryptoKey OpenSSLCryptoProvider::hkdfSha256(const CryptoKey& ikm, const std::vector<uint8_t>& salt,
+                                            const std::string& info, size_t length) {
+    CryptoKey derived_key(length);
+    EVP_PKEY_CTX* ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_HKDF, nullptr);
+    if (!ctx) {
+        pimpl_->handleOpenSSLError("Failed to create HKDF context");
+    }
+    size_t out_len = length;
+    // OpenSSL rejects a zero-length salt; leaving it unset gives RFC 5869's default of zeroes
+    bool ok = EVP_PKEY_derive_init(ctx) == 1 &&
+              EVP_PKEY_CTX_set_hkdf_md(ctx, EVP_sha256()) == 1 &&
+              (salt.empty() || EVP_PKEY_CTX_set1_hkdf_salt(ctx, salt.data(), static_cast<int>(salt.size())) == 1) &&
+              EVP_PKEY_CTX_set1_hkdf_key(ctx, ikm.data.data(), static_cast<int>(ikm.size())) == 1 &&
+              EVP_PKEY_CTX_add1_hkdf_info(ctx, reinterpret_cast<const unsigned char*>(info.data()),
+                                          static_cast<int>(info.size())) == 1 &&
+              EVP_PKEY_derive(ctx, derived_key.data.data(), &out_len) == 1 && out_len == length;
+    EVP_PKEY_CTX_free(ctx);
+    if (!ok) {
+        pimpl_->handleOpenSSLError("HKDF failed");
+    }
+    return derived_key;
+}
+
+CryptoKey OpenSSLCryptoProvider::generateX25519PrivateKey() {
+    // X25519 clamps the scalar itself, so any 32 random bytes are a valid private key
+    CryptoKey key(X25519_KEY_SIZE);
+    if (RAND_bytes(key.data.data(), static_cast<int>(key.size())) != 1) {
+        pimpl_->handleOpenSSLError("Key generation failed");
+    }
+    return key;
+}
+
+std::vector<uint8_t> OpenSSLCryptoProvider::x25519PublicKey(const CryptoKey& private_key) {
+    EVP_PKEY* pkey = EVP_PKEY_new_raw_private_key(EVP_PKEY_X25519, nullptr, private_key.data.data(), private_key.size());
+    if (!pkey) {
+        pimpl_->handleOpenSSLError("Invalid X25519 private key");
+    }
+    std::vector<uint8_t> public_key(X25519_KEY_SIZE);
+    size_t length = public_key.size();
+    bool ok = EVP_PKEY_get_raw_public_key(pkey, public_key.data(), &length) == 1 && length == X25519_KEY_SIZE;
+    EVP_PKEY_free(pkey);
+    if (!ok) {
+        pimpl_->handleOpenSSLError("Failed to compute X25519 public key");
+    }
+    return public_key;
+}
+
+CryptoKey OpenSSLCryptoProvider::x25519(const CryptoKey& private_key, const std::vector<uint8_t>& peer_public) {
+    EVP_PKEY* own = EVP_PKEY_new_raw_private_key(EVP_PKEY_X25519, nullptr, private_key.data.data(), private_key.size());
+    EVP_PKEY* peer = EVP_PKEY_new_raw_public_key(EVP_PKEY_X25519, nullptr, peer_public.data(), peer_public.size());
+    EVP_PKEY_CTX* ctx = own ? EVP_PKEY_CTX_new(own, nullptr) : nullptr;
+    CryptoKey shared(X25519_KEY_SIZE);
+    size_t length = shared.size();
+    // Derivation fails for low-order peer keys, whose shared secret would be all zeroes
+    bool ok = own && peer && ctx && EVP_PKEY_derive_init(ctx) == 1 && EVP_PKEY_derive_set_peer(ctx, peer) == 1 &&
+              EVP_PKEY_derive(ctx, shared.data.data(), &length) == 1 && length == X25519_KEY_SIZE;
+    EVP_PKEY_CTX_free(ctx);
+    EVP_PKEY_free(peer);
+    EVP_PKEY_free(own);
+    if (!ok) {
+        pimpl_->handleOpenSSLError("X25519 key agreement failed");
+    }
+    return shared;
+}
+
+CryptoKey OpenSSLCryptoProvider::generateEd25519PrivateKey() {
+    // An Ed25519 private key is a 32-byte seed
+    CryptoKey key(ED25519_KEY_SIZE);
+    if (RAND_bytes(key.data.data(), static_cast<int>(key.size())) != 1) {
+        pimpl_->handleOpenSSLError("Key generation failed");
+    }
+    return key;
+}
+
+std::vector<uint8_t> OpenSSLCryptoProvider::ed25519PublicKey(const CryptoKey& private_key) {
+    EVP_PKEY* pkey = EVP_PKEY_new_raw_private_key(EVP_PKEY_ED25519, nullptr, private_key.data.data(), private_key.size());
+    if (!pkey) {
+        pimpl_->handleOpenSSLError("Invalid Ed25519 private key");
+    }
+    std::vector<uint8_t> public_key(ED25519_KEY_SIZE);
+    size_t length = public_key.size();
+    bool ok = EVP_PKEY_get_raw_public_key(pkey, public_key.data(), &length) == 1 && length == ED25519_KEY_SIZE;
+    EVP_PKEY_free(pkey);
+    if (!ok) {
+        pimpl_->handleOpenSSLError("Failed to compute Ed25519 public key");
+    }
+    return public_key;
+}
+
+std::vector<uint8_t> OpenSSLCryptoProvider::ed25519Sign(const CryptoKey& private_key,
+                                                        const std::vector<uint8_t>& message) {
+    EVP_PKEY* pkey = EVP_PKEY_new_raw_private_key(EVP_PKEY_ED25519, nullptr, private_key.data.data(), private_key.size());
+    EVP_MD_CTX* ctx = EVP_MD_CTX_new();
+    std::vector<uint8_t> signature(ED25519_SIGNATURE_SIZE);
+    size_t length = signature.size();
+    // Ed25519 hashes internally, so it is used one-shot without a digest
+    bool ok = pkey && ctx && EVP_DigestSignInit(ctx, nullptr, nullptr, nullptr, pkey) == 1 &&
+              EVP_DigestSign(ctx, signature.data(), &length, message.data(), message.size()) == 1 &&
+              length == ED25519_SIGNATURE_SIZE;
+    EVP_MD_CTX_free(ctx);
+    EVP_PKEY_free(pkey);
+    if (!ok) {
+        pimpl_->handleOpenSSLError("Ed25519 signing failed");
+    }
+    return signature;
+}
+
+bool OpenSSLCryptoProvider::ed25519Verify(const std::vector<uint8_t>& public_key, const std::vector<uint8_t>& message,
+                                          const std::vector<uint8_t>& signature) {
+    return ed25519VerifyBatch(public_key, {message}, {signature}).front();
+}
+
+std::vector<bool> OpenSSLCryptoProvider::ed25519VerifyBatch(const std::vector<uint8_t>& public_key,
+                                                            const std::vector<std::vector<uint8_t>>& messages,
+                                                            const std::vector<std::vector<uint8_t>>& signatures) {
+    std::vector<bool> valid(messages.size(), false);
+    if (signatures.size() != messages.size()) {
+        return valid;
+    }
+    // Decoding the public key is a point decompression; do it once, not per signature
+    EVP_PKEY* pkey = EVP_PKEY_new_raw_public_key(EVP_PKEY_ED25519, nullptr, public_key.data(), public_key.size());
+    EVP_MD_CTX* ctx = pkey ? EVP_MD_CTX_new() : nullptr;
+    for (size_t i = 0; ctx && i < messages.size(); ++i) {
+        valid[i] = signatures[i].size() == ED25519_SIGNATURE_SIZE &&
+                   EVP_DigestVerifyInit(ctx, nullptr, nullptr, nullptr, pkey) == 1 &&
+                   EVP_DigestVerify(ctx, signatures[i].data(), signatures[i].size(), messages[i].data(),
+                                    messages[i].size()) == 1;
+        EVP_MD_CTX_reset(ctx);
+    }
+    EVP_MD_CTX_free(ctx);
+    EVP_PKEY_free(pkey);
+    // A failed verification leaves an error on the queue that later calls must not pick up
+    ERR_clear_error();
+    return valid;
+}
+
 EncryptedData OpenSSLCryptoProvider::encrypt(const std::vector<uint8_t>& plaintext, const CryptoKey& key, const CryptoIV& iv) {
     EncryptedData result;
     result.iv = iv; // Set the IV in the result
@@ -209,6 +346,17 @@ std::vector<uint8_t> OpenSSLCryptoProvider::sha256(const std::vector<uint8_t>& d
     return hash;
 }
 
+std::vector<uint8_t> OpenSSLCryptoProvider::hmacSha256(const CryptoKey& key, const std::vector<uint8_t>& data) {
+    std::vector<uint8_t> mac(SHA256_DIGEST_SIZE);
+    unsigned int length = 0;
+    if (!HMAC(EVP_sha256(), key.data.data(), static_cast<int>(key.size()), data.data(), data.size(), mac.data(),
+              &length) ||
+        length != SHA256_DIGEST_SIZE) {
+        pimpl_->handleOpenSSLError("HMAC failed");
+    }
+    return mac;
+}
+
 std::string OpenSSLCryptoProvider::toHex(const std::vector<uint8_t>& data) {
     std::stringstream ss;
     ss << std::hex << std::uppercase << std::setfill('0');
@@ -274,6 +422,16 @@ class MockCryptoProvider : public CryptoProvider {
 private:
     std::mt19937 rng{std::random_device{}()};
 
+    std::vector<uint8_t> mockSignature(const std::vector<uint8_t>& public_key, const std::vector<uint8_t>& message) {
+        // Simple mock - anyone holding the public key can forge it
+        auto input = public_key;
+        input.insert(input.end(), message.begin(), message.end());
+        auto signature = sha256(input);
+        auto second = sha256(signature);
+        signature.insert(signature.end(), second.begin(), second.end());
+        return signature;
+    }
+
 public:
     MockCryptoProvider() = default;
     CryptoKey generateKey() override {
@@ -314,6 +472,64 @@ public:
         return key;
     }
 
+    CryptoKey hkdfSha256(const CryptoKey& ikm, const std::vector<uint8_t>& salt, const std::string& info,
+                         size_t length) override {
+        // Simple mock - hash the inputs, repeated to length
+        std::vector<uint8_t> input = ikm.data;
+        input.insert(input.end(), salt.begin(), salt.end());
+        input.insert(input.end(), info.begin(), info.end());
+        auto hash = sha256(input);
+        CryptoKey key(length);
+        for (size_t i = 0; i < length; ++i) {
+            key.data[i] = hash[i % hash.size()];
+        }
+        return key;
+    }
+
+    CryptoKey generateX25519PrivateKey() override {
+        return generateKey();
+    }
+
+    std::vector<uint8_t> x25519PublicKey(const CryptoKey& private_key) override {
+        return sha256(private_key.data);
+    }
+
+    CryptoKey x25519(const CryptoKey& private_key, const std::vector<uint8_t>& peer_public) override {
+        // Simple mock - symmetric in the two public keys, so both sides agree
+        auto own_public = x25519PublicKey(private_key);
+        auto input = std::min(own_public, peer_public);
+        auto other = std::max(own_public, peer_public);
+        input.insert(input.end(), other.begin(), other.end());
+        return CryptoKey(sha256(input));
+    }
+
+    CryptoKey generateEd25519PrivateKey() override {
+        return generateKey();
+    }
+
+    std::vector<uint8_t> ed25519PublicKey(const CryptoKey& private_key) override {
+        return sha256(sha256(private_key.data));
+    }
+
+    std::vector<uint8_t> ed25519Sign(const CryptoKey& private_key, const std::vector<uint8_t>& message) override {
+        return mockSignature(ed25519PublicKey(private_key), message);
+    }
+
+    bool ed25519Verify(const std::vector<uint8_t>& public_key, const std::vector<uint8_t>& message,
+                       const std::vector<uint8_t>& signature) override {
+        return signature == mockSignature(public_key, message);
+    }
+
+    std::vector<bool> ed25519VerifyBatch(const std::vector<uint8_t>& public_key,
+                                         const std::vector<std::vector<uint8_t>>& messages,
+                                         const std::vector<std::vector<uint8_t>>& signatures) override {
+        std::vector<bool> valid(messages.size(), false);
+        for (size_t i = 0; i < messages.size() && i < signatures.size(); ++i) {
+            valid[i] = ed25519Verify(public_key, messages[i], signatures[i]);
+        }
+        return valid;
+    }
+
     EncryptedData encrypt(const std::vector<uint8_t>& plaintext, const CryptoKey& key, const CryptoIV& iv) override {
         // Simple XOR encryption (NOT SECURE - for demo only)
         EncryptedData result;
@@ -370,6 +586,13 @@ public:
         return hash;
     }
 
+    std::vector<uint8_t> hmacSha256(const CryptoKey& key, const std::vector<uint8_t>& data) override {
+        // Simple mock - keyed hash, not a real HMAC
+        auto input = key.data;
+        input.insert(input.end(), data.begin(), data.end());
+        return sha256(input);
+    }
+
     std::string toHex(const std::vector<uint8_t>& data) override {
         std::stringstream ss;
         ss << std::hex << std::setfill('0');
@@ -0,0 +1,584 @@
+#include "tcfs/Daemon.hpp"
+#include "tcfs/SecureDelete.hpp"
+#include <algorithm>
+#include <fstream>
+#include <future>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace fs = std::filesystem;
+
+namespace tcfs {
+
+namespace {
+
+template <typename Options>
+Options with_log(Options options, const std::function<void(const std::string&)>& log) {
+    if (!options.log) {
+        options.log = log;
+    }
+    return options;
+}
+
+} // namespace
+
+Daemon::Daemon(Store& store, DaemonOptions options)
+    : store_(store),
+      options_(std::move(options)),
+      sweeper_(store, with_log(options_.sweeper, options_.log)),
+      queue_(options_.release),
+      prefetcher_(store, with_log(options_.prefetch, options_.log)),
+      inbox_(options_.inbox.dir),
+      events_(options_.events.max_buffered, options_.events.slow_consumers),
+      event_server_(events_, with_log(options_.events, options_.log)) {
+    store_.set_tier_options(with_log(options_.tiers, options_.log));
+    sweeper_.set_destroy_listener([this](const CatalogEntry& entry) {
+        publish("destroyed", entry, time_utils::now());
+    });
+}
+
+Result<void> Daemon::start() {
+    auto now = time_utils::now();
+    scheduler_.clear();
+    if (!restore_snapshot(now)) {
+        auto catalog = store_.catalog();
+        if (!catalog) {
+            return Result<void>(catalog.error(), catalog.error_message());
+        }
+        for (const auto* entry : catalog.value()->entries()) {
+            schedule(*entry, now);
+        }
+    }
+    auto swept = sweeper_.start();
+    if (!swept) {
+        return swept;
+    }
+    if (options_.tiers.demote_after.count() > 0) {
+        auto tiers = store_.tiers();
+        if (!tiers) {
+            return Result<void>(tiers.error(), tiers.error_message());
+        }
+        auto recovered = tiers.value()->recover();
+        if (!recovered) {
+            return recovered;
+        }
+    }
+    if (!options_.inbox.dir.empty()) {
+        auto watching = inbox_.start();
+        if (!watching) {
+            return watching;
+        }
+        log("Watching inbox " + options_.inbox.dir.string() +
+            (inbox_.uses_notifications() ? " (inotify)" : " (directory scans)"));
+    }
+    if (!options_.events.socket.empty()) {
+        auto serving = event_server_.start();
+        if (!serving) {
+            return serving;
+        }
+        log("Serving events on " + options_.events.socket.string());
+    }
+    log("Scheduled " + std::to_string(scheduler_.size()) + " capsules, " +
+        std::to_string(sweeper_.size()) + " with an expiry");
+    return Result<void>();
+}
+
+bool Daemon::restore_snapshot(const TimePoint& now) {
+    restored_from_snapshot_ = false;
+    std::error_code ec;
+    if (options_.snapshot.path.empty() || !fs::exists(options_.snapshot.path, ec)) {
+        return false;
+    }
+
+    const auto started = std::chrono::steady_clock::now();
+    auto snapshot = CatalogSnapshot::load(options_.snapshot.path, store_.catalog_journal_path());
+    if (!snapshot) {
+        log(snapshot.error_message() + "; rebuilding from the journal");
+        return false;
+    }
+    const auto snapshot_sequence = snapshot.value().catalog.sequence;
+    auto changes = store_.restore_catalog(std::move(snapshot.value().catalog));
+    if (!changes) {
+        log("Replaying the journal after the snapshot failed: " + changes.error_message() + "; rebuilding");
+        return false;
+    }
+    auto catalog = store_.catalog();
+    if (!catalog) {
+        return false;
+    }
+
+    scheduler_.load(std::move(snapshot.value().schedule));
+    for (const auto& id : changes.value().touched) {
+        if (const auto* entry = catalog.value()->find(id)) {
+            schedule(*entry, now);
+        } else {
+            scheduler_.remove(id);
+        }
+    }
+    // Capsules without a time in the snapshot, e.g. queued for release when it was taken
+    for (const auto* entry : catalog.value()->entries()) {
+        if (entry->state == CapsuleState::Locked && !scheduler_.contains(entry->id)) {
+            schedule(*entry, now);
+        }
+    }
+
+    snapshot_sequence_ = snapshot_sequence;
+    restored_from_snapshot_ = true;
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started);
+    log("Restored " + std::to_string(catalog.value()->size()) + " capsules from snapshot in " +
+        std::to_string(elapsed.count()) + "ms, replayed " +
+        std::to_string(catalog.value()->last_sequence() - snapshot_sequence) + " journal record(s)");
+    return true;
+}
+
+Result<void> Daemon::save_snapshot() {
+    if (options_.snapshot.path.empty()) {
+        return Result<void>();
+    }
+    auto catalog = store_.catalog();
+    if (!catalog) {
+        return Result<void>(catalog.error(), catalog.error_message());
+    }
+    auto image = catalog.value()->image();
+    auto sequence = image.sequence;
+    auto saved = CatalogSnapshot::save(options_.snapshot.path, image, scheduler_, store_.catalog_journal_path());
+    if (saved) {
+        snapshot_sequence_ = sequence;
+    }
+    return saved;
+}
+
+Result<void> Daemon::refresh(const TimePoint& now) {
+    auto catalog = store_.catalog();
+    if (!catalog) {
+        return Result<void>(catalog.error(), catalog.error_message());
+    }
+    auto changes = catalog.value()->refresh();
+    if (!changes) {
+        return Result<void>(changes.error(), changes.error_message());
+    }
+    // Entries rewritten by an update or a group extend are announced as updated, not locked again
+    std::unordered_set<std::string> added(changes.value().added.begin(), changes.value().added.end());
+    for (const auto& id : changes.value().touched) {
+        const auto* entry = catalog.value()->find(id);
+        if (entry) {
+            schedule(*entry, now);
+            sweeper_.track(*entry);
+            publish(entry->state == CapsuleState::Released ? "released"
+                    : added.count(id) != 0                 ? "locked"
+                                                           : "updated",
+                    *entry, now);
+        } else {
+            scheduler_.remove(id);
+            sweeper_.forget(id);
+            prefetcher_.forget(id);
+            CatalogEntry removed; // Only the id survives a removal by another process
+            removed.id = id;
+            publish("removed", removed, now);
+        }
+    }
+    // Dependents unblocked by a release or removal in another process; tick() only sees its own releases
+    for (const auto& id : changes.value().ready) {
+        if (const auto* entry = catalog.value()->find(id)) {
+            schedule(*entry, now);
+        }
+    }
+    return Result<void>();
+}
+
+size_t Daemon::tick(const TimePoint& now) {
+    auto catalog = store_.catalog();
+    if (!catalog) {
+        log("Catalog unavailable: " + catalog.error_message());
+        return 0;
+    }
+    ingest(now);
+
+    // Destroy before releasing so a capsule that expired while the daemon was down is never released
+    auto swept = sweeper_.sweep_batch(now);
+    for (const auto& id : swept.destroyed) {
+        scheduler_.remove(id);
+        prefetcher_.forget(id);
+    }
+    for (const auto& id : swept.ready) {
+        if (const auto* entry = catalog.value()->find(id)) {
+            schedule(*entry, now);
+        }
+    }
+
+    for (const auto& due : scheduler_.pop_due(now)) {
+        admit(due.capsule_id, due.due, now);
+    }
+
+    // Drain in batches of at most max_concurrency, highest priority first, within the I/O budget
+    const auto started = std::chrono::steady_clock::now();
+    size_t released = 0;
+    for (auto batch = queue_.take_batch(now); !batch.empty(); batch = queue_.take_batch(now)) {
+        std::vector<Result<void>> written;
+        if (options_.release_dir.empty() || batch.size() == 1) {
+            for (const auto& request : batch) {
+                written.push_back(write_release_files(request.capsule_id, now));
+            }
+        } else {
+            std::vector<std::future<Result<void>>> pending;
+            for (const auto& request : batch) {
+                pending.push_back(std::async(std::launch::async, [this, &request, now] {
+                    return write_release_files(request.capsule_id, now);
+                }));
+            }
+            for (auto& future : pending) {
+                written.push_back(future.get());
+            }
+        }
+
+        // Catalog updates stay on this thread
+        for (size_t i = 0; i < batch.size(); ++i) {
+            const auto& request = batch[i];
+            auto ready = written[i] ? complete_release(request.capsule_id, now)
+                                    : Result<std::vector<std::string>>(written[i].error(), written[i].error_message());
+            if (!ready) {
+                log("Failed to release " + request.capsule_id + ": " + ready.error_message());
+                scheduler_.schedule_at(request.capsule_id, now + options_.recheck_interval);
+                prefetcher_.rescheduled(request.capsule_id, scheduler_.due_time(request.capsule_id), now);
+                continue;
+            }
+            ++released;
+            queue_.record_completion(request, now + std::chrono::duration_cast<TimePoint::duration>(
+                                                        std::chrono::steady_clock::now() - started));
+
+            // Dependents whose last dependency was just released go out in this same pass
+            for (const auto& dependent : ready.value()) {
+                admit(dependent, now, now);
+            }
+        }
+    }
+
+    prefetcher_.prefetch(scheduler_, now);
+    migrate_tiers(now);
+    return released;
+}
+
+size_t Daemon::ingest(const TimePoint& now) {
+    if (!inbox_.is_running()) {
+        return 0;
+    }
+    inbox_.wait(std::chrono::milliseconds(0)); // Pick up events the kernel has queued
+
+    Policy policy;
+    policy.set_owner(store_.default_owner());
+    policy.set_label(options_.inbox.label);
+    policy.set_unlock_time(now + options_.inbox.lock_for);
+
+    size_t locked = 0;
+    for (auto batch = inbox_.take(options_.inbox.batch_size); !batch.empty();
+         batch = inbox_.take(options_.inbox.batch_size)) {
+        auto catalog = store_.catalog();
+        if (!catalog) {
+            log("Catalog unavailable: " + catalog.error_message());
+            return locked;
+        }
+
+        // Never overwrite an existing capsule from the inbox; the file stays put
+        std::vector<std::filesystem::path> inputs;
+        std::unordered_map<std::string, std::filesystem::path> input_by_id;
+        for (auto& path : batch) {
+            auto id = Store::capsule_id_for(path);
+            if (catalog.value()->contains(id)) {
+                log("Inbox file " + path.filename().string() + " not locked: a capsule with that name exists");
+                continue;
+            }
+            input_by_id.emplace(id, path);
+            inputs.push_back(std::move(path));
+        }
+
+        auto result = store_.lock_batch(inputs, policy, options_.inbox.workers);
+        if (!result) {
+            log("Inbox batch of " + std::to_string(inputs.size()) + " failed: " + result.error_message());
+            continue;
+        }
+        for (const auto& [input, reason] : result.value().failed) {
+            log("Inbox file " + input.filename().string() + " not locked: " + reason);
+        }
+        for (const auto& id : result.value().locked) {
+            auto deleted = secure_delete(input_by_id[id]);
+            if (!deleted) {
+                log("Failed to delete ingested file " + input_by_id[id].string() + ": " + deleted.error_message());
+            }
+            if (const auto* entry = catalog.value()->find(id)) {
+                schedule(*entry, now);
+                sweeper_.track(*entry);
+                publish("locked", *entry, now);
+            }
+        }
+        locked += result.value().locked.size();
+    }
+    if (locked != 0) {
+        log("Locked " + std::to_string(locked) + " file(s) from the inbox");
+    }
+    return locked;
+}
+
+void Daemon::admit(const std::string& id, const TimePoint& due, const TimePoint& now) {
+    auto catalog = store_.catalog();
+    if (!catalog) {
+        return;
+    }
+    const auto* entry = catalog.value()->find(id);
+    if (!entry || entry->state == CapsuleState::Released || !catalog.value()->dependencies_ready(id)) {
+        return; // Blocked capsules are rescheduled when their last dependency is released
+    }
+
+    if (!entry->has_schedule_rules && now < TimePoint(std::chrono::seconds(entry->unlock_at - entry->grace_seconds))) {
+        schedule(*entry, now);
+        return;
+    }
+
+    // The metadata decides: an extend interrupted before its catalog commit leaves the catalog's time too early
+    auto policy = store_.read_policy(id);
+    if (!policy) {
+        log("Skipping " + id + ": " + policy.error_message());
+        prefetcher_.forget(id);
+        return;
+    }
+    if (!policy.value().is_unlock_allowed(now)) {
+        auto next = policy.value().next_unlock_time(now);
+        if (next && *next > now) {
+            scheduler_.schedule_at(id, *next);
+        } else if (next) {
+            // Time-based rules hold but the condition does not: check again later
+            scheduler_.schedule_at(id, now + options_.recheck_interval);
+        }
+        prefetcher_.rescheduled(id, scheduler_.due_time(id), now);
+        return;
+    }
+
+    queue_.push(*entry, due);
+}
+
+void Daemon::run() {
+    stop_requested_.store(false);
+    while (!stop_requested_.load()) {
+        auto now = time_utils::now();
+        auto refreshed = refresh(now);
+        if (!refreshed) {
+            log("Catalog refresh failed: " + refreshed.error_message());
+        }
+        if (tick(now) != 0 && queue_.empty()) {
+            auto lag = queue_.lag();
+            log("Release lag over the last " + std::to_string(std::min(lag.count, ReleaseQueue::LAG_WINDOW)) +
+                " releases: p50=" + std::to_string(lag.p50.count()) + "ms p99=" + std::to_string(lag.p99.count()) +
+                "ms max=" + std::to_string(lag.max.count()) + "ms");
+        }
+
+        auto wake = now + options_.poll_interval;
+        if (auto next = scheduler_.next_due()) {
+            wake = std::min(wake, *next);
+        }
+        if (auto next = queue_.next_eligible(time_utils::now())) {
+            wake = std::min(wake, *next);
+        }
+        if (auto next = prefetcher_.next_wake(scheduler_, now)) {
+            wake = std::min(wake, *next);
+        }
+        if (sweeper_.has_expired(now)) {
+            wake = std::min(wake, now + std::chrono::duration_cast<TimePoint::duration>(options_.sweeper.batch_pause));
+        } else if (auto next = sweeper_.next_expiry()) {
+            wake = std::min(wake, *next);
+        }
+        // Wake at least once a second so stop() from a signal handler is noticed promptly
+        wake = std::min(wake, time_utils::now() + std::chrono::seconds(1));
+
+        // Only rewrite the snapshot when the catalog moved on, and at most once per interval
+        auto catalog = store_.catalog();
+        if (!options_.snapshot.path.empty() && now >= next_snapshot_ && catalog &&
+            catalog.value()->last_sequence() != snapshot_sequence_) {
+            next_snapshot_ = now + options_.snapshot.interval;
+            auto saved = save_snapshot();
+            if (!saved) {
+                log("Snapshot failed: " + saved.error_message());
+            }
+        }
+
+        wait_until(wake);
+    }
+
+    auto saved = save_snapshot();
+    if (!saved) {
+        log("Snapshot failed: " + saved.error_message());
+    }
+}
+
+void Daemon::wait_until(const TimePoint& wake) {
+    if (!inbox_.is_running()) {
+        std::unique_lock<std::mutex> lock(wait_mutex_);
+        wait_cv_.wait_until(lock, wake, [this] { return stop_requested_.load(); });
+        return;
+    }
+    if (inbox_.pending() != 0) {
+        return; // A burst larger than one batch: keep draining
+    }
+
+    // Sleep on the inotify descriptor instead of the condition variable
+    auto timeout = std::chrono::duration_cast<std::chrono::milliseconds>(wake - time_utils::now());
+    if (!inbox_.wait(std::max(timeout, std::chrono::milliseconds(0)))) {
+        return;
+    }
+    // Coalesce the rest of the burst into the same batch
+    auto deadline = std::chrono::steady_clock::now() + options_.inbox.coalesce;
+    for (auto left = options_.inbox.coalesce; left.count() > 0 && inbox_.pending() < options_.inbox.batch_size;
+         left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now())) {
+        inbox_.wait(left);
+    }
+}
+
+void Daemon::schedule(const CatalogEntry& entry, const TimePoint& now) {
+    auto catalog = store_.catalog();
+    if (entry.state == CapsuleState::Released || !catalog || !catalog.value()->dependencies_ready(entry.id)) {
+        scheduler_.remove(entry.id);
+    } else if (!entry.has_schedule_rules) {
+        auto due = TimePoint(std::chrono::seconds(entry.unlock_at - entry.grace_seconds));
+        scheduler_.schedule_at(entry.id, std::max(due, now));
+    } else if (auto policy = store_.read_policy(entry.id)) {
+        scheduler_.schedule(entry.id, policy.value(), now);
+    } else {
+        log("Cannot schedule " + entry.id + ": " + policy.error_message());
+        scheduler_.remove(entry.id);
+    }
+    // An extended or blocked capsule gives its prefetched pages back
+    prefetcher_.rescheduled(entry.id, scheduler_.due_time(entry.id), now);
+}
+
+void Daemon::migrate_tiers(const TimePoint& now) {
+    if (options_.tiers.demote_after.count() <= 0 || now < next_tier_pass_) {
+        return;
+    }
+    auto tiers = store_.tiers();
+    if (!tiers) {
+        log("Tier manager unavailable: " + tiers.error_message());
+        return;
+    }
+    auto pass = tiers.value()->migrate(now);
+    // A pass scans the whole catalog; come back soon only while there is work left
+    bool busy = !pass.promoted.empty() || !pass.demoted.empty() || pass.packs_compacted != 0;
+    next_tier_pass_ = now + (busy ? std::chrono::seconds(1) : options_.poll_interval);
+    if (!pass.promoted.empty()) {
+        log("Promoted " + std::to_string(pass.promoted.size()) + " capsule(s) from the cold tier");
+    }
+    if (pass.packs_compacted != 0) {
+        log("Compacted " + std::to_string(pass.packs_compacted) + " cold pack(s)");
+    }
+}
+
+Result<void> Daemon::write_release_files(const std::string& id, const TimePoint& now) {
+    if (options_.release_dir.empty()) {
+        return Result<void>();
+    }
+
+    auto catalog = store_.catalog();
+    const auto* entry = catalog ? catalog.value()->find(id) : nullptr;
+    auto filename = fs::path(entry && !entry->original_filename.empty() ? entry->original_filename : id).filename();
+
+    std::error_code ec;
+    fs::create_directories(options_.release_dir, ec);
+
+    // Staged capsules whose later stages are still closed release only their open parts, each once per run.
+    // released_stages_ is not persisted, so a restarted daemon writes the open parts again: at least once.
+    std::vector<std::pair<fs::path, size_t>> parts;
+    auto layout = store_.read_layout(id);
+    auto earlier = released_stages_.find(id);
+    if (layout && layout.value().stages.size() > 1) {
+        auto open = layout.value().open_stages(now);
+        if (open.size() < layout.value().stages.size() || earlier != released_stages_.end()) {
+            for (auto stage : open) {
+                if (earlier != released_stages_.end() &&
+                    std::find(earlier->second.begin(), earlier->second.end(), stage) != earlier->second.end()) {
+                    continue;
+                }
+                auto part_name = filename.string() + "." + layout.value().stages[stage].name;
+                parts.emplace_back(options_.release_dir / part_name, stage);
+            }
+            if (parts.empty()) {
+                return Result<void>();
+            }
+        }
+    }
+
+    if (parts.empty()) {
+        return write_release(options_.release_dir / filename, store_.decrypt(id));
+    }
+    for (const auto& [path, stage] : parts) {
+        auto written = write_release(path, store_.read_stage(id, stage));
+        if (!written) {
+            return written;
+        }
+    }
+    return Result<void>();
+}
+
+Result<std::vector<std::string>> Daemon::complete_release(const std::string& id, const TimePoint& now) {
+    // Until its last stage opens, a staged capsule stays locked and its dependents blocked
+    auto layout = store_.read_layout(id);
+    if (layout && layout.value().stages.size() > 1) {
+        const auto& stages = layout.value().stages;
+        auto open = layout.value().open_stages(now);
+        if (open.size() < stages.size()) {
+            released_stages_[id] = open;
+            std::optional<TimePoint> next;
+            for (size_t stage = 0; stage < stages.size(); ++stage) {
+                if (std::find(open.begin(), open.end(), stage) != open.end()) {
+                    continue;
+                }
+                auto at = stages[stage].policy.next_unlock_time(now);
+                if (at && *at > now && (!next || *at < *next)) {
+                    next = at;
+                }
+            }
+            scheduler_.schedule_at(id, next.value_or(now + options_.recheck_interval));
+            prefetcher_.rescheduled(id, scheduler_.due_time(id), now);
+            log("Released " + std::to_string(open.size()) + " of " + std::to_string(stages.size()) + " stages of " + id);
+            return Result<std::vector<std::string>>(std::vector<std::string>{});
+        }
+    }
+
+    auto ready = store_.mark_released(id);
+    if (ready) {
+        released_stages_.erase(id);
+        prefetcher_.release(id);
+        log("Released " + id);
+        auto catalog = store_.catalog();
+        if (const auto* entry = catalog ? catalog.value()->find(id) : nullptr) {
+            publish("released", *entry, now);
+        }
+        if (on_release_) {
+            on_release_(id);
+        }
+    }
+    return ready;
+}
+
+void Daemon::publish(std::string type, const CatalogEntry& entry, const TimePoint& now) {
+    auto seconds = std::chrono::duration_cast<std::chrono::seconds>(now.time_since_epoch()).count();
+    events_.publish(CapsuleEvent::from_entry(std::move(type), entry, static_cast<int64_t>(seconds)));
+}
+
+Result<void> Daemon::write_release(const fs::path& path, const Result<std::vector<uint8_t>>& plaintext) {
+    if (!plaintext) {
+        return Result<void>(plaintext.error(), plaintext.error_message());
+    }
+    std::ofstream output(path, std::ios::binary);
+    output.write(reinterpret_cast<const char*>(plaintext.value().data()),
+                 static_cast<std::streamsize>(plaintext.value().size()));
+    output.close();
+    if (!output) {
+        return Result<void>(ErrorCode::FILE_ACCESS_ERROR, "Failed to write released file: " + path.string());
+    }
+    return Result<void>();
+}
+
+void Daemon::log(const std::string& message) const {
+    if (options_.log) {
+        options_.log(message);
+    }
+}
+
+} // namespace tcfs
@@ -0,0 +1,175 @@
+#include "tcfs/EventBus.hpp"
+#include <algorithm>
+#include <iterator>
+
+namespace tcfs {
+
+namespace {
+
+bool listed(const std::vector<std::string>& values, const std::string& value) {
+    return values.empty() || std::find(values.begin(), values.end(), value) != values.end();
+}
+
+} // namespace
+
+CapsuleEvent CapsuleEvent::from_entry(std::string type, const CatalogEntry& entry, int64_t time) {
+    CapsuleEvent event;
+    event.type = std::move(type);
+    event.capsule_id = entry.id;
+    event.label = entry.label;
+    event.owner = entry.owner;
+    event.unlock_at = entry.unlock_at;
+    event.time = time;
+    return event;
+}
+
+nlohmann::json CapsuleEvent::to_json() const {
+    nlohmann::json json;
+    json["seq"] = seq;
+    json["type"] = type;
+    json["id"] = capsule_id;
+    json["label"] = label;
+    json["owner"] = owner;
+    if (unlock_at != 0) {
+        json["unlock_at"] = unlock_at;
+    }
+    json["time"] = time;
+    return json;
+}
+
+bool EventFilter::matches(const CapsuleEvent& event) const {
+    return listed(types, event.type) && listed(labels, event.label) && listed(owners, event.owner) &&
+           listed(capsule_ids, event.capsule_id);
+}
+
+nlohmann::json EventFilter::to_json() const {
+    nlohmann::json json = nlohmann::json::object();
+    if (!types.empty()) {
+        json["types"] = types;
+    }
+    if (!labels.empty()) {
+        json["labels"] = labels;
+    }
+    if (!owners.empty()) {
+        json["owners"] = owners;
+    }
+    if (!capsule_ids.empty()) {
+        json["ids"] = capsule_ids;
+    }
+    return json;
+}
+
+Result<EventFilter> EventFilter::from_json(const nlohmann::json& json) {
+    if (!json.is_object()) {
+        return Result<EventFilter>(ErrorCode::InvalidArgument, "Event filter must be an object");
+    }
+    try {
+        EventFilter filter;
+        filter.types = json.value("types", std::vector<std::string>{});
+        filter.labels = json.value("labels", std::vector<std::string>{});
+        filter.owners = json.value("owners", std::vector<std::string>{});
+        filter.capsule_ids = json.value("ids", std::vector<std::string>{});
+        return Result<EventFilter>(std::move(filter));
+    } catch (const nlohmann::json::exception& e) {
+        return Result<EventFilter>(ErrorCode::InvalidArgument, std::string("Invalid event filter: ") + e.what());
+    }
+}
+
+EventBus::EventBus(size_t max_buffered, SlowConsumerPolicy policy)
+    : max_buffered_(std::max<size_t>(1, max_buffered)), policy_(policy) {
+}
+
+EventBus::SubscriberId EventBus::subscribe(EventFilter filter) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto id = next_id_++;
+    subscribers_[id].filter = std::move(filter);
+    return id;
+}
+
+void EventBus::set_filter(SubscriberId id, EventFilter filter) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = subscribers_.find(id);
+    if (it != subscribers_.end()) {
+        it->second.filter = std::move(filter);
+    }
+}
+
+void EventBus::unsubscribe(SubscriberId id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    subscribers_.erase(id);
+}
+
+uint64_t EventBus::publish(CapsuleEvent event) {
+    bool queued = false;
+    std::function<void()> notify;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        event.seq = ++seq_;
+        for (auto& [id, subscriber] : subscribers_) {
+            if (subscriber.disconnected || !subscriber.filter.matches(event)) {
+                continue;
+            }
+            if (subscriber.queue.size() >= max_buffered_) {
+                if (policy_ == SlowConsumerPolicy::Disconnect) {
+                    subscriber.disconnected = true;
+                    subscriber.queue.clear();
+                    queued = true; // The reader has to learn about the disconnect
+                    continue;
+                }
+                subscriber.queue.pop_front();
+                ++subscriber.skipped;
+            }
+            subscriber.queue.push_back(event);
+            queued = true;
+        }
+        if (queued) {
+            notify = notify_;
+        }
+    }
+    if (notify) {
+        notify();
+    }
+    return event.seq;
+}
+
+EventDelivery EventBus::take(SubscriberId id, size_t max) {
+    EventDelivery delivery;
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = subscribers_.find(id);
+    if (it == subscribers_.end()) {
+        delivery.disconnected = true;
+        return delivery;
+    }
+    auto& subscriber = it->second;
+    delivery.disconnected = subscriber.disconnected;
+    delivery.skipped = subscriber.skipped;
+    subscriber.skipped = 0;
+    auto count = std::min(max, subscriber.queue.size());
+    delivery.events.assign(std::make_move_iterator(subscriber.queue.begin()),
+                           std::make_move_iterator(subscriber.queue.begin() + static_cast<std::ptrdiff_t>(count)));
+    subscriber.queue.erase(subscriber.queue.begin(), subscriber.queue.begin() + static_cast<std::ptrdiff_t>(count));
+    return delivery;
+}
+
+void EventBus::set_notify(std::function<void()> notify) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    notify_ = std::move(notify);
+}
+
+size_t EventBus::subscribers() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return subscribers_.size();
+}
+
+size_t EventBus::pending(SubscriberId id) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = subscribers_.find(id);
+    return it == subscribers_.end() ? 0 : it->second.queue.size();
+}
+
+uint64_t EventBus::last_seq() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return seq_;
+}
+
+} // namespace tcfs
@@ -0,0 +1,443 @@
+#include "tcfs/EventServer.hpp"
+#include <cerrno>
+#include <cstring>
+#include <unordered_map>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace tcfs {
+
+#ifdef __linux__
+
+namespace {
+
+Result<sockaddr_un> socket_address(const fs::path& path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    const auto& native = path.native();
+    if (native.empty() || native.size() >= sizeof(address.sun_path)) {
+        return Result<sockaddr_un>(ErrorCode::InvalidArgument, "Unusable socket path: " + path.string());
+    }
+    std::memcpy(address.sun_path, native.c_str(), native.size() + 1);
+    return Result<sockaddr_un>(address);
+}
+
+std::string errno_message(const std::string& what) {
+    return what + ": " + std::strerror(errno);
+}
+
+/**
+ * @brief One client: unparsed request bytes, unsent reply bytes and its subscription
+ */
+struct Connection {
+    int fd = -1;
+    std::string in;
+    std::string out;
+    size_t sent = 0;
+    EventBus::SubscriberId subscriber = 0;
+    bool closing = false;
+    bool watching_writes = false;
+};
+
+std::string line(const nlohmann::json& json) {
+    return json.dump() + "\n";
+}
+
+} // namespace
+
+#endif
+
+EventServer::EventServer(EventBus& bus, EventOptions options) : bus_(bus), options_(std::move(options)) {
+}
+
+EventServer::~EventServer() {
+    stop();
+}
+
+Result<void> EventServer::start() {
+#ifdef __linux__
+    if (running_.load()) {
+        return Result<void>();
+    }
+    auto address = socket_address(options_.socket);
+    if (!address) {
+        return Result<void>(address.error(), address.error_message());
+    }
+
+    // A socket file nobody answers on is left over from a crash; a live one belongs to another daemon
+    std::error_code ec;
+    if (fs::exists(fs::symlink_status(options_.socket, ec))) {
+        int probe = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        bool live = probe >= 0 &&
+                    ::connect(probe, reinterpret_cast<const sockaddr*>(&address.value()), sizeof(sockaddr_un)) == 0;
+        if (probe >= 0) {
+            ::close(probe);
+        }
+        if (live) {
+            return Result<void>(ErrorCode::FILE_ACCESS_ERROR, "Event socket already in use: " + options_.socket.string());
+        }
+        fs::remove(options_.socket, ec);
+    }
+
+    listen_fd_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    epoll_fd_ = ::epoll_create1(EPOLL_CLOEXEC);
+    wake_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (listen_fd_ < 0 || epoll_fd_ < 0 || wake_fd_ < 0) {
+        auto message = errno_message("Failed to create event socket");
+        close_descriptors();
+        return Result<void>(ErrorCode::FILE_ACCESS_ERROR, message);
+    }
+    if (::bind(listen_fd_, reinterpret_cast<const sockaddr*>(&address.value()), sizeof(sockaddr_un)) != 0 ||
+        ::chmod(options_.socket.c_str(), 0600) != 0 || ::listen(listen_fd_, 64) != 0) {
+        auto message = errno_message("Failed to listen on " + options_.socket.string());
+        close_descriptors();
+        fs::remove(options_.socket, ec);
+        return Result<void>(ErrorCode::FILE_ACCESS_ERROR, message);
+    }
+
+    epoll_event listen_event{};
+    listen_event.events = EPOLLIN;
+    listen_event.data.fd = listen_fd_;
+    epoll_event wake_event{};
+    wake_event.events = EPOLLIN;
+    wake_event.data.fd = wake_fd_;
+    if (::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, listen_fd_, &listen_event) != 0 ||
+        ::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &wake_event) != 0) {
+        auto message = errno_message("Failed to watch event socket");
+        close_descriptors();
+        fs::remove(options_.socket, ec);
+        return Result<void>(ErrorCode::FILE_ACCESS_ERROR, message);
+    }
+
+    bus_.set_notify([this] { wake(); });
+    stopping_.store(false);
+    running_.store(true);
+    thread_ = std::thread([this] { loop(); });
+    return Result<void>();
+#else
+    return Result<void>(ErrorCode::InternalError, "Event subscriptions need epoll (Linux)");
+#endif
+}
+
+void EventServer::stop() {
+    if (!running_.load()) {
+        return;
+    }
+    bus_.set_notify(nullptr);
+    stopping_.store(true);
+    wake();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    close_descriptors();
+    std::error_code ec;
+    fs::remove(options_.socket, ec);
+    running_.store(false);
+}
+
+void EventServer::wake() {
+#ifdef __linux__
+    uint64_t one = 1;
+    if (wake_fd_ >= 0 && ::write(wake_fd_, &one, sizeof(one)) < 0) {
+        // The counter is already non-zero, so the loop wakes regardless
+    }
+#endif
+}
+
+void EventServer::close_descriptors() {
+#ifdef __linux__
+    for (int* fd : {&listen_fd_, &epoll_fd_, &wake_fd_}) {
+        if (*fd >= 0) {
+            ::close(*fd);
+            *fd = -1;
+        }
+    }
+#endif
+}
+
+void EventServer::loop() {
+#ifdef __linux__
+    std::unordered_map<int, Connection> clients;
+
+    auto drop = [&](int fd) {
+        auto it = clients.find(fd);
+        if (it == clients.end()) {
+            return;
+        }
+        if (it->second.subscriber != 0) {
+            bus_.unsubscribe(it->second.subscriber);
+        }
+        ::epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+        ::close(fd);
+        clients.erase(it);
+        connections_.store(clients.size());
+    };
+
+    // Write what the socket takes without blocking; false on a dead peer
+    auto flush = [](Connection& client) {
+        while (client.sent < client.out.size()) {
+            auto written = ::send(client.fd, client.out.data() + client.sent, client.out.size() - client.sent,
+                                  MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (written > 0) {
+                client.sent += static_cast<size_t>(written);
+            } else if (written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                return true;
+            } else if (written < 0 && errno == EINTR) {
+                continue;
+            } else {
+                return false;
+            }
+        }
+        client.out.clear();
+        client.sent = 0;
+        return true;
+    };
+
+    // Output is bounded per client; beyond that the client is dropped rather than buffered for
+    auto over_limit = [&](const Connection& client) {
+        if (client.out.size() - client.sent <= options_.max_pending_bytes) {
+            return false;
+        }
+        log("Disconnecting event client: more than " + std::to_string(options_.max_pending_bytes) +
+            " bytes unread");
+        return true;
+    };
+
+    // Move queued events into the socket until it fills up. Events are only taken from the
+    // bus once the previous write drained, so a stalled client's backlog stays in its bounded queue.
+    auto pump = [&](Connection& client) {
+        for (;;) {
+            if (client.out.empty() && client.subscriber != 0 && !client.closing) {
+                auto delivery = bus_.take(client.subscriber, EVENTS_PER_WRITE);
+                if (delivery.disconnected) {
+                    nlohmann::json notice;
+                    notice["type"] = "disconnected";
+                    notice["reason"] = "slow consumer";
+                    client.out = line(notice);
+                    client.closing = true;
+                } else {
+                    if (delivery.skipped != 0) {
+                        nlohmann::json overflow;
+                        overflow["type"] = "overflow";
+                        overflow["skipped"] = delivery.skipped;
+                        client.out += line(overflow);
+                    }
+                    for (const auto& event : delivery.events) {
+                        client.out += line(event.to_json());
+                    }
+                }
+            }
+            if (over_limit(client)) {
+                return false;
+            }
+            if (client.out.empty()) {
+                break;
+            }
+            if (!flush(client)) {
+                return false;
+            }
+            if (!client.out.empty() || client.closing) {
+                break;
+            }
+        }
+        if (client.closing) {
+            return false; // Best effort: the notice went out if the socket had room
+        }
+        bool want_writes = !client.out.empty();
+        if (want_writes != client.watching_writes) {
+            epoll_event interest{};
+            interest.events = EPOLLIN | EPOLLRDHUP | (want_writes ? EPOLLOUT : 0u);
+            interest.data.fd = client.fd;
+            ::epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, client.fd, &interest);
+            client.watching_writes = want_writes;
+        }
+        return true;
+    };
+
+    auto handle_request = [&](Connection& client, const std::string& request) {
+        auto json = nlohmann::json::parse(request, nullptr, false);
+        nlohmann::json reply;
+        if (json.is_discarded() || !json.is_object() || !json.contains("subscribe")) {
+            reply["type"] = "error";
+            reply["message"] = "Expected {\"subscribe\": {...}}";
+        } else if (auto filter = EventFilter::from_json(json["subscribe"]); !filter) {
+            reply["type"] = "error";
+            reply["message"] = filter.error_message();
+        } else {
+            if (client.subscriber == 0) {
+                client.subscriber = bus_.subscribe(std::move(filter.value()));
+            } else {
+                bus_.set_filter(client.subscriber, std::move(filter.value()));
+            }
+            reply["type"] = "subscribed";
+            reply["seq"] = bus_.last_seq();
+        }
+        client.out += line(reply);
+    };
+
+    // Read requests; false once the client hung up or misbehaved
+    auto receive = [&](Connection& client) {
+        char buffer[4096];
+        for (;;) {
+            auto received = ::recv(client.fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+            if (received > 0) {
+                client.in.append(buffer, static_cast<size_t>(received));
+            } else if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                break;
+            } else if (received < 0 && errno == EINTR) {
+                continue;
+            } else {
+                return false;
+            }
+        }
+        for (auto end = client.in.find('\n'); end != std::string::npos; end = client.in.find('\n')) {
+            auto request = client.in.substr(0, end);
+            client.in.erase(0, end + 1);
+            if (!request.empty()) {
+                handle_request(client, request);
+            }
+            if (over_limit(client)) {
+                return false;
+            }
+        }
+        return client.in.size() <= MAX_REQUEST_LINE;
+    };
+
+    epoll_event ready[64];
+    while (!stopping_.load()) {
+        int count = ::epoll_wait(epoll_fd_, ready, 64, -1);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            log(errno_message("Event loop failed"));
+            break;
+        }
+        for (int i = 0; i < count; ++i) {
+            int fd = ready[i].data.fd;
+            if (fd == wake_fd_) {
+                uint64_t counter = 0;
+                if (::read(wake_fd_, &counter, sizeof(counter)) < 0) {
+                    // Spurious wake-up; nothing to drain
+                }
+                std::vector<int> dead;
+                for (auto& [client_fd, client] : clients) {
+                    if (client.subscriber != 0 && !pump(client)) {
+                        dead.push_back(client_fd);
+                    }
+                }
+                for (int client_fd : dead) {
+                    drop(client_fd);
+                }
+            } else if (fd == listen_fd_) {
+                for (int accepted; (accepted = ::accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0;) {
+                    if (clients.size() >= options_.max_subscribers) {
+                        log("Refusing event subscriber: limit of " + std::to_string(options_.max_subscribers) + " reached");
+                        ::close(accepted);
+                        continue;
+                    }
+                    epoll_event interest{};
+                    interest.events = EPOLLIN | EPOLLRDHUP;
+                    interest.data.fd = accepted;
+                    if (::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, accepted, &interest) != 0) {
+                        ::close(accepted);
+                        continue;
+                    }
+                    clients[accepted].fd = accepted;
+                    connections_.store(clients.size());
+                }
+            } else if (auto it = clients.find(fd); it != clients.end()) {
+                auto& client = it->second;
+                bool alive = !(ready[i].events & (EPOLLERR | EPOLLHUP));
+                if (alive && (ready[i].events & (EPOLLIN | EPOLLRDHUP))) {
+                    alive = receive(client);
+                }
+                if (alive) {
+                    alive = pump(client);
+                }
+                if (!alive) {
+                    drop(fd);
+                }
+            }
+        }
+    }
+
+    while (!clients.empty()) {
+        drop(clients.begin()->first);
+    }
+#endif
+}
+
+void EventServer::log(const std::string& message) const {
+    if (options_.log) {
+        options_.log(message);
+    }
+}
+
+Result<void> subscribe_events(const fs::path& socket, const EventFilter& filter,
+                              const std::function<bool(const nlohmann::json&)>& on_event) {
+#ifdef __linux__
+    auto address = socket_address(socket);
+    if (!address) {
+        return Result<void>(address.error(), address.error_message());
+    }
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || ::connect(fd, reinterpret_cast<const sockaddr*>(&address.value()), sizeof(sockaddr_un)) != 0) {
+        auto message = errno_message("Cannot connect to " + socket.string() + " (is the daemon running?)");
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        return Result<void>(ErrorCode::FILE_ACCESS_ERROR, message);
+    }
+
+    nlohmann::json request;
+    request["subscribe"] = filter.to_json();
+    auto payload = line(request);
+    for (size_t sent = 0; sent < payload.size();) {
+        auto written = ::send(fd, payload.data() + sent, payload.size() - sent, MSG_NOSIGNAL);
+        if (written <= 0) {
+            ::close(fd);
+            return Result<void>(ErrorCode::FILE_ACCESS_ERROR, errno_message("Failed to subscribe"));
+        }
+        sent += static_cast<size_t>(written);
+    }
+
+    std::string pending;
+    char buffer[4096];
+    for (;;) {
+        auto received = ::recv(fd, buffer, sizeof(buffer), 0);
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received <= 0) {
+            ::close(fd);
+            return Result<void>(ErrorCode::FILE_ACCESS_ERROR, "Daemon closed the event stream");
+        }
+        pending.append(buffer, static_cast<size_t>(received));
+        for (auto end = pending.find('\n'); end != std::string::npos; end = pending.find('\n')) {
+            auto json = nlohmann::json::parse(pending.substr(0, end), nullptr, false);
+            pending.erase(0, end + 1);
+            if (!json.is_discarded() && !on_event(json)) {
+                ::close(fd);
+                return Result<void>();
+            }
+        }
+    }
+#else
+    (void)socket;
+    (void)filter;
+    (void)on_event;
+    return Result<void>(ErrorCode::InternalError, "Event subscriptions need Unix sockets");
+#endif
+}
+
+} // namespace tcfs
@@ -0,0 +1,152 @@
+#include "tcfs/InboxWatcher.hpp"
+#include <algorithm>
+#include <iterator>
+#include <thread>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace tcfs {
+
+InboxWatcher::InboxWatcher(fs::path dir) : dir_(std::move(dir)) {
+}
+
+InboxWatcher::~InboxWatcher() {
+    stop();
+}
+
+Result<void> InboxWatcher::start() {
+    std::error_code ec;
+    fs::create_directories(dir_, ec);
+    if (!fs::is_directory(dir_, ec)) {
+        return Result<void>(ErrorCode::FILE_ACCESS_ERROR, "Inbox is not a directory: " + dir_.string());
+    }
+
+#ifdef __linux__
+    fd_ = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd_ >= 0) {
+        watch_ = ::inotify_add_watch(fd_, dir_.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+        if (watch_ < 0) {
+            ::close(fd_);
+            fd_ = -1;
+        }
+    }
+#endif
+
+    running_ = true;
+    // Files dropped while nobody was watching
+    scan(false);
+    return Result<void>();
+}
+
+void InboxWatcher::stop() {
+#ifdef __linux__
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+#endif
+    fd_ = -1;
+    watch_ = -1;
+    running_ = false;
+}
+
+bool InboxWatcher::wait(std::chrono::milliseconds timeout) {
+    if (!running_) {
+        return false;
+    }
+#ifdef __linux__
+    if (fd_ >= 0) {
+        pollfd descriptor{fd_, POLLIN, 0};
+        auto ms = static_cast<int>(std::max<std::chrono::milliseconds::rep>(0, timeout.count()));
+        if (::poll(&descriptor, 1, ms) > 0) {
+            drain_events();
+        }
+        return !pending_.empty();
+    }
+#endif
+    std::this_thread::sleep_for(timeout);
+    scan(true);
+    return !pending_.empty();
+}
+
+std::vector<fs::path> InboxWatcher::take(size_t max) {
+    std::vector<fs::path> ready;
+    while (!pending_.empty() && ready.size() < max) {
+        auto path = std::move(pending_.front());
+        pending_.pop_front();
+        queued_.erase(path.filename().string());
+        std::error_code ec;
+        if (fs::is_regular_file(path, ec)) {
+            ready.push_back(std::move(path));
+        }
+    }
+    return ready;
+}
+
+void InboxWatcher::enqueue(const std::string& name) {
+    if (name.empty() || name.front() == '.') {
+        return;
+    }
+    if (queued_.insert(name).second) {
+        pending_.push_back(dir_ / name);
+    }
+}
+
+void InboxWatcher::drain_events() {
+#ifdef __linux__
+    alignas(inotify_event) char buffer[64 * 1024];
+    for (;;) {
+        auto length = ::read(fd_, buffer, sizeof(buffer));
+        if (length <= 0) {
+            break;
+        }
+        for (char* cursor = buffer; cursor < buffer + length;) {
+            auto* event = reinterpret_cast<inotify_event*>(cursor);
+            if (event->mask & IN_Q_OVERFLOW) {
+                scan(false); // Events were lost: fall back to the directory listing
+            } else if (event->len > 0 && !(event->mask & IN_ISDIR)) {
+                enqueue(event->name);
+            }
+            cursor += sizeof(inotify_event) + event->len;
+        }
+    }
+#endif
+}
+
+void InboxWatcher::scan(bool require_stable) {
+    std::unordered_map<std::string, Signature> current;
+    std::error_code ec;
+    for (fs::directory_iterator it(dir_, ec), end; !ec && it != end; it.increment(ec)) {
+        std::error_code file_ec;
+        if (!it->is_regular_file(file_ec)) {
+            continue;
+        }
+        auto name = it->path().filename().string();
+        Signature signature{it->file_size(file_ec), it->last_write_time(file_ec)};
+        if (file_ec) {
+            continue;
+        }
+
+        // A file is finished once it looks the same on two consecutive scans
+        auto previous = seen_.find(name);
+        bool stable = previous != seen_.end() && previous->second == signature;
+        auto reported = reported_.find(name);
+        if ((!require_stable || stable) && (reported == reported_.end() || !(reported->second == signature))) {
+            enqueue(name);
+            reported_[name] = signature;
+        }
+        current.emplace(std::move(name), signature);
+    }
+
+    for (auto it = reported_.begin(); it != reported_.end();) {
+        it = current.count(it->first) ? std::next(it) : reported_.erase(it);
+    }
+    seen_ = std::move(current);
+}
+
+} // namespace tcfs
@@ -0,0 +1,98 @@
+#include "tcfs/Prefetcher.hpp"
+#include "tcfs/PageCache.hpp"
+
+namespace fs = std::filesystem;
+
+namespace tcfs {
+
+Prefetcher::Prefetcher(Store& store, PrefetchOptions options)
+    : store_(store), options_(std::move(options)), budget_(options_.bytes_per_second, options_.bytes_per_second) {
+}
+
+size_t Prefetcher::prefetch(const UnlockScheduler& scheduler, const TimePoint& now) {
+    if (!enabled()) {
+        return 0;
+    }
+
+    // Already prefetched capsules sit at the front; look just past them
+    auto candidates = scheduler.peek_until(now + options_.horizon, prefetched_.size() + options_.max_per_tick);
+
+    size_t prefetched = 0;
+    for (const auto& candidate : candidates) {
+        if (is_prefetched(candidate.capsule_id)) {
+            continue;
+        }
+
+        std::error_code ec;
+        auto path = store_.capsule_path(candidate.capsule_id);
+        auto size = fs::file_size(path, ec);
+        if (ec) {
+            continue;
+        }
+        if (resident_bytes_ + size > options_.max_resident_bytes) {
+            break; // Wait for releases to hand pages back
+        }
+        if (!budget_.try_consume(size, now)) {
+            break;
+        }
+
+        auto advised = advise_willneed(path);
+        if (!advised) {
+            log("Prefetch of " + candidate.capsule_id + " failed: " + advised.error_message());
+            continue;
+        }
+        advise_willneed(store_.metadata_path(candidate.capsule_id));
+
+        prefetched_.emplace(candidate.capsule_id, size);
+        resident_bytes_ += size;
+        ++prefetched;
+    }
+    return prefetched;
+}
+
+std::optional<Prefetcher::TimePoint> Prefetcher::next_wake(const UnlockScheduler& scheduler, const TimePoint& now) const {
+    if (!enabled()) {
+        return std::nullopt;
+    }
+    auto next = scheduler.next_due_after(now + options_.horizon);
+    if (!next) {
+        return std::nullopt;
+    }
+    return *next - options_.horizon;
+}
+
+void Prefetcher::release(const std::string& capsule_id) {
+    auto it = prefetched_.find(capsule_id);
+    if (it == prefetched_.end()) {
+        return;
+    }
+    // The plaintext has been written out; the ciphertext pages are cold from here on
+    advise_dontneed(store_.capsule_path(capsule_id));
+    resident_bytes_ -= it->second;
+    prefetched_.erase(it);
+}
+
+void Prefetcher::forget(const std::string& capsule_id) {
+    auto it = prefetched_.find(capsule_id);
+    if (it == prefetched_.end()) {
+        return;
+    }
+    advise_dontneed(store_.capsule_path(capsule_id)); // Fails harmlessly once the capsule is destroyed
+    resident_bytes_ -= it->second;
+    prefetched_.erase(it);
+}
+
+void Prefetcher::rescheduled(const std::string& capsule_id, const std::optional<TimePoint>& due, const TimePoint& now) {
+    // Left counted, a capsule moved out of reach would hold its share of max_resident_bytes indefinitely
+    if (!due || *due > now + options_.horizon) {
+        forget(capsule_id);
+    }
+}
+
+void Prefetcher::log(const std::string& message) const {
+    if (options_.log) {
+        options_.log(message);
+    }
+}
+
+} // namespace tcfs
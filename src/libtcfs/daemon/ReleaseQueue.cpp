@@ -0,0 +1,169 @@
+#include "tcfs/ReleaseQueue.hpp"
+#include "tcfs/Condition.hpp"
+#include <algorithm>
+
+namespace tcfs {
+
+TokenBucket::TokenBucket(uint64_t rate_per_second, uint64_t burst)
+    : rate_(rate_per_second), burst_(static_cast<double>(std::max(burst, rate_per_second))), tokens_(burst_) {
+}
+
+void TokenBucket::refill(const TimePoint& now) {
+    if (last_ && now > *last_) {
+        auto elapsed = std::chrono::duration<double>(now - *last_).count();
+        tokens_ = std::min(burst_, tokens_ + elapsed * static_cast<double>(rate_));
+    }
+    if (!last_ || now > *last_) {
+        last_ = now;
+    }
+}
+
+bool TokenBucket::try_consume(uint64_t cost, const TimePoint& now) {
+    if (unlimited()) {
+        return true;
+    }
+    refill(now);
+    auto needed = std::min(static_cast<double>(cost), burst_);
+    if (tokens_ < needed) {
+        return false;
+    }
+    tokens_ -= static_cast<double>(cost); // May go negative for oversized requests; later ones wait it out
+    return true;
+}
+
+TokenBucket::TimePoint TokenBucket::ready_at(uint64_t cost, const TimePoint& now) {
+    if (unlimited()) {
+        return now;
+    }
+    refill(now);
+    auto needed = std::min(static_cast<double>(cost), burst_);
+    if (tokens_ >= needed) {
+        return now;
+    }
+    auto wait = std::chrono::duration<double>((needed - tokens_) / static_cast<double>(rate_));
+    return now + std::chrono::ceil<TimePoint::duration>(wait);
+}
+
+ReleaseQueue::ReleaseQueue(ReleaseQueueOptions options)
+    : options_(std::move(options)), io_budget_(options_.io_bytes_per_second, options_.io_burst_bytes) {
+    if (options_.max_concurrency == 0) {
+        options_.max_concurrency = 1;
+    }
+}
+
+ReleasePriority ReleaseQueue::classify(const CatalogEntry& entry) const {
+    const auto& labels = options_.high_priority_labels;
+    if (!entry.label.empty() && std::find(labels.begin(), labels.end(), entry.label) != labels.end()) {
+        return ReleasePriority::High;
+    }
+    if (options_.bulk_size_bytes != 0 && entry.size >= options_.bulk_size_bytes) {
+        return ReleasePriority::Bulk;
+    }
+    return ReleasePriority::Normal;
+}
+
+ReleaseQueue::TimePoint::duration ReleaseQueue::jitter_for(const std::string& capsule_id) const {
+    auto window = std::chrono::duration_cast<TimePoint::duration>(options_.max_jitter).count();
+    if (window <= 0) {
+        return TimePoint::duration::zero();
+    }
+    auto hash = Condition::hash_label(capsule_id);
+    return TimePoint::duration(static_cast<TimePoint::rep>(hash % static_cast<uint64_t>(window)));
+}
+
+bool ReleaseQueue::push(const CatalogEntry& entry, const TimePoint& due) {
+    if (!queued_.insert(entry.id).second) {
+        return false;
+    }
+    Request request;
+    request.capsule_id = entry.id;
+    request.size = entry.size;
+    request.priority = classify(entry);
+    request.due = due;
+    request.not_before = due + jitter_for(entry.id);
+    auto& queue = classes_[static_cast<size_t>(request.priority)];
+    queue.emplace(request.not_before, std::move(request));
+    return true;
+}
+
+std::vector<ReleaseQueue::Request> ReleaseQueue::take_batch(const TimePoint& now) {
+    std::vector<Request> batch;
+    for (auto& queue : classes_) {
+        while (batch.size() < options_.max_concurrency && !queue.empty() && queue.begin()->first <= now) {
+            auto it = queue.begin();
+            if (!io_budget_.try_consume(it->second.size, now)) {
+                return batch; // Budget exhausted: lower classes must not overtake
+            }
+            queued_.erase(it->second.capsule_id);
+            batch.push_back(std::move(it->second));
+            queue.erase(it);
+        }
+    }
+    return batch;
+}
+
+void ReleaseQueue::requeue(Request request, const TimePoint& not_before) {
+    if (!queued_.insert(request.capsule_id).second) {
+        return;
+    }
+    request.not_before = not_before;
+    auto& queue = classes_[static_cast<size_t>(request.priority)];
+    queue.emplace(not_before, std::move(request));
+}
+
+std::optional<ReleaseQueue::TimePoint> ReleaseQueue::next_eligible(const TimePoint& now) {
+    std::optional<TimePoint> next;
+    for (const auto& queue : classes_) {
+        if (queue.empty()) {
+            continue;
+        }
+        const auto& head = queue.begin()->second;
+        auto at = std::max(head.not_before, now);
+        at = std::max(at, io_budget_.ready_at(head.size, now));
+        if (!next || at < *next) {
+            next = at;
+        }
+    }
+    return next;
+}
+
+void ReleaseQueue::record_completion(const Request& request, const TimePoint& finished) {
+    auto lag = std::chrono::duration_cast<std::chrono::milliseconds>(finished - request.due).count();
+    lag = std::max<int64_t>(lag, 0);
+    if (lags_.size() < LAG_WINDOW) {
+        lags_.push_back(lag);
+    } else {
+        lags_[lag_count_ % LAG_WINDOW] = lag;
+    }
+    ++lag_count_;
+    lag_max_ = std::max(lag_max_, lag);
+}
+
+ReleaseLagStats ReleaseQueue::lag() const {
+    ReleaseLagStats stats;
+    stats.count = lag_count_;
+    if (lags_.empty()) {
+        return stats;
+    }
+    auto sorted = lags_;
+    auto percentile = [&sorted](size_t p) {
+        auto index = (sorted.size() - 1) * p / 100;
+        std::nth_element(sorted.begin(), sorted.begin() + static_cast<std::ptrdiff_t>(index), sorted.end());
+        return std::chrono::milliseconds(sorted[index]);
+    };
+    stats.p50 = percentile(50);
+    stats.p99 = percentile(99);
+    stats.max = std::chrono::milliseconds(lag_max_);
+    return stats;
+}
+
+std::string to_string(ReleasePriority priority) {
+    switch (priority) {
+        case ReleasePriority::High: return "high";
+        case ReleasePriority::Normal: return "normal";
+        case ReleasePriority::Bulk: return "bulk";
+    }
+    return "normal";
+}
+
+} // namespace tcfs
@@ -0,0 +1,195 @@
+#include "tcfs/Scrubber.hpp"
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <future>
+
+namespace fs = std::filesystem;
+
+namespace tcfs {
+
+Scrubber::Scrubber(Store& store, ScrubberOptions options) : store_(store), options_(std::move(options)) {
+    options_.workers = std::max<size_t>(1, options_.workers);
+    options_.batch_size = std::max<size_t>(1, options_.batch_size);
+}
+
+Result<ScrubReport> Scrubber::scrub(const std::vector<std::string>& ids) {
+    // Signers are compared in their base64 form, as recorded in the headers
+    std::vector<std::string> trusted;
+    for (const auto& key : options_.trusted_signers) {
+        trusted.push_back(store_.crypto().toBase64(key));
+    }
+    if (trusted.empty()) {
+        auto own = store_.signer_public_key();
+        if (!own) {
+            return Result<ScrubReport>(own.error(), "No trusted signer: " + own.error_message());
+        }
+        trusted.push_back(store_.crypto().toBase64(own.value()));
+    }
+
+    const auto group_status = check_groups(trusted);
+    const size_t batches = (ids.size() + options_.batch_size - 1) / options_.batch_size;
+    std::vector<ScrubReport> reports(batches);
+    std::atomic<size_t> next{0};
+    std::vector<std::future<void>> pool;
+    for (size_t w = 0; w < std::min(options_.workers, batches); ++w) {
+        pool.push_back(std::async(std::launch::async, [&] {
+            for (size_t b = next++; b < batches; b = next++) {
+                auto begin = b * options_.batch_size;
+                reports[b] = scrub_batch(ids, begin, std::min(ids.size(), begin + options_.batch_size), trusted,
+                                         group_status);
+            }
+        }));
+    }
+    for (auto& worker : pool) {
+        worker.get();
+    }
+
+    ScrubReport total;
+    for (auto& report : reports) {
+        total.verified += report.verified;
+        total.unsigned_ids.insert(total.unsigned_ids.end(), report.unsigned_ids.begin(), report.unsigned_ids.end());
+        total.failed.insert(total.failed.end(), report.failed.begin(), report.failed.end());
+    }
+    for (const auto& [id, reason] : total.failed) {
+        log("Header of " + id + " failed verification: " + reason);
+    }
+    log("Scrubbed " + std::to_string(ids.size()) + " header(s): " + std::to_string(total.verified) + " verified, " +
+        std::to_string(total.unsigned_ids.size()) + " unsigned, " + std::to_string(total.failed.size()) + " failed");
+    return Result<ScrubReport>(std::move(total));
+}
+
+std::map<std::string, std::string> Scrubber::check_groups(const std::vector<std::string>& trusted) const {
+    auto& crypto = store_.crypto();
+    std::map<std::string, std::string> failures; // Every group file; an empty reason means it verified
+    std::error_code ec;
+    for (fs::directory_iterator it(store_.root() / Store::GROUPS_DIRNAME, ec), end; !ec && it != end; it.increment(ec)) {
+        if (it->path().extension() != ".json") {
+            continue;
+        }
+        auto name = it->path().stem().string();
+        auto& reason = failures[name];
+        auto record = store_.read_group(name);
+        if (!record) {
+            reason = record.error_message();
+            continue;
+        }
+        if (!record.value().contains(Store::SIGNATURE_FIELD)) {
+            reason = "Group file is not signed";
+            continue;
+        }
+        try {
+            const auto& signature = record.value().at(Store::SIGNATURE_FIELD);
+            auto signer = signature.at("key").get<std::string>();
+            if (signature.value("alg", "") != "ed25519") {
+                reason = "Unsupported signature algorithm";
+            } else if (std::find(trusted.begin(), trusted.end(), signer) == trusted.end()) {
+                reason = "Group file signed by an untrusted key";
+            } else if (!crypto.ed25519Verify(crypto.fromBase64(signer), Store::header_bytes(record.value()),
+                                             crypto.fromBase64(signature.at("value").get<std::string>()))) {
+                reason = "Signature does not match group file";
+            }
+        } catch (const nlohmann::json::exception& e) {
+            reason = "Malformed signature: " + std::string(e.what());
+        } catch (const TCFSException& e) {
+            reason = "Malformed signature: " + e.getMessage();
+        }
+    }
+    for (const auto& [name, reason] : failures) {
+        if (!reason.empty()) {
+            log("Group file " + name + " failed verification: " + reason);
+        }
+    }
+    return failures;
+}
+
+ScrubReport Scrubber::scrub_batch(const std::vector<std::string>& ids, size_t begin, size_t end,
+                                  const std::vector<std::string>& trusted,
+                                  const std::map<std::string, std::string>& group_status) {
+    auto& crypto = store_.crypto();
+    std::vector<std::string> failure(end - begin);
+    std::vector<bool> is_unsigned(end - begin, false);
+
+    struct Group {
+        std::vector<size_t> items;
+        std::vector<std::vector<uint8_t>> messages;
+        std::vector<std::vector<uint8_t>> signatures;
+    };
+    std::map<std::string, Group> by_signer;
+
+    for (size_t i = begin; i < end; ++i) {
+        auto& reason = failure[i - begin];
+        auto metadata = store_.read_metadata(ids[i]);
+        if (!metadata) {
+            reason = metadata.error_message();
+            continue;
+        }
+        const auto& header = metadata.value();
+        if (!header.contains(Store::SIGNATURE_FIELD)) {
+            is_unsigned[i - begin] = true;
+            continue;
+        }
+        if (header.contains(Store::GROUP_FIELD) && header[Store::GROUP_FIELD].is_string()) {
+            // The member's policy lives in the group file; its header alone proves nothing about it
+            auto group = header[Store::GROUP_FIELD].get<std::string>();
+            auto status = group_status.find(group);
+            if (status == group_status.end()) {
+                reason = "Group file of " + group + " not found";
+                continue;
+            }
+            if (!status->second.empty()) {
+                reason = "Group " + group + ": " + status->second;
+                continue;
+            }
+        }
+        try {
+            const auto& signature = header.at(Store::SIGNATURE_FIELD);
+            auto signer = signature.at("key").get<std::string>();
+            if (signature.value("alg", "") != "ed25519") {
+                reason = "Unsupported signature algorithm";
+            } else if (std::find(trusted.begin(), trusted.end(), signer) == trusted.end()) {
+                reason = "Signed by an untrusted key";
+            } else {
+                auto& group = by_signer[signer];
+                group.items.push_back(i - begin);
+                group.messages.push_back(Store::header_bytes(header));
+                group.signatures.push_back(crypto.fromBase64(signature.at("value").get<std::string>()));
+            }
+        } catch (const nlohmann::json::exception& e) {
+            reason = "Malformed signature: " + std::string(e.what());
+        } catch (const TCFSException& e) {
+            reason = "Malformed signature: " + e.getMessage();
+        }
+    }
+
+    ScrubReport report;
+    for (const auto& [signer, group] : by_signer) {
+        auto valid = crypto.ed25519VerifyBatch(crypto.fromBase64(signer), group.messages, group.signatures);
+        for (size_t k = 0; k < group.items.size(); ++k) {
+            if (valid[k]) {
+                ++report.verified;
+            } else {
+                failure[group.items[k]] = "Signature does not match header";
+            }
+        }
+    }
+    for (size_t i = begin; i < end; ++i) {
+        if (is_unsigned[i - begin]) {
+            report.unsigned_ids.push_back(ids[i]);
+            if (options_.require_signatures) {
+                report.failed.emplace_back(ids[i], "Header is not signed");
+            }
+        } else if (!failure[i - begin].empty()) {
+            report.failed.emplace_back(ids[i], failure[i - begin]);
+        }
+    }
+    return report;
+}
+
+void Scrubber::log(const std::string& message) const {
+    if (options_.log) {
+        options_.log(message);
+    }
+}
+
+} // namespace tcfs
@@ -0,0 +1,84 @@
+#include "tcfs/Sweeper.hpp"
+#include <thread>
+
+namespace tcfs {
+
+Sweeper::Sweeper(Store& store, SweeperOptions options) : store_(store), options_(std::move(options)) {
+    if (options_.batch_size == 0) {
+        options_.batch_size = 1;
+    }
+}
+
+Result<void> Sweeper::start() {
+    auto catalog = store_.catalog();
+    if (!catalog) {
+        return Result<void>(catalog.error(), catalog.error_message());
+    }
+    index_.clear();
+    for (const auto* entry : catalog.value()->entries()) {
+        track(*entry);
+    }
+    return Result<void>();
+}
+
+void Sweeper::track(const CatalogEntry& entry) {
+    if (entry.expire_at == 0) {
+        index_.remove(entry.id);
+        return;
+    }
+    index_.schedule_at(entry.id, TimePoint(std::chrono::seconds(entry.expire_at)));
+}
+
+SweepResult Sweeper::sweep_batch(const TimePoint& now) {
+    SweepResult result;
+    for (const auto& due : index_.pop_due(now, options_.batch_size)) {
+        std::optional<CatalogEntry> entry;
+        if (on_destroy_) {
+            auto catalog = store_.catalog();
+            const auto* found = catalog ? catalog.value()->find(due.capsule_id) : nullptr;
+            if (found) {
+                entry = *found;
+            }
+        }
+        auto ready = store_.destroy(due.capsule_id, "expired");
+        if (!ready) {
+            log("Failed to destroy expired capsule " + due.capsule_id + ": " + ready.error_message());
+            ++result.failed;
+            continue; // Left out of the index; the next start() picks it up again
+        }
+        log("Destroyed expired capsule " + due.capsule_id);
+        result.destroyed.push_back(due.capsule_id);
+        if (entry) {
+            on_destroy_(*entry);
+        }
+        result.ready.insert(result.ready.end(), ready.value().begin(), ready.value().end());
+    }
+    return result;
+}
+
+SweepResult Sweeper::sweep(const TimePoint& now) {
+    SweepResult total;
+    while (has_expired(now)) {
+        if (!total.destroyed.empty() || total.failed != 0) {
+            std::this_thread::sleep_for(options_.batch_pause);
+        }
+        auto batch = sweep_batch(now);
+        total.destroyed.insert(total.destroyed.end(), batch.destroyed.begin(), batch.destroyed.end());
+        total.ready.insert(total.ready.end(), batch.ready.begin(), batch.ready.end());
+        total.failed += batch.failed;
+    }
+    return total;
+}
+
+bool Sweeper::has_expired(const TimePoint& now) const {
+    auto next = index_.next_due();
+    return next && *next <= now;
+}
+
+void Sweeper::log(const std::string& message) const {
+    if (options_.log) {
+        options_.log(message);
+    }
+}
+
+} // namespace tcfs
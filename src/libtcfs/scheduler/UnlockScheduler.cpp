@@ -0,0 +1,224 @@
+#include "tcfs/UnlockScheduler.hpp"
+#include <algorithm>
+#include <bit>
+#include <functional>
+
+namespace tcfs {
+
+namespace {
+
+uint32_t id_hash(std::string_view capsule_id) {
+    auto hash = static_cast<uint64_t>(std::hash<std::string_view>{}(capsule_id));
+    return static_cast<uint32_t>(hash ^ (hash >> 32));
+}
+
+} // namespace
+
+bool UnlockScheduler::schedule(const std::string& capsule_id, const Policy& policy, const TimePoint& now) {
+    auto next = policy.next_unlock_time(now);
+    if (!next) {
+        remove(capsule_id);
+        return false;
+    }
+    schedule_at(capsule_id, *next);
+    return true;
+}
+
+void UnlockScheduler::schedule_at(const std::string& capsule_id, const TimePoint& due) {
+    auto existing = by_id_.find(std::string_view(capsule_id));
+    if (existing != by_id_.end()) {
+        if (existing->second->first == due) {
+            return;
+        }
+        auto previous = existing->second;
+        by_id_.erase(existing); // Its key views the node erased next
+        by_time_.erase(previous);
+    } else if (auto loaded = find_loaded(capsule_id); loaded != NOT_LOADED) {
+        if (loaded_[loaded].due == due) {
+            return;
+        }
+        drop_loaded(loaded);
+    }
+    auto position = by_time_.emplace(due, capsule_id);
+    by_id_.emplace(std::string_view(position->second), position);
+}
+
+void UnlockScheduler::remove(const std::string& capsule_id) {
+    auto existing = by_id_.find(std::string_view(capsule_id));
+    if (existing != by_id_.end()) {
+        auto position = existing->second;
+        by_id_.erase(existing);
+        by_time_.erase(position);
+        return;
+    }
+    auto loaded = find_loaded(capsule_id);
+    if (loaded != NOT_LOADED) {
+        drop_loaded(loaded);
+    }
+}
+
+bool UnlockScheduler::contains(const std::string& capsule_id) const {
+    return by_id_.count(std::string_view(capsule_id)) != 0 || find_loaded(capsule_id) != NOT_LOADED;
+}
+
+size_t UnlockScheduler::find_loaded(std::string_view capsule_id) const {
+    if (loaded_slots_.empty()) {
+        return NOT_LOADED;
+    }
+    const auto hash = id_hash(capsule_id);
+    const auto mask = loaded_slots_.size() - 1;
+    // Linear probing; tombstoned entries keep their slot and simply never match
+    for (auto slot = hash & mask; loaded_slots_[slot] != 0; slot = (slot + 1) & mask) {
+        auto index = static_cast<size_t>(loaded_slots_[slot] & 0xffffffffu) - 1;
+        if (loaded_slots_[slot] >> 32 == hash && loaded_[index].capsule_id == capsule_id) {
+            return index;
+        }
+    }
+    return NOT_LOADED;
+}
+
+void UnlockScheduler::drop_loaded(size_t index) {
+    std::string().swap(loaded_[index].capsule_id);
+    --loaded_live_;
+    loaded_head_ = next_loaded(loaded_head_);
+    if (loaded_live_ == 0) {
+        loaded_ = {};
+        loaded_slots_ = {};
+        loaded_head_ = 0;
+    }
+}
+
+size_t UnlockScheduler::next_loaded(size_t index) const {
+    while (index < loaded_.size() && loaded_[index].capsule_id.empty()) {
+        ++index;
+    }
+    return index;
+}
+
+std::vector<UnlockScheduler::Entry> UnlockScheduler::pop_due(const TimePoint& now, size_t limit) {
+    std::vector<Entry> due;
+    auto it = by_time_.begin();
+    while (due.size() < limit) {
+        // Merge the loaded array and the tree; on equal times the loaded entry was scheduled first
+        if (loaded_head_ < loaded_.size() && loaded_[loaded_head_].due <= now &&
+            (it == by_time_.end() || loaded_[loaded_head_].due <= it->first)) {
+            due.push_back(Entry{std::string(), loaded_[loaded_head_].due});
+            due.back().capsule_id.swap(loaded_[loaded_head_].capsule_id);
+            drop_loaded(loaded_head_);
+        } else if (it != by_time_.end() && it->first <= now) {
+            by_id_.erase(std::string_view(it->second));
+            due.push_back(Entry{std::move(it->second), it->first});
+            it = by_time_.erase(it);
+        } else {
+            break;
+        }
+    }
+    return due;
+}
+
+std::vector<UnlockScheduler::Entry> UnlockScheduler::peek_until(const TimePoint& horizon, size_t limit) const {
+    std::vector<Entry> due;
+    auto it = by_time_.begin();
+    for (size_t index = loaded_head_; due.size() < limit;) {
+        if (index < loaded_.size() && loaded_[index].due <= horizon &&
+            (it == by_time_.end() || loaded_[index].due <= it->first)) {
+            due.push_back(loaded_[index]);
+            index = next_loaded(index + 1);
+        } else if (it != by_time_.end() && it->first <= horizon) {
+            due.push_back(Entry{it->second, it->first});
+            ++it;
+        } else {
+            break;
+        }
+    }
+    return due;
+}
+
+std::optional<UnlockScheduler::TimePoint> UnlockScheduler::next_due() const {
+    std::optional<TimePoint> next;
+    if (loaded_head_ < loaded_.size()) {
+        next = loaded_[loaded_head_].due;
+    }
+    if (!by_time_.empty() && (!next || by_time_.begin()->first < *next)) {
+        next = by_time_.begin()->first;
+    }
+    return next;
+}
+
+std::optional<UnlockScheduler::TimePoint> UnlockScheduler::next_due_after(const TimePoint& time) const {
+    std::optional<TimePoint> next;
+    // Tombstones keep their time, so the array stays searchable
+    auto after = std::upper_bound(loaded_.begin() + static_cast<std::ptrdiff_t>(loaded_head_), loaded_.end(), time,
+                                  [](const TimePoint& t, const Entry& entry) { return t < entry.due; });
+    auto index = next_loaded(static_cast<size_t>(after - loaded_.begin()));
+    if (index < loaded_.size()) {
+        next = loaded_[index].due;
+    }
+    auto it = by_time_.upper_bound(time);
+    if (it != by_time_.end() && (!next || it->first < *next)) {
+        next = it->first;
+    }
+    return next;
+}
+
+std::optional<UnlockScheduler::TimePoint> UnlockScheduler::due_time(const std::string& capsule_id) const {
+    auto existing = by_id_.find(std::string_view(capsule_id));
+    if (existing != by_id_.end()) {
+        return existing->second->first;
+    }
+    auto loaded = find_loaded(capsule_id);
+    if (loaded == NOT_LOADED) {
+        return std::nullopt;
+    }
+    return loaded_[loaded].due;
+}
+
+void UnlockScheduler::clear() {
+    by_id_.clear();
+    by_time_.clear();
+    loaded_ = {};
+    loaded_slots_ = {};
+    loaded_head_ = 0;
+    loaded_live_ = 0;
+}
+
+void UnlockScheduler::load(std::vector<Entry> entries) {
+    clear();
+    if (entries.empty()) {
+        return;
+    }
+    // Sort positions rather than the entries themselves, then move each id once
+    std::vector<std::pair<TimePoint, size_t>> order;
+    order.reserve(entries.size());
+    for (size_t i = 0; i < entries.size(); ++i) {
+        order.emplace_back(entries[i].due, i);
+    }
+    std::sort(order.begin(), order.end());
+    loaded_.reserve(entries.size());
+    for (const auto& [due, index] : order) {
+        loaded_.push_back(Entry{std::move(entries[index].capsule_id), due});
+    }
+
+    // At most half full, so probe runs stay short
+    loaded_slots_.assign(std::bit_ceil(loaded_.size() * 2), 0);
+    const auto mask = loaded_slots_.size() - 1;
+    for (size_t i = 0; i < loaded_.size(); ++i) {
+        if (find_loaded(loaded_[i].capsule_id) != NOT_LOADED) {
+            loaded_[i].capsule_id.clear(); // A later duplicate of an id
+            continue;
+        }
+        const auto hash = id_hash(loaded_[i].capsule_id);
+        auto slot = hash & mask;
+        while (loaded_slots_[slot] != 0) {
+            slot = (slot + 1) & mask;
+        }
+        loaded_slots_[slot] = uint64_t{hash} << 32 | (i + 1);
+        ++loaded_live_;
+    }
+    loaded_head_ = next_loaded(0);
+    if (loaded_live_ == 0) {
+        clear();
+    }
+}
+
+} // namespace tcfs
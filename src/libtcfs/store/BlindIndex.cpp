@@ -0,0 +1,108 @@
+#include "tcfs/BlindIndex.hpp"
+#include <algorithm>
+#include <cctype>
+
+namespace tcfs {
+
+std::string BlindIndex::normalize(const std::string& value) {
+    std::string result(value);
+    std::transform(result.begin(), result.end(), result.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return result;
+}
+
+uint64_t BlindIndex::token(char kind, const std::string& field, const std::string& text) const {
+    // Kind and field are separated by NULs so "label"+"x" cannot collide with "labelx"+""
+    std::vector<uint8_t> input;
+    input.reserve(field.size() + text.size() + 3);
+    input.push_back(static_cast<uint8_t>(kind));
+    input.push_back(0);
+    input.insert(input.end(), field.begin(), field.end());
+    input.push_back(0);
+    input.insert(input.end(), text.begin(), text.end());
+    auto mac = crypto_.hmacSha256(key_, input);
+    uint64_t value = 0;
+    for (size_t i = 0; i < sizeof(value); ++i) {
+        value = (value << 8) | mac[i];
+    }
+    return value;
+}
+
+std::vector<uint64_t> BlindIndex::tokens(const std::string& field, const std::string& value) const {
+    std::vector<uint64_t> result;
+    auto text = normalize(value);
+    if (text.empty()) {
+        return result;
+    }
+    result.push_back(token('e', field, text));
+    for (size_t length = 1; length <= std::min(text.size(), MAX_PREFIX); ++length) {
+        result.push_back(token('p', field, text.substr(0, length)));
+    }
+    for (size_t i = 0; i + GRAM <= text.size(); ++i) {
+        result.push_back(token('t', field, text.substr(i, GRAM)));
+    }
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+}
+
+Result<std::vector<uint64_t>> BlindIndex::query(const std::string& field, const std::string& term,
+                                                BlindMatch match) const {
+    auto text = normalize(term);
+    if (text.empty()) {
+        return Result<std::vector<uint64_t>>(ErrorCode::InvalidArgument, "Search term must not be empty");
+    }
+    std::vector<uint64_t> result;
+    try {
+        switch (match) {
+            case BlindMatch::Exact:
+                result.push_back(token('e', field, text));
+                break;
+            case BlindMatch::Prefix:
+                result.push_back(token('p', field, text.substr(0, std::min(text.size(), MAX_PREFIX))));
+                break;
+            case BlindMatch::Contains:
+                if (text.size() < GRAM) {
+                    return Result<std::vector<uint64_t>>(ErrorCode::InvalidArgument,
+                                                         "Substring search needs at least 3 characters");
+                }
+                for (size_t i = 0; i + GRAM <= text.size(); ++i) {
+                    result.push_back(token('t', field, text.substr(i, GRAM)));
+                }
+                break;
+        }
+    } catch (const TCFSException& e) {
+        return Result<std::vector<uint64_t>>(e.getErrorCode(), e.getMessage());
+    }
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return Result<std::vector<uint64_t>>(std::move(result));
+}
+
+bool BlindIndex::is_exact(const std::string& term, BlindMatch match) {
+    switch (match) {
+        case BlindMatch::Exact:
+            return true;
+        case BlindMatch::Prefix:
+            return term.size() <= MAX_PREFIX;
+        case BlindMatch::Contains:
+            return term.size() == GRAM;
+    }
+    return false;
+}
+
+bool BlindIndex::matches(const std::string& value, const std::string& term, BlindMatch match) {
+    auto text = normalize(value);
+    auto needle = normalize(term);
+    switch (match) {
+        case BlindMatch::Exact:
+            return text == needle;
+        case BlindMatch::Prefix:
+            return text.compare(0, needle.size(), needle) == 0;
+        case BlindMatch::Contains:
+            return text.find(needle) != std::string::npos;
+    }
+    return false;
+}
+
+} // namespace tcfs
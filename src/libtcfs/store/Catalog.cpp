@@ -0,0 +1,983 @@
+#include "tcfs/Catalog.hpp"
+#include "tcfs/FileSync.hpp"
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+namespace tcfs {
+
+namespace {
+
+// Tokens are journaled as one hex string, 16 digits each, which is denser than a JSON number array
+std::string tokens_to_hex(const std::vector<uint64_t>& tokens) {
+    static const char* DIGITS = "0123456789abcdef";
+    std::string hex;
+    hex.reserve(tokens.size() * 16);
+    for (uint64_t token : tokens) {
+        for (int shift = 60; shift >= 0; shift -= 4) {
+            hex.push_back(DIGITS[(token >> shift) & 0xf]);
+        }
+    }
+    return hex;
+}
+
+Result<std::vector<uint64_t>> tokens_from_hex(const std::string& hex) {
+    if (hex.size() % 16 != 0) {
+        return Result<std::vector<uint64_t>>(ErrorCode::InvalidMetadata, "Invalid catalog tokens");
+    }
+    std::vector<uint64_t> tokens(hex.size() / 16, 0);
+    for (size_t i = 0; i < hex.size(); ++i) {
+        char c = hex[i];
+        int digit = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+        if (digit < 0) {
+            return Result<std::vector<uint64_t>>(ErrorCode::InvalidMetadata, "Invalid catalog tokens");
+        }
+        tokens[i / 16] = (tokens[i / 16] << 4) | static_cast<uint64_t>(digit);
+    }
+    return Result<std::vector<uint64_t>>(std::move(tokens));
+}
+
+std::string lowercase(const std::string& text) {
+    std::string result(text);
+    std::transform(result.begin(), result.end(), result.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return result;
+}
+
+} // namespace
+
+nlohmann::json CatalogEntry::to_json() const {
+    nlohmann::json json;
+    json["id"] = id;
+    json["original_filename"] = original_filename;
+    json["owner"] = owner;
+    json["label"] = label;
+    if (!notes.empty()) {
+        json["notes"] = notes;
+    }
+    json["unlock_at"] = unlock_at;
+    json["grace_seconds"] = grace_seconds;
+    json["size"] = size;
+    json["has_schedule_rules"] = has_schedule_rules;
+    json["depends_on"] = depends_on;
+    if (expire_at != 0) {
+        json["expire_at"] = expire_at;
+    }
+    json["state"] = tcfs::to_string(state);
+    if (!blind_tokens.empty()) {
+        json["tokens"] = tokens_to_hex(blind_tokens);
+    }
+    if (!group.empty()) {
+        json["group"] = group;
+    }
+    return json;
+}
+
+Result<CatalogEntry> CatalogEntry::from_json(const nlohmann::json& json) {
+    try {
+        CatalogEntry entry;
+        entry.id = json.at("id").get<std::string>();
+        entry.original_filename = json.value("original_filename", "");
+        entry.owner = json.value("owner", "");
+        entry.label = json.value("label", "");
+        entry.notes = json.value("notes", "");
+        entry.unlock_at = json.at("unlock_at").get<int64_t>();
+        entry.grace_seconds = json.value("grace_seconds", 0u);
+        entry.size = json.value("size", uint64_t{0});
+        entry.has_schedule_rules = json.value("has_schedule_rules", false);
+        entry.depends_on = json.value("depends_on", std::vector<std::string>{});
+        entry.expire_at = json.value("expire_at", int64_t{0});
+        auto state = capsule_state_from_string(json.value("state", "locked"));
+        if (!state) {
+            return Result<CatalogEntry>(ErrorCode::InvalidMetadata, state.error_message());
+        }
+        entry.state = state.value();
+        auto tokens = tokens_from_hex(json.value("tokens", ""));
+        if (!tokens) {
+            return Result<CatalogEntry>(tokens.error(), tokens.error_message());
+        }
+        entry.blind_tokens = std::move(tokens).value();
+        entry.group = json.value("group", "");
+        if (entry.id.empty()) {
+            return Result<CatalogEntry>(ErrorCode::InvalidMetadata, "Catalog entry without id");
+        }
+        return Result<CatalogEntry>(std::move(entry));
+    } catch (const nlohmann::json::exception& e) {
+        return Result<CatalogEntry>(ErrorCode::InvalidMetadata, std::string("Invalid catalog entry: ") + e.what());
+    }
+}
+
+nlohmann::json GroupEntry::to_json() const {
+    nlohmann::json json;
+    json["name"] = name;
+    json["label"] = label;
+    json["unlock_at"] = unlock_at;
+    json["grace_seconds"] = grace_seconds;
+    json["has_schedule_rules"] = has_schedule_rules;
+    if (expire_at != 0) {
+        json["expire_at"] = expire_at;
+    }
+    return json;
+}
+
+Result<GroupEntry> GroupEntry::from_json(const nlohmann::json& json) {
+    try {
+        GroupEntry group;
+        group.name = json.at("name").get<std::string>();
+        group.label = json.value("label", "");
+        group.unlock_at = json.at("unlock_at").get<int64_t>();
+        group.grace_seconds = json.value("grace_seconds", 0u);
+        group.has_schedule_rules = json.value("has_schedule_rules", false);
+        group.expire_at = json.value("expire_at", int64_t{0});
+        if (group.name.empty()) {
+            return Result<GroupEntry>(ErrorCode::InvalidMetadata, "Catalog group without name");
+        }
+        return Result<GroupEntry>(std::move(group));
+    } catch (const nlohmann::json::exception& e) {
+        return Result<GroupEntry>(ErrorCode::InvalidMetadata, std::string("Invalid catalog group: ") + e.what());
+    }
+}
+
+Result<void> Catalog::load(const fs::path& journal_path) {
+    attach(journal_path);
+    journal_offset_ = 0;
+    sequence_ = 0;
+    entries_.clear();
+    live_.clear();
+    dependents_.clear();
+    pending_dependencies_.clear();
+    slot_by_id_.clear();
+    slots_by_token_.clear();
+    text_index_.clear();
+    groups_.clear();
+    slots_by_group_.clear();
+    reset_columns();
+
+    auto replayed = refresh();
+    if (!replayed) {
+        return Result<void>(replayed.error(), replayed.error_message());
+    }
+    return Result<void>();
+}
+
+void Catalog::attach(const fs::path& journal_path) {
+    journal_path_ = journal_path;
+    seen_generation_.reset();
+    // Best effort: without the header (e.g. a read-only store) refresh reads to the end of the journal
+    (void)generation_.open(generation_path());
+}
+
+Result<CatalogChanges> Catalog::refresh() {
+    auto state = generation_.read();
+    if (!state || state->generation == 0) {
+        return replay(UINT64_MAX); // No writer has published yet (or the header is unavailable)
+    }
+    if (seen_generation_ == state->generation) {
+        return Result<CatalogChanges>(CatalogChanges{});
+    }
+    auto changes = replay(state->committed_offset);
+    if (changes) {
+        seen_generation_ = state->generation;
+    }
+    return changes;
+}
+
+Result<CatalogChanges> Catalog::replay(uint64_t limit) {
+    CatalogChanges changes;
+    std::error_code ec;
+    if (journal_path_.empty() || !fs::exists(journal_path_, ec)) {
+        return Result<CatalogChanges>(std::move(changes));
+    }
+
+    auto journal_size = fs::file_size(journal_path_, ec);
+    if (ec) {
+        return Result<CatalogChanges>(ErrorCode::FILE_ACCESS_ERROR, "Failed to stat catalog journal: " + ec.message());
+    }
+    if (journal_size < journal_offset_ || limit < journal_offset_) {
+        // Journal was rewritten behind us: start over
+        auto path = journal_path_;
+        auto reloaded = load(path);
+        if (!reloaded) {
+            return Result<CatalogChanges>(reloaded.error(), reloaded.error_message());
+        }
+        for (const auto* entry : entries()) {
+            changes.touched.push_back(entry->id);
+        }
+        return Result<CatalogChanges>(std::move(changes));
+    }
+
+    std::ifstream journal(journal_path_, std::ios::binary);
+    if (!journal) {
+        return Result<CatalogChanges>(ErrorCode::FILE_ACCESS_ERROR,
+                                      "Failed to open catalog journal: " + journal_path_.string());
+    }
+    journal.seekg(static_cast<std::streamoff>(journal_offset_));
+
+    std::string line;
+    while (std::getline(journal, line)) {
+        if (journal.eof() || journal_offset_ + line.size() + 1 > limit) {
+            // Torn trailing record without newline, or a commit not yet published: leave it for later
+            break;
+        }
+        journal_offset_ += line.size() + 1;
+        if (line.empty()) {
+            continue;
+        }
+        try {
+            auto applied = apply(nlohmann::json::parse(line), changes);
+            if (!applied) {
+                return Result<CatalogChanges>(applied.error(), applied.error_message());
+            }
+        } catch (const nlohmann::json::exception& e) {
+            return Result<CatalogChanges>(ErrorCode::InvalidMetadata,
+                                          std::string("Corrupted catalog journal record: ") + e.what());
+        }
+    }
+    return Result<CatalogChanges>(std::move(changes));
+}
+
+Result<FileLock> Catalog::lock_for_write() {
+    if (journal_path_.empty()) {
+        return Result<FileLock>(ErrorCode::InternalError, "Catalog is not attached to a journal");
+    }
+    auto lock = FileLock::exclusive(lock_path());
+    if (!lock) {
+        return lock;
+    }
+    if (!generation_.is_open()) {
+        (void)generation_.open(generation_path()); // The store directory may exist by now
+    }
+
+    auto synced = replay(UINT64_MAX);
+    if (!synced) {
+        return Result<FileLock>(synced.error(), synced.error_message());
+    }
+    // With the lock held nobody is mid-append, so a torn tail is left over from a crashed
+    // writer: cut it off before it glues itself to our record
+    std::error_code ec;
+    if (fs::exists(journal_path_, ec) && fs::file_size(journal_path_, ec) > journal_offset_ && !ec) {
+        fs::resize_file(journal_path_, journal_offset_, ec);
+        if (ec) {
+            return Result<FileLock>(ErrorCode::FILE_ACCESS_ERROR, "Failed to trim catalog journal: " + ec.message());
+        }
+    }
+    // Also publishes records a crashed writer appended but never announced
+    publish();
+    return lock;
+}
+
+void Catalog::publish() {
+    auto state = generation_.read();
+    if (!state || state->committed_offset != journal_offset_ || state->sequence != sequence_) {
+        generation_.publish(journal_offset_, sequence_);
+        state = generation_.read();
+    }
+    if (state) {
+        seen_generation_ = state->generation;
+    }
+}
+
+Result<CatalogChanges> Catalog::restore(const fs::path& journal_path, CatalogImage image) {
+    attach(journal_path);
+    journal_offset_ = image.journal_offset;
+    sequence_ = image.sequence;
+    entries_ = std::move(image.entries);
+    live_.assign(entries_.size(), true);
+    dependents_ = std::move(image.dependents);
+    pending_dependencies_ = std::move(image.pending_dependencies);
+    dependents_.resize(entries_.size());
+    pending_dependencies_.resize(entries_.size(), 0);
+    slot_by_id_.clear();
+    slot_by_id_.reserve(entries_.size());
+    slots_by_token_.clear();
+    text_index_.clear();
+    groups_.clear();
+    slots_by_group_.clear();
+    reset_columns();
+    for (auto& group : image.groups) {
+        auto name = group.name;
+        groups_.emplace(std::move(name), std::move(group));
+    }
+    for (uint32_t slot = 0; slot < entries_.size(); ++slot) {
+        slot_by_id_.emplace(entries_[slot].id, slot);
+        index_tokens(slot);
+        index_text(slot);
+        join_group(slot);
+        index_columns(slot);
+    }
+    return refresh();
+}
+
+CatalogImage Catalog::image() const {
+    CatalogImage image;
+    image.journal_offset = journal_offset_;
+    image.sequence = sequence_;
+
+    std::vector<uint32_t> compacted(entries_.size(), NO_SLOT);
+    for (size_t slot = 0; slot < entries_.size(); ++slot) {
+        if (live_[slot]) {
+            compacted[slot] = static_cast<uint32_t>(image.entries.size());
+            image.entries.push_back(entries_[slot]);
+        }
+    }
+    image.dependents.reserve(image.entries.size());
+    image.pending_dependencies.reserve(image.entries.size());
+    for (size_t slot = 0; slot < entries_.size(); ++slot) {
+        if (!live_[slot]) {
+            continue;
+        }
+        auto& dependents = image.dependents.emplace_back();
+        for (uint32_t dependent : dependents_[slot]) {
+            if (compacted[dependent] != NO_SLOT) {
+                dependents.push_back(compacted[dependent]);
+            }
+        }
+        image.pending_dependencies.push_back(pending_dependencies_[slot]);
+    }
+    for (const auto* group : groups()) {
+        image.groups.push_back(*group);
+    }
+    return image;
+}
+
+Result<void> Catalog::put(const CatalogEntry& entry) {
+    auto lock = lock_for_write();
+    if (!lock) {
+        return Result<void>(lock.error(), lock.error_message());
+    }
+
+    auto checked = check_put(entry);
+    if (!checked) {
+        return checked;
+    }
+
+    nlohmann::json record;
+    record["op"] = "put";
+    record["entry"] = entry.to_json();
+    auto committed = commit(std::move(record));
+    if (!committed) {
+        return Result<void>(committed.error(), committed.error_message());
+    }
+    return Result<void>();
+}
+
+Result<void> Catalog::put_all(const std::vector<CatalogEntry>& entries) {
+    auto lock = lock_for_write();
+    if (!lock) {
+        return Result<void>(lock.error(), lock.error_message());
+    }
+
+    std::vector<nlohmann::json> records;
+    records.reserve(entries.size());
+    for (const auto& entry : entries) {
+        auto checked = check_put(entry);
+        if (!checked) {
+            return checked;
+        }
+        nlohmann::json record;
+        record["op"] = "put";
+        record["entry"] = entry.to_json();
+        records.push_back(std::move(record));
+    }
+    if (records.empty()) {
+        return Result<void>();
+    }
+
+    auto committed = commit_all(std::move(records), true);
+    if (!committed) {
+        return Result<void>(committed.error(), committed.error_message());
+    }
+    return Result<void>();
+}
+
+Result<void> Catalog::put_transaction(const std::vector<CatalogEntry>& entries) {
+    auto lock = lock_for_write();
+    if (!lock) {
+        return Result<void>(lock.error(), lock.error_message());
+    }
+
+    nlohmann::json record;
+    record["op"] = "txn";
+    record["entries"] = nlohmann::json::array();
+    for (const auto& entry : entries) {
+        auto checked = check_put(entry);
+        if (!checked) {
+            return checked;
+        }
+        record["entries"].push_back(entry.to_json());
+    }
+    if (entries.empty()) {
+        return Result<void>();
+    }
+
+    // Durable before the caller rewrites any metadata that relies on it
+    std::vector<nlohmann::json> records;
+    records.push_back(std::move(record));
+    auto committed = commit_all(std::move(records), true);
+    if (!committed) {
+        return Result<void>(committed.error(), committed.error_message());
+    }
+    return Result<void>();
+}
+
+Result<void> Catalog::put_group(const GroupEntry& group) {
+    if (group.name.empty()) {
+        return Result<void>(ErrorCode::InvalidArgument, "Group name must not be empty");
+    }
+    auto lock = lock_for_write();
+    if (!lock) {
+        return Result<void>(lock.error(), lock.error_message());
+    }
+
+    nlohmann::json record;
+    record["op"] = "group";
+    record["group"] = group.to_json();
+    auto committed = commit(std::move(record));
+    if (!committed) {
+        return Result<void>(committed.error(), committed.error_message());
+    }
+    return Result<void>();
+}
+
+Result<void> Catalog::check_put(const CatalogEntry& entry) const {
+    if (!entry.group.empty() && groups_.count(entry.group) == 0) {
+        return Result<void>(ErrorCode::InvalidPolicy, "Unknown group: " + entry.group);
+    }
+    uint32_t existing = slot_of(entry.id);
+    for (const auto& dependency : entry.depends_on) {
+        if (dependency == entry.id) {
+            return Result<void>(ErrorCode::InvalidPolicy, "Capsule cannot depend on itself: " + entry.id);
+        }
+        uint32_t dependency_slot = slot_of(dependency);
+        if (dependency_slot == NO_SLOT) {
+            return Result<void>(ErrorCode::InvalidPolicy, "Unknown dependency: " + dependency);
+        }
+        if (existing != NO_SLOT && reaches(existing, dependency_slot)) {
+            return Result<void>(ErrorCode::InvalidPolicy, "Dependency cycle through: " + dependency);
+        }
+    }
+    return Result<void>();
+}
+
+Result<std::vector<std::string>> Catalog::mark_released(const std::string& id) {
+    auto lock = lock_for_write();
+    if (!lock) {
+        return Result<std::vector<std::string>>(lock.error(), lock.error_message());
+    }
+    uint32_t slot = slot_of(id);
+    if (slot == NO_SLOT) {
+        return Result<std::vector<std::string>>(ErrorCode::FileNotFound, "Capsule not in catalog: " + id);
+    }
+    if (entries_[slot].state == CapsuleState::Released) {
+        return Result<std::vector<std::string>>(std::vector<std::string>{});
+    }
+
+    nlohmann::json record;
+    record["op"] = "release";
+    record["id"] = id;
+    auto committed = commit(std::move(record));
+    if (!committed) {
+        return Result<std::vector<std::string>>(committed.error(), committed.error_message());
+    }
+    return Result<std::vector<std::string>>(std::move(committed.value().ready));
+}
+
+Result<std::vector<std::string>> Catalog::remove(const std::string& id) {
+    auto lock = lock_for_write();
+    if (!lock) {
+        return Result<std::vector<std::string>>(lock.error(), lock.error_message());
+    }
+    if (slot_of(id) == NO_SLOT) {
+        return Result<std::vector<std::string>>(std::vector<std::string>{});
+    }
+
+    nlohmann::json record;
+    record["op"] = "remove";
+    record["id"] = id;
+    auto committed = commit(std::move(record));
+    if (!committed) {
+        return Result<std::vector<std::string>>(committed.error(), committed.error_message());
+    }
+    return Result<std::vector<std::string>>(std::move(committed.value().ready));
+}
+
+const CatalogEntry* Catalog::find(const std::string& id) const {
+    uint32_t slot = slot_of(id);
+    return slot == NO_SLOT ? nullptr : &entries_[slot];
+}
+
+bool Catalog::dependencies_ready(const std::string& id) const {
+    uint32_t slot = slot_of(id);
+    return slot == NO_SLOT || pending_dependencies_[slot] == 0;
+}
+
+std::vector<std::string> Catalog::find_by_tokens(const std::vector<uint64_t>& tokens) const {
+    std::vector<std::string> result;
+    const std::vector<uint32_t>* rarest = nullptr;
+    for (uint64_t token : tokens) {
+        auto it = slots_by_token_.find(token);
+        if (it == slots_by_token_.end()) {
+            return result;
+        }
+        if (!rarest || it->second.size() < rarest->size()) {
+            rarest = &it->second;
+        }
+    }
+    if (!rarest) {
+        return result;
+    }
+    std::vector<uint32_t> slots(*rarest);
+    std::sort(slots.begin(), slots.end());
+    for (uint32_t slot : slots) {
+        const auto& held = entries_[slot].blind_tokens;
+        if (std::all_of(tokens.begin(), tokens.end(),
+                        [&held](uint64_t token) { return std::binary_search(held.begin(), held.end(), token); })) {
+            result.push_back(entries_[slot].id);
+        }
+    }
+    return result;
+}
+
+std::vector<std::string> Catalog::find_text(const std::string& text) const {
+    auto needle = lowercase(text);
+    return matching({needle}, [&needle](const CatalogEntry& entry) {
+        return lowercase(entry.label).find(needle) != std::string::npos ||
+               lowercase(entry.notes).find(needle) != std::string::npos ||
+               lowercase(entry.original_filename).find(needle) != std::string::npos;
+    });
+}
+
+std::vector<std::string> Catalog::find_glob(const std::string& pattern) const {
+    return matching(TrigramIndex::glob_literals(pattern), [&pattern](const CatalogEntry& entry) {
+        return TrigramIndex::glob_match(pattern, entry.original_filename);
+    });
+}
+
+std::vector<std::string> Catalog::matching(const std::vector<std::string>& literals,
+                                           const std::function<bool(const CatalogEntry&)>& accept) const {
+    std::vector<std::string> result;
+    std::optional<std::vector<uint32_t>> candidates;
+    for (const auto& literal : literals) {
+        if (literal.size() < TrigramIndex::GRAM) {
+            continue;
+        }
+        auto slots = text_index_.candidates(literal);
+        candidates = candidates ? TrigramIndex::intersect(*candidates, slots) : std::move(slots);
+        if (candidates->empty()) {
+            return result;
+        }
+    }
+    auto check = [&](uint32_t slot) {
+        if (live_[slot] && accept(entries_[slot])) {
+            result.push_back(entries_[slot].id);
+        }
+    };
+    if (candidates) {
+        for (uint32_t slot : *candidates) {
+            check(slot);
+        }
+    } else {
+        for (uint32_t slot = 0; slot < entries_.size(); ++slot) {
+            check(slot);
+        }
+    }
+    return result;
+}
+
+const GroupEntry* Catalog::find_group(const std::string& name) const {
+    auto it = groups_.find(name);
+    return it == groups_.end() ? nullptr : &it->second;
+}
+
+std::vector<const GroupEntry*> Catalog::groups() const {
+    std::vector<const GroupEntry*> result;
+    result.reserve(groups_.size());
+    for (const auto& [name, group] : groups_) {
+        result.push_back(&group);
+    }
+    std::sort(result.begin(), result.end(),
+              [](const GroupEntry* a, const GroupEntry* b) { return a->name < b->name; });
+    return result;
+}
+
+size_t Catalog::group_size(const std::string& name) const {
+    auto it = slots_by_group_.find(name);
+    return it == slots_by_group_.end() ? 0 : it->second.size();
+}
+
+std::vector<std::string> Catalog::group_members(const std::string& name) const {
+    std::vector<std::string> result;
+    auto it = slots_by_group_.find(name);
+    if (it == slots_by_group_.end()) {
+        return result;
+    }
+    auto slots = it->second;
+    std::sort(slots.begin(), slots.end());
+    result.reserve(slots.size());
+    for (uint32_t slot : slots) {
+        result.push_back(entries_[slot].id);
+    }
+    return result;
+}
+
+std::vector<std::string> Catalog::dependents(const std::string& id) const {
+    std::vector<std::string> result;
+    uint32_t slot = slot_of(id);
+    if (slot == NO_SLOT) {
+        return result;
+    }
+    for (uint32_t dependent : dependents_[slot]) {
+        result.push_back(entries_[dependent].id);
+    }
+    return result;
+}
+
+std::vector<const CatalogEntry*> Catalog::entries() const {
+    std::vector<const CatalogEntry*> result;
+    result.reserve(slot_by_id_.size());
+    for (size_t slot = 0; slot < entries_.size(); ++slot) {
+        if (live_[slot]) {
+            result.push_back(&entries_[slot]);
+        }
+    }
+    return result;
+}
+
+uint32_t Catalog::slot_of(const std::string& id) const {
+    auto it = slot_by_id_.find(id);
+    return it == slot_by_id_.end() ? NO_SLOT : it->second;
+}
+
+bool Catalog::reaches(uint32_t from, uint32_t target) const {
+    std::vector<uint32_t> stack{from};
+    std::vector<bool> visited(entries_.size(), false);
+    while (!stack.empty()) {
+        uint32_t slot = stack.back();
+        stack.pop_back();
+        if (slot == target) {
+            return true;
+        }
+        if (visited[slot]) {
+            continue;
+        }
+        visited[slot] = true;
+        for (uint32_t next : dependents_[slot]) {
+            stack.push_back(next);
+        }
+    }
+    return false;
+}
+
+Result<CatalogChanges> Catalog::commit(nlohmann::json record) {
+    std::vector<nlohmann::json> records;
+    records.push_back(std::move(record));
+    return commit_all(std::move(records), false);
+}
+
+Result<CatalogChanges> Catalog::commit_all(std::vector<nlohmann::json> records, bool sync) {
+    if (journal_path_.empty()) {
+        return Result<CatalogChanges>(ErrorCode::InternalError, "Catalog is not attached to a journal");
+    }
+    std::string lines;
+    for (size_t i = 0; i < records.size(); ++i) {
+        records[i]["seq"] = sequence_ + 1 + i;
+        lines += records[i].dump(-1, ' ', false, nlohmann::json::error_handler_t::replace) + "\n";
+    }
+
+    std::ofstream journal(journal_path_, std::ios::binary | std::ios::app);
+    if (!journal) {
+        return Result<CatalogChanges>(ErrorCode::FILE_ACCESS_ERROR,
+                                      "Failed to open catalog journal: " + journal_path_.string());
+    }
+    // One write per commit so concurrent appenders never interleave within a line
+    journal.write(lines.data(), static_cast<std::streamsize>(lines.size()));
+    journal.flush();
+    if (!journal) {
+        return Result<CatalogChanges>(ErrorCode::FILE_ACCESS_ERROR, "Failed to append to catalog journal");
+    }
+    journal.close();
+    if (sync && !sync_path(journal_path_)) {
+        return Result<CatalogChanges>(ErrorCode::FILE_ACCESS_ERROR, "Failed to sync catalog journal");
+    }
+
+    // The journal lock is held, so replaying applies exactly our records; then readers may see them
+    auto changes = replay(UINT64_MAX);
+    if (changes) {
+        publish();
+    }
+    return changes;
+}
+
+Result<void> Catalog::apply(const nlohmann::json& record, CatalogChanges& changes) {
+    ++sequence_;
+
+    const auto op = record.value("op", "");
+    if (op == "put") {
+        auto entry = CatalogEntry::from_json(record.at("entry"));
+        if (!entry) {
+            return Result<void>(entry.error(), entry.error_message());
+        }
+        changes.touched.push_back(entry.value().id);
+        if (slot_of(entry.value().id) == NO_SLOT) {
+            changes.added.push_back(entry.value().id);
+        }
+        apply_put(entry.value());
+        return Result<void>();
+    }
+    if (op == "txn") {
+        // Parse every entry before applying any, so a bad record changes nothing
+        std::vector<CatalogEntry> entries;
+        for (const auto& json : record.at("entries")) {
+            auto entry = CatalogEntry::from_json(json);
+            if (!entry) {
+                return Result<void>(entry.error(), entry.error_message());
+            }
+            entries.push_back(std::move(entry).value());
+        }
+        for (const auto& entry : entries) {
+            changes.touched.push_back(entry.id);
+            if (slot_of(entry.id) == NO_SLOT) {
+                changes.added.push_back(entry.id);
+            }
+            apply_put(entry);
+        }
+        return Result<void>();
+    }
+    if (op == "group") {
+        auto group = GroupEntry::from_json(record.at("group"));
+        if (!group) {
+            return Result<void>(group.error(), group.error_message());
+        }
+        auto moved = apply_group(group.value());
+        changes.touched.insert(changes.touched.end(), moved.begin(), moved.end());
+        return Result<void>();
+    }
+
+    const auto id = record.value("id", "");
+    uint32_t slot = slot_of(id);
+    if (slot == NO_SLOT) {
+        return Result<void>(); // Refers to a capsule removed earlier in the journal
+    }
+    changes.touched.push_back(id);
+
+    std::vector<std::string> ready;
+    if (op == "release") {
+        ready = apply_release(slot);
+    } else if (op == "remove") {
+        ready = apply_remove(slot);
+    } else {
+        return Result<void>(ErrorCode::InvalidMetadata, "Unknown catalog journal operation: " + op);
+    }
+    changes.ready.insert(changes.ready.end(), ready.begin(), ready.end());
+    return Result<void>();
+}
+
+void Catalog::index_tokens(uint32_t slot) {
+    for (uint64_t token : entries_[slot].blind_tokens) {
+        slots_by_token_[token].push_back(slot);
+    }
+}
+
+void Catalog::unindex_tokens(uint32_t slot) {
+    for (uint64_t token : entries_[slot].blind_tokens) {
+        auto it = slots_by_token_.find(token);
+        if (it == slots_by_token_.end()) {
+            continue;
+        }
+        auto& list = it->second;
+        list.erase(std::remove(list.begin(), list.end(), slot), list.end());
+        if (list.empty()) {
+            slots_by_token_.erase(it);
+        }
+    }
+}
+
+void Catalog::index_text(uint32_t slot) {
+    const auto& entry = entries_[slot];
+    text_index_.add(slot, entry.label);
+    text_index_.add(slot, entry.notes);
+    text_index_.add(slot, entry.original_filename);
+}
+
+void Catalog::index_columns(uint32_t slot) {
+    auto intern = [](std::vector<std::string>& names, std::unordered_map<std::string, uint32_t>& ids,
+                     const std::string& name) {
+        if (name.empty()) {
+            return uint32_t{0};
+        }
+        auto [it, inserted] = ids.emplace(name, static_cast<uint32_t>(names.size()));
+        if (inserted) {
+            names.push_back(name);
+        }
+        return it->second;
+    };
+    if (columns_.flags.size() <= slot) {
+        columns_.unlock_at.resize(slot + 1);
+        columns_.size.resize(slot + 1);
+        columns_.label.resize(slot + 1);
+        columns_.owner.resize(slot + 1);
+        columns_.flags.resize(slot + 1);
+    }
+    const auto& entry = entries_[slot];
+    columns_.unlock_at[slot] = entry.unlock_at;
+    columns_.size[slot] = entry.size;
+    columns_.label[slot] = intern(columns_.labels, label_ids_, entry.label);
+    columns_.owner[slot] = intern(columns_.owners, owner_ids_, entry.owner);
+    columns_.flags[slot] = static_cast<uint8_t>(
+        (live_[slot] ? CatalogColumns::LIVE : 0) | (entry.state == CapsuleState::Locked ? CatalogColumns::LOCKED : 0));
+}
+
+void Catalog::reset_columns() {
+    columns_ = CatalogColumns();
+    label_ids_.clear();
+    owner_ids_.clear();
+}
+
+void Catalog::join_group(uint32_t slot) {
+    auto& entry = entries_[slot];
+    auto it = groups_.find(entry.group);
+    if (entry.group.empty() || it == groups_.end()) {
+        return;
+    }
+    // The group record, not the member, is authoritative for the schedule
+    entry.unlock_at = it->second.unlock_at;
+    entry.expire_at = it->second.expire_at;
+    entry.grace_seconds = it->second.grace_seconds;
+    entry.has_schedule_rules = it->second.has_schedule_rules;
+    slots_by_group_[entry.group].push_back(slot);
+}
+
+void Catalog::leave_group(uint32_t slot) {
+    auto it = slots_by_group_.find(entries_[slot].group);
+    if (it == slots_by_group_.end()) {
+        return;
+    }
+    auto& list = it->second;
+    list.erase(std::remove(list.begin(), list.end(), slot), list.end());
+    if (list.empty()) {
+        slots_by_group_.erase(it);
+    }
+}
+
+std::vector<std::string> Catalog::apply_group(const GroupEntry& group) {
+    groups_[group.name] = group;
+    std::vector<std::string> moved;
+    auto it = slots_by_group_.find(group.name);
+    if (it == slots_by_group_.end()) {
+        return moved;
+    }
+    // Members share the schedule; this only refreshes the in-memory copies
+    moved.reserve(it->second.size());
+    for (uint32_t slot : it->second) {
+        auto& entry = entries_[slot];
+        entry.unlock_at = group.unlock_at;
+        entry.expire_at = group.expire_at;
+        entry.grace_seconds = group.grace_seconds;
+        entry.has_schedule_rules = group.has_schedule_rules;
+        columns_.unlock_at[slot] = group.unlock_at;
+        moved.push_back(entry.id);
+    }
+    return moved;
+}
+
+void Catalog::apply_put(const CatalogEntry& entry) {
+    uint32_t slot = slot_of(entry.id);
+    if (slot == NO_SLOT) {
+        slot = static_cast<uint32_t>(entries_.size());
+        entries_.push_back(entry);
+        live_.push_back(true);
+        dependents_.emplace_back();
+        pending_dependencies_.push_back(0);
+        slot_by_id_.emplace(entry.id, slot);
+    } else {
+        unindex_tokens(slot);
+        leave_group(slot);
+        // Drop the edges of the previous version before adding the new ones
+        for (const auto& dependency : entries_[slot].depends_on) {
+            uint32_t dependency_slot = slot_of(dependency);
+            if (dependency_slot != NO_SLOT) {
+                auto& list = dependents_[dependency_slot];
+                list.erase(std::remove(list.begin(), list.end(), slot), list.end());
+            }
+        }
+        entries_[slot] = entry;
+        pending_dependencies_[slot] = 0;
+    }
+    index_tokens(slot);
+    index_text(slot);
+    join_group(slot);
+    index_columns(slot);
+
+    for (const auto& dependency : entry.depends_on) {
+        uint32_t dependency_slot = slot_of(dependency);
+        if (dependency_slot == NO_SLOT) {
+            continue; // Dependency removed since: treated as satisfied
+        }
+        dependents_[dependency_slot].push_back(slot);
+        if (entries_[dependency_slot].state != CapsuleState::Released) {
+            ++pending_dependencies_[slot];
+        }
+    }
+}
+
+std::vector<std::string> Catalog::apply_release(uint32_t slot) {
+    std::vector<std::string> ready;
+    if (entries_[slot].state == CapsuleState::Released) {
+        return ready;
+    }
+    entries_[slot].state = CapsuleState::Released;
+    columns_.flags[slot] &= static_cast<uint8_t>(~CatalogColumns::LOCKED);
+    for (uint32_t dependent : dependents_[slot]) {
+        if (pending_dependencies_[dependent] > 0 && --pending_dependencies_[dependent] == 0 &&
+            entries_[dependent].state == CapsuleState::Locked) {
+            ready.push_back(entries_[dependent].id);
+        }
+    }
+    return ready;
+}
+
+std::vector<std::string> Catalog::apply_remove(uint32_t slot) {
+    // A capsule that disappears no longer blocks anything
+    auto ready = apply_release(slot);
+
+    for (const auto& dependency : entries_[slot].depends_on) {
+        uint32_t dependency_slot = slot_of(dependency);
+        if (dependency_slot != NO_SLOT) {
+            auto& list = dependents_[dependency_slot];
+            list.erase(std::remove(list.begin(), list.end(), slot), list.end());
+        }
+    }
+    unindex_tokens(slot);
+    leave_group(slot);
+    slot_by_id_.erase(entries_[slot].id);
+    live_[slot] = false;
+    columns_.flags[slot] = 0;
+    dependents_[slot].clear();
+    pending_dependencies_[slot] = 0;
+    return ready;
+}
+
+std::string to_string(CapsuleState state) {
+    switch (state) {
+        case CapsuleState::Locked:
+            return "locked";
+        case CapsuleState::Released:
+            return "released";
+        default:
+            return "unknown";
+    }
+}
+
+Result<CapsuleState> capsule_state_from_string(const std::string& str) {
+    if (str == "locked") {
+        return Result<CapsuleState>(CapsuleState::Locked);
+    }
+    if (str == "released") {
+        return Result<CapsuleState>(CapsuleState::Released);
+    }
+    return Result<CapsuleState>(ErrorCode::InvalidArgument, "Unknown capsule state: " + str);
+}
+
+} // namespace tcfs
@@ -0,0 +1,176 @@
+#include "tcfs/CatalogQuery.hpp"
+#include "tcfs/Policy.hpp"
+#include "tcfs/TrigramIndex.hpp"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+
+namespace tcfs {
+
+namespace {
+
+std::string lowercase(const std::string& text) {
+    std::string result(text);
+    std::transform(result.begin(), result.end(), result.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return result;
+}
+
+std::string trim(const std::string& text) {
+    auto begin = text.find_first_not_of(" \t");
+    auto end = text.find_last_not_of(" \t");
+    return begin == std::string::npos ? std::string() : text.substr(begin, end - begin + 1);
+}
+
+bool is_time_field(const std::string& field) {
+    return field == "unlock" || field == "expire";
+}
+
+} // namespace
+
+Result<CatalogQuery> CatalogQuery::parse(const std::string& text) {
+    CatalogQuery query;
+    size_t start = 0;
+    while (start <= text.size()) {
+        auto comma = text.find(',', start);
+        auto part = trim(text.substr(start, comma == std::string::npos ? std::string::npos : comma - start));
+        start = comma == std::string::npos ? text.size() + 1 : comma + 1;
+        if (part.empty()) {
+            continue;
+        }
+
+        auto at = part.find_first_of("!<>~=");
+        if (at == std::string::npos || at == 0) {
+            return Result<CatalogQuery>(ErrorCode::InvalidArgument, "Filter term needs FIELD OP VALUE: " + part);
+        }
+        Term term;
+        term.field = trim(part.substr(0, at));
+        auto two = part.substr(at, 2);
+        size_t op_length = 1;
+        if (two == "!=") {
+            term.op = Op::NotEqual;
+            op_length = 2;
+        } else if (two == "<=") {
+            term.op = Op::LessEqual;
+            op_length = 2;
+        } else if (two == ">=") {
+            term.op = Op::GreaterEqual;
+            op_length = 2;
+        } else if (part[at] == '~') {
+            term.op = Op::Contains;
+        } else if (part[at] == '=') {
+            term.op = Op::Equal;
+        } else if (part[at] == '<') {
+            term.op = Op::Less;
+        } else if (part[at] == '>') {
+            term.op = Op::Greater;
+        } else {
+            return Result<CatalogQuery>(ErrorCode::InvalidArgument, "Unknown operator in filter term: " + part);
+        }
+        term.value = trim(part.substr(at + op_length));
+
+        if (is_time_field(term.field)) {
+            if (term.op == Op::Contains || term.op == Op::NotEqual || term.op == Op::Equal) {
+                return Result<CatalogQuery>(ErrorCode::InvalidArgument, term.field + " takes <, <=, > or >=: " + part);
+            }
+            auto time = time_utils::parse_rfc3339(term.value);
+            if (!time) {
+                return Result<CatalogQuery>(ErrorCode::InvalidArgument, "Invalid time in filter term: " + part);
+            }
+            term.time = static_cast<int64_t>(std::chrono::system_clock::to_time_t(time.value()));
+        } else if (term.field == "state") {
+            if (term.op != Op::Equal || (term.value != "locked" && term.value != "released")) {
+                return Result<CatalogQuery>(ErrorCode::InvalidArgument, "state takes =locked or =released: " + part);
+            }
+        } else if (term.field == "id" || term.field == "name" || term.field == "label" || term.field == "notes" ||
+                   term.field == "owner" || term.field == "group") {
+            if (term.op != Op::Equal && term.op != Op::NotEqual && term.op != Op::Contains) {
+                return Result<CatalogQuery>(ErrorCode::InvalidArgument, term.field + " takes =, != or ~: " + part);
+            }
+            if (term.op == Op::Contains) {
+                term.value = lowercase(term.value);
+            }
+        } else {
+            return Result<CatalogQuery>(ErrorCode::InvalidArgument, "Unknown filter field: " + term.field);
+        }
+        query.terms_.push_back(std::move(term));
+    }
+    return Result<CatalogQuery>(std::move(query));
+}
+
+const std::string* CatalogQuery::text_field(const CatalogEntry& entry, const std::string& field) {
+    if (field == "id") {
+        return &entry.id;
+    } else if (field == "name") {
+        return &entry.original_filename;
+    } else if (field == "label") {
+        return &entry.label;
+    } else if (field == "notes") {
+        return &entry.notes;
+    } else if (field == "owner") {
+        return &entry.owner;
+    } else if (field == "group") {
+        return &entry.group;
+    }
+    return nullptr;
+}
+
+bool CatalogQuery::matches(const CatalogEntry& entry) const {
+    for (const auto& term : terms_) {
+        if (is_time_field(term.field)) {
+            int64_t value = term.field == "unlock" ? entry.unlock_at : entry.expire_at;
+            if (term.field == "expire" && value == 0) {
+                return false; // Never expires: no expiry time to compare
+            }
+            bool holds = term.op == Op::Less        ? value < term.time
+                         : term.op == Op::LessEqual ? value <= term.time
+                         : term.op == Op::Greater   ? value > term.time
+                                                    : value >= term.time;
+            if (!holds) {
+                return false;
+            }
+            continue;
+        }
+        if (term.field == "state") {
+            if ((entry.state == CapsuleState::Released) != (term.value == "released")) {
+                return false;
+            }
+            continue;
+        }
+
+        const auto& value = *text_field(entry, term.field);
+        bool equal = term.field == "name" ? TrigramIndex::glob_match(term.value, value) : value == term.value;
+        bool holds = term.op == Op::Equal      ? equal
+                     : term.op == Op::NotEqual ? !equal
+                                               : lowercase(value).find(term.value) != std::string::npos;
+        if (!holds) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::vector<const CatalogEntry*> CatalogQuery::select(const Catalog& catalog) const {
+    std::vector<const CatalogEntry*> result;
+    auto narrowing = std::find_if(terms_.begin(), terms_.end(), [](const Term& term) {
+        return term.op == Op::Contains && term.value.size() >= TrigramIndex::GRAM &&
+               (term.field == "label" || term.field == "notes" || term.field == "name");
+    });
+    if (narrowing != terms_.end()) {
+        for (const auto& id : catalog.find_text(narrowing->value)) {
+            const auto* entry = catalog.find(id);
+            if (entry && matches(*entry)) {
+                result.push_back(entry);
+            }
+        }
+        return result;
+    }
+    for (const auto* entry : catalog.entries()) {
+        if (matches(*entry)) {
+            result.push_back(entry);
+        }
+    }
+    return result;
+}
+
+} // namespace tcfs
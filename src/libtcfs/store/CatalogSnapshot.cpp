@@ -0,0 +1,449 @@
+#include "tcfs/CatalogSnapshot.hpp"
+#include "tcfs/FileSync.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace tcfs {
+
+namespace {
+
+constexpr char MAGIC[8] = {'T', 'C', 'F', 'S', 'S', 'N', 'A', 'P'};
+constexpr uint64_t BYTE_ORDER_MARK = 0x0102030405060708ULL;
+constexpr uint64_t JOURNAL_TAIL_BYTES = 4096;
+constexpr int64_t NOT_SCHEDULED = std::numeric_limits<int64_t>::min();
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint64_t byte_order;
+    uint64_t journal_offset;
+    uint64_t journal_sequence;
+    uint64_t journal_tail_hash;
+    uint64_t entry_count;
+    uint64_t dependent_count;   // uint32_t entry indices
+    uint64_t dependency_count;  // StringRefs naming depends_on ids
+    uint64_t token_count;       // uint64_t blind-index tokens
+    uint64_t group_count;       // GroupRecords
+    uint64_t heap_size;
+    uint64_t payload_size;
+    uint64_t payload_hash;
+};
+
+struct StringRef {
+    uint64_t offset;
+    uint64_t length;
+};
+
+// Fixed-size so the record array can be indexed in place
+struct EntryRecord {
+    StringRef id;
+    StringRef original_filename;
+    StringRef owner;
+    StringRef label;
+    StringRef notes;
+    StringRef group;
+    int64_t unlock_at;
+    int64_t expire_at;
+    uint64_t size;
+    int64_t due_ns;             // NOT_SCHEDULED if the scheduler has no entry
+    uint32_t grace_seconds;
+    uint32_t pending_dependencies;
+    uint32_t dependencies_first;
+    uint32_t dependencies_count;
+    uint32_t dependents_first;
+    uint32_t dependents_count;
+    uint8_t state;
+    uint8_t has_schedule_rules;
+    uint8_t reserved[2];
+    uint32_t tokens_count;
+    uint64_t tokens_first;
+};
+
+struct GroupRecord {
+    StringRef name;
+    StringRef label;
+    int64_t unlock_at;
+    int64_t expire_at;
+    uint32_t grace_seconds;
+    uint8_t has_schedule_rules;
+    uint8_t reserved[3];
+};
+
+static_assert(sizeof(Header) == 112, "snapshot header layout");
+static_assert(sizeof(EntryRecord) == 168, "snapshot record layout");
+static_assert(sizeof(GroupRecord) == 56, "snapshot group layout");
+
+uint64_t padded(uint64_t size) {
+    return (size + 7) & ~uint64_t{7};
+}
+
+/**
+ * @brief FNV-1a over 8-byte words, with a fold so high bits reach low ones
+ */
+uint64_t hash_bytes(const char* data, size_t size) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + i, sizeof(word));
+        hash = (hash ^ word) * 0x100000001b3ULL;
+        hash ^= hash >> 32;
+    }
+    for (; i < size; ++i) {
+        hash = (hash ^ static_cast<unsigned char>(data[i])) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+Result<uint64_t> journal_tail_hash(const fs::path& journal_path, uint64_t offset) {
+    if (offset == 0) {
+        return Result<uint64_t>(hash_bytes(nullptr, 0));
+    }
+    std::error_code ec;
+    auto size = fs::file_size(journal_path, ec);
+    if (ec || size < offset) {
+        return Result<uint64_t>(ErrorCode::CorruptedData, "Catalog journal is shorter than the snapshot");
+    }
+    auto length = std::min(offset, JOURNAL_TAIL_BYTES);
+    std::string tail(length, '\0');
+    std::ifstream journal(journal_path, std::ios::binary);
+    journal.seekg(static_cast<std::streamoff>(offset - length));
+    journal.read(tail.data(), static_cast<std::streamsize>(length));
+    if (!journal) {
+        return Result<uint64_t>(ErrorCode::FILE_ACCESS_ERROR, "Failed to read catalog journal: " + journal_path.string());
+    }
+    return Result<uint64_t>(hash_bytes(tail.data(), tail.size()));
+}
+
+/**
+ * @brief Read-only view of a whole file: mmap where available, a buffer elsewhere
+ */
+class MappedFile {
+public:
+    ~MappedFile() {
+#ifndef _WIN32
+        if (mapped_) {
+            ::munmap(mapped_, size_);
+        }
+#endif
+    }
+
+    Result<void> open(const fs::path& path) {
+#ifndef _WIN32
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return Result<void>(ErrorCode::FileNotFound, "Cannot open snapshot: " + path.string());
+        }
+        struct stat info{};
+        if (::fstat(fd, &info) != 0) {
+            ::close(fd);
+            return Result<void>(ErrorCode::FILE_ACCESS_ERROR, "Cannot stat snapshot: " + path.string());
+        }
+        size_ = static_cast<size_t>(info.st_size);
+        if (size_ != 0) {
+            void* mapped = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped == MAP_FAILED) {
+                ::close(fd);
+                return Result<void>(ErrorCode::FILE_ACCESS_ERROR, "Cannot map snapshot: " + path.string());
+            }
+            mapped_ = mapped;
+            ::madvise(mapped_, size_, MADV_SEQUENTIAL);
+        }
+        ::close(fd);
+        data_ = static_cast<const char*>(mapped_);
+#else
+        std::ifstream input(path, std::ios::binary);
+        if (!input) {
+            return Result<void>(ErrorCode::FileNotFound, "Cannot open snapshot: " + path.string());
+        }
+        buffer_.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+        data_ = buffer_.data();
+        size_ = buffer_.size();
+#endif
+        return Result<void>();
+    }
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+#ifndef _WIN32
+    void* mapped_ = nullptr;
+#else
+    std::vector<char> buffer_;
+#endif
+};
+
+} // namespace
+
+Result<void> CatalogSnapshot::save(const fs::path& path, const CatalogImage& catalog, const UnlockScheduler& scheduler,
+                                   const fs::path& journal_path) {
+    auto tail_hash = journal_tail_hash(journal_path, catalog.journal_offset);
+    if (!tail_hash) {
+        return Result<void>(tail_hash.error(), tail_hash.error_message());
+    }
+
+    std::vector<EntryRecord> records;
+    std::vector<uint32_t> dependents;
+    std::vector<StringRef> dependencies;
+    std::vector<uint64_t> tokens;
+    std::vector<GroupRecord> groups;
+    std::string heap;
+    records.reserve(catalog.entries.size());
+    auto intern = [&heap](const std::string& value) {
+        StringRef ref{heap.size(), value.size()};
+        heap += value;
+        return ref;
+    };
+
+    for (size_t i = 0; i < catalog.entries.size(); ++i) {
+        const auto& entry = catalog.entries[i];
+        EntryRecord record{};
+        record.id = intern(entry.id);
+        record.original_filename = intern(entry.original_filename);
+        record.owner = intern(entry.owner);
+        record.label = intern(entry.label);
+        record.notes = intern(entry.notes);
+        record.group = intern(entry.group);
+        record.unlock_at = entry.unlock_at;
+        record.expire_at = entry.expire_at;
+        record.size = entry.size;
+        auto due = scheduler.due_time(entry.id);
+        record.due_ns = due ? std::chrono::duration_cast<std::chrono::nanoseconds>(due->time_since_epoch()).count()
+                            : NOT_SCHEDULED;
+        record.grace_seconds = entry.grace_seconds;
+        record.pending_dependencies = i < catalog.pending_dependencies.size() ? catalog.pending_dependencies[i] : 0;
+        record.dependencies_first = static_cast<uint32_t>(dependencies.size());
+        record.dependencies_count = static_cast<uint32_t>(entry.depends_on.size());
+        for (const auto& dependency : entry.depends_on) {
+            dependencies.push_back(intern(dependency));
+        }
+        record.dependents_first = static_cast<uint32_t>(dependents.size());
+        if (i < catalog.dependents.size()) {
+            record.dependents_count = static_cast<uint32_t>(catalog.dependents[i].size());
+            dependents.insert(dependents.end(), catalog.dependents[i].begin(), catalog.dependents[i].end());
+        }
+        record.state = static_cast<uint8_t>(entry.state == CapsuleState::Released ? 1 : 0);
+        record.has_schedule_rules = entry.has_schedule_rules ? 1 : 0;
+        record.tokens_first = tokens.size();
+        record.tokens_count = static_cast<uint32_t>(entry.blind_tokens.size());
+        tokens.insert(tokens.end(), entry.blind_tokens.begin(), entry.blind_tokens.end());
+        records.push_back(record);
+    }
+    for (const auto& group : catalog.groups) {
+        GroupRecord record{};
+        record.name = intern(group.name);
+        record.label = intern(group.label);
+        record.unlock_at = group.unlock_at;
+        record.expire_at = group.expire_at;
+        record.grace_seconds = group.grace_seconds;
+        record.has_schedule_rules = group.has_schedule_rules ? 1 : 0;
+        groups.push_back(record);
+    }
+
+    // Sections are 8-byte aligned so a mapped file can be read in place
+    std::string payload;
+    payload.append(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(EntryRecord));
+    payload.append(reinterpret_cast<const char*>(dependents.data()), dependents.size() * sizeof(uint32_t));
+    payload.resize(padded(payload.size()), '\0');
+    payload.append(reinterpret_cast<const char*>(dependencies.data()), dependencies.size() * sizeof(StringRef));
+    payload.append(reinterpret_cast<const char*>(tokens.data()), tokens.size() * sizeof(uint64_t));
+    payload.append(reinterpret_cast<const char*>(groups.data()), groups.size() * sizeof(GroupRecord));
+    payload += heap;
+
+    Header header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.header_size = sizeof(Header);
+    header.byte_order = BYTE_ORDER_MARK;
+    header.journal_offset = catalog.journal_offset;
+    header.journal_sequence = catalog.sequence;
+    header.journal_tail_hash = tail_hash.value();
+    header.entry_count = records.size();
+    header.dependent_count = dependents.size();
+    header.dependency_count = dependencies.size();
+    header.token_count = tokens.size();
+    header.group_count = groups.size();
+    header.heap_size = heap.size();
+    header.payload_size = payload.size();
+    header.payload_hash = hash_bytes(payload.data(), payload.size());
+
+    auto temp = path;
+    temp += ".tmp";
+    {
+        std::ofstream output(temp, std::ios::binary | std::ios::trunc);
+        output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        output.write(payload.data(), static_cast<std::streamsize>(payload.size()));
+        output.close();
+        if (!output) {
+            std::error_code ec;
+            fs::remove(temp, ec);
+            return Result<void>(ErrorCode::FILE_ACCESS_ERROR, "Failed to write snapshot: " + temp.string());
+        }
+    }
+    std::error_code ec;
+    if (sync_path(temp)) {
+        fs::rename(temp, path, ec);
+    } else {
+        ec = std::make_error_code(std::errc::io_error);
+    }
+    if (ec) {
+        std::error_code ignored;
+        fs::remove(temp, ignored);
+        return Result<void>(ErrorCode::FILE_ACCESS_ERROR, "Failed to install snapshot: " + path.string());
+    }
+    sync_path(path.has_parent_path() ? path.parent_path() : fs::path("."));
+    return Result<void>();
+}
+
+Result<SnapshotContents> CatalogSnapshot::load(const fs::path& path, const fs::path& journal_path) {
+    MappedFile file;
+    auto opened = file.open(path);
+    if (!opened) {
+        return Result<SnapshotContents>(opened.error(), opened.error_message());
+    }
+
+    auto corrupt = [&path](const std::string& why) {
+        return Result<SnapshotContents>(ErrorCode::CorruptedData, "Snapshot " + path.string() + " rejected: " + why);
+    };
+    Header header{};
+    if (file.size() < sizeof(Header)) {
+        return corrupt("truncated header");
+    }
+    std::memcpy(&header, file.data(), sizeof(Header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION ||
+        header.header_size != sizeof(Header) || header.byte_order != BYTE_ORDER_MARK) {
+        return corrupt("unknown format");
+    }
+
+    // Section sizes, checked against the file before any multiplication can overflow
+    const uint64_t available = file.size() - sizeof(Header);
+    if (header.payload_size != available || header.entry_count > available / sizeof(EntryRecord) ||
+        header.dependent_count > available / sizeof(uint32_t) ||
+        header.dependency_count > available / sizeof(StringRef) || header.token_count > available / sizeof(uint64_t) ||
+        header.group_count > available / sizeof(GroupRecord) || header.heap_size > available) {
+        return corrupt("size mismatch");
+    }
+    const uint64_t dependents_at = header.entry_count * sizeof(EntryRecord);
+    const uint64_t dependencies_at = padded(dependents_at + header.dependent_count * sizeof(uint32_t));
+    const uint64_t tokens_at = dependencies_at + header.dependency_count * sizeof(StringRef);
+    const uint64_t groups_at = tokens_at + header.token_count * sizeof(uint64_t);
+    const uint64_t heap_at = groups_at + header.group_count * sizeof(GroupRecord);
+    if (heap_at + header.heap_size != header.payload_size) {
+        return corrupt("size mismatch");
+    }
+
+    const char* payload = file.data() + sizeof(Header);
+    if (hash_bytes(payload, header.payload_size) != header.payload_hash) {
+        return corrupt("checksum mismatch");
+    }
+    auto tail_hash = journal_tail_hash(journal_path, header.journal_offset);
+    if (!tail_hash || tail_hash.value() != header.journal_tail_hash) {
+        return corrupt("catalog journal was rewritten since it was taken");
+    }
+
+    const char* heap = payload + heap_at;
+    bool valid = true;
+    auto string_at = [&](const StringRef& ref) {
+        if (ref.offset > header.heap_size || ref.length > header.heap_size - ref.offset) {
+            valid = false;
+            return std::string();
+        }
+        return std::string(heap + ref.offset, static_cast<size_t>(ref.length));
+    };
+
+    SnapshotContents contents;
+    auto& image = contents.catalog;
+    image.journal_offset = header.journal_offset;
+    image.sequence = header.journal_sequence;
+    const auto count = static_cast<size_t>(header.entry_count);
+    image.entries.resize(count);
+    image.dependents.resize(count);
+    image.pending_dependencies.resize(count);
+
+    for (size_t i = 0; i < count && valid; ++i) {
+        EntryRecord record;
+        std::memcpy(&record, payload + i * sizeof(EntryRecord), sizeof(record));
+        if (uint64_t{record.dependencies_first} + record.dependencies_count > header.dependency_count ||
+            uint64_t{record.dependents_first} + record.dependents_count > header.dependent_count ||
+            record.tokens_first > header.token_count || record.tokens_count > header.token_count - record.tokens_first ||
+            record.state > 1) {
+            return corrupt("record " + std::to_string(i) + " out of range");
+        }
+
+        auto& entry = image.entries[i];
+        entry.id = string_at(record.id);
+        entry.original_filename = string_at(record.original_filename);
+        entry.owner = string_at(record.owner);
+        entry.label = string_at(record.label);
+        entry.notes = string_at(record.notes);
+        entry.group = string_at(record.group);
+        entry.unlock_at = record.unlock_at;
+        entry.expire_at = record.expire_at;
+        entry.size = record.size;
+        entry.grace_seconds = record.grace_seconds;
+        entry.has_schedule_rules = record.has_schedule_rules != 0;
+        entry.state = record.state == 1 ? CapsuleState::Released : CapsuleState::Locked;
+        entry.blind_tokens.resize(record.tokens_count);
+        std::memcpy(entry.blind_tokens.data(), payload + tokens_at + record.tokens_first * sizeof(uint64_t),
+                    record.tokens_count * sizeof(uint64_t));
+        entry.depends_on.reserve(record.dependencies_count);
+        for (uint32_t d = 0; d < record.dependencies_count; ++d) {
+            StringRef ref;
+            std::memcpy(&ref, payload + dependencies_at + (uint64_t{record.dependencies_first} + d) * sizeof(StringRef),
+                        sizeof(ref));
+            entry.depends_on.push_back(string_at(ref));
+        }
+
+        auto& dependents = image.dependents[i];
+        dependents.resize(record.dependents_count);
+        std::memcpy(dependents.data(), payload + dependents_at + uint64_t{record.dependents_first} * sizeof(uint32_t),
+                    record.dependents_count * sizeof(uint32_t));
+        for (auto dependent : dependents) {
+            if (dependent >= count) {
+                return corrupt("record " + std::to_string(i) + " out of range");
+            }
+        }
+        image.pending_dependencies[i] = record.pending_dependencies;
+
+        if (record.due_ns != NOT_SCHEDULED) {
+            auto due = std::chrono::duration_cast<UnlockScheduler::TimePoint::duration>(
+                std::chrono::nanoseconds(record.due_ns));
+            contents.schedule.push_back({entry.id, UnlockScheduler::TimePoint(due)});
+        }
+    }
+    for (size_t i = 0; i < static_cast<size_t>(header.group_count) && valid; ++i) {
+        GroupRecord record;
+        std::memcpy(&record, payload + groups_at + i * sizeof(GroupRecord), sizeof(record));
+        auto& group = image.groups.emplace_back();
+        group.name = string_at(record.name);
+        group.label = string_at(record.label);
+        group.unlock_at = record.unlock_at;
+        group.expire_at = record.expire_at;
+        group.grace_seconds = record.grace_seconds;
+        group.has_schedule_rules = record.has_schedule_rules != 0;
+    }
+    if (!valid) {
+        return corrupt("string out of range");
+    }
+    return Result<SnapshotContents>(std::move(contents));
+}
+
+} // namespace tcfs
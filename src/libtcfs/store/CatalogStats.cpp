@@ -0,0 +1,153 @@
+#include "tcfs/CatalogStats.hpp"
+#include <algorithm>
+#include <map>
+
+namespace tcfs {
+
+namespace {
+
+void sort_ranked(std::vector<StatsTotal>& totals) {
+    std::sort(totals.begin(), totals.end(), [](const StatsTotal& a, const StatsTotal& b) {
+        return a.bytes != b.bytes ? a.bytes > b.bytes : a.key < b.key;
+    });
+}
+
+std::vector<StatsTotal> ranked(const std::vector<std::string>& names, const std::vector<uint64_t>& capsules,
+                               const std::vector<uint64_t>& bytes) {
+    std::vector<StatsTotal> result;
+    for (size_t i = 0; i < names.size(); ++i) {
+        if (capsules[i] != 0) {
+            result.push_back({names[i], capsules[i], bytes[i]});
+        }
+    }
+    sort_ranked(result);
+    return result;
+}
+
+std::vector<StatsTotal> summed(const std::vector<const std::vector<StatsTotal>*>& lists) {
+    std::map<std::string, StatsTotal> by_key;
+    for (const auto* list : lists) {
+        for (const auto& total : *list) {
+            auto& sum = by_key[total.key];
+            sum.key = total.key;
+            sum.capsules += total.capsules;
+            sum.bytes += total.bytes;
+        }
+    }
+    std::vector<StatsTotal> result;
+    result.reserve(by_key.size());
+    for (auto& [key, total] : by_key) {
+        result.push_back(std::move(total));
+    }
+    sort_ranked(result);
+    return result;
+}
+
+void add_to(StatsTotal& sum, const StatsTotal& part) {
+    sum.key = part.key;
+    sum.capsules += part.capsules;
+    sum.bytes += part.bytes;
+}
+
+} // namespace
+
+Result<int64_t> CatalogStats::bucket_seconds(const std::string& name) {
+    if (name == "hour") {
+        return Result<int64_t>(int64_t{3600});
+    } else if (name == "day") {
+        return Result<int64_t>(int64_t{86400});
+    } else if (name == "week") {
+        return Result<int64_t>(int64_t{7 * 86400});
+    }
+    return Result<int64_t>(ErrorCode::InvalidArgument, "Bucket must be hour, day or week: " + name);
+}
+
+CatalogStats CatalogStats::compute(const CatalogColumns& columns, int64_t from, int64_t until, int64_t bucket) {
+    CatalogStats stats;
+    stats.live_.key = "live";
+    stats.locked_.key = "locked";
+    stats.due_.key = "due";
+
+    // Epoch-aligned buckets, so day buckets start at midnight UTC; due still counts from the exact from
+    int64_t start = from;
+    size_t buckets = 0;
+    if (bucket > 0) {
+        start -= ((start % bucket) + bucket) % bucket;
+        buckets = until > start ? static_cast<size_t>((until - start + bucket - 1) / bucket) : 0;
+    }
+    const auto span = static_cast<uint64_t>(buckets) * static_cast<uint64_t>(bucket);
+    const auto width = static_cast<uint64_t>(std::max<int64_t>(bucket, 1));
+
+    // The extra bucket collects everything outside the timeline
+    std::vector<uint64_t> timeline_capsules(buckets + 1, 0);
+    std::vector<uint64_t> timeline_bytes(buckets + 1, 0);
+    std::vector<uint64_t> label_capsules(columns.labels.size(), 0);
+    std::vector<uint64_t> label_bytes(columns.labels.size(), 0);
+    std::vector<uint64_t> owner_capsules(columns.owners.size(), 0);
+    std::vector<uint64_t> owner_bytes(columns.owners.size(), 0);
+
+    const size_t count = columns.flags.size();
+    const int64_t* unlock_at = columns.unlock_at.data();
+    const uint64_t* size = columns.size.data();
+    const uint32_t* label = columns.label.data();
+    const uint32_t* owner = columns.owner.data();
+    const uint8_t* flags = columns.flags.data();
+    for (size_t i = 0; i < count; ++i) {
+        const uint64_t live = flags[i] & CatalogColumns::LIVE;
+        const uint64_t locked = (flags[i] & CatalogColumns::LOCKED) >> 1;
+        const uint64_t live_bytes = size[i] * live;
+        const uint64_t locked_bytes = size[i] * locked;
+        stats.live_.capsules += live;
+        stats.live_.bytes += live_bytes;
+        stats.locked_.capsules += locked;
+        stats.locked_.bytes += locked_bytes;
+        label_capsules[label[i]] += live;
+        label_bytes[label[i]] += live_bytes;
+        owner_capsules[owner[i]] += live;
+        owner_bytes[owner[i]] += live_bytes;
+
+        // Unlock times before start wrap around to huge offsets and share the spill bucket
+        const uint64_t due = locked & static_cast<uint64_t>(unlock_at[i] < from);
+        stats.due_.capsules += due;
+        stats.due_.bytes += size[i] * due;
+        const uint64_t offset = static_cast<uint64_t>(unlock_at[i]) - static_cast<uint64_t>(start);
+        const uint64_t inside = locked & static_cast<uint64_t>(offset < span);
+        const size_t slot = inside ? static_cast<size_t>(offset / width) : buckets;
+        timeline_capsules[slot] += inside;
+        timeline_bytes[slot] += locked_bytes;
+    }
+
+    stats.timeline_.reserve(buckets);
+    for (size_t b = 0; b < buckets; ++b) {
+        stats.timeline_.push_back({start + static_cast<int64_t>(b) * bucket, timeline_capsules[b], timeline_bytes[b]});
+    }
+    stats.by_label_ = ranked(columns.labels, label_capsules, label_bytes);
+    stats.by_owner_ = ranked(columns.owners, owner_capsules, owner_bytes);
+    return stats;
+}
+
+CatalogStats CatalogStats::combine(const std::vector<CatalogStats>& parts) {
+    CatalogStats stats;
+    std::vector<const std::vector<StatsTotal>*> labels;
+    std::vector<const std::vector<StatsTotal>*> owners;
+    for (const auto& part : parts) {
+        add_to(stats.live_, part.live_);
+        add_to(stats.locked_, part.locked_);
+        add_to(stats.due_, part.due_);
+        if (stats.timeline_.empty()) {
+            stats.timeline_ = part.timeline_;
+        } else {
+            for (size_t b = 0; b < std::min(stats.timeline_.size(), part.timeline_.size()); ++b) {
+                stats.timeline_[b].capsules += part.timeline_[b].capsules;
+                stats.timeline_[b].bytes += part.timeline_[b].bytes;
+            }
+        }
+        labels.push_back(&part.by_label_);
+        owners.push_back(&part.by_owner_);
+    }
+    stats.by_label_ = summed(labels);
+    stats.by_owner_ = summed(owners);
+    return stats;
+}
+
+} // namespace tcfs
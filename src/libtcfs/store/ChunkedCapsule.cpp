@@ -0,0 +1,324 @@
+#include "tcfs/ChunkedCapsule.hpp"
+#include "tcfs/KeySlots.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace tcfs {
+
+std::optional<size_t> ChunkedLayout::find_stage(const std::string& name) const {
+    for (size_t i = 0; i < stages.size(); ++i) {
+        if (stages[i].name == name) {
+            return i;
+        }
+    }
+    return std::nullopt;
+}
+
+std::vector<size_t> ChunkedLayout::open_stages(const Policy::TimePoint& now) const {
+    std::vector<size_t> open;
+    for (size_t i = 0; i < stages.size(); ++i) {
+        if (stages[i].policy.is_unlock_allowed(now)) {
+            open.push_back(i);
+        }
+    }
+    return open;
+}
+
+nlohmann::json ChunkedLayout::to_json(CryptoProvider& crypto, const CryptoKey* master) const {
+    nlohmann::json json;
+    json["format"] = FORMAT;
+    json["segment_size"] = segment_size;
+    json["plaintext_size"] = plaintext_size;
+    json["stages"] = nlohmann::json::array();
+    for (const auto& stage : stages) {
+        nlohmann::json entry;
+        entry["name"] = stage.name;
+        entry["policy"] = stage.policy.to_json();
+        entry["offset"] = stage.offset;
+        entry["length"] = stage.length;
+        entry["file_offset"] = stage.file_offset;
+        entry["first_segment"] = stage.first_segment;
+        entry["segment_count"] = stage.segment_count;
+        entry["iv"] = crypto.toBase64(stage.base_iv);
+        if (master) {
+            entry["data_key_wrapped"] = crypto.toBase64(wrap_key(crypto, stage.key, *master));
+        } else {
+            entry["data_key_encrypted"] = crypto.toBase64(stage.key); // Simple storage, as for single-segment capsules
+        }
+        json["stages"].push_back(std::move(entry));
+    }
+    return json;
+}
+
+Result<ChunkedLayout> ChunkedLayout::from_json(const nlohmann::json& json, CryptoProvider& crypto,
+                                               const CryptoKey* master) {
+    try {
+        if (json.value("format", "") != FORMAT) {
+            return Result<ChunkedLayout>(ErrorCode::InvalidMetadata, "Unsupported capsule format");
+        }
+
+        ChunkedLayout layout;
+        layout.segment_size = json.at("segment_size").get<uint32_t>();
+        layout.plaintext_size = json.at("plaintext_size").get<uint64_t>();
+        if (layout.segment_size == 0) {
+            return Result<ChunkedLayout>(ErrorCode::InvalidMetadata, "Segment size must be positive");
+        }
+
+        uint64_t expected_offset = 0;
+        uint64_t expected_file_offset = ChunkedCapsule::HEADER_SIZE;
+        uint32_t expected_segment = 0;
+        for (const auto& entry : json.at("stages")) {
+            CapsuleStage stage;
+            stage.name = entry.at("name").get<std::string>();
+            auto policy = Policy::from_json(entry.at("policy"), true);
+            if (!policy) {
+                return Result<ChunkedLayout>(ErrorCode::InvalidMetadata,
+                                             "Invalid policy for stage " + stage.name + ": " + policy.error_message());
+            }
+            stage.policy = std::move(policy).value();
+            stage.offset = entry.at("offset").get<uint64_t>();
+            stage.length = entry.at("length").get<uint64_t>();
+            stage.file_offset = entry.at("file_offset").get<uint64_t>();
+            stage.first_segment = entry.at("first_segment").get<uint32_t>();
+            stage.segment_count = entry.at("segment_count").get<uint32_t>();
+            stage.base_iv = crypto.fromBase64(entry.at("iv").get<std::string>());
+            if (entry.contains("data_key_wrapped")) {
+                layout.sealed = true;
+                if (master) {
+                    auto wrapped = crypto.fromBase64(entry.at("data_key_wrapped").get<std::string>());
+                    auto key = unwrap_key(crypto, wrapped, *master);
+                    if (!key) {
+                        return Result<ChunkedLayout>(ErrorCode::InvalidKey, "Cannot unwrap the key of stage " + stage.name);
+                    }
+                    stage.key = std::move(key).value();
+                }
+            } else {
+                stage.key = crypto.fromBase64(entry.at("data_key_encrypted").get<std::string>());
+            }
+
+            // The table must tile the plaintext and the file exactly
+            auto segments = (stage.length + layout.segment_size - 1) / layout.segment_size;
+            if (stage.offset != expected_offset || stage.file_offset != expected_file_offset ||
+                stage.first_segment != expected_segment || stage.segment_count != segments ||
+                stage.base_iv.size() != CryptoProvider::AES_GCM_IV_SIZE ||
+                (stage.key.size() != CryptoProvider::AES_256_KEY_SIZE && !(layout.sealed && stage.key.empty()))) {
+                return Result<ChunkedLayout>(ErrorCode::InvalidMetadata, "Inconsistent stage table at stage " + stage.name);
+            }
+            expected_offset += stage.length;
+            expected_file_offset += ChunkedCapsule::stage_file_size(stage);
+            expected_segment += stage.segment_count;
+            layout.stages.push_back(std::move(stage));
+        }
+
+        if (layout.stages.empty() || expected_offset != layout.plaintext_size) {
+            return Result<ChunkedLayout>(ErrorCode::InvalidMetadata, "Stage table does not cover the capsule");
+        }
+        return Result<ChunkedLayout>(std::move(layout));
+    } catch (const nlohmann::json::exception& e) {
+        return Result<ChunkedLayout>(ErrorCode::InvalidMetadata, "Invalid chunked layout: " + std::string(e.what()));
+    }
+}
+
+CryptoIV ChunkedCapsule::segment_iv(const CryptoIV& base_iv, uint32_t segment_index) {
+    CryptoIV iv = base_iv;
+    auto n = iv.size();
+    iv[n - 4] ^= static_cast<uint8_t>(segment_index >> 24);
+    iv[n - 3] ^= static_cast<uint8_t>(segment_index >> 16);
+    iv[n - 2] ^= static_cast<uint8_t>(segment_index >> 8);
+    iv[n - 1] ^= static_cast<uint8_t>(segment_index);
+    return iv;
+}
+
+uint64_t ChunkedCapsule::stage_file_size(const CapsuleStage& stage) {
+    return stage.length + uint64_t{stage.segment_count} * CryptoProvider::AES_GCM_TAG_SIZE;
+}
+
+Result<ChunkedLayout> ChunkedCapsule::plan(CryptoProvider& crypto, uint64_t input_size,
+                                           const std::vector<StageSpec>& stages, uint32_t segment_size) {
+    if (segment_size == 0) {
+        return Result<ChunkedLayout>(ErrorCode::InvalidArgument, "Segment size must be positive");
+    }
+    if (stages.empty() || stages.front().offset != 0) {
+        return Result<ChunkedLayout>(ErrorCode::InvalidArgument, "The first stage must start at offset 0");
+    }
+    for (size_t i = 1; i < stages.size(); ++i) {
+        if (stages[i].offset <= stages[i - 1].offset || stages[i].offset >= input_size) {
+            return Result<ChunkedLayout>(ErrorCode::InvalidArgument,
+                                         "Stage offsets must increase and lie inside the input: " + stages[i].name);
+        }
+    }
+
+    ChunkedLayout layout;
+    layout.segment_size = segment_size;
+    layout.plaintext_size = input_size;
+    uint64_t file_offset = HEADER_SIZE;
+    uint32_t segment_index = 0;
+
+    try {
+        for (size_t i = 0; i < stages.size(); ++i) {
+            CapsuleStage stage;
+            stage.name = stages[i].name;
+            stage.policy = stages[i].policy;
+            stage.offset = stages[i].offset;
+            stage.length = (i + 1 < stages.size() ? stages[i + 1].offset : input_size) - stage.offset;
+            stage.file_offset = file_offset;
+            stage.first_segment = segment_index;
+            stage.segment_count = static_cast<uint32_t>((stage.length + segment_size - 1) / segment_size);
+            stage.base_iv = crypto.generateIV();
+            stage.key = crypto.generateKey().data;
+
+            file_offset += stage_file_size(stage);
+            segment_index += stage.segment_count;
+            layout.stages.push_back(std::move(stage));
+        }
+    } catch (const TCFSException& e) {
+        return Result<ChunkedLayout>(e.getErrorCode(), e.getMessage());
+    }
+    return Result<ChunkedLayout>(std::move(layout));
+}
+
+Result<ChunkedLayout> ChunkedCapsule::write(CryptoProvider& crypto, std::istream& input, uint64_t input_size,
+                                            std::ostream& output, const std::vector<StageSpec>& stages,
+                                            uint32_t segment_size) {
+    auto layout = plan(crypto, input_size, stages, segment_size);
+    if (!layout) {
+        return layout;
+    }
+    output.write(MAGIC, HEADER_SIZE);
+    auto written = write_segments(crypto, input, output, layout.value(), 0, segment_count(layout.value()));
+    if (!written) {
+        return Result<ChunkedLayout>(written.error(), written.error_message());
+    }
+    return layout;
+}
+
+Result<void> ChunkedCapsule::write_segments(CryptoProvider& crypto, std::istream& input, std::ostream& output,
+                                            const ChunkedLayout& layout, uint32_t first, uint32_t last) {
+    std::vector<uint8_t> buffer;
+    try {
+        for (const auto& stage : layout.stages) {
+            auto begin = std::max(first, stage.first_segment);
+            auto end = std::min(last, stage.first_segment + stage.segment_count);
+            if (begin >= end) {
+                continue;
+            }
+            CryptoKey key(stage.key);
+            for (auto segment_index = begin; segment_index < end; ++segment_index) {
+                auto done = uint64_t{segment_index - stage.first_segment} * layout.segment_size;
+                auto chunk = static_cast<size_t>(std::min<uint64_t>(layout.segment_size, stage.length - done));
+                buffer.resize(chunk);
+                input.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(chunk));
+                if (static_cast<size_t>(input.gcount()) != chunk) {
+                    return Result<void>(ErrorCode::FILE_ACCESS_ERROR, "Input ended before its expected size");
+                }
+
+                auto sealed = crypto.encrypt(buffer, key, segment_iv(stage.base_iv, segment_index));
+                output.write(reinterpret_cast<const char*>(sealed.ciphertext.data()),
+                             static_cast<std::streamsize>(sealed.ciphertext.size()));
+                output.write(reinterpret_cast<const char*>(sealed.tag.data()),
+                             static_cast<std::streamsize>(sealed.tag.size()));
+                if (!output) {
+                    return Result<void>(ErrorCode::FILE_ACCESS_ERROR, "Failed to write capsule segment");
+                }
+            }
+        }
+    } catch (const TCFSException& e) {
+        return Result<void>(e.getErrorCode(), e.getMessage());
+    }
+
+    std::fill(buffer.begin(), buffer.end(), 0);
+    return Result<void>();
+}
+
+uint32_t ChunkedCapsule::segment_count(const ChunkedLayout& layout) {
+    return layout.stages.empty() ? 0 : layout.stages.back().first_segment + layout.stages.back().segment_count;
+}
+
+std::pair<uint64_t, uint64_t> ChunkedCapsule::segment_offsets(const ChunkedLayout& layout, uint32_t segment) {
+    const uint64_t stride = uint64_t{layout.segment_size} + CryptoProvider::AES_GCM_TAG_SIZE;
+    for (const auto& stage : layout.stages) {
+        if (segment < stage.first_segment + stage.segment_count) {
+            auto k = uint64_t{segment - stage.first_segment};
+            return {stage.offset + k * layout.segment_size, stage.file_offset + k * stride};
+        }
+    }
+    // One past the last segment: the ends of the plaintext and of the capsule file
+    uint64_t file_size = HEADER_SIZE;
+    for (const auto& stage : layout.stages) {
+        file_size += stage_file_size(stage);
+    }
+    return {layout.plaintext_size, file_size};
+}
+
+Result<std::vector<uint8_t>> ChunkedCapsule::read(CryptoProvider& crypto, std::istream& capsule,
+                                                  const ChunkedLayout& layout, size_t stage_index,
+                                                  uint64_t offset, uint64_t length) {
+    if (stage_index >= layout.stages.size()) {
+        return Result<std::vector<uint8_t>>(ErrorCode::InvalidArgument, "No such stage");
+    }
+    const auto& stage = layout.stages[stage_index];
+    if (stage.key.empty()) {
+        return Result<std::vector<uint8_t>>(ErrorCode::InvalidKey,
+                                            "Capsule is sealed to recipients; a recipient passphrase is required");
+    }
+    if (offset > stage.length || length > stage.length - offset) {
+        return Result<std::vector<uint8_t>>(ErrorCode::InvalidArgument, "Range lies outside stage " + stage.name);
+    }
+
+    char magic[HEADER_SIZE] = {};
+    capsule.seekg(0);
+    capsule.read(magic, HEADER_SIZE);
+    if (!capsule || std::memcmp(magic, MAGIC, HEADER_SIZE) != 0) {
+        return Result<std::vector<uint8_t>>(ErrorCode::CorruptedData, "Not a chunked capsule");
+    }
+
+    std::vector<uint8_t> result;
+    result.reserve(static_cast<size_t>(length));
+    if (length == 0) {
+        return Result<std::vector<uint8_t>>(std::move(result));
+    }
+
+    const uint64_t stride = uint64_t{layout.segment_size} + CryptoProvider::AES_GCM_TAG_SIZE;
+    const auto first = static_cast<uint32_t>(offset / layout.segment_size);
+    const auto last = static_cast<uint32_t>((offset + length - 1) / layout.segment_size);
+    CryptoKey key(stage.key);
+
+    try {
+        EncryptedData sealed;
+        for (uint32_t k = first; k <= last; ++k) {
+            auto segment_start = uint64_t{k} * layout.segment_size;
+            auto chunk = static_cast<size_t>(std::min<uint64_t>(layout.segment_size, stage.length - segment_start));
+
+            sealed.ciphertext.resize(chunk);
+            sealed.tag.resize(CryptoProvider::AES_GCM_TAG_SIZE);
+            capsule.seekg(static_cast<std::streamoff>(stage.file_offset + uint64_t{k} * stride));
+            capsule.read(reinterpret_cast<char*>(sealed.ciphertext.data()), static_cast<std::streamsize>(chunk));
+            capsule.read(reinterpret_cast<char*>(sealed.tag.data()), static_cast<std::streamsize>(sealed.tag.size()));
+            if (!capsule) {
+                return Result<std::vector<uint8_t>>(ErrorCode::CorruptedData, "Capsule is truncated in stage " + stage.name);
+            }
+
+            auto iv = segment_iv(stage.base_iv, stage.first_segment + k);
+            auto plaintext = crypto.decrypt(sealed, key, iv);
+
+            auto from = k == first ? static_cast<size_t>(offset - segment_start) : 0;
+            auto to = std::min<uint64_t>(chunk, offset + length - segment_start);
+            result.insert(result.end(), plaintext.begin() + static_cast<std::ptrdiff_t>(from),
+                          plaintext.begin() + static_cast<std::ptrdiff_t>(to));
+            std::fill(plaintext.begin(), plaintext.end(), 0);
+        }
+    } catch (const TCFSException& e) {
+        return Result<std::vector<uint8_t>>(e.getErrorCode(), e.getMessage());
+    }
+    return Result<std::vector<uint8_t>>(std::move(result));
+}
+
+Result<std::vector<uint8_t>> ChunkedCapsule::read_stage(CryptoProvider& crypto, std::istream& capsule,
+                                                        const ChunkedLayout& layout, size_t stage) {
+    if (stage >= layout.stages.size()) {
+        return Result<std::vector<uint8_t>>(ErrorCode::InvalidArgument, "No such stage");
+    }
+    return read(crypto, capsule, layout, stage, 0, layout.stages[stage].length);
+}
+
+} // namespace tcfs
@@ -0,0 +1,401 @@
+#include "tcfs/DirectIO.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <new>
+#include <optional>
+#include <utility>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace tcfs {
+
+namespace {
+
+size_t round_up(size_t value, size_t multiple) {
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+#ifndef _WIN32
+
+ssize_t read_at(int fd, uint8_t* data, size_t length, uint64_t offset) {
+    ssize_t n;
+    do {
+        n = ::pread(fd, data, length, static_cast<off_t>(offset));
+    } while (n < 0 && errno == EINTR);
+    return n;
+}
+
+bool write_at(int fd, const uint8_t* data, size_t length, uint64_t offset) {
+    while (length > 0) {
+        auto n = ::pwrite(fd, data, length, static_cast<off_t>(offset));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        data += n;
+        length -= static_cast<size_t>(n);
+        offset += static_cast<uint64_t>(n);
+    }
+    return true;
+}
+
+bool truncate_to(int fd, uint64_t length) {
+    return ::ftruncate(fd, static_cast<off_t>(length)) == 0;
+}
+
+std::optional<uint64_t> size_of(int fd) {
+    struct stat info {};
+    if (::fstat(fd, &info) != 0) {
+        return std::nullopt;
+    }
+    return static_cast<uint64_t>(info.st_size);
+}
+
+#endif
+
+} // namespace
+
+BufferPool::BufferPool(size_t buffer_size, size_t capacity, bool huge_pages)
+    : buffer_size_(round_up(std::max<size_t>(buffer_size, 1), huge_pages ? HUGE_PAGE_SIZE : ALIGNMENT)),
+      capacity_(capacity), huge_pages_(huge_pages) {}
+
+BufferPool::~BufferPool() {
+    for (const auto& block : idle_) {
+        deallocate(block);
+    }
+}
+
+BufferPool::Buffer BufferPool::acquire() {
+    Block block;
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        if (!idle_.empty()) {
+            block = idle_.back();
+            idle_.pop_back();
+        } else {
+            ++allocated_;
+        }
+    }
+    if (!block.data) {
+        block = allocate();
+    }
+    return Buffer(this, block.data, buffer_size_, block.mapped);
+}
+
+size_t BufferPool::allocated() const {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return allocated_;
+}
+
+BufferPool::Block BufferPool::allocate() const {
+#if !defined(_WIN32) && defined(MAP_ANONYMOUS)
+    if (huge_pages_) {
+        void* data = MAP_FAILED;
+#ifdef MAP_HUGETLB
+        data = ::mmap(nullptr, buffer_size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+        if (data == MAP_FAILED) {
+            // No reserved huge pages: ask for transparent ones instead
+            data = ::mmap(nullptr, buffer_size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+#ifdef MADV_HUGEPAGE
+            if (data != MAP_FAILED) {
+                ::madvise(data, buffer_size_, MADV_HUGEPAGE);
+            }
+#endif
+        }
+        if (data != MAP_FAILED) {
+            return Block{static_cast<uint8_t*>(data), true};
+        }
+    }
+#endif
+    return Block{static_cast<uint8_t*>(::operator new(buffer_size_, std::align_val_t{ALIGNMENT})), false};
+}
+
+void BufferPool::deallocate(const Block& block) const {
+#if !defined(_WIN32) && defined(MAP_ANONYMOUS)
+    if (block.mapped) {
+        ::munmap(block.data, buffer_size_);
+        return;
+    }
+#endif
+    ::operator delete(block.data, std::align_val_t{ALIGNMENT});
+}
+
+void BufferPool::release(Block block) {
+    std::fill_n(block.data, buffer_size_, uint8_t{0});
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        if (idle_.size() < capacity_) {
+            idle_.push_back(block);
+            return;
+        }
+        --allocated_;
+    }
+    deallocate(block);
+}
+
+BufferPool::Buffer::Buffer(Buffer&& other) noexcept
+    : pool_(std::exchange(other.pool_, nullptr)), data_(std::exchange(other.data_, nullptr)),
+      size_(std::exchange(other.size_, 0)), mapped_(other.mapped_) {}
+
+BufferPool::Buffer& BufferPool::Buffer::operator=(Buffer&& other) noexcept {
+    if (this != &other) {
+        if (pool_) {
+            pool_->release(Block{data_, mapped_});
+        }
+        pool_ = std::exchange(other.pool_, nullptr);
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+        mapped_ = other.mapped_;
+    }
+    return *this;
+}
+
+BufferPool::Buffer::~Buffer() {
+    if (pool_) {
+        pool_->release(Block{data_, mapped_});
+    }
+}
+
+#ifndef _WIN32
+
+Result<std::unique_ptr<DirectFile>> DirectFile::open(const fs::path& path, Mode mode, BufferPool& pool, bool direct,
+                                                     uint64_t offset) {
+    // A writer resuming at offset reads back the partial block before it
+    int flags = (mode == Mode::Read ? O_RDONLY : offset == 0 ? O_WRONLY | O_CREAT | O_TRUNC : O_RDWR) | O_CLOEXEC;
+    int fd = -1;
+    bool bypass = false;
+#ifdef O_DIRECT
+    if (direct) {
+        fd = ::open(path.c_str(), flags | O_DIRECT, 0666);
+        bypass = fd >= 0; // EINVAL: the filesystem does not support O_DIRECT
+    }
+#endif
+    if (fd < 0) {
+        fd = ::open(path.c_str(), flags, 0666);
+    }
+    if (fd < 0) {
+        return Result<std::unique_ptr<DirectFile>>(ErrorCode::FILE_ACCESS_ERROR, "Failed to open file: " + path.string());
+    }
+#if !defined(O_DIRECT) && defined(F_NOCACHE)
+    bypass = direct && ::fcntl(fd, F_NOCACHE, 1) != -1;
+#endif
+    std::unique_ptr<DirectFile> file(new DirectFile(fd, mode, pool.acquire(), bypass, path));
+    if (mode == Mode::Write && offset != 0 && !file->resume_at(offset)) {
+        return Result<std::unique_ptr<DirectFile>>(ErrorCode::FILE_ACCESS_ERROR, "Failed to resume writing " + path.string());
+    }
+    return Result<std::unique_ptr<DirectFile>>(std::move(file));
+}
+
+#else
+
+Result<std::unique_ptr<DirectFile>> DirectFile::open(const fs::path& path, Mode, BufferPool&, bool, uint64_t) {
+    return Result<std::unique_ptr<DirectFile>>(ErrorCode::FILE_ACCESS_ERROR,
+                                               "Direct I/O is not supported on this platform: " + path.string());
+}
+
+#endif
+
+DirectFile::DirectFile(int fd, Mode mode, BufferPool::Buffer buffer, bool direct, fs::path path)
+    : fd_(fd), mode_(mode), buffer_(std::move(buffer)), direct_(direct), path_(std::move(path)) {
+    auto* begin = reinterpret_cast<char*>(buffer_.data());
+    if (mode_ == Mode::Read) {
+        setg(begin, begin, begin);
+    } else {
+        setp(begin, begin + buffer_.size());
+    }
+}
+
+DirectFile::~DirectFile() {
+#ifndef _WIN32
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+#endif
+}
+
+Result<void> DirectFile::close() {
+    if (fd_ < 0) {
+        return Result<void>();
+    }
+    bool ok = mode_ == Mode::Read || flush(true);
+#ifndef _WIN32
+    ok = ::close(fd_) == 0 && ok;
+#endif
+    fd_ = -1;
+    if (!ok) {
+        return Result<void>(ErrorCode::FILE_ACCESS_ERROR, "Failed to write file: " + path_.string());
+    }
+    return Result<void>();
+}
+
+DirectFile::int_type DirectFile::underflow() {
+    if (gptr() < egptr()) {
+        return traits_type::to_int_type(*gptr());
+    }
+    if (mode_ != Mode::Read || !fill(buffer_offset_ + static_cast<uint64_t>(egptr() - eback()))) {
+        return traits_type::eof();
+    }
+    return traits_type::to_int_type(*gptr());
+}
+
+bool DirectFile::fill(uint64_t offset) {
+#ifndef _WIN32
+    // O_DIRECT reads start on an aligned offset; the bytes before offset are skipped
+    auto aligned = offset / BufferPool::ALIGNMENT * BufferPool::ALIGNMENT;
+    size_t filled = 0;
+    while (filled < buffer_.size()) {
+        auto n = read_at(fd_, buffer_.data() + filled, buffer_.size() - filled, aligned + filled);
+        if (n < 0) {
+            return false;
+        }
+        filled += static_cast<size_t>(n);
+        if (n == 0 || (direct_ && filled % BufferPool::ALIGNMENT != 0)) {
+            break; // End of file
+        }
+    }
+    if (!direct_ && filled > 0) {
+        drop_cached(aligned, filled, false);
+    }
+    buffer_offset_ = aligned;
+    auto* begin = reinterpret_cast<char*>(buffer_.data());
+    auto skip = static_cast<size_t>(offset - aligned);
+    setg(begin, begin + std::min(skip, filled), begin + filled);
+    return skip < filled;
+#else
+    (void)offset;
+    return false;
+#endif
+}
+
+bool DirectFile::resume_at(uint64_t offset) {
+#ifndef _WIN32
+    auto aligned = offset / BufferPool::ALIGNMENT * BufferPool::ALIGNMENT;
+    auto partial = static_cast<size_t>(offset - aligned);
+    if (!truncate_to(fd_, offset)) {
+        return false;
+    }
+    if (partial != 0 && read_at(fd_, buffer_.data(), BufferPool::ALIGNMENT, aligned) != static_cast<ssize_t>(partial)) {
+        return false;
+    }
+    buffer_offset_ = aligned;
+    pbump(static_cast<int>(partial));
+    return true;
+#else
+    (void)offset;
+    return false;
+#endif
+}
+
+DirectFile::int_type DirectFile::overflow(int_type ch) {
+    if (mode_ != Mode::Write || !flush(false)) {
+        return traits_type::eof();
+    }
+    if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(ch);
+        pbump(1);
+    }
+    return traits_type::not_eof(ch);
+}
+
+bool DirectFile::flush(bool last) {
+#ifndef _WIN32
+    auto length = static_cast<size_t>(pptr() - pbase());
+    if (length == 0) {
+        return true;
+    }
+    // Only the final block may be partial; O_DIRECT writes it padded and the file is cut back after
+    auto written = length;
+    if (direct_ && last) {
+        written = round_up(length, BufferPool::ALIGNMENT);
+        std::fill(buffer_.data() + length, buffer_.data() + written, uint8_t{0});
+    }
+    if (!write_at(fd_, buffer_.data(), written, buffer_offset_) ||
+        (written != length && !truncate_to(fd_, buffer_offset_ + length))) {
+        return false;
+    }
+    if (!direct_) {
+        drop_cached(buffer_offset_, length, true);
+    }
+    buffer_offset_ += length;
+    auto* begin = reinterpret_cast<char*>(buffer_.data());
+    setp(begin, begin + buffer_.size());
+    return true;
+#else
+    (void)last;
+    return false;
+#endif
+}
+
+void DirectFile::drop_cached(uint64_t offset, uint64_t length, bool written) {
+#if !defined(_WIN32) && defined(POSIX_FADV_DONTNEED)
+    if (written) {
+        // Dirty pages stay cached until written back
+#ifdef SYNC_FILE_RANGE_WRITE
+        ::sync_file_range(fd_, static_cast<off_t>(offset), static_cast<off_t>(length),
+                          SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+#else
+        ::fdatasync(fd_);
+#endif
+    }
+    ::posix_fadvise(fd_, static_cast<off_t>(offset), static_cast<off_t>(length), POSIX_FADV_DONTNEED);
+#else
+    (void)offset;
+    (void)length;
+    (void)written;
+#endif
+}
+
+DirectFile::pos_type DirectFile::seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) {
+    if (mode_ == Mode::Write) {
+        // Writers are sequential; they only report their position
+        if (off != 0 || dir != std::ios_base::cur) {
+            return pos_type(off_type(-1));
+        }
+        return pos_type(static_cast<off_type>(buffer_offset_) + (pptr() - pbase()));
+    }
+    off_type base = 0;
+    if (dir == std::ios_base::cur) {
+        base = static_cast<off_type>(buffer_offset_) + (gptr() - eback());
+    } else if (dir == std::ios_base::end) {
+#ifndef _WIN32
+        auto size = size_of(fd_);
+        if (!size) {
+            return pos_type(off_type(-1));
+        }
+        base = static_cast<off_type>(*size);
+#endif
+    }
+    return seekpos(pos_type(base + off), which);
+}
+
+DirectFile::pos_type DirectFile::seekpos(pos_type pos, std::ios_base::openmode which) {
+    auto target = static_cast<off_type>(pos);
+    if (mode_ != Mode::Read || !(which & std::ios_base::in) || target < 0) {
+        return pos_type(off_type(-1));
+    }
+    auto offset = static_cast<uint64_t>(target);
+    auto buffered = static_cast<uint64_t>(egptr() - eback());
+    if (offset >= buffer_offset_ && offset <= buffer_offset_ + buffered) {
+        setg(eback(), eback() + (offset - buffer_offset_), egptr());
+        return pos;
+    }
+    fill(offset); // Past the end, reads just find end of file
+    return pos;
+}
+
+int DirectFile::sync() {
+    // Partial blocks cannot be written mid-file with O_DIRECT; close() writes them
+    return 0;
+}
+
+} // namespace tcfs
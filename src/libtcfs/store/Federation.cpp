@@ -0,0 +1,71 @@
+#include "tcfs/Federation.hpp"
+#include <cctype>
+#include <fstream>
+#include <nlohmann/json.hpp>
+
+namespace fs = std::filesystem;
+
+namespace tcfs {
+
+namespace {
+
+// Next separator at or after start; the ':' of a drive letter opening a path ("C:\caps", "D:/x") is part of it
+size_t find_separator(const std::string& spec, size_t start) {
+    auto at = spec.find(Federation::SEPARATOR, start);
+    bool drive_letter = Federation::SEPARATOR == ':' && at == start + 1 && at + 1 < spec.size() &&
+                        std::isalpha(static_cast<unsigned char>(spec[start])) &&
+                        (spec[at + 1] == '\\' || spec[at + 1] == '/');
+    return drive_letter ? spec.find(Federation::SEPARATOR, at + 1) : at;
+}
+
+} // namespace
+
+Result<std::vector<fs::path>> Federation::resolve(const std::string& spec) {
+    std::vector<fs::path> roots;
+    if (find_separator(spec, 0) != std::string::npos) {
+        size_t start = 0;
+        while (start <= spec.size()) {
+            auto end = find_separator(spec, start);
+            auto root = spec.substr(start, end == std::string::npos ? std::string::npos : end - start);
+            if (!root.empty()) {
+                roots.emplace_back(root);
+            }
+            start = end == std::string::npos ? spec.size() + 1 : end + 1;
+        }
+    } else {
+        std::error_code ec;
+        if (fs::is_regular_file(spec, ec)) {
+            return read_config(spec);
+        }
+        roots.emplace_back(spec);
+    }
+    if (roots.empty()) {
+        return Result<std::vector<fs::path>>(ErrorCode::InvalidArgument, "No store named in: " + spec);
+    }
+    return Result<std::vector<fs::path>>(std::move(roots));
+}
+
+Result<std::vector<fs::path>> Federation::read_config(const fs::path& path) {
+    std::ifstream file(path);
+    if (!file) {
+        return Result<std::vector<fs::path>>(ErrorCode::FILE_ACCESS_ERROR, "Failed to read federation config: " + path.string());
+    }
+    std::vector<fs::path> roots;
+    try {
+        nlohmann::json config;
+        file >> config;
+        for (const auto& store : config.at(STORES_FIELD)) {
+            fs::path root = store.get<std::string>();
+            roots.push_back(root.is_absolute() ? root : path.parent_path() / root);
+        }
+    } catch (const nlohmann::json::exception& e) {
+        return Result<std::vector<fs::path>>(ErrorCode::InvalidArgument,
+                                             "Invalid federation config " + path.string() + ": " + e.what());
+    }
+    if (roots.empty()) {
+        return Result<std::vector<fs::path>>(ErrorCode::InvalidArgument, "Federation config names no stores: " + path.string());
+    }
+    return Result<std::vector<fs::path>>(std::move(roots));
+}
+
+} // namespace tcfs
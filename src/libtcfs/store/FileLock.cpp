@@ -0,0 +1,117 @@
+#include "tcfs/FileLock.hpp"
+#include <cerrno>
+#include <cstring>
+#include <utility>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace tcfs {
+
+namespace {
+
+#ifndef _WIN32
+Result<int> open_lock_file(const fs::path& path) {
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        return Result<int>(ErrorCode::FILE_ACCESS_ERROR,
+                           "Cannot open lock file " + path.string() + ": " + std::strerror(errno));
+    }
+    return Result<int>(fd);
+}
+#endif
+
+} // namespace
+
+FileLock::~FileLock() {
+    release();
+}
+
+FileLock::FileLock(FileLock&& other) noexcept : fd_(std::exchange(other.fd_, -1)) {
+}
+
+FileLock& FileLock::operator=(FileLock&& other) noexcept {
+    if (this != &other) {
+        release();
+        fd_ = std::exchange(other.fd_, -1);
+    }
+    return *this;
+}
+
+Result<FileLock> FileLock::exclusive(const fs::path& path) {
+#ifndef _WIN32
+    auto fd = open_lock_file(path);
+    if (!fd) {
+        return Result<FileLock>(fd.error(), fd.error_message());
+    }
+    while (::flock(fd.value(), LOCK_EX) != 0) {
+        if (errno != EINTR) {
+            auto message = "Cannot lock " + path.string() + ": " + std::strerror(errno);
+            ::close(fd.value());
+            return Result<FileLock>(ErrorCode::FILE_ACCESS_ERROR, message);
+        }
+    }
+    return Result<FileLock>(FileLock(fd.value()));
+#else
+    (void)path;
+    return Result<FileLock>(FileLock());
+#endif
+}
+
+Result<FileLock> FileLock::range(const fs::path& path, uint64_t offset) {
+#ifndef _WIN32
+    auto fd = open_lock_file(path);
+    if (!fd) {
+        return Result<FileLock>(fd.error(), fd.error_message());
+    }
+    struct flock region {};
+    region.l_type = F_WRLCK;
+    region.l_whence = SEEK_SET;
+    region.l_start = static_cast<off_t>(offset);
+    region.l_len = 1;
+#ifdef F_OFD_SETLKW
+    const int command = F_OFD_SETLKW; // Owned by this descriptor, not the process
+#else
+    // Process-wide POSIX locks: threads of one process do not exclude each other, and closing
+    // any descriptor of the file drops every range the process holds on it
+    const int command = F_SETLKW;
+#endif
+    while (::fcntl(fd.value(), command, &region) != 0) {
+        if (errno != EINTR) {
+            auto message = "Cannot lock " + path.string() + ": " + std::strerror(errno);
+            ::close(fd.value());
+            return Result<FileLock>(ErrorCode::FILE_ACCESS_ERROR, message);
+        }
+    }
+    return Result<FileLock>(FileLock(fd.value()));
+#else
+    (void)path;
+    (void)offset;
+    return Result<FileLock>(FileLock());
+#endif
+}
+
+void FileLock::release() {
+#ifndef _WIN32
+    if (fd_ >= 0) {
+        ::close(fd_); // Closing the description drops both flock and OFD locks
+    }
+#endif
+    fd_ = -1;
+}
+
+size_t lock_shard(const std::string& key, size_t shards) {
+    // FNV-1a: std::hash is not guaranteed to agree between processes built differently
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (char c : key) {
+        hash = (hash ^ static_cast<uint8_t>(c)) * 0x100000001b3ULL;
+    }
+    return shards == 0 ? 0 : static_cast<size_t>(hash % shards);
+}
+
+} // namespace tcfs
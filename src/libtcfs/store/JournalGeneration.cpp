@@ -0,0 +1,117 @@
+#include "tcfs/JournalGeneration.hpp"
+#include <atomic>
+#include <thread>
+#include <utility>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace tcfs {
+
+struct JournalGeneration::Header {
+    std::atomic<uint64_t> generation;
+    std::atomic<uint64_t> committed_offset;
+    std::atomic<uint64_t> sequence;
+};
+
+// The header lives in memory shared between processes, so the atomics must not hide a lock
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared seqlock needs lock-free 64-bit atomics");
+
+namespace {
+
+constexpr size_t HEADER_FILE_SIZE = 4096;
+constexpr int READ_ATTEMPTS = 1000;
+
+} // namespace
+
+JournalGeneration::~JournalGeneration() {
+    close();
+}
+
+JournalGeneration::JournalGeneration(JournalGeneration&& other) noexcept
+    : header_(std::exchange(other.header_, nullptr)) {
+}
+
+JournalGeneration& JournalGeneration::operator=(JournalGeneration&& other) noexcept {
+    if (this != &other) {
+        close();
+        header_ = std::exchange(other.header_, nullptr);
+    }
+    return *this;
+}
+
+Result<void> JournalGeneration::open(const fs::path& path) {
+    close();
+#ifndef _WIN32
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        return Result<void>(ErrorCode::FILE_ACCESS_ERROR, "Cannot open journal generation: " + path.string());
+    }
+    // Growing a fresh file to the header size yields zeroes, i.e. generation 0 at offset 0
+    if (::lseek(fd, 0, SEEK_END) < static_cast<off_t>(HEADER_FILE_SIZE) &&
+        ::ftruncate(fd, static_cast<off_t>(HEADER_FILE_SIZE)) != 0) {
+        ::close(fd);
+        return Result<void>(ErrorCode::FILE_ACCESS_ERROR, "Cannot size journal generation: " + path.string());
+    }
+    void* mapped = ::mmap(nullptr, HEADER_FILE_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        return Result<void>(ErrorCode::FILE_ACCESS_ERROR, "Cannot map journal generation: " + path.string());
+    }
+    header_ = static_cast<Header*>(mapped);
+    return Result<void>();
+#else
+    (void)path;
+    return Result<void>(ErrorCode::InternalError, "Shared journal generation needs mmap");
+#endif
+}
+
+void JournalGeneration::close() {
+#ifndef _WIN32
+    if (header_) {
+        ::munmap(header_, HEADER_FILE_SIZE);
+    }
+#endif
+    header_ = nullptr;
+}
+
+std::optional<JournalGeneration::State> JournalGeneration::read() const {
+    if (!header_) {
+        return std::nullopt;
+    }
+    for (int attempt = 0; attempt < READ_ATTEMPTS; ++attempt) {
+        State state;
+        state.generation = header_->generation.load(std::memory_order_acquire);
+        if (state.generation & 1) {
+            std::this_thread::yield(); // A writer is mid-update
+            continue;
+        }
+        state.committed_offset = header_->committed_offset.load(std::memory_order_relaxed);
+        state.sequence = header_->sequence.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (header_->generation.load(std::memory_order_relaxed) == state.generation) {
+            return state;
+        }
+    }
+    return std::nullopt;
+}
+
+void JournalGeneration::publish(uint64_t committed_offset, uint64_t sequence) {
+    if (!header_) {
+        return;
+    }
+    // An odd value left by a writer that died mid-update is simply overwritten
+    auto generation = header_->generation.load(std::memory_order_relaxed) | 1;
+    header_->generation.store(generation, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    header_->committed_offset.store(committed_offset, std::memory_order_relaxed);
+    header_->sequence.store(sequence, std::memory_order_relaxed);
+    header_->generation.store(generation + 1, std::memory_order_release);
+}
+
+} // namespace tcfs
@@ -0,0 +1,223 @@
+#include "tcfs/KeySlots.hpp"
+#include <algorithm>
+
+namespace tcfs {
+
+namespace {
+
+CryptoKey derive_kek(CryptoProvider& crypto, const std::string& passphrase, const KeySlot& slot) {
+    KDFParams params(KDFType::PBKDF2);
+    params.salt = slot.salt;
+    params.iterations = slot.iterations;
+    return crypto.deriveKey(passphrase, slot.salt, params);
+}
+
+} // namespace
+
+std::vector<std::string> KeySlots::recipients() const {
+    std::vector<std::string> result;
+    result.reserve(slots_.size());
+    for (const auto& [recipient, slot] : slots_) {
+        result.push_back(recipient);
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+Result<void> KeySlots::add(CryptoProvider& crypto, const std::string& recipient, const std::string& passphrase,
+                           const CryptoKey& master, uint32_t iterations) {
+    if (recipient.empty()) {
+        return Result<void>(ErrorCode::InvalidArgument, "Recipient name must not be empty");
+    }
+    if (passphrase.empty()) {
+        return Result<void>(ErrorCode::InvalidArgument, "Passphrase for " + recipient + " must not be empty");
+    }
+    if (iterations == 0 || master.size() != CryptoProvider::AES_256_KEY_SIZE) {
+        return Result<void>(ErrorCode::InvalidArgument, "Invalid key slot parameters");
+    }
+
+    try {
+        KeySlot slot;
+        slot.iterations = iterations;
+        slot.salt = crypto.generateSalt();
+        auto kek = derive_kek(crypto, passphrase, slot);
+        slot.wrapped = wrap_key(crypto, master.data, kek);
+        slots_[recipient] = std::move(slot);
+    } catch (const TCFSException& e) {
+        return Result<void>(e.getErrorCode(), e.getMessage());
+    }
+    return Result<void>();
+}
+
+Result<SealContext> SealContext::create(CryptoProvider& crypto, const PublicRecipient& recipient) {
+    if (recipient.name.empty() || recipient.public_key.size() != CryptoProvider::X25519_KEY_SIZE) {
+        return Result<SealContext>(ErrorCode::InvalidKey, "Invalid X25519 public key for " + recipient.name);
+    }
+    try {
+        SealContext context;
+        context.recipient_ = recipient.name;
+        auto ephemeral = crypto.generateX25519PrivateKey();
+        context.ephemeral_public_ = crypto.x25519PublicKey(ephemeral);
+        auto shared = crypto.x25519(ephemeral, recipient.public_key);
+
+        auto salt = context.ephemeral_public_;
+        salt.insert(salt.end(), recipient.public_key.begin(), recipient.public_key.end());
+        context.kek_ = crypto.hkdfSha256(shared, salt, INFO, CryptoProvider::AES_256_KEY_SIZE);
+        return Result<SealContext>(std::move(context));
+    } catch (const TCFSException& e) {
+        return Result<SealContext>(e.getErrorCode(), e.getMessage());
+    }
+}
+
+std::vector<uint8_t> SealContext::wrap(CryptoProvider& crypto, const CryptoKey& key) const {
+    return wrap_key(crypto, key.data, kek_);
+}
+
+Result<CryptoKey> SealContext::open(CryptoProvider& crypto, const CryptoKey& private_key,
+                                    const std::vector<uint8_t>& ephemeral_public) {
+    if (private_key.size() != CryptoProvider::X25519_KEY_SIZE) {
+        return Result<CryptoKey>(ErrorCode::InvalidKey, "Invalid X25519 private key");
+    }
+    try {
+        auto shared = crypto.x25519(private_key, ephemeral_public);
+        auto salt = ephemeral_public;
+        auto own_public = crypto.x25519PublicKey(private_key);
+        salt.insert(salt.end(), own_public.begin(), own_public.end());
+        return Result<CryptoKey>(crypto.hkdfSha256(shared, salt, INFO, CryptoProvider::AES_256_KEY_SIZE));
+    } catch (const TCFSException& e) {
+        return Result<CryptoKey>(ErrorCode::InvalidKey, e.getMessage());
+    }
+}
+
+Result<void> KeySlots::add_sealed(CryptoProvider& crypto, const SealContext& context, const CryptoKey& master) {
+    if (master.size() != CryptoProvider::AES_256_KEY_SIZE) {
+        return Result<void>(ErrorCode::InvalidArgument, "Invalid key slot parameters");
+    }
+    try {
+        KeySlot slot;
+        slot.kind = KeySlot::Kind::X25519;
+        slot.ephemeral_public = context.ephemeral_public();
+        slot.wrapped = context.wrap(crypto, master);
+        slots_[context.recipient()] = std::move(slot);
+    } catch (const TCFSException& e) {
+        return Result<void>(e.getErrorCode(), e.getMessage());
+    }
+    return Result<void>();
+}
+
+bool KeySlots::remove(const std::string& recipient) {
+    return slots_.erase(recipient) != 0;
+}
+
+Result<CryptoKey> KeySlots::open(CryptoProvider& crypto, const RecipientCredential& credential) const {
+    auto it = slots_.find(credential.recipient);
+    if (it == slots_.end()) {
+        return Result<CryptoKey>(ErrorCode::InvalidKey, credential.recipient + " is not a recipient of this capsule");
+    }
+    const auto& slot = it->second;
+    try {
+        CryptoKey kek;
+        if (slot.kind == KeySlot::Kind::X25519) {
+            auto derived = SealContext::open(crypto, CryptoKey(credential.private_key), slot.ephemeral_public);
+            if (!derived) {
+                return Result<CryptoKey>(derived.error(), derived.error_message());
+            }
+            kek = std::move(derived).value();
+        } else {
+            kek = derive_kek(crypto, credential.passphrase, slot);
+        }
+        auto master = unwrap_key(crypto, slot.wrapped, kek);
+        if (!master || master.value().size() != CryptoProvider::AES_256_KEY_SIZE) {
+            return Result<CryptoKey>(ErrorCode::InvalidKey, "Wrong key or passphrase for " + credential.recipient);
+        }
+        return Result<CryptoKey>(CryptoKey(std::move(master).value()));
+    } catch (const TCFSException& e) {
+        return Result<CryptoKey>(e.getErrorCode(), e.getMessage());
+    }
+}
+
+nlohmann::json KeySlots::to_json(CryptoProvider& crypto) const {
+    nlohmann::json json;
+    json["kdf"] = KDF;
+    json["slots"] = nlohmann::json::object();
+    for (const auto& [recipient, slot] : slots_) {
+        nlohmann::json entry;
+        if (slot.kind == KeySlot::Kind::X25519) {
+            entry["type"] = "x25519";
+            entry["ephemeral"] = crypto.toBase64(slot.ephemeral_public);
+        } else {
+            entry["iterations"] = slot.iterations;
+            entry["salt"] = crypto.toBase64(slot.salt);
+        }
+        entry["wrapped"] = crypto.toBase64(slot.wrapped);
+        json["slots"][recipient] = std::move(entry);
+    }
+    return json;
+}
+
+Result<KeySlots> KeySlots::from_json(const nlohmann::json& json, CryptoProvider& crypto) {
+    try {
+        if (json.value("kdf", "") != KDF) {
+            return Result<KeySlots>(ErrorCode::InvalidMetadata, "Unsupported key slot KDF");
+        }
+        KeySlots slots;
+        for (const auto& [recipient, entry] : json.at("slots").items()) {
+            KeySlot slot;
+            const auto type = entry.value("type", "passphrase");
+            if (type == "x25519") {
+                slot.kind = KeySlot::Kind::X25519;
+                slot.ephemeral_public = crypto.fromBase64(entry.at("ephemeral").get<std::string>());
+            } else if (type == "passphrase") {
+                slot.iterations = entry.at("iterations").get<uint32_t>();
+                slot.salt = crypto.fromBase64(entry.at("salt").get<std::string>());
+            } else {
+                return Result<KeySlots>(ErrorCode::InvalidMetadata, "Unknown key slot type: " + type);
+            }
+            slot.wrapped = crypto.fromBase64(entry.at("wrapped").get<std::string>());
+            bool key_material_ok = slot.kind == KeySlot::Kind::X25519
+                                       ? slot.ephemeral_public.size() == CryptoProvider::X25519_KEY_SIZE
+                                       : slot.iterations != 0 && !slot.salt.empty();
+            if (!key_material_ok ||
+                slot.wrapped.size() != CryptoProvider::AES_GCM_IV_SIZE + CryptoProvider::AES_256_KEY_SIZE +
+                                            CryptoProvider::AES_GCM_TAG_SIZE) {
+                return Result<KeySlots>(ErrorCode::InvalidMetadata, "Invalid key slot for " + recipient);
+            }
+            slots.slots_.emplace(recipient, std::move(slot));
+        }
+        return Result<KeySlots>(std::move(slots));
+    } catch (const nlohmann::json::exception& e) {
+        return Result<KeySlots>(ErrorCode::InvalidMetadata, "Invalid key slots: " + std::string(e.what()));
+    }
+}
+
+std::vector<uint8_t> wrap_key(CryptoProvider& crypto, const std::vector<uint8_t>& key, const CryptoKey& kek) {
+    auto iv = crypto.generateIV();
+    auto sealed = crypto.encrypt(key, kek, iv);
+    std::vector<uint8_t> wrapped;
+    wrapped.reserve(iv.size() + sealed.ciphertext.size() + sealed.tag.size());
+    wrapped.insert(wrapped.end(), iv.begin(), iv.end());
+    wrapped.insert(wrapped.end(), sealed.ciphertext.begin(), sealed.ciphertext.end());
+    wrapped.insert(wrapped.end(), sealed.tag.begin(), sealed.tag.end());
+    return wrapped;
+}
+
+Result<std::vector<uint8_t>> unwrap_key(CryptoProvider& crypto, const std::vector<uint8_t>& wrapped,
+                                        const CryptoKey& kek) {
+    constexpr auto IV_SIZE = CryptoProvider::AES_GCM_IV_SIZE;
+    constexpr auto TAG_SIZE = CryptoProvider::AES_GCM_TAG_SIZE;
+    if (wrapped.size() < IV_SIZE + TAG_SIZE) {
+        return Result<std::vector<uint8_t>>(ErrorCode::InvalidKey, "Wrapped key is truncated");
+    }
+    using Diff = std::vector<uint8_t>::difference_type;
+    EncryptedData sealed;
+    sealed.iv.assign(wrapped.begin(), wrapped.begin() + static_cast<Diff>(IV_SIZE));
+    sealed.ciphertext.assign(wrapped.begin() + static_cast<Diff>(IV_SIZE), wrapped.end() - static_cast<Diff>(TAG_SIZE));
+    sealed.tag.assign(wrapped.end() - static_cast<Diff>(TAG_SIZE), wrapped.end());
+    try {
+        return Result<std::vector<uint8_t>>(crypto.decrypt(sealed, kek, sealed.iv));
+    } catch (const TCFSException&) {
+        return Result<std::vector<uint8_t>>(ErrorCode::InvalidKey, "Key unwrap failed");
+    }
+}
+
+} // namespace tcfs
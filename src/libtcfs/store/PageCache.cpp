@@ -0,0 +1,67 @@
+#include "tcfs/PageCache.hpp"
+#include <algorithm>
+#include <fstream>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace tcfs {
+
+#if !defined(_WIN32) && defined(POSIX_FADV_WILLNEED)
+
+namespace {
+
+Result<void> advise(const fs::path& path, uint64_t offset, uint64_t length, int advice) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return Result<void>(ErrorCode::FILE_ACCESS_ERROR, "Failed to open file: " + path.string());
+    }
+    int rc = ::posix_fadvise(fd, static_cast<off_t>(offset), static_cast<off_t>(length), advice);
+    ::close(fd);
+    if (rc != 0) {
+        return Result<void>(ErrorCode::FILE_ACCESS_ERROR, "posix_fadvise failed for " + path.string());
+    }
+    return Result<void>();
+}
+
+} // namespace
+
+Result<void> advise_willneed(const fs::path& path, uint64_t offset, uint64_t length) {
+    return advise(path, offset, length, POSIX_FADV_WILLNEED);
+}
+
+Result<void> advise_dontneed(const fs::path& path, uint64_t offset, uint64_t length) {
+    return advise(path, offset, length, POSIX_FADV_DONTNEED);
+}
+
+#else
+
+Result<void> advise_willneed(const fs::path& path, uint64_t offset, uint64_t length) {
+    // No readahead hint available: read the range once so the OS caches it
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return Result<void>(ErrorCode::FILE_ACCESS_ERROR, "Failed to open file: " + path.string());
+    }
+    file.seekg(static_cast<std::streamoff>(offset));
+    std::vector<char> buffer(64 * 1024);
+    uint64_t remaining = length == 0 ? UINT64_MAX : length;
+    while (remaining > 0 && file) {
+        auto chunk = static_cast<std::streamsize>(std::min<uint64_t>(buffer.size(), remaining));
+        file.read(buffer.data(), chunk);
+        remaining -= static_cast<uint64_t>(file.gcount());
+    }
+    return Result<void>();
+}
+
+Result<void> advise_dontneed(const fs::path&, uint64_t, uint64_t) {
+    return Result<void>();
+}
+
+#endif
+
+} // namespace tcfs
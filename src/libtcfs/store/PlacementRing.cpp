@@ -0,0 +1,38 @@
+#include "tcfs/PlacementRing.hpp"
+#include <algorithm>
+
+namespace tcfs {
+
+PlacementRing::PlacementRing(std::vector<std::string> members) : members_(std::move(members)) {
+    points_.reserve(members_.size() * VIRTUAL_NODES);
+    for (uint32_t member = 0; member < members_.size(); ++member) {
+        for (size_t node = 0; node < VIRTUAL_NODES; ++node) {
+            points_.emplace_back(hash(members_[member] + "#" + std::to_string(node)), member);
+        }
+    }
+    std::sort(points_.begin(), points_.end());
+}
+
+const std::string& PlacementRing::locate(const std::string& key) const {
+    auto point = std::lower_bound(points_.begin(), points_.end(), std::make_pair(hash(key), uint32_t{0}));
+    if (point == points_.end()) {
+        point = points_.begin(); // Wrap around the ring
+    }
+    return members_[point->second];
+}
+
+uint64_t PlacementRing::hash(const std::string& key) {
+    // FNV-1a, then a SplitMix64 finalizer so that similar names spread over the whole ring
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (char c : key) {
+        hash = (hash ^ static_cast<uint8_t>(c)) * 0x100000001b3ULL;
+    }
+    hash ^= hash >> 30;
+    hash *= 0xbf58476d1ce4e5b9ULL;
+    hash ^= hash >> 27;
+    hash *= 0x94d049bb133111ebULL;
+    hash ^= hash >> 31;
+    return hash;
+}
+
+} // namespace tcfs
@@ -0,0 +1,102 @@
+#include "tcfs/ProgressJournal.hpp"
+#include "tcfs/FileSync.hpp"
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+namespace tcfs {
+
+bool ProgressJournal::same_operation(const ProgressJournal& other) const {
+    return operation == other.operation && source == other.source && source_size == other.source_size &&
+           source_modified == other.source_modified && output == other.output && instance == other.instance &&
+           stage == other.stage;
+}
+
+std::string ProgressJournal::capsule_instance(const ChunkedLayout& layout) {
+    static constexpr char DIGITS[] = "0123456789abcdef";
+    std::string instance;
+    for (const auto& stage : layout.stages) {
+        for (auto byte : stage.base_iv) {
+            instance += DIGITS[byte >> 4];
+            instance += DIGITS[byte & 0x0f];
+        }
+    }
+    return instance;
+}
+
+nlohmann::json ProgressJournal::to_json() const {
+    nlohmann::json json;
+    json["operation"] = operation;
+    json["source"] = source;
+    json["source_size"] = source_size;
+    json["source_modified"] = source_modified;
+    json["output"] = output;
+    if (!instance.empty()) {
+        json["instance"] = instance;
+    }
+    if (stage) {
+        json["stage"] = *stage;
+    }
+    if (!layout.is_null()) {
+        json["layout"] = layout;
+    }
+    json["done"] = done;
+    return json;
+}
+
+Result<ProgressJournal> ProgressJournal::from_json(const nlohmann::json& json) {
+    try {
+        ProgressJournal journal;
+        journal.operation = json.at("operation").get<std::string>();
+        journal.source = json.at("source").get<std::string>();
+        journal.source_size = json.at("source_size").get<uint64_t>();
+        journal.source_modified = json.at("source_modified").get<int64_t>();
+        journal.output = json.at("output").get<std::string>();
+        journal.instance = json.value("instance", "");
+        if (json.contains("stage")) {
+            journal.stage = json.at("stage").get<size_t>();
+        }
+        journal.layout = json.value("layout", nlohmann::json());
+        journal.done = json.at("done").get<uint64_t>();
+        return Result<ProgressJournal>(std::move(journal));
+    } catch (const nlohmann::json::exception& e) {
+        return Result<ProgressJournal>(ErrorCode::InvalidMetadata, "Invalid progress journal: " + std::string(e.what()));
+    }
+}
+
+Result<void> ProgressJournal::save(const fs::path& path) const {
+    auto temp_path = path;
+    temp_path += ".tmp";
+    {
+        std::ofstream file(temp_path, std::ios::trunc);
+        file << to_json().dump() << std::endl;
+        if (!file) {
+            return Result<void>(ErrorCode::FILE_ACCESS_ERROR, "Failed to write progress journal: " + path.string());
+        }
+    }
+    std::error_code ec;
+    if (!sync_path(temp_path)) {
+        fs::remove(temp_path, ec);
+        return Result<void>(ErrorCode::FILE_ACCESS_ERROR, "Failed to sync progress journal: " + path.string());
+    }
+    fs::rename(temp_path, path, ec);
+    if (ec || !sync_path(path.parent_path())) {
+        fs::remove(temp_path, ec);
+        return Result<void>(ErrorCode::FILE_ACCESS_ERROR, "Failed to replace progress journal: " + path.string());
+    }
+    return Result<void>();
+}
+
+Result<ProgressJournal> ProgressJournal::load(const fs::path& path) {
+    std::ifstream input(path);
+    if (!input) {
+        return Result<ProgressJournal>(ErrorCode::FileNotFound, "No progress journal: " + path.string());
+    }
+    try {
+        return from_json(nlohmann::json::parse(input));
+    } catch (const nlohmann::json::exception& e) {
+        return Result<ProgressJournal>(ErrorCode::InvalidMetadata, "Invalid progress journal: " + std::string(e.what()));
+    }
+}
+
+} // namespace tcfs
@@ -0,0 +1,82 @@
+#include "tcfs/SecureDelete.hpp"
+#include <algorithm>
+#include <fstream>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace tcfs {
+
+namespace {
+
+constexpr size_t OVERWRITE_CHUNK = 64 * 1024;
+
+#ifndef _WIN32
+Result<void> overwrite(const fs::path& path, uint64_t size) {
+    int fd = ::open(path.c_str(), O_WRONLY);
+    if (fd < 0) {
+        return Result<void>(ErrorCode::FILE_ACCESS_ERROR, "Failed to open file for overwrite: " + path.string());
+    }
+    std::vector<char> zeros(OVERWRITE_CHUNK, 0);
+    for (uint64_t done = 0; done < size;) {
+        auto chunk = static_cast<size_t>(std::min<uint64_t>(OVERWRITE_CHUNK, size - done));
+        auto written = ::pwrite(fd, zeros.data(), chunk, static_cast<off_t>(done));
+        if (written <= 0) {
+            ::close(fd);
+            return Result<void>(ErrorCode::FILE_ACCESS_ERROR, "Failed to overwrite file: " + path.string());
+        }
+        done += static_cast<uint64_t>(written);
+    }
+    bool synced = ::fsync(fd) == 0;
+    ::close(fd);
+    if (!synced) {
+        return Result<void>(ErrorCode::FILE_ACCESS_ERROR, "Failed to flush overwritten file: " + path.string());
+    }
+    return Result<void>();
+}
+#else
+Result<void> overwrite(const fs::path& path, uint64_t size) {
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+    if (!file) {
+        return Result<void>(ErrorCode::FILE_ACCESS_ERROR, "Failed to open file for overwrite: " + path.string());
+    }
+    std::vector<char> zeros(OVERWRITE_CHUNK, 0);
+    for (uint64_t done = 0; done < size;) {
+        auto chunk = static_cast<size_t>(std::min<uint64_t>(OVERWRITE_CHUNK, size - done));
+        file.write(zeros.data(), static_cast<std::streamsize>(chunk));
+        done += chunk;
+    }
+    file.flush();
+    if (!file) {
+        return Result<void>(ErrorCode::FILE_ACCESS_ERROR, "Failed to overwrite file: " + path.string());
+    }
+    return Result<void>();
+}
+#endif
+
+} // namespace
+
+Result<void> secure_delete(const fs::path& path) {
+    std::error_code ec;
+    auto size = fs::file_size(path, ec);
+    if (ec) {
+        return Result<void>(ErrorCode::FileNotFound, "File not found: " + path.string());
+    }
+
+    auto overwritten = overwrite(path, size);
+    if (!overwritten) {
+        return overwritten;
+    }
+
+    if (!fs::remove(path, ec)) {
+        return Result<void>(ErrorCode::FILE_ACCESS_ERROR, "Failed to delete file: " + path.string() + ": " + ec.message());
+    }
+    return Result<void>();
+}
+
+} // namespace tcfs
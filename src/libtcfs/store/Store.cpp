@@ -0,0 +1,2143 @@
+#include "tcfs/Store.hpp"
+#include "tcfs/FileSync.hpp"
+#include "tcfs/SecureDelete.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <optional>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace fs = std::filesystem;
+
+namespace tcfs {
+
+namespace {
+
+Result<void> write_secret_file(const fs::path& path, const std::string& text) {
+    std::ofstream file(path, std::ios::trunc);
+    std::error_code ec;
+    fs::permissions(path, fs::perms::owner_read | fs::perms::owner_write, fs::perm_options::replace, ec);
+    file << text << std::endl;
+    if (!file || ec) {
+        return Result<void>(ErrorCode::FILE_ACCESS_ERROR, "Failed to write key file: " + path.string());
+    }
+    return Result<void>();
+}
+
+std::optional<std::vector<uint8_t>> read_key_file(CryptoProvider& crypto, const fs::path& path, size_t size) {
+    std::ifstream file(path);
+    std::string encoded;
+    if (!file || !std::getline(file, encoded)) {
+        return std::nullopt;
+    }
+    try {
+        auto key = crypto.fromBase64(encoded);
+        if (key.size() == size) {
+            return key;
+        }
+    } catch (const TCFSException&) {
+        // Treated like a missing key
+    }
+    return std::nullopt;
+}
+
+/**
+ * @brief Shift the unlock and expiry times of a stored policy by delta, leaving other fields as written
+ */
+Result<void> shift_policy_times(nlohmann::json& policy, std::chrono::seconds delta) {
+    for (const char* field : {"unlock_at", "expire_at"}) {
+        if (!policy.contains(field) || !policy[field].is_string()) {
+            continue;
+        }
+        auto time = time_utils::parse_rfc3339(policy[field].get<std::string>());
+        if (!time) {
+            return Result<void>(ErrorCode::InvalidMetadata, std::string("Invalid ") + field + " in stored policy");
+        }
+        policy[field] = time_utils::format_rfc3339(time.value() + delta);
+    }
+    return Result<void>();
+}
+
+/**
+ * @brief Copy from to to through a synced temporary file, so to is either absent or complete
+ */
+Result<void> copy_durably(const fs::path& from, const fs::path& to) {
+    auto temp_path = to;
+    temp_path += ".tmp";
+    std::error_code ec;
+    fs::copy_file(from, temp_path, fs::copy_options::overwrite_existing, ec);
+    if (ec || !sync_path(temp_path)) {
+        fs::remove(temp_path, ec);
+        return Result<void>(ErrorCode::FILE_ACCESS_ERROR, "Failed to copy " + from.string() + " to " + to.string());
+    }
+    fs::rename(temp_path, to, ec);
+    if (ec || !sync_path(to.parent_path())) {
+        fs::remove(temp_path, ec);
+        return Result<void>(ErrorCode::FILE_ACCESS_ERROR, "Failed to place " + to.string());
+    }
+    return Result<void>();
+}
+
+/**
+ * @brief Output of an encrypt or decrypt pass: a DirectFile with a buffer pool, an ofstream without
+ *
+ * Opening at a non-zero offset keeps the file's first offset bytes and
+ * continues after them.
+ */
+class OutputFile {
+public:
+    static Result<OutputFile> open(const fs::path& path, BufferPool* pool, uint64_t offset) {
+        OutputFile file;
+        file.path_ = path;
+        if (pool) {
+            auto direct = DirectFile::open(path, DirectFile::Mode::Write, *pool, true, offset);
+            if (!direct) {
+                return Result<OutputFile>(direct.error(), direct.error_message());
+            }
+            file.direct_ = std::move(direct).value();
+            file.stream_ = std::make_unique<std::ostream>(file.direct_.get());
+            return Result<OutputFile>(std::move(file));
+        }
+        std::error_code ec;
+        if (offset != 0) {
+            fs::resize_file(path, offset, ec);
+        }
+        auto mode = std::ios::binary | std::ios::out | (offset == 0 ? std::ios::trunc : std::ios::in);
+        file.file_ = std::make_unique<std::ofstream>(path, mode);
+        if (ec || !*file.file_) {
+            return Result<OutputFile>(ErrorCode::FILE_ACCESS_ERROR, "Failed to write file: " + path.string());
+        }
+        file.file_->seekp(static_cast<std::streamoff>(offset));
+        file.stream_ = std::make_unique<std::ostream>(file.file_->rdbuf());
+        return Result<OutputFile>(std::move(file));
+    }
+
+    std::ostream& stream() { return *stream_; }
+
+    /**
+     * @brief Sync what left the buffers; the bytes now durable in the file
+     */
+    Result<uint64_t> checkpoint() {
+        uint64_t bytes = 0;
+        if (direct_) {
+            bytes = direct_->flushed();
+        } else {
+            stream_->flush();
+            bytes = static_cast<uint64_t>(static_cast<std::streamoff>(stream_->tellp()));
+        }
+        if (!*stream_ || !sync_path(path_)) {
+            return Result<uint64_t>(ErrorCode::FILE_ACCESS_ERROR, "Failed to sync file: " + path_.string());
+        }
+        return Result<uint64_t>(bytes);
+    }
+
+    Result<void> close() {
+        bool ok = static_cast<bool>(*stream_);
+        if (direct_) {
+            ok = static_cast<bool>(direct_->close()) && ok;
+        } else {
+            file_->close();
+            ok = ok && !file_->fail();
+        }
+        if (!ok) {
+            return Result<void>(ErrorCode::FILE_ACCESS_ERROR, "Failed to write file: " + path_.string());
+        }
+        return Result<void>();
+    }
+
+private:
+    fs::path path_;
+    std::unique_ptr<DirectFile> direct_;
+    std::unique_ptr<std::ofstream> file_;
+    std::unique_ptr<std::ostream> stream_;
+};
+
+/**
+ * @brief Whether capsule holds the first done segments of layout, judged by the last of them authenticating
+ */
+bool committed_segments_intact(CryptoProvider& crypto, const fs::path& capsule, const ChunkedLayout& layout,
+                               uint32_t done) {
+    std::error_code ec;
+    auto size = fs::file_size(capsule, ec);
+    if (ec || done > ChunkedCapsule::segment_count(layout) ||
+        size < ChunkedCapsule::segment_offsets(layout, done).second) {
+        return false;
+    }
+    if (done == 0) {
+        return true;
+    }
+    for (size_t i = 0; i < layout.stages.size(); ++i) {
+        const auto& stage = layout.stages[i];
+        if (done - 1 < stage.first_segment + stage.segment_count) {
+            auto offset = uint64_t{done - 1 - stage.first_segment} * layout.segment_size;
+            std::ifstream input(capsule, std::ios::binary);
+            return ChunkedCapsule::read(crypto, input, layout, i, offset,
+                                        std::min<uint64_t>(layout.segment_size, stage.length - offset))
+                .isSuccess();
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+Store::Store(fs::path root) : Store(std::move(root), createCryptoProvider()) {
+}
+
+Store::Store(fs::path root, std::unique_ptr<CryptoProvider> crypto)
+    : root_(std::move(root)), crypto_(std::move(crypto)) {
+}
+
+bool Store::exists() const {
+    std::error_code ec;
+    return fs::is_directory(root_, ec);
+}
+
+Result<void> Store::init(const std::string& owner, const std::string& kdf) {
+    std::error_code ec;
+    fs::create_directories(root_, ec);
+    if (ec) {
+        return Result<void>(ErrorCode::FILE_ACCESS_ERROR, "Failed to create store directory: " + ec.message());
+    }
+
+    nlohmann::json config;
+    config["version"] = TOOL_VERSION;
+    config["owner"] = owner;
+    config["kdf"] = kdf;
+    config["created_at"] = time_utils::format_rfc3339(time_utils::now());
+
+    auto config_path = root_ / CONFIG_FILENAME;
+    std::ofstream config_file(config_path);
+    if (!config_file) {
+        return Result<void>(ErrorCode::FILE_ACCESS_ERROR, "Failed to create config file: " + config_path.string());
+    }
+    config_file << config.dump(2) << std::endl;
+    if (!config_file) {
+        return Result<void>(ErrorCode::FILE_ACCESS_ERROR, "Failed to write config file: " + config_path.string());
+    }
+
+    // Re-initializing keeps existing keys, so signatures and blind-index tokens stay valid
+    try {
+        auto key_path = root_ / SIGNING_KEY_FILENAME;
+        if (!fs::exists(key_path)) {
+            auto key = crypto_->generateEd25519PrivateKey();
+            auto written = write_secret_file(key_path, crypto_->toBase64(key.data));
+            if (!written) {
+                return written;
+            }
+            std::ofstream public_file(root_ / SIGNING_PUBLIC_KEY_FILENAME, std::ios::trunc);
+            public_file << crypto_->toBase64(crypto_->ed25519PublicKey(key)) << std::endl;
+            if (!public_file) {
+                return Result<void>(ErrorCode::FILE_ACCESS_ERROR, "Failed to write host public key");
+            }
+        }
+        auto metadata_key_path = root_ / METADATA_KEY_FILENAME;
+        if (!fs::exists(metadata_key_path)) {
+            auto written = write_secret_file(metadata_key_path, crypto_->toBase64(crypto_->generateKey().data));
+            if (!written) {
+                return written;
+            }
+        }
+    } catch (const TCFSException& e) {
+        return Result<void>(e.getErrorCode(), e.getMessage());
+    }
+    return Result<void>();
+}
+
+const CryptoKey* Store::signing_key() const {
+    std::call_once(signing_key_once_, [this] {
+        // An unreadable key leaves headers unsigned; tcfs verify reports them
+        auto key = read_key_file(*crypto_, root_ / SIGNING_KEY_FILENAME, CryptoProvider::ED25519_KEY_SIZE);
+        if (key) {
+            signing_key_.emplace(std::move(*key));
+            signing_key_public_ = crypto_->toBase64(crypto_->ed25519PublicKey(*signing_key_));
+        }
+    });
+    return signing_key_ ? &*signing_key_ : nullptr;
+}
+
+const BlindIndex* Store::blind_index() const {
+    std::call_once(metadata_key_once_, [this] {
+        auto key = read_key_file(*crypto_, root_ / METADATA_KEY_FILENAME, CryptoProvider::AES_256_KEY_SIZE);
+        if (!key) {
+            return;
+        }
+        // Separate keys for encryption and tokens, so neither use weakens the other
+        CryptoKey master(std::move(*key));
+        try {
+            auto index_key = crypto_->hkdfSha256(master, {}, "tcfs blind index v1", CryptoProvider::AES_256_KEY_SIZE);
+            metadata_cipher_key_.emplace(
+                crypto_->hkdfSha256(master, {}, "tcfs metadata encryption v1", CryptoProvider::AES_256_KEY_SIZE));
+            blind_index_.emplace(*crypto_, std::move(index_key));
+        } catch (const TCFSException&) {
+            metadata_cipher_key_.reset();
+        }
+    });
+    return blind_index_ ? &*blind_index_ : nullptr;
+}
+
+const CryptoKey* Store::metadata_cipher_key() const {
+    return blind_index() ? &*metadata_cipher_key_ : nullptr;
+}
+
+Result<std::vector<uint8_t>> Store::signer_public_key() const {
+    auto path = root_ / SIGNING_PUBLIC_KEY_FILENAME;
+    std::ifstream public_file(path);
+    std::string encoded;
+    if (!public_file || !std::getline(public_file, encoded)) {
+        return Result<std::vector<uint8_t>>(ErrorCode::FileNotFound, "Store has no host public key: " + path.string());
+    }
+    try {
+        auto key = crypto_->fromBase64(encoded);
+        if (key.size() != CryptoProvider::ED25519_KEY_SIZE) {
+            return Result<std::vector<uint8_t>>(ErrorCode::InvalidKey, "Not an Ed25519 public key: " + path.string());
+        }
+        return Result<std::vector<uint8_t>>(std::move(key));
+    } catch (const TCFSException& e) {
+        return Result<std::vector<uint8_t>>(ErrorCode::InvalidKey, e.getMessage());
+    }
+}
+
+Result<void> Store::sign_header(nlohmann::json& header) const {
+    header.erase(SIGNATURE_FIELD);
+    const auto* key = signing_key();
+    if (!key) {
+        return Result<void>();
+    }
+    try {
+        nlohmann::json signature;
+        signature["alg"] = "ed25519";
+        signature["key"] = signing_key_public_;
+        signature["value"] = crypto_->toBase64(crypto_->ed25519Sign(*key, header_bytes(header)));
+        header[SIGNATURE_FIELD] = std::move(signature);
+    } catch (const TCFSException& e) {
+        return Result<void>(e.getErrorCode(), "Failed to sign metadata: " + e.getMessage());
+    }
+    return Result<void>();
+}
+
+std::vector<uint8_t> Store::header_bytes(const nlohmann::json& metadata) {
+    auto header = metadata;
+    header.erase(SIGNATURE_FIELD);
+    auto text = header.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
+    return std::vector<uint8_t>(text.begin(), text.end());
+}
+
+Result<nlohmann::json> Store::config() const {
+    auto config_path = root_ / CONFIG_FILENAME;
+    if (!fs::exists(config_path)) {
+        return Result<nlohmann::json>(nlohmann::json::object());
+    }
+    std::ifstream config_file(config_path, std::ios::binary);
+    if (!config_file) {
+        return Result<nlohmann::json>(ErrorCode::FILE_ACCESS_ERROR, "Failed to read config file: " + config_path.string());
+    }
+    try {
+        nlohmann::json config;
+        config_file >> config;
+        return Result<nlohmann::json>(std::move(config));
+    } catch (const nlohmann::json::exception& e) {
+        return Result<nlohmann::json>(ErrorCode::InvalidMetadata, std::string("Failed to parse config file: ") + e.what());
+    }
+}
+
+std::string Store::default_owner() const {
+    auto loaded = config();
+    if (loaded && loaded.value().contains("owner") && loaded.value()["owner"].is_string()) {
+        return loaded.value()["owner"].get<std::string>();
+    }
+    return "user@example.com";
+}
+
+fs::path Store::capsule_path(const std::string& id) const {
+    return capsule_path_on(*placement(), id);
+}
+
+fs::path Store::capsule_path_on(const PlacementRing& ring, const std::string& id) const {
+    if (ring.empty()) {
+        return root_ / (id + CAPSULE_EXTENSION);
+    }
+    return data_dir_path(ring.locate(id)) / (id + CAPSULE_EXTENSION);
+}
+
+fs::path Store::data_dir_path(const std::string& member) const {
+    fs::path dir(member);
+    auto normal = (dir.is_absolute() ? dir : root_ / dir).lexically_normal();
+    return normal.has_filename() ? normal : normal.parent_path(); // "." names the store itself
+}
+
+std::shared_ptr<const PlacementRing> Store::placement() const {
+    // One stat per lookup keeps every process on the ring another one just committed
+    std::error_code ec;
+    auto modified = fs::last_write_time(root_ / CONFIG_FILENAME, ec);
+    std::lock_guard<std::mutex> guard(placement_mutex_);
+    if (placement_ && (ec || modified == placement_config_time_)) {
+        return placement_;
+    }
+    std::vector<std::string> members;
+    auto loaded = config();
+    if (loaded && loaded.value().contains(DATA_DIRS_FIELD) && loaded.value()[DATA_DIRS_FIELD].is_array()) {
+        for (const auto& dir : loaded.value()[DATA_DIRS_FIELD]) {
+            if (dir.is_string()) {
+                members.push_back(dir.get<std::string>());
+            }
+        }
+    }
+    placement_ = std::make_shared<const PlacementRing>(std::move(members));
+    placement_config_time_ = ec ? fs::file_time_type{} : modified;
+    return placement_;
+}
+
+std::vector<fs::path> Store::data_dirs() const {
+    std::vector<fs::path> dirs;
+    for (const auto& member : placement()->members()) {
+        dirs.push_back(data_dir_path(member));
+    }
+    return dirs;
+}
+
+Result<void> Store::write_config(const nlohmann::json& config) {
+    auto path = root_ / CONFIG_FILENAME;
+    auto temp_path = path;
+    temp_path += ".tmp";
+    {
+        std::ofstream output(temp_path, std::ios::trunc);
+        output << config.dump(2) << std::endl;
+        if (!output) {
+            return Result<void>(ErrorCode::FILE_ACCESS_ERROR, "Failed to write config file: " + path.string());
+        }
+    }
+    std::error_code ec;
+    if (!sync_path(temp_path)) {
+        fs::remove(temp_path, ec);
+        return Result<void>(ErrorCode::FILE_ACCESS_ERROR, "Failed to sync config file: " + path.string());
+    }
+    fs::rename(temp_path, path, ec);
+    if (ec) {
+        fs::remove(temp_path, ec);
+        return Result<void>(ErrorCode::FILE_ACCESS_ERROR, "Failed to replace config file: " + path.string());
+    }
+    sync_path(root_);
+    return Result<void>();
+}
+
+Result<std::vector<FileLock>> Store::lock_all_shards() const {
+    std::vector<FileLock> locks;
+    locks.reserve(LOCK_SHARDS);
+    for (size_t shard = 0; shard < LOCK_SHARDS; ++shard) {
+        auto lock = FileLock::range(root_ / SHARD_LOCK_FILENAME, shard);
+        if (!lock) {
+            return Result<std::vector<FileLock>>(lock.error(), lock.error_message());
+        }
+        locks.push_back(std::move(lock).value());
+    }
+    return Result<std::vector<FileLock>>(std::move(locks));
+}
+
+Result<RebalanceResult> Store::add_data_dir(const fs::path& dir, size_t workers) {
+    auto loaded = config();
+    if (!loaded) {
+        return Result<RebalanceResult>(loaded.error(), loaded.error_message());
+    }
+    auto members = placement()->members();
+    auto normal = data_dir_path(dir.string());
+    for (const auto& member : members) {
+        if (data_dir_path(member) == normal) {
+            return Result<RebalanceResult>(ErrorCode::InvalidArgument, "Already a data directory: " + dir.string());
+        }
+    }
+    std::error_code ec;
+    fs::create_directories(normal, ec);
+    if (ec) {
+        return Result<RebalanceResult>(ErrorCode::FILE_ACCESS_ERROR, "Failed to create data directory: " + normal.string());
+    }
+    auto shards = lock_all_shards();
+    if (!shards) {
+        return Result<RebalanceResult>(shards.error(), shards.error_message());
+    }
+
+    if (members.empty()) {
+        members.emplace_back("."); // The store directory keeps its share
+    }
+    members.push_back(dir.string());
+    PlacementRing ring(members);
+    auto result = place_capsules(ring, false, workers);
+    if (!result.failed.empty()) {
+        return Result<RebalanceResult>(std::move(result)); // Nothing committed; the old layout is intact
+    }
+
+    auto config = std::move(loaded).value();
+    config[DATA_DIRS_FIELD] = members;
+    auto written = write_config(config);
+    if (!written) {
+        return Result<RebalanceResult>(written.error(), written.error_message());
+    }
+    auto cleaned = place_capsules(ring, true, workers);
+    result.failed = std::move(cleaned.failed);
+    return Result<RebalanceResult>(std::move(result));
+}
+
+Result<RebalanceResult> Store::rebalance(size_t workers) {
+    auto shards = lock_all_shards();
+    if (!shards) {
+        return Result<RebalanceResult>(shards.error(), shards.error_message());
+    }
+    return Result<RebalanceResult>(place_capsules(*placement(), true, workers));
+}
+
+RebalanceResult Store::place_capsules(const PlacementRing& ring, bool drop_stale, size_t workers) {
+    std::vector<fs::path> dirs{data_dir_path(".")};
+    for (const auto& member : ring.members()) {
+        auto dir = data_dir_path(member);
+        if (std::find(dirs.begin(), dirs.end(), dir) == dirs.end()) {
+            dirs.push_back(dir);
+        }
+    }
+
+    auto ids = scan_capsule_ids();
+    std::vector<std::optional<Result<uint64_t>>> copied(ids.size()); // Bytes copied, if any
+    std::atomic<size_t> next{0};
+    std::vector<std::future<void>> pool;
+    for (size_t w = 0; w < std::max<size_t>(1, std::min(workers, ids.size())); ++w) {
+        pool.push_back(std::async(std::launch::async, [&] {
+            for (size_t i = next++; i < ids.size(); i = next++) {
+                auto file_name = ids[i] + CAPSULE_EXTENSION;
+                auto target = capsule_path_on(ring, ids[i]);
+                std::error_code ec;
+                if (!fs::exists(target, ec)) {
+                    // Cold capsules have no copy anywhere and come back to target when promoted
+                    auto source = std::find_if(dirs.begin(), dirs.end(), [&](const fs::path& dir) {
+                        return fs::exists(dir / file_name, ec);
+                    });
+                    if (source == dirs.end()) {
+                        continue;
+                    }
+                    auto size = fs::file_size(*source / file_name, ec);
+                    auto placed = copy_durably(*source / file_name, target);
+                    copied[i] = placed ? Result<uint64_t>(ec ? 0 : size)
+                                       : Result<uint64_t>(placed.error(), placed.error_message());
+                    if (!placed) {
+                        continue;
+                    }
+                }
+                if (!drop_stale) {
+                    continue;
+                }
+                for (const auto& dir : dirs) {
+                    if (dir / file_name != target.lexically_normal()) {
+                        fs::remove(dir / file_name, ec);
+                    }
+                }
+            }
+        }));
+    }
+    for (auto& worker : pool) {
+        worker.get();
+    }
+
+    RebalanceResult result;
+    for (size_t i = 0; i < ids.size(); ++i) {
+        if (!copied[i]) {
+            continue;
+        }
+        if (*copied[i]) {
+            ++result.moved;
+            result.bytes += copied[i]->value();
+        } else {
+            result.failed.emplace_back(ids[i], copied[i]->error_message());
+        }
+    }
+    return result;
+}
+
+fs::path Store::metadata_path(const std::string& id) const {
+    return root_ / (id + CAPSULE_EXTENSION + METADATA_EXTENSION);
+}
+
+fs::path Store::progress_path(const std::string& id, const std::string& operation) const {
+    return root_ / (id + "." + operation + ProgressJournal::EXTENSION);
+}
+
+std::string Store::capsule_id_for(const fs::path& input) {
+    return input.filename().string();
+}
+
+Result<std::string> Store::resolve(const std::string& name) const {
+    // Accept both "name" and "name.tcfs"; metadata always stays hot, so it also finds cold capsules
+    if (fs::exists(capsule_path(name)) || fs::exists(metadata_path(name))) {
+        return Result<std::string>(name);
+    }
+    const std::string extension = CAPSULE_EXTENSION;
+    if (name.size() > extension.size() && name.compare(name.size() - extension.size(), extension.size(), extension) == 0) {
+        auto id = name.substr(0, name.size() - extension.size());
+        if (fs::exists(capsule_path(id)) || fs::exists(metadata_path(id))) {
+            return Result<std::string>(std::move(id));
+        }
+    }
+    if (blind_index()) {
+        try {
+            auto id = private_id(fs::path(name).filename().string());
+            if (fs::exists(metadata_path(id))) {
+                return Result<std::string>(std::move(id));
+            }
+        } catch (const TCFSException&) {
+            // Falls through to not found
+        }
+    }
+    return Result<std::string>(ErrorCode::FileNotFound, "Encrypted file not found in store: " + capsule_path(name).string());
+}
+
+Result<std::string> Store::id_for(const fs::path& input) const {
+    if (!private_metadata_) {
+        return Result<std::string>(capsule_id_for(input));
+    }
+    if (!blind_index()) {
+        return Result<std::string>(ErrorCode::InvalidKey, "Private metadata needs the store's " +
+                                                              std::string(METADATA_KEY_FILENAME));
+    }
+    return Result<std::string>(private_id(input.filename().string()));
+}
+
+std::string Store::private_id(const std::string& file_name) const {
+    // Deterministic, so relocking the same file name replaces the capsule as it does for public ids
+    std::vector<uint8_t> input(file_name.begin(), file_name.end());
+    input.insert(input.begin(), {'i', 'd', 0});
+    auto mac = crypto_->hmacSha256(*metadata_cipher_key_, input);
+    mac.resize(16);
+    return crypto_->toHex(mac);
+}
+
+std::vector<std::string> Store::scan_capsule_ids() const {
+    std::set<std::string> ids;
+    std::error_code ec;
+    for (fs::directory_iterator it(root_, ec), end; !ec && it != end; it.increment(ec)) {
+        if (!it->is_regular_file()) {
+            continue;
+        }
+        auto path = it->path();
+        if (path.extension() == METADATA_EXTENSION) {
+            path = path.stem(); // Cold capsules have only their metadata here
+        }
+        if (path.extension() == CAPSULE_EXTENSION) {
+            ids.insert(path.stem().string());
+        }
+    }
+    return std::vector<std::string>(ids.begin(), ids.end());
+}
+
+Result<nlohmann::json> Store::read_metadata(const std::string& id) const {
+    auto path = metadata_path(id);
+    if (!fs::exists(path)) {
+        return Result<nlohmann::json>(ErrorCode::FileNotFound, "Metadata file not found: " + path.string());
+    }
+    std::ifstream metadata_file(path, std::ios::binary);
+    if (!metadata_file) {
+        return Result<nlohmann::json>(ErrorCode::FILE_ACCESS_ERROR, "Failed to read metadata file: " + path.string());
+    }
+    try {
+        nlohmann::json metadata;
+        metadata_file >> metadata;
+        return Result<nlohmann::json>(std::move(metadata));
+    } catch (const nlohmann::json::exception& e) {
+        return Result<nlohmann::json>(ErrorCode::InvalidMetadata, "JSON parsing error: " + std::string(e.what()));
+    }
+}
+
+Result<void> Store::write_metadata(const std::string& id, const nlohmann::json& unsigned_metadata) const {
+    auto path = metadata_path(id);
+    auto temp_path = path;
+    temp_path += ".tmp";
+
+    // Every rewrite is re-signed, so adding a recipient keeps the header verifiable
+    auto metadata = unsigned_metadata;
+    metadata.erase(SIGNATURE_FIELD);
+    if (metadata.contains(GROUP_FIELD)) {
+        // Group members refer to the shared policy instead of keeping copies of it
+        metadata.erase("policy");
+        if (metadata.contains("chunked") && !metadata["chunked"]["stages"].empty()) {
+            metadata["chunked"]["stages"][0].erase("policy");
+        }
+    }
+    auto signed_header = sign_header(metadata);
+    if (!signed_header) {
+        return signed_header;
+    }
+
+    {
+        std::ofstream meta_output(temp_path, std::ios::binary | std::ios::trunc);
+        if (!meta_output) {
+            return Result<void>(ErrorCode::FILE_ACCESS_ERROR, "Failed to write metadata file: " + path.string());
+        }
+        try {
+            // Use dump with ensure_ascii=false to properly handle UTF-8
+            meta_output << metadata.dump(2, ' ', false, nlohmann::json::error_handler_t::replace) << std::endl;
+        } catch (const nlohmann::json::exception& e) {
+            return Result<void>(ErrorCode::FILE_ACCESS_ERROR, "JSON serialization error: " + std::string(e.what()));
+        }
+        if (!meta_output) {
+            return Result<void>(ErrorCode::FILE_ACCESS_ERROR, "Failed to write metadata file: " + path.string());
+        }
+    }
+
+    // Readers see either the old or the new metadata, never a partial file
+    std::error_code ec;
+    fs::rename(temp_path, path, ec);
+    if (ec) {
+        fs::remove(temp_path, ec);
+        return Result<void>(ErrorCode::FILE_ACCESS_ERROR, "Failed to replace metadata file: " + path.string());
+    }
+    return Result<void>();
+}
+
+Result<Policy> Store::read_policy(const std::string& id) const {
+    auto metadata = read_metadata(id);
+    if (!metadata) {
+        return Result<Policy>(metadata.error(), metadata.error_message());
+    }
+    if (metadata.value().contains(GROUP_FIELD)) {
+        return group_policy(metadata.value()[GROUP_FIELD].get<std::string>());
+    }
+    if (!metadata.value().contains("policy")) {
+        return Result<Policy>(ErrorCode::InvalidMetadata, "Policy not found in metadata");
+    }
+    auto policy = Policy::from_json(metadata.value()["policy"], true); // Stored policies may be past their unlock time
+    if (!policy) {
+        std::string error_msg = "Failed to parse policy from metadata";
+        if (!policy.error_message().empty()) {
+            error_msg += ": " + policy.error_message();
+        }
+        return Result<Policy>(ErrorCode::InvalidMetadata, error_msg);
+    }
+    return policy;
+}
+
+Result<std::string> Store::lock(const fs::path& input, const Policy& policy,
+                                const std::vector<ChunkedCapsule::StageSpec>& later_stages) {
+    return lock_source({input}, policy, later_stages);
+}
+
+Result<std::string> Store::lock(std::istream& input, uint64_t size, const std::string& name, const Policy& policy,
+                                const std::vector<ChunkedCapsule::StageSpec>& later_stages) {
+    if (name.empty() || fs::path(name).filename() != fs::path(name)) {
+        return Result<std::string>(ErrorCode::InvalidArgument, "Capsule name must be a plain file name: " + name);
+    }
+    return lock_source({name, &input, size}, policy, later_stages);
+}
+
+Result<std::string> Store::lock_source(const LockSource& source, const Policy& policy,
+                                       const std::vector<ChunkedCapsule::StageSpec>& later_stages) {
+    auto catalog_result = catalog();
+    if (!catalog_result) {
+        return Result<std::string>(catalog_result.error(), catalog_result.error_message());
+    }
+    for (const auto& dependency : policy.depends_on()) {
+        if (!catalog_result.value()->contains(dependency)) {
+            return Result<std::string>(ErrorCode::InvalidPolicy, "Unknown dependency: " + dependency);
+        }
+    }
+
+    // Held until the catalog has the new entry, so a concurrent destroy or relock of the same name waits
+    auto id = id_for(source.path);
+    if (!id) {
+        return id;
+    }
+    auto shard = lock_capsules({id.value()});
+    if (!shard) {
+        return Result<std::string>(shard.error(), shard.error_message());
+    }
+    auto seals = seal_contexts();
+    if (!seals) {
+        return Result<std::string>(seals.error(), seals.error_message());
+    }
+    auto entry = write_capsule(source, policy, later_stages, false, seals.value());
+    if (!entry) {
+        return Result<std::string>(entry.error(), entry.error_message());
+    }
+    auto dropped = drop_stale_cold_copy(entry.value().id);
+    if (!dropped) {
+        return Result<std::string>(dropped.error(), dropped.error_message());
+    }
+
+    auto put = catalog_result.value()->put(entry.value());
+    if (!put) {
+        return Result<std::string>(put.error(), put.error_message());
+    }
+    return Result<std::string>(entry.value().id);
+}
+
+Result<BatchLockResult> Store::lock_batch(const std::vector<fs::path>& inputs, const Policy& policy, size_t workers) {
+    return lock_many(inputs, policy, "", workers);
+}
+
+Result<BatchLockResult> Store::lock_many(const std::vector<fs::path>& inputs, const Policy& policy,
+                                         const std::string& group, size_t workers) {
+    auto catalog_result = catalog();
+    if (!catalog_result) {
+        return Result<BatchLockResult>(catalog_result.error(), catalog_result.error_message());
+    }
+    for (const auto& dependency : policy.depends_on()) {
+        if (!catalog_result.value()->contains(dependency)) {
+            return Result<BatchLockResult>(ErrorCode::InvalidPolicy, "Unknown dependency: " + dependency);
+        }
+    }
+
+    // Two inputs with the same file name would race for one capsule
+    BatchLockResult result;
+    std::vector<fs::path> unique_inputs;
+    std::vector<std::string> ids;
+    std::unordered_set<std::string> seen;
+    for (const auto& input : inputs) {
+        auto id = id_for(input);
+        if (!id) {
+            return Result<BatchLockResult>(id.error(), id.error_message());
+        }
+        if (seen.insert(id.value()).second) {
+            unique_inputs.push_back(input);
+            ids.push_back(id.value());
+        } else {
+            result.failed.emplace_back(input, "Another input in the batch has the same name");
+        }
+    }
+    auto shards = lock_capsules(ids);
+    if (!shards) {
+        return Result<BatchLockResult>(shards.error(), shards.error_message());
+    }
+
+    // One key agreement per recipient for the whole batch
+    auto seals = seal_contexts();
+    if (!seals) {
+        return Result<BatchLockResult>(seals.error(), seals.error_message());
+    }
+
+    // Encrypt and fsync in parallel; only the catalog commit is serialized
+    std::vector<std::optional<Result<CatalogEntry>>> written(unique_inputs.size());
+    std::atomic<size_t> next{0};
+    std::vector<std::future<void>> pool;
+    for (size_t w = 0; w < std::max<size_t>(1, std::min(workers, unique_inputs.size())); ++w) {
+        pool.push_back(std::async(std::launch::async, [&] {
+            for (size_t i = next++; i < unique_inputs.size(); i = next++) {
+                written[i] = write_capsule({unique_inputs[i]}, policy, {}, true, seals.value(), group);
+            }
+        }));
+    }
+    for (auto& worker : pool) {
+        worker.get();
+    }
+
+    std::vector<CatalogEntry> entries;
+    for (size_t i = 0; i < unique_inputs.size(); ++i) {
+        auto& entry = *written[i];
+        if (!entry) {
+            result.failed.emplace_back(unique_inputs[i], entry.error_message());
+            continue;
+        }
+        auto dropped = drop_stale_cold_copy(entry.value().id);
+        if (!dropped) {
+            result.failed.emplace_back(unique_inputs[i], dropped.error_message());
+            continue;
+        }
+        result.locked.push_back(entry.value().id);
+        entries.push_back(std::move(entry).value());
+    }
+    if (entries.empty()) {
+        return Result<BatchLockResult>(std::move(result));
+    }
+
+    // New directory entries, then one journal write and fsync for the whole batch
+    sync_path(root_);
+    auto put = catalog_result.value()->put_all(entries);
+    if (!put) {
+        return Result<BatchLockResult>(put.error(), put.error_message());
+    }
+    return Result<BatchLockResult>(std::move(result));
+}
+
+Result<CatalogEntry> Store::write_capsule(const LockSource& source, const Policy& policy,
+                                          const std::vector<ChunkedCapsule::StageSpec>& later_stages, bool sync,
+                                          const std::vector<SealContext>& seals, const std::string& group) {
+    const auto& input = source.path;
+    if (!source.stream && !fs::exists(input)) {
+        return Result<CatalogEntry>(ErrorCode::FileNotFound, "Input file not found: " + input.string());
+    }
+
+    std::error_code ec;
+    auto input_size = source.stream ? source.size : fs::file_size(input, ec);
+    if (ec) {
+        return Result<CatalogEntry>(ErrorCode::FILE_ACCESS_ERROR, "Failed to read input file: " + input.string());
+    }
+
+    std::vector<ChunkedCapsule::StageSpec> stages;
+    stages.push_back({FIRST_STAGE_NAME, policy, 0});
+    stages.insert(stages.end(), later_stages.begin(), later_stages.end());
+
+    auto resolved_id = id_for(input);
+    if (!resolved_id) {
+        return Result<CatalogEntry>(resolved_id.error(), resolved_id.error_message());
+    }
+    const auto id = resolved_id.value();
+    auto output_path = capsule_path(id);
+    auto journal_path = checkpoints_.interval != 0 && seals.empty() && !source.stream ? progress_path(id, "lock")
+                                                                                        : fs::path();
+
+    // Encrypt segment by segment so large inputs never sit in memory whole
+    auto layout = encrypt_capsule(source, input_size, output_path, stages, journal_path);
+    if (!layout || (sync && !sync_path(output_path))) {
+        if (journal_path.empty() || !fs::exists(journal_path)) {
+            fs::remove(output_path, ec); // Kept when a checkpoint can resume it
+        }
+        if (!layout) {
+            return Result<CatalogEntry>(layout.error(), layout.error_message());
+        }
+        return Result<CatalogEntry>(ErrorCode::FILE_ACCESS_ERROR, "Failed to write encrypted file: " + output_path.string());
+    }
+
+    CapsuleDescription description{policy.label(), policy.notes(), input.filename().string(), private_metadata_};
+    nlohmann::json metadata;
+    metadata["policy"] = policy.to_json();
+    if (private_metadata_) {
+        try {
+            nlohmann::json fields;
+            fields["label"] = description.label;
+            fields["notes"] = description.notes;
+            fields["original_filename"] = description.original_filename;
+            auto text = fields.dump();
+            auto sealed = crypto_->encrypt(std::vector<uint8_t>(text.begin(), text.end()), *metadata_cipher_key(),
+                                           crypto_->generateIV());
+            metadata[PRIVATE_FIELD] = {{"iv", crypto_->toBase64(sealed.iv)},
+                                       {"ciphertext", crypto_->toBase64(sealed.ciphertext)},
+                                       {"tag", crypto_->toBase64(sealed.tag)}};
+        } catch (const TCFSException& e) {
+            fs::remove(output_path, ec);
+            return Result<CatalogEntry>(e.getErrorCode(), e.getMessage());
+        }
+    }
+    if (seals.empty()) {
+        metadata["chunked"] = layout.value().to_json(*crypto_);
+    } else {
+        // Stage keys are written only in wrapped form
+        try {
+            auto master = crypto_->generateKey();
+            metadata["chunked"] = layout.value().to_json(*crypto_, &master);
+            KeySlots slots;
+            for (const auto& seal : seals) {
+                auto added = slots.add_sealed(*crypto_, seal, master);
+                if (!added) {
+                    fs::remove(output_path, ec);
+                    return Result<CatalogEntry>(added.error(), added.error_message());
+                }
+            }
+            metadata["key_slots"] = slots.to_json(*crypto_);
+        } catch (const TCFSException& e) {
+            fs::remove(output_path, ec);
+            return Result<CatalogEntry>(e.getErrorCode(), e.getMessage());
+        }
+    }
+    if (!group.empty()) {
+        metadata[GROUP_FIELD] = group;
+    }
+    metadata["created_at"] = time_utils::format_rfc3339(time_utils::now());
+    metadata["tool_version"] = TOOL_VERSION;
+    if (!private_metadata_) {
+        metadata["original_filename"] = description.original_filename;
+    } else {
+        // Every copy of the policy carries label and notes, including the per-stage ones
+        metadata["policy"]["label"] = "";
+        metadata["policy"]["notes"] = "";
+        for (auto& stage : metadata["chunked"]["stages"]) {
+            stage["policy"]["label"] = "";
+            stage["policy"]["notes"] = "";
+        }
+    }
+
+    auto written = write_metadata(id, metadata);
+    if (!written) {
+        return Result<CatalogEntry>(written.error(), written.error_message());
+    }
+    if (sync && !sync_path(metadata_path(id))) {
+        return Result<CatalogEntry>(ErrorCode::FILE_ACCESS_ERROR, "Failed to sync metadata file: " + metadata_path(id).string());
+    }
+    if (!journal_path.empty()) {
+        fs::remove(journal_path, ec);
+    }
+
+    auto capsule_size = fs::file_size(output_path, ec);
+    auto entry = make_catalog_entry(id, metadata, policy, ec ? 0 : capsule_size);
+    if (private_metadata_) {
+        entry.label.clear();
+        entry.notes.clear();
+    }
+    try {
+        entry.blind_tokens = blind_tokens(description);
+    } catch (const TCFSException& e) {
+        return Result<CatalogEntry>(e.getErrorCode(), e.getMessage());
+    }
+    return Result<CatalogEntry>(std::move(entry));
+}
+
+Result<ChunkedLayout> Store::encrypt_capsule(const LockSource& source, uint64_t input_size, const fs::path& output_path,
+                                             const std::vector<ChunkedCapsule::StageSpec>& stages,
+                                             const fs::path& journal_path) {
+    const auto& input = source.path;
+    std::error_code ec;
+    ProgressJournal journal;
+    journal.operation = "lock";
+    journal.source = fs::absolute(input, ec).lexically_normal().string();
+    journal.source_size = input_size;
+    journal.source_modified = static_cast<int64_t>(fs::last_write_time(input, ec).time_since_epoch().count());
+    journal.output = output_path.string();
+
+    std::optional<ChunkedLayout> layout;
+    uint32_t done = 0;
+    if (!journal_path.empty() && checkpoints_.resume) {
+        auto saved = ProgressJournal::load(journal_path);
+        auto parsed = saved && saved.value().same_operation(journal)
+                          ? ChunkedLayout::from_json(saved.value().layout, *crypto_)
+                          : Result<ChunkedLayout>(ErrorCode::FileNotFound, "No matching checkpoint");
+        if (parsed && committed_segments_intact(*crypto_, output_path, parsed.value(),
+                                                static_cast<uint32_t>(saved.value().done))) {
+            layout = std::move(parsed).value();
+            done = static_cast<uint32_t>(saved.value().done);
+            journal.layout = saved.value().layout;
+            journal.done = done;
+        }
+    }
+    if (!layout) {
+        auto planned = ChunkedCapsule::plan(*crypto_, input_size, stages);
+        if (!planned) {
+            return planned;
+        }
+        layout = std::move(planned).value();
+        if (!journal_path.empty()) {
+            journal.layout = layout->to_json(*crypto_);
+        }
+    }
+
+    auto [plaintext_offset, file_offset] = ChunkedCapsule::segment_offsets(*layout, done);
+    std::ifstream file;
+    std::unique_ptr<DirectFile> direct_file;
+    if (!source.stream && buffer_pool_) {
+        auto opened = DirectFile::open(input, DirectFile::Mode::Read, *buffer_pool_);
+        direct_file = opened ? std::move(opened).value() : nullptr;
+    } else if (!source.stream) {
+        file.open(input, std::ios::binary);
+    }
+    if (!(source.stream || direct_file || file)) {
+        return Result<ChunkedLayout>(ErrorCode::FILE_ACCESS_ERROR, "Failed to read input file: " + input.string());
+    }
+    std::istream input_stream(source.stream ? source.stream->rdbuf()
+                              : direct_file ? static_cast<std::streambuf*>(direct_file.get())
+                                            : file.rdbuf());
+    // A caller's stream is read from where it stands; it is never checkpointed, so never resumed
+    if (!source.stream) {
+        input_stream.seekg(static_cast<std::streamoff>(plaintext_offset));
+    }
+
+    auto output = OutputFile::open(output_path, buffer_pool_.get(), done == 0 ? 0 : file_offset);
+    if (!output) {
+        return Result<ChunkedLayout>(output.error(), output.error_message());
+    }
+    if (done == 0) {
+        output.value().stream().write(ChunkedCapsule::MAGIC, ChunkedCapsule::HEADER_SIZE);
+    }
+
+    const auto total = ChunkedCapsule::segment_count(*layout);
+    const auto step = journal_path.empty() ? total : checkpoints_.interval;
+    while (done < total) {
+        auto next = total - done > step ? done + step : total;
+        auto written = ChunkedCapsule::write_segments(*crypto_, input_stream, output.value().stream(), *layout, done, next);
+        if (!written) {
+            return Result<ChunkedLayout>(written.error(), written.error_message());
+        }
+        done = next;
+        if (journal_path.empty() || done == total) {
+            continue;
+        }
+        // Record only whole segments that reached the file
+        auto durable = output.value().checkpoint();
+        if (!durable) {
+            return Result<ChunkedLayout>(durable.error(), durable.error_message());
+        }
+        uint32_t low = static_cast<uint32_t>(journal.done), high = done;
+        while (low < high) {
+            auto middle = low + (high - low + 1) / 2;
+            if (ChunkedCapsule::segment_offsets(*layout, middle).second <= durable.value()) {
+                low = middle;
+            } else {
+                high = middle - 1;
+            }
+        }
+        journal.done = low;
+        auto saved = journal.save(journal_path);
+        if (!saved) {
+            return Result<ChunkedLayout>(saved.error(), saved.error_message());
+        }
+    }
+    auto closed = output.value().close();
+    if (!closed) {
+        return Result<ChunkedLayout>(closed.error(), closed.error_message());
+    }
+    return Result<ChunkedLayout>(std::move(*layout));
+}
+
+std::vector<uint64_t> Store::blind_tokens(const CapsuleDescription& description) const {
+    std::vector<uint64_t> tokens;
+    const auto* index = blind_index();
+    if (!index) {
+        return tokens;
+    }
+    for (const auto& [field, value] : {std::pair<const char*, const std::string&>{"label", description.label},
+                                       {"notes", description.notes},
+                                       {"filename", description.original_filename}}) {
+        auto field_tokens = index->tokens(field, value);
+        tokens.insert(tokens.end(), field_tokens.begin(), field_tokens.end());
+    }
+    std::sort(tokens.begin(), tokens.end());
+    tokens.erase(std::unique(tokens.begin(), tokens.end()), tokens.end());
+    return tokens;
+}
+
+Result<CapsuleDescription> Store::describe(const std::string& id) const {
+    auto metadata = read_metadata(id);
+    if (!metadata) {
+        return Result<CapsuleDescription>(metadata.error(), metadata.error_message());
+    }
+    return describe_metadata(metadata.value());
+}
+
+Result<CapsuleDescription> Store::describe_metadata(const nlohmann::json& metadata) const {
+    CapsuleDescription description;
+    try {
+        if (!metadata.contains(PRIVATE_FIELD)) {
+            const auto& policy = metadata.value("policy", nlohmann::json::object());
+            description.label = policy.value("label", "");
+            description.notes = policy.value("notes", "");
+            description.original_filename = metadata.value("original_filename", "");
+            return Result<CapsuleDescription>(std::move(description));
+        }
+        const auto* key = metadata_cipher_key();
+        if (!key) {
+            return Result<CapsuleDescription>(ErrorCode::InvalidKey, "Private metadata needs the store's " +
+                                                                         std::string(METADATA_KEY_FILENAME));
+        }
+        const auto& sealed = metadata.at(PRIVATE_FIELD);
+        EncryptedData encrypted(crypto_->fromBase64(sealed.at("ciphertext").get<std::string>()),
+                                crypto_->fromBase64(sealed.at("iv").get<std::string>()),
+                                crypto_->fromBase64(sealed.at("tag").get<std::string>()));
+        auto plaintext = crypto_->decrypt(encrypted, *key, encrypted.iv);
+        auto fields = nlohmann::json::parse(plaintext.begin(), plaintext.end());
+        description.label = fields.value("label", "");
+        description.notes = fields.value("notes", "");
+        description.original_filename = fields.value("original_filename", "");
+        description.encrypted = true;
+        return Result<CapsuleDescription>(std::move(description));
+    } catch (const nlohmann::json::exception& e) {
+        return Result<CapsuleDescription>(ErrorCode::InvalidMetadata, "Invalid private metadata: " + std::string(e.what()));
+    } catch (const TCFSException& e) {
+        return Result<CapsuleDescription>(ErrorCode::InvalidKey, "Cannot decrypt private metadata: " + e.getMessage());
+    }
+}
+
+Result<std::vector<std::string>> Store::search(const std::string& field, const std::string& term, BlindMatch match) {
+    if (field != "label" && field != "notes" && field != "filename") {
+        return Result<std::vector<std::string>>(ErrorCode::InvalidArgument, "Unknown search field: " + field);
+    }
+    const auto* index = blind_index();
+    if (!index) {
+        return Result<std::vector<std::string>>(ErrorCode::InvalidKey, "Search needs the store's " +
+                                                                           std::string(METADATA_KEY_FILENAME));
+    }
+    auto tokens = index->query(field, term, match);
+    if (!tokens) {
+        return Result<std::vector<std::string>>(tokens.error(), tokens.error_message());
+    }
+    auto catalog_result = catalog();
+    if (!catalog_result) {
+        return Result<std::vector<std::string>>(catalog_result.error(), catalog_result.error_message());
+    }
+    auto candidates = catalog_result.value()->find_by_tokens(tokens.value());
+    if (BlindIndex::is_exact(term, match)) {
+        return Result<std::vector<std::string>>(std::move(candidates));
+    }
+
+    std::vector<std::string> confirmed;
+    for (const auto& id : candidates) {
+        auto description = describe(id);
+        if (!description) {
+            continue;
+        }
+        const auto& value = field == "label"   ? description.value().label
+                            : field == "notes" ? description.value().notes
+                                               : description.value().original_filename;
+        if (BlindIndex::matches(value, term, match)) {
+            confirmed.push_back(id);
+        }
+    }
+    return Result<std::vector<std::string>>(std::move(confirmed));
+}
+
+Result<std::vector<SealContext>> Store::seal_contexts() {
+    std::vector<SealContext> seals;
+    seals.reserve(seal_recipients_.size());
+    for (const auto& recipient : seal_recipients_) {
+        auto context = SealContext::create(*crypto_, recipient);
+        if (!context) {
+            return Result<std::vector<SealContext>>(context.error(), context.error_message());
+        }
+        seals.push_back(std::move(context).value());
+    }
+    return Result<std::vector<SealContext>>(std::move(seals));
+}
+
+Result<void> Store::drop_stale_cold_copy(const std::string& id) {
+    // Relocking a name whose old ciphertext went cold: the pack copy is stale now
+    auto tier_manager = tiers();
+    if (tier_manager && tier_manager.value()->is_cold(id)) {
+        return tier_manager.value()->drop(id);
+    }
+    return Result<void>();
+}
+
+Result<std::vector<FileLock>> Store::lock_capsules(const std::vector<std::string>& ids) const {
+    std::set<size_t> shards;
+    for (const auto& id : ids) {
+        shards.insert(lock_shard(id, LOCK_SHARDS));
+    }
+    std::vector<FileLock> locks;
+    locks.reserve(shards.size());
+    for (size_t shard : shards) {
+        auto lock = FileLock::range(root_ / SHARD_LOCK_FILENAME, shard);
+        if (!lock) {
+            return Result<std::vector<FileLock>>(lock.error(), lock.error_message());
+        }
+        locks.push_back(std::move(lock).value());
+    }
+    return Result<std::vector<FileLock>>(std::move(locks));
+}
+
+fs::path Store::group_path(const std::string& name) const {
+    return root_ / GROUPS_DIRNAME / (name + ".json");
+}
+
+Result<void> Store::create_group(const std::string& name, const Policy& policy) {
+    bool valid_name = !name.empty() && name.front() != '.' &&
+                      std::all_of(name.begin(), name.end(), [](unsigned char c) {
+                          return std::isalnum(c) || c == '-' || c == '_' || c == '.';
+                      });
+    if (!valid_name) {
+        return Result<void>(ErrorCode::InvalidArgument, "Group names use letters, digits, '-', '_' and '.': " + name);
+    }
+    auto catalog_result = catalog();
+    if (!catalog_result) {
+        return Result<void>(catalog_result.error(), catalog_result.error_message());
+    }
+    for (const auto& dependency : policy.depends_on()) {
+        if (!catalog_result.value()->contains(dependency)) {
+            return Result<void>(ErrorCode::InvalidPolicy, "Unknown dependency: " + dependency);
+        }
+    }
+
+    auto shard = lock_capsules({std::string(GROUPS_DIRNAME) + "/" + name});
+    if (!shard) {
+        return Result<void>(shard.error(), shard.error_message());
+    }
+    // The file goes first: it decides when members open, and the daemon checks it before releasing one
+    std::error_code ec;
+    if (fs::exists(group_path(name), ec)) {
+        // A create interrupted before its catalog commit is finished by running it again
+        auto existing = group_policy(name);
+        if (catalog_result.value()->find_group(name) || !existing ||
+            existing.value().to_json() != policy.to_json()) {
+            return Result<void>(ErrorCode::InvalidArgument, "Group already exists: " + name);
+        }
+    } else {
+        auto written = write_group(name, policy);
+        if (!written) {
+            return written;
+        }
+    }
+    return catalog_result.value()->put_group(make_group_entry(name, policy));
+}
+
+Result<Policy> Store::group_policy(const std::string& name) const {
+    auto path = group_path(name);
+    std::error_code ec;
+    auto modified = fs::last_write_time(path, ec);
+    if (ec) {
+        return Result<Policy>(ErrorCode::FileNotFound, "Group not found: " + name);
+    }
+    {
+        std::lock_guard<std::mutex> guard(group_policies_mutex_);
+        auto it = group_policies_.find(name);
+        if (it != group_policies_.end() && it->second.first == modified) {
+            return Result<Policy>(it->second.second);
+        }
+    }
+
+    auto read = read_group(name);
+    if (!read) {
+        return Result<Policy>(read.error(), read.error_message());
+    }
+    const auto& record = read.value();
+    // The group file is the only copy of its members' policy: only one signed by this host counts
+    if (signing_key()) {
+        bool verified = false;
+        try {
+            const auto& signature = record.at(SIGNATURE_FIELD);
+            verified = signature.value("alg", "") == "ed25519" &&
+                       signature.at("key").get<std::string>() == signing_key_public_ &&
+                       crypto_->ed25519Verify(crypto_->fromBase64(signing_key_public_), header_bytes(record),
+                                              crypto_->fromBase64(signature.at("value").get<std::string>()));
+        } catch (const nlohmann::json::exception&) {
+        } catch (const TCFSException&) {
+        }
+        if (!verified) {
+            return Result<Policy>(ErrorCode::InvalidMetadata,
+                                  "Group file " + path.string() + " is not signed by this store's host key");
+        }
+    }
+    if (!record.contains("policy")) {
+        return Result<Policy>(ErrorCode::InvalidMetadata, "Policy not found in group " + name);
+    }
+    auto policy = Policy::from_json(record["policy"], true);
+    if (!policy) {
+        return Result<Policy>(ErrorCode::InvalidMetadata, "Invalid policy in group " + name + ": " + policy.error_message());
+    }
+    std::lock_guard<std::mutex> guard(group_policies_mutex_);
+    group_policies_[name] = {modified, policy.value()};
+    return policy;
+}
+
+Result<nlohmann::json> Store::read_group(const std::string& name) const {
+    auto path = group_path(name);
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return Result<nlohmann::json>(ErrorCode::FileNotFound, "Group not found: " + name);
+    }
+    try {
+        nlohmann::json record;
+        file >> record;
+        return Result<nlohmann::json>(std::move(record));
+    } catch (const nlohmann::json::exception& e) {
+        return Result<nlohmann::json>(ErrorCode::InvalidMetadata, "Invalid group file " + path.string() + ": " + e.what());
+    }
+}
+
+Result<void> Store::extend_group(const std::string& name, const Policy::TimePoint& unlock_at) {
+    auto catalog_result = catalog();
+    if (!catalog_result) {
+        return Result<void>(catalog_result.error(), catalog_result.error_message());
+    }
+    auto shard = lock_capsules({std::string(GROUPS_DIRNAME) + "/" + name});
+    if (!shard) {
+        return Result<void>(shard.error(), shard.error_message());
+    }
+    auto current = group_policy(name);
+    if (!current) {
+        return Result<void>(current.error(), current.error_message());
+    }
+    auto policy = std::move(current).value();
+    if (unlock_at == policy.unlock_time()) {
+        // A retry after the file was rewritten but the catalog not yet committed
+        auto entry = make_group_entry(name, policy);
+        const auto* recorded = catalog_result.value()->find_group(name);
+        if (recorded && recorded->unlock_at == entry.unlock_at && recorded->expire_at == entry.expire_at) {
+            return Result<void>();
+        }
+        return catalog_result.value()->put_group(entry);
+    }
+    if (unlock_at < policy.unlock_time()) {
+        return Result<void>(ErrorCode::InvalidPolicy, "Group " + name + " already unlocks at " +
+                                                          policy.unlock_time_rfc3339() + "; unlock times only move later");
+    }
+    if (policy.expire_at()) {
+        policy.set_expire_at(*policy.expire_at() + (unlock_at - policy.unlock_time()));
+    }
+    policy.set_unlock_time(unlock_at);
+
+    // As in create_group, the file first: until the catalog commits, members stay locked until the later time
+    auto written = write_group(name, policy);
+    if (!written) {
+        return written;
+    }
+    return catalog_result.value()->put_group(make_group_entry(name, policy));
+}
+
+Result<BatchLockResult> Store::lock_group(const std::string& name, const std::vector<fs::path>& inputs, size_t workers) {
+    if (private_metadata_) {
+        return Result<BatchLockResult>(ErrorCode::InvalidArgument,
+                                       "Private capsules cannot join a group; its label and notes are stored in plaintext");
+    }
+    auto policy = group_policy(name);
+    if (!policy) {
+        return Result<BatchLockResult>(policy.error(), policy.error_message());
+    }
+    return lock_many(inputs, policy.value(), name, workers);
+}
+
+Result<UpdateResult> Store::extend(const CatalogQuery& query, const UnlockExtension& extension, size_t workers) {
+    if (!extension.to && extension.by <= std::chrono::seconds(0)) {
+        return Result<UpdateResult>(ErrorCode::InvalidArgument, "Unlock times only move later");
+    }
+    auto catalog_result = catalog();
+    if (!catalog_result) {
+        return Result<UpdateResult>(catalog_result.error(), catalog_result.error_message());
+    }
+    auto* catalog = catalog_result.value();
+    auto audit = audit_log();
+    if (!audit) {
+        return Result<UpdateResult>(audit.error(), audit.error_message());
+    }
+
+    UpdateResult result;
+    std::vector<CatalogEntry> entries;
+    for (const auto* entry : query.select(*catalog)) {
+        if (entry->state == CapsuleState::Released) {
+            result.skipped.emplace_back(entry->id, "already released");
+        } else if (!entry->group.empty()) {
+            result.skipped.emplace_back(entry->id, "member of group " + entry->group + "; extend the group instead");
+        } else {
+            entries.push_back(*entry);
+        }
+    }
+    std::vector<std::string> ids;
+    for (const auto& entry : entries) {
+        ids.push_back(entry.id);
+    }
+    auto shards = lock_capsules(ids);
+    if (!shards) {
+        return Result<UpdateResult>(shards.error(), shards.error_message());
+    }
+
+    // Read and shift metadata in parallel
+    std::vector<std::optional<Result<nlohmann::json>>> shifted(entries.size());
+    std::vector<std::string> skip_reasons(entries.size());
+    std::vector<char> catalog_lags(entries.size(), 0); // Not vector<bool>: workers write neighbouring elements
+    auto run_workers = [&](const std::function<void(size_t)>& work) {
+        std::atomic<size_t> next{0};
+        std::vector<std::future<void>> pool;
+        for (size_t w = 0; w < std::max<size_t>(1, std::min(workers, entries.size())); ++w) {
+            pool.push_back(std::async(std::launch::async, [&] {
+                for (size_t i = next++; i < entries.size(); i = next++) {
+                    work(i);
+                }
+            }));
+        }
+        for (auto& worker : pool) {
+            worker.get();
+        }
+    };
+    run_workers([&](size_t i) {
+        auto metadata = read_metadata(entries[i].id);
+        if (!metadata) {
+            shifted[i] = metadata;
+            return;
+        }
+        auto& json = metadata.value();
+        if (!json.contains("policy") || !json["policy"].contains("unlock_at")) {
+            shifted[i] = Result<nlohmann::json>(ErrorCode::InvalidMetadata, "Policy not found in metadata");
+            return;
+        }
+        auto current = time_utils::parse_rfc3339(json["policy"]["unlock_at"].get<std::string>());
+        if (!current) {
+            shifted[i] = Result<nlohmann::json>(ErrorCode::InvalidMetadata, "Invalid unlock_at in stored policy");
+            return;
+        }
+        auto delta = extension.to ? std::chrono::duration_cast<std::chrono::seconds>(*extension.to - current.value())
+                                  : extension.by;
+        auto& entry = entries[i];
+        if (delta <= std::chrono::seconds(0)) {
+            // Metadata moved by an update interrupted before its catalog commit: the catalog catches up
+            auto unlock_at = static_cast<int64_t>(std::chrono::system_clock::to_time_t(current.value()));
+            if (entry.unlock_at < unlock_at) {
+                entry.unlock_at = unlock_at;
+                if (json["policy"].contains("expire_at")) {
+                    auto expire_at = time_utils::parse_rfc3339(json["policy"]["expire_at"].get<std::string>());
+                    if (expire_at) {
+                        entry.expire_at = static_cast<int64_t>(std::chrono::system_clock::to_time_t(expire_at.value()));
+                    }
+                }
+                catalog_lags[i] = 1;
+            }
+            skip_reasons[i] = "already unlocks at " + time_utils::format_rfc3339(current.value());
+            return;
+        }
+
+        auto shifted_policy = shift_policy_times(json["policy"], delta);
+        if (shifted_policy && json.contains("chunked")) {
+            for (auto& stage : json["chunked"]["stages"]) {
+                if (shifted_policy && stage.contains("policy")) {
+                    shifted_policy = shift_policy_times(stage["policy"], delta);
+                }
+            }
+        }
+        if (!shifted_policy) {
+            shifted[i] = Result<nlohmann::json>(shifted_policy.error(), shifted_policy.error_message());
+            return;
+        }
+        entry.unlock_at = static_cast<int64_t>(std::chrono::system_clock::to_time_t(current.value() + delta));
+        if (json["policy"].contains("expire_at")) {
+            auto expire_at = time_utils::parse_rfc3339(json["policy"]["expire_at"].get<std::string>());
+            entry.expire_at = static_cast<int64_t>(std::chrono::system_clock::to_time_t(expire_at.value()));
+        }
+        shifted[i] = std::move(metadata);
+    });
+
+    // The .meta files are authoritative for unlocking, so they move first, each atomically. A failure or
+    // crash before the catalog commit leaves a capsule locked longer than the catalog says, never shorter.
+    std::vector<std::optional<Result<void>>> written(entries.size());
+    run_workers([&](size_t i) {
+        if (shifted[i] && *shifted[i]) {
+            written[i] = write_metadata(entries[i].id, shifted[i]->value());
+        }
+    });
+
+    std::vector<size_t> changed;
+    std::vector<CatalogEntry> committed;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        if (!shifted[i]) {
+            result.skipped.emplace_back(entries[i].id, skip_reasons[i]);
+            if (catalog_lags[i]) {
+                committed.push_back(entries[i]);
+            }
+        } else if (!*shifted[i]) {
+            result.failed.emplace_back(entries[i].id, shifted[i]->error_message());
+        } else if (!*written[i]) {
+            result.failed.emplace_back(entries[i].id, written[i]->error_message());
+        } else {
+            changed.push_back(i);
+            committed.push_back(entries[i]);
+        }
+    }
+
+    // Commit point, fsynced: the daemon and every reader of the catalog see all new times or none
+    auto put = catalog->put_transaction(committed);
+    if (!put) {
+        return Result<UpdateResult>(put.error(), put.error_message());
+    }
+
+    for (size_t i : changed) {
+        result.updated.push_back(entries[i].id);
+        nlohmann::json details;
+        details["unlock_at"] = time_utils::format_rfc3339(std::chrono::system_clock::from_time_t(entries[i].unlock_at));
+        auto logged = audit.value()->append("extend", entries[i].id, details);
+        if (!logged) {
+            return Result<UpdateResult>(logged.error(), logged.error_message());
+        }
+    }
+    return Result<UpdateResult>(std::move(result));
+}
+
+Result<void> Store::write_group(const std::string& name, const Policy& policy) {
+    std::error_code ec;
+    fs::create_directories(root_ / GROUPS_DIRNAME, ec);
+    auto path = group_path(name);
+    auto temp_path = path;
+    temp_path += ".tmp";
+
+    nlohmann::json record;
+    record["name"] = name;
+    record["policy"] = policy.to_json();
+    record["updated_at"] = time_utils::format_rfc3339(time_utils::now());
+    auto signed_record = sign_header(record);
+    if (!signed_record) {
+        return signed_record;
+    }
+    {
+        std::ofstream output(temp_path, std::ios::binary | std::ios::trunc);
+        output << record.dump(2, ' ', false, nlohmann::json::error_handler_t::replace) << std::endl;
+        if (!output) {
+            return Result<void>(ErrorCode::FILE_ACCESS_ERROR, "Failed to write group file: " + path.string());
+        }
+    }
+    // Members read either the old or the new policy, never a partial file
+    if (!sync_path(temp_path)) {
+        fs::remove(temp_path, ec);
+        return Result<void>(ErrorCode::FILE_ACCESS_ERROR, "Failed to sync group file: " + path.string());
+    }
+    fs::rename(temp_path, path, ec);
+    if (ec) {
+        fs::remove(temp_path, ec);
+        return Result<void>(ErrorCode::FILE_ACCESS_ERROR, "Failed to replace group file: " + path.string());
+    }
+    sync_path(path.parent_path());
+    return Result<void>();
+}
+
+Result<nlohmann::json> Store::with_group_policy(nlohmann::json metadata) const {
+    if (!metadata.contains(GROUP_FIELD)) {
+        return Result<nlohmann::json>(std::move(metadata));
+    }
+    auto policy = group_policy(metadata[GROUP_FIELD].get<std::string>());
+    if (!policy) {
+        return Result<nlohmann::json>(policy.error(), policy.error_message());
+    }
+    auto policy_json = policy.value().to_json();
+    if (metadata.contains("chunked") && !metadata["chunked"]["stages"].empty()) {
+        metadata["chunked"]["stages"][0]["policy"] = policy_json;
+    }
+    metadata["policy"] = std::move(policy_json);
+    return Result<nlohmann::json>(std::move(metadata));
+}
+
+Result<std::vector<uint8_t>> Store::decrypt(const std::string& id) {
+    auto metadata_result = read_metadata(id);
+    if (!metadata_result) {
+        return Result<std::vector<uint8_t>>(metadata_result.error(), metadata_result.error_message());
+    }
+    const auto& metadata = metadata_result.value();
+
+    if (metadata.contains("chunked")) {
+        auto layout = layout_of(metadata);
+        if (!layout) {
+            return Result<std::vector<uint8_t>>(layout.error(), layout.error_message());
+        }
+        std::vector<uint8_t> plaintext;
+        plaintext.reserve(static_cast<size_t>(layout.value().plaintext_size));
+        for (size_t stage = 0; stage < layout.value().stages.size(); ++stage) {
+            auto part = read_range(id, layout.value(), stage, 0, layout.value().stages[stage].length);
+            if (!part) {
+                return part;
+            }
+            plaintext.insert(plaintext.end(), part.value().begin(), part.value().end());
+        }
+        return Result<std::vector<uint8_t>>(std::move(plaintext));
+    }
+
+    // Single-segment capsules written before the chunked format
+    if (!metadata.contains("iv") || !metadata.contains("tag") || !metadata.contains("data_key_encrypted")) {
+        return Result<std::vector<uint8_t>>(ErrorCode::InvalidMetadata, "Missing encryption parameters in metadata");
+    }
+
+    try {
+        auto iv = crypto_->fromBase64(metadata["iv"].get<std::string>());
+        auto tag = crypto_->fromBase64(metadata["tag"].get<std::string>());
+        CryptoKey data_key(crypto_->fromBase64(metadata["data_key_encrypted"].get<std::string>()));
+
+        auto hot = ensure_hot(id);
+        if (!hot) {
+            return Result<std::vector<uint8_t>>(hot.error(), hot.error_message());
+        }
+        auto path = capsule_path(id);
+        std::ifstream encrypted_file(path, std::ios::binary);
+        if (!encrypted_file) {
+            return Result<std::vector<uint8_t>>(ErrorCode::FILE_ACCESS_ERROR, "Failed to read encrypted file: " + path.string());
+        }
+
+        EncryptedData enc_data;
+        enc_data.ciphertext.assign(std::istreambuf_iterator<char>(encrypted_file), std::istreambuf_iterator<char>());
+        enc_data.iv = iv;
+        enc_data.tag = tag;
+
+        return Result<std::vector<uint8_t>>(crypto_->decrypt(enc_data, data_key, iv));
+    } catch (const TCFSException& e) {
+        return Result<std::vector<uint8_t>>(e.getErrorCode(), e.getMessage());
+    }
+}
+
+Result<ChunkedLayout> Store::read_layout(const std::string& id) {
+    auto metadata = read_metadata(id);
+    if (!metadata) {
+        return Result<ChunkedLayout>(metadata.error(), metadata.error_message());
+    }
+    if (!metadata.value().contains("chunked")) {
+        return Result<ChunkedLayout>(ErrorCode::InvalidArgument, "Capsule " + id + " has no stages (single-segment format)");
+    }
+    return layout_of(metadata.value());
+}
+
+Result<ChunkedLayout> Store::layout_of(const nlohmann::json& stored) {
+    auto resolved = with_group_policy(stored);
+    if (!resolved) {
+        return Result<ChunkedLayout>(resolved.error(), resolved.error_message());
+    }
+    const auto& metadata = resolved.value();
+    if (!metadata.contains("key_slots") || !credential_) {
+        return ChunkedLayout::from_json(metadata.at("chunked"), *crypto_); // Sealed stage keys stay empty
+    }
+    auto slots = KeySlots::from_json(metadata.at("key_slots"), *crypto_);
+    if (!slots) {
+        return Result<ChunkedLayout>(slots.error(), slots.error_message());
+    }
+    auto master = slots.value().open(*crypto_, *credential_);
+    if (!master) {
+        return Result<ChunkedLayout>(master.error(), master.error_message());
+    }
+    return ChunkedLayout::from_json(metadata.at("chunked"), *crypto_, &master.value());
+}
+
+Result<void> Store::add_recipient(const std::string& id, const std::string& recipient, const std::string& passphrase,
+                                  uint32_t iterations) {
+    auto shard = lock_capsules({id});
+    if (!shard) {
+        return Result<void>(shard.error(), shard.error_message());
+    }
+    auto metadata = read_metadata(id);
+    if (!metadata) {
+        return Result<void>(metadata.error(), metadata.error_message());
+    }
+    auto& json = metadata.value();
+    if (!json.contains("chunked")) {
+        return Result<void>(ErrorCode::InvalidArgument, "Capsule " + id + " has no stages (single-segment format)");
+    }
+
+    KeySlots slots;
+    CryptoKey master;
+    if (json.contains("key_slots")) {
+        auto parsed = KeySlots::from_json(json["key_slots"], *crypto_);
+        if (!parsed) {
+            return Result<void>(parsed.error(), parsed.error_message());
+        }
+        slots = std::move(parsed).value();
+        if (!credential_) {
+            return Result<void>(ErrorCode::InvalidKey, "Capsule " + id + " is sealed; open it as an existing recipient");
+        }
+        auto opened = slots.open(*crypto_, *credential_);
+        if (!opened) {
+            return Result<void>(opened.error(), opened.error_message());
+        }
+        master = std::move(opened).value();
+    } else {
+        // First recipient: wrap the stage keys under a fresh master key
+        auto resolved = with_group_policy(json);
+        if (!resolved) {
+            return Result<void>(resolved.error(), resolved.error_message());
+        }
+        auto layout = ChunkedLayout::from_json(resolved.value()["chunked"], *crypto_);
+        if (!layout) {
+            return Result<void>(layout.error(), layout.error_message());
+        }
+        try {
+            master = crypto_->generateKey();
+            json["chunked"] = layout.value().to_json(*crypto_, &master);
+        } catch (const TCFSException& e) {
+            return Result<void>(e.getErrorCode(), e.getMessage());
+        }
+    }
+
+    auto added = slots.add(*crypto_, recipient, passphrase, master, iterations);
+    if (!added) {
+        return added;
+    }
+    json["key_slots"] = slots.to_json(*crypto_);
+    return write_metadata(id, json);
+}
+
+Result<void> Store::remove_recipient(const std::string& id, const std::string& recipient) {
+    auto shard = lock_capsules({id});
+    if (!shard) {
+        return Result<void>(shard.error(), shard.error_message());
+    }
+    auto metadata = read_metadata(id);
+    if (!metadata) {
+        return Result<void>(metadata.error(), metadata.error_message());
+    }
+    auto& json = metadata.value();
+    if (!json.contains("key_slots")) {
+        return Result<void>(ErrorCode::InvalidArgument, "Capsule " + id + " has no recipients");
+    }
+    auto slots = KeySlots::from_json(json["key_slots"], *crypto_);
+    if (!slots) {
+        return Result<void>(slots.error(), slots.error_message());
+    }
+    if (!slots.value().contains(recipient)) {
+        return Result<void>(ErrorCode::InvalidArgument, recipient + " is not a recipient of " + id);
+    }
+    if (slots.value().size() == 1) {
+        return Result<void>(ErrorCode::InvalidArgument, "Cannot remove the last recipient of " + id);
+    }
+    slots.value().remove(recipient);
+    json["key_slots"] = slots.value().to_json(*crypto_);
+    return write_metadata(id, json);
+}
+
+Result<std::vector<std::string>> Store::recipients(const std::string& id) {
+    auto metadata = read_metadata(id);
+    if (!metadata) {
+        return Result<std::vector<std::string>>(metadata.error(), metadata.error_message());
+    }
+    if (!metadata.value().contains("key_slots")) {
+        return Result<std::vector<std::string>>(std::vector<std::string>{});
+    }
+    auto slots = KeySlots::from_json(metadata.value()["key_slots"], *crypto_);
+    if (!slots) {
+        return Result<std::vector<std::string>>(slots.error(), slots.error_message());
+    }
+    return Result<std::vector<std::string>>(slots.value().recipients());
+}
+
+Result<std::vector<uint8_t>> Store::read_range(const std::string& id, size_t stage, uint64_t offset, uint64_t length) {
+    auto layout = read_layout(id);
+    if (!layout) {
+        return Result<std::vector<uint8_t>>(layout.error(), layout.error_message());
+    }
+    return read_range(id, layout.value(), stage, offset, length);
+}
+
+Result<std::vector<uint8_t>> Store::read_stage(const std::string& id, size_t stage) {
+    auto layout = read_layout(id);
+    if (!layout) {
+        return Result<std::vector<uint8_t>>(layout.error(), layout.error_message());
+    }
+    if (stage >= layout.value().stages.size()) {
+        return Result<std::vector<uint8_t>>(ErrorCode::InvalidArgument, "No such stage in capsule " + id);
+    }
+    return read_range(id, layout.value(), stage, 0, layout.value().stages[stage].length);
+}
+
+Result<std::vector<uint8_t>> Store::read_range(const std::string& id, const ChunkedLayout& layout, size_t stage,
+                                               uint64_t offset, uint64_t length) {
+    auto hot = ensure_hot(id);
+    if (!hot) {
+        return Result<std::vector<uint8_t>>(hot.error(), hot.error_message());
+    }
+    auto path = capsule_path(id);
+    if (buffer_pool_) {
+        auto direct_file = DirectFile::open(path, DirectFile::Mode::Read, *buffer_pool_);
+        if (!direct_file) {
+            return Result<std::vector<uint8_t>>(direct_file.error(), direct_file.error_message());
+        }
+        std::istream capsule(direct_file.value().get());
+        return ChunkedCapsule::read(*crypto_, capsule, layout, stage, offset, length);
+    }
+    std::ifstream capsule(path, std::ios::binary);
+    if (!capsule) {
+        return Result<std::vector<uint8_t>>(ErrorCode::FILE_ACCESS_ERROR, "Failed to read encrypted file: " + path.string());
+    }
+    return ChunkedCapsule::read(*crypto_, capsule, layout, stage, offset, length);
+}
+
+Result<uint64_t> Store::unlock_to(const std::string& id, const fs::path& output, std::optional<size_t> stage) {
+    auto layout = read_layout(id);
+    if (!layout) {
+        return Result<uint64_t>(layout.error(), layout.error_message());
+    }
+    std::vector<size_t> selected;
+    if (stage) {
+        if (*stage >= layout.value().stages.size()) {
+            return Result<uint64_t>(ErrorCode::InvalidArgument, "No such stage in capsule " + id);
+        }
+        selected.push_back(*stage);
+    } else {
+        for (size_t i = 0; i < layout.value().stages.size(); ++i) {
+            selected.push_back(i);
+        }
+    }
+    uint64_t total = 0;
+    for (auto index : selected) {
+        total += layout.value().stages[index].length;
+    }
+
+    std::error_code ec;
+    ProgressJournal journal;
+    journal.operation = "unlock";
+    journal.source = id;
+    journal.source_size = layout.value().plaintext_size;
+    journal.output = fs::absolute(output, ec).lexically_normal().string();
+    journal.instance = ProgressJournal::capsule_instance(layout.value()); // A re-locked capsule starts over
+    journal.stage = stage;
+    auto journal_path = checkpoints_.interval != 0 ? progress_path(id, "unlock") : fs::path();
+    if (!journal_path.empty() && checkpoints_.resume) {
+        auto saved = ProgressJournal::load(journal_path);
+        auto size = fs::file_size(output, ec);
+        if (saved && saved.value().same_operation(journal) && !ec && size >= saved.value().done) {
+            journal.done = saved.value().done;
+        }
+    }
+
+    auto file = OutputFile::open(output, buffer_pool_.get(), journal.done);
+    if (!file) {
+        return Result<uint64_t>(file.error(), file.error_message());
+    }
+    const uint64_t batch = uint64_t{checkpoints_.interval != 0 ? checkpoints_.interval : CheckpointOptions::DEFAULT_INTERVAL} *
+                           layout.value().segment_size;
+    uint64_t position = 0; // Output bytes of the stages before the current one
+    for (auto index : selected) {
+        const auto& current = layout.value().stages[index];
+        for (uint64_t offset = journal.done > position ? journal.done - position : 0; offset < current.length;) {
+            auto length = std::min(batch, current.length - offset);
+            auto part = read_range(id, layout.value(), index, offset, length);
+            if (!part) {
+                return Result<uint64_t>(part.error(), part.error_message());
+            }
+            file.value().stream().write(reinterpret_cast<const char*>(part.value().data()),
+                                        static_cast<std::streamsize>(part.value().size()));
+            std::fill(part.value().begin(), part.value().end(), 0);
+            offset += length;
+            if (journal_path.empty() || position + offset == total) {
+                continue;
+            }
+            auto durable = file.value().checkpoint();
+            if (!durable) {
+                return Result<uint64_t>(durable.error(), durable.error_message());
+            }
+            journal.done = durable.value();
+            auto saved = journal.save(journal_path);
+            if (!saved) {
+                return Result<uint64_t>(saved.error(), saved.error_message());
+            }
+        }
+        position += current.length;
+    }
+    auto closed = file.value().close();
+    if (!closed) {
+        return Result<uint64_t>(closed.error(), closed.error_message());
+    }
+    if (!journal_path.empty()) {
+        fs::remove(journal_path, ec);
+    }
+    return Result<uint64_t>(total);
+}
+
+Result<std::vector<std::string>> Store::mark_released(const std::string& id) {
+    auto catalog_result = catalog();
+    if (!catalog_result) {
+        return Result<std::vector<std::string>>(catalog_result.error(), catalog_result.error_message());
+    }
+    return catalog_result.value()->mark_released(id);
+}
+
+Result<std::vector<std::string>> Store::destroy(const std::string& id, const std::string& reason) {
+    auto catalog_result = catalog();
+    if (!catalog_result) {
+        return Result<std::vector<std::string>>(catalog_result.error(), catalog_result.error_message());
+    }
+    auto audit = audit_log();
+    if (!audit) {
+        return Result<std::vector<std::string>>(audit.error(), audit.error_message());
+    }
+
+    auto shard = lock_capsules({id});
+    if (!shard) {
+        return Result<std::vector<std::string>>(shard.error(), shard.error_message());
+    }
+
+    // Metadata holds the data keys: shred it first so a crash mid-way leaves undecryptable ciphertext
+    for (const auto& path : {metadata_path(id), capsule_path(id)}) {
+        if (!fs::exists(path)) {
+            continue;
+        }
+        auto deleted = secure_delete(path);
+        if (!deleted) {
+            return Result<std::vector<std::string>>(deleted.error(), deleted.error_message());
+        }
+    }
+
+    auto tier_manager = tiers();
+    if (tier_manager && tier_manager.value()->is_cold(id)) {
+        auto dropped = tier_manager.value()->drop(id);
+        if (!dropped) {
+            return Result<std::vector<std::string>>(dropped.error(), dropped.error_message());
+        }
+    }
+
+    nlohmann::json details;
+    details["reason"] = reason;
+    auto logged = audit.value()->append("destroy", id, details);
+    if (!logged) {
+        return Result<std::vector<std::string>>(logged.error(), logged.error_message());
+    }
+
+    if (!catalog_result.value()->contains(id)) {
+        return Result<std::vector<std::string>>(std::vector<std::string>{});
+    }
+    return catalog_result.value()->remove(id);
+}
+
+Result<AuditLog*> Store::audit_log() {
+    if (!audit_log_) {
+        auto log = std::make_unique<AuditLog>(*crypto_);
+        auto opened = log->open(root_ / AuditLog::FILENAME);
+        if (!opened) {
+            return Result<AuditLog*>(opened.error(), opened.error_message());
+        }
+        audit_log_ = std::move(log);
+    }
+    return Result<AuditLog*>(audit_log_.get());
+}
+
+Result<TierManager*> Store::tiers() {
+    std::lock_guard<std::mutex> guard(tiers_mutex_);
+    if (!tiers_) {
+        auto manager = std::make_unique<TierManager>(*this, tier_options_);
+        auto opened = manager->open();
+        if (!opened) {
+            return Result<TierManager*>(opened.error(), opened.error_message());
+        }
+        tiers_ = std::move(manager);
+    }
+    return Result<TierManager*>(tiers_.get());
+}
+
+void Store::set_tier_options(TierOptions options) {
+    std::lock_guard<std::mutex> guard(tiers_mutex_);
+    tier_options_ = std::move(options);
+    tiers_.reset();
+}
+
+Result<void> Store::ensure_hot(const std::string& id) {
+    if (fs::exists(capsule_path(id))) {
+        return Result<void>();
+    }
+    auto tier_manager = tiers();
+    if (!tier_manager) {
+        return Result<void>(tier_manager.error(), tier_manager.error_message());
+    }
+    if (!tier_manager.value()->is_cold(id)) {
+        return Result<void>(ErrorCode::FILE_ACCESS_ERROR, "Failed to read encrypted file: " + capsule_path(id).string());
+    }
+    return tier_manager.value()->promote(id);
+}
+
+Result<Catalog*> Store::catalog() {
+    if (!catalog_loaded_) {
+        auto journal_path = root_ / Catalog::JOURNAL_FILENAME;
+        if (!fs::exists(journal_path) && exists()) {
+            // Stores created before the catalog existed: index their metadata once
+            auto rebuilt = rebuild_catalog();
+            if (!rebuilt) {
+                return Result<Catalog*>(rebuilt.error(), rebuilt.error_message());
+            }
+        } else {
+            auto loaded = catalog_.load(journal_path);
+            if (!loaded) {
+                return Result<Catalog*>(loaded.error(), loaded.error_message());
+            }
+        }
+        catalog_loaded_ = true;
+    }
+    return Result<Catalog*>(&catalog_);
+}
+
+Result<CatalogChanges> Store::restore_catalog(CatalogImage image) {
+    auto changes = catalog_.restore(catalog_journal_path(), std::move(image));
+    catalog_loaded_ = changes.isSuccess();
+    return changes;
+}
+
+Result<void> Store::rebuild_catalog() {
+    auto journal_path = root_ / Catalog::JOURNAL_FILENAME;
+    std::error_code ec;
+    fs::remove(journal_path, ec);
+    auto loaded = catalog_.load(journal_path);
+    if (!loaded) {
+        return loaded;
+    }
+
+    // Groups first, so their members can join them
+    for (const auto& file : fs::directory_iterator(root_ / GROUPS_DIRNAME, ec)) {
+        if (file.path().extension() != ".json") {
+            continue;
+        }
+        auto name = file.path().stem().string();
+        auto policy = group_policy(name);
+        if (!policy) {
+            continue;
+        }
+        auto put = catalog_.put_group(make_group_entry(name, policy.value()));
+        if (!put) {
+            return put;
+        }
+    }
+    ec.clear();
+
+    std::unordered_map<std::string, CatalogEntry> pending;
+    for (const auto& id : scan_capsule_ids()) {
+        auto metadata = read_metadata(id);
+        if (!metadata) {
+            continue;
+        }
+        auto policy = read_policy(id);
+        if (!policy) {
+            continue;
+        }
+        auto size = fs::file_size(capsule_path(id), ec);
+        if (ec) {
+            auto tier_manager = tiers();
+            auto cold = tier_manager ? tier_manager.value()->location(id) : std::nullopt;
+            if (cold) {
+                size = cold->length;
+                ec.clear();
+            }
+        }
+        auto entry = make_catalog_entry(id, metadata.value(), policy.value(), ec ? 0 : size);
+        auto description = describe_metadata(metadata.value());
+        try {
+            if (description) {
+                entry.blind_tokens = blind_tokens(description.value());
+            }
+        } catch (const TCFSException&) {
+            // Left out of searches until the next rebuild
+        }
+        pending.emplace(id, std::move(entry));
+    }
+
+    // Insert dependencies before their dependents; drop edges to capsules that no longer exist
+    std::unordered_set<std::string> visiting;
+    std::function<Result<void>(const std::string&)> insert = [&](const std::string& id) -> Result<void> {
+        auto it = pending.find(id);
+        if (it == pending.end() || catalog_.contains(id) || !visiting.insert(id).second) {
+            return Result<void>();
+        }
+        auto entry = it->second;
+        std::vector<std::string> kept;
+        for (const auto& dependency : entry.depends_on) {
+            auto inserted = insert(dependency);
+            if (!inserted) {
+                return inserted;
+            }
+            if (catalog_.contains(dependency)) {
+                kept.push_back(dependency);
+            }
+        }
+        entry.depends_on = std::move(kept);
+        return catalog_.put(entry);
+    };
+    for (const auto& [id, entry] : pending) {
+        auto inserted = insert(id);
+        if (!inserted) {
+            return inserted;
+        }
+    }
+    catalog_loaded_ = true;
+    return Result<void>();
+}
+
+CatalogEntry Store::make_catalog_entry(const std::string& id, const nlohmann::json& metadata,
+                                       const Policy& policy, uint64_t size) {
+    CatalogEntry entry;
+    entry.id = id;
+    entry.original_filename = metadata.value("original_filename", id);
+    entry.owner = policy.owner();
+    entry.label = policy.label();
+    entry.notes = policy.notes();
+    entry.unlock_at = static_cast<int64_t>(std::chrono::system_clock::to_time_t(policy.unlock_time()));
+    entry.grace_seconds = policy.grace_seconds();
+    entry.size = size;
+    entry.has_schedule_rules = policy.has_condition() || policy.recurrence().has_value();
+    entry.depends_on = policy.depends_on();
+    if (policy.expire_at()) {
+        entry.expire_at = static_cast<int64_t>(std::chrono::system_clock::to_time_t(*policy.expire_at()));
+    }
+    entry.group = metadata.value(GROUP_FIELD, "");
+    return entry;
+}
+
+GroupEntry Store::make_group_entry(const std::string& name, const Policy& policy) {
+    GroupEntry group;
+    group.name = name;
+    group.label = policy.label();
+    group.unlock_at = static_cast<int64_t>(std::chrono::system_clock::to_time_t(policy.unlock_time()));
+    group.grace_seconds = policy.grace_seconds();
+    group.has_schedule_rules = policy.has_condition() || policy.recurrence().has_value();
+    if (policy.expire_at()) {
+        group.expire_at = static_cast<int64_t>(std::chrono::system_clock::to_time_t(*policy.expire_at()));
+    }
+    return group;
+}
+
+} // namespace tcfs
@@ -0,0 +1,581 @@
+#include "tcfs/TierManager.hpp"
+#include "tcfs/FileSync.hpp"
+#include "tcfs/Store.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+namespace tcfs {
+
+namespace {
+
+constexpr size_t COPY_CHUNK = 1024 * 1024;
+
+bool copy_range(std::istream& input, uint64_t offset, uint64_t length, std::ostream& output) {
+    std::vector<char> buffer(COPY_CHUNK);
+    input.seekg(static_cast<std::streamoff>(offset));
+    for (uint64_t done = 0; done < length;) {
+        auto chunk = static_cast<size_t>(std::min<uint64_t>(buffer.size(), length - done));
+        input.read(buffer.data(), static_cast<std::streamsize>(chunk));
+        if (static_cast<size_t>(input.gcount()) != chunk) {
+            return false;
+        }
+        output.write(buffer.data(), static_cast<std::streamsize>(chunk));
+        if (!output) {
+            return false;
+        }
+        done += chunk;
+    }
+    return true;
+}
+
+nlohmann::json record(const std::string& op, const std::string& id) {
+    nlohmann::json json;
+    json["op"] = op;
+    json["id"] = id;
+    return json;
+}
+
+nlohmann::json cold_record(const std::string& id, const ColdLocation& location) {
+    auto json = record("cold", id);
+    json["pack"] = location.pack;
+    json["offset"] = location.offset;
+    json["length"] = location.length;
+    return json;
+}
+
+} // namespace
+
+TierManager::TierManager(Store& store, TierOptions options)
+    : store_(store),
+      options_(std::move(options)),
+      cold_dir_(options_.cold_dir.empty() ? store.root() / COLD_DIRNAME : options_.cold_dir),
+      journal_path_(store.root() / JOURNAL_FILENAME),
+      budget_(options_.bytes_per_second, options_.bytes_per_second) {
+}
+
+Result<void> TierManager::open() {
+    std::lock_guard<std::mutex> guard(mutex_);
+    journal_offset_ = 0;
+    sequence_ = 0;
+    cold_.clear();
+    pack_live_bytes_.clear();
+    return refresh_locked();
+}
+
+Result<void> TierManager::recover() {
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto refreshed = refresh_locked();
+    if (!refreshed) {
+        return refreshed;
+    }
+
+    // A hot file is complete (it is only ever created by rename), so it shadows the cold copy
+    std::vector<nlohmann::json> records;
+    for (const auto& [id, location] : cold_) {
+        if (fs::exists(store_.capsule_path(id))) {
+            records.push_back(record("hot", id));
+        }
+    }
+    auto appended = append_locked(std::move(records));
+    if (!appended) {
+        return appended;
+    }
+
+    std::error_code ec;
+    for (fs::directory_iterator it(cold_dir_, ec), end; !ec && it != end; it.increment(ec)) {
+        const auto& path = it->path();
+        auto name = path.filename().string();
+        bool temporary = path.extension() == ".tmp";
+        bool orphan = path.extension() == PACK_EXTENSION && pack_live_bytes_.count(pack_key(path)) == 0;
+        if (temporary || orphan) {
+            std::error_code remove_ec;
+            fs::remove(path, remove_ec);
+            log("Removed " + std::string(temporary ? "unfinished" : "unreferenced") + " pack " + name);
+        }
+    }
+    for (auto it = pack_live_bytes_.begin(); it != pack_live_bytes_.end();) {
+        auto pack = (it++)->first;
+        delete_pack_if_empty_locked(pack);
+    }
+    return Result<void>();
+}
+
+bool TierManager::is_cold(const std::string& capsule_id) const {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return cold_.count(capsule_id) != 0;
+}
+
+std::optional<ColdLocation> TierManager::location(const std::string& capsule_id) const {
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto it = cold_.find(capsule_id);
+    if (it == cold_.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+size_t TierManager::cold_count() const {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return cold_.size();
+}
+
+uint64_t TierManager::cold_bytes() const {
+    std::lock_guard<std::mutex> guard(mutex_);
+    uint64_t total = 0;
+    for (const auto& [pack, live] : pack_live_bytes_) {
+        total += live;
+    }
+    return total;
+}
+
+Result<void> TierManager::demote(const std::vector<std::string>& capsule_ids) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto refreshed = refresh_locked();
+    if (!refreshed) {
+        return refreshed;
+    }
+    return demote_locked(capsule_ids);
+}
+
+Result<void> TierManager::promote(const std::string& capsule_id) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto refreshed = refresh_locked();
+    if (!refreshed) {
+        return refreshed;
+    }
+    return promote_locked(capsule_id);
+}
+
+Result<void> TierManager::drop(const std::string& capsule_id) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto refreshed = refresh_locked();
+    if (!refreshed) {
+        return refreshed;
+    }
+    auto it = cold_.find(capsule_id);
+    if (it == cold_.end()) {
+        return Result<void>();
+    }
+    auto location = it->second;
+
+    // The keys are already gone with the metadata; zeroing the range keeps the ciphertext from lingering until compaction
+    {
+        std::fstream pack(pack_path(location.pack), std::ios::binary | std::ios::in | std::ios::out);
+        if (pack) {
+            std::vector<char> zeros(static_cast<size_t>(std::min<uint64_t>(COPY_CHUNK, location.length)), 0);
+            pack.seekp(static_cast<std::streamoff>(location.offset));
+            for (uint64_t done = 0; done < location.length;) {
+                auto chunk = std::min<uint64_t>(zeros.size(), location.length - done);
+                pack.write(zeros.data(), static_cast<std::streamsize>(chunk));
+                done += chunk;
+            }
+        }
+    }
+    sync_path(pack_path(location.pack));
+
+    auto appended = append_locked({record("drop", capsule_id)});
+    if (!appended) {
+        return appended;
+    }
+    delete_pack_if_empty_locked(location.pack);
+    return Result<void>();
+}
+
+Result<size_t> TierManager::compact() {
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto refreshed = refresh_locked();
+    if (!refreshed) {
+        return Result<size_t>(refreshed.error(), refreshed.error_message());
+    }
+    return compact_locked(std::nullopt);
+}
+
+TierPass TierManager::migrate(const TimePoint& now) {
+    TierPass pass;
+    auto catalog = store_.catalog();
+    if (!catalog) {
+        log("Catalog unavailable: " + catalog.error_message());
+        return pass;
+    }
+
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto refreshed = refresh_locked();
+    if (!refreshed) {
+        log("Tier journal unavailable: " + refreshed.error_message());
+        return pass;
+    }
+
+    const auto now_seconds = std::chrono::duration_cast<std::chrono::seconds>(now.time_since_epoch()).count();
+    auto opens_in = [now_seconds](const CatalogEntry& entry) {
+        return entry.unlock_at - static_cast<int64_t>(entry.grace_seconds) - now_seconds;
+    };
+
+    // Promote first, soonest unlock first, so the budget goes to capsules about to be read
+    std::vector<std::pair<int64_t, std::string>> promotions;
+    for (const auto& [id, location] : cold_) {
+        const auto* entry = catalog.value()->find(id);
+        if (entry && (entry->state == CapsuleState::Released || opens_in(*entry) <= options_.promote_before.count())) {
+            promotions.emplace_back(opens_in(*entry), id);
+        }
+    }
+    std::sort(promotions.begin(), promotions.end());
+    for (const auto& [opens, id] : promotions) {
+        if (!budget_.try_consume(cold_.at(id).length, now)) {
+            return pass;
+        }
+        auto promoted = promote_locked(id);
+        if (promoted) {
+            pass.promoted.push_back(id);
+        } else {
+            log("Promotion of " + id + " failed: " + promoted.error_message());
+            pass.failed.push_back(id);
+        }
+    }
+
+    if (enabled()) {
+        // Furthest unlock first; the threshold never drops below promote_before so capsules do not bounce
+        auto threshold = std::max(options_.demote_after, options_.promote_before).count();
+        std::vector<std::pair<int64_t, std::string>> candidates;
+        for (const auto* entry : catalog.value()->entries()) {
+            if (entry->state == CapsuleState::Locked && cold_.count(entry->id) == 0 && opens_in(*entry) > threshold) {
+                candidates.emplace_back(opens_in(*entry), entry->id);
+            }
+        }
+        std::sort(candidates.rbegin(), candidates.rend());
+
+        std::vector<std::string> batch;
+        uint64_t batch_bytes = 0;
+        for (const auto& candidate : candidates) {
+            const auto& id = candidate.second;
+            std::error_code ec;
+            auto size = fs::file_size(store_.capsule_path(id), ec);
+            if (ec) {
+                continue;
+            }
+            if (batch_bytes > 0 && batch_bytes + size > options_.pack_target_bytes) {
+                break;
+            }
+            if (!budget_.try_consume(size, now)) {
+                break;
+            }
+            batch.push_back(id);
+            batch_bytes += size;
+        }
+        if (!batch.empty()) {
+            auto demoted = demote_locked(batch);
+            if (demoted) {
+                pass.demoted = std::move(batch);
+            } else {
+                log("Demotion failed: " + demoted.error_message());
+                pass.failed.insert(pass.failed.end(), batch.begin(), batch.end());
+            }
+        }
+    }
+
+    auto compacted = compact_locked(now);
+    if (compacted) {
+        pass.packs_compacted = compacted.value();
+    } else {
+        log("Compaction failed: " + compacted.error_message());
+    }
+    return pass;
+}
+
+Result<void> TierManager::refresh_locked() {
+    std::error_code ec;
+    if (!fs::exists(journal_path_, ec)) {
+        return Result<void>();
+    }
+    auto journal_size = fs::file_size(journal_path_, ec);
+    if (ec) {
+        return Result<void>(ErrorCode::FILE_ACCESS_ERROR, "Failed to stat tier journal: " + ec.message());
+    }
+    if (journal_size < journal_offset_) {
+        journal_offset_ = 0;
+        sequence_ = 0;
+        cold_.clear();
+        pack_live_bytes_.clear();
+    }
+
+    std::ifstream journal(journal_path_, std::ios::binary);
+    if (!journal) {
+        return Result<void>(ErrorCode::FILE_ACCESS_ERROR, "Failed to open tier journal: " + journal_path_.string());
+    }
+    journal.seekg(static_cast<std::streamoff>(journal_offset_));
+
+    std::string line;
+    while (std::getline(journal, line)) {
+        if (journal.eof()) {
+            break; // Torn trailing record: the migration it belongs to never completed
+        }
+        journal_offset_ += line.size() + 1;
+        if (line.empty()) {
+            continue;
+        }
+        auto record = nlohmann::json::parse(line, nullptr, false);
+        if (record.is_discarded() || !record.is_object()) {
+            return Result<void>(ErrorCode::InvalidMetadata, "Corrupted tier journal record");
+        }
+        apply(record);
+    }
+    return Result<void>();
+}
+
+Result<void> TierManager::append_locked(std::vector<nlohmann::json> records) {
+    if (records.empty()) {
+        return Result<void>();
+    }
+    std::string lines;
+    for (auto& record : records) {
+        record["seq"] = ++sequence_;
+        lines += record.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace) + "\n";
+    }
+
+    {
+        std::ofstream journal(journal_path_, std::ios::binary | std::ios::app);
+        journal.write(lines.data(), static_cast<std::streamsize>(lines.size()));
+        journal.flush();
+        if (!journal) {
+            return Result<void>(ErrorCode::FILE_ACCESS_ERROR, "Failed to append to tier journal");
+        }
+    }
+    if (!sync_path(journal_path_)) {
+        return Result<void>(ErrorCode::FILE_ACCESS_ERROR, "Failed to sync tier journal");
+    }
+    return refresh_locked();
+}
+
+void TierManager::apply(const nlohmann::json& record) {
+    sequence_ = std::max(sequence_, record.value("seq", uint64_t{0}));
+    auto id = record.value("id", "");
+    auto op = record.value("op", "");
+
+    auto previous = cold_.find(id);
+    if (previous != cold_.end()) {
+        pack_live_bytes_[previous->second.pack] -= previous->second.length;
+        cold_.erase(previous);
+    }
+    if (op == "cold") {
+        ColdLocation location;
+        location.pack = record.value("pack", "");
+        location.offset = record.value("offset", uint64_t{0});
+        location.length = record.value("length", uint64_t{0});
+        pack_live_bytes_[location.pack] += location.length;
+        cold_.emplace(id, std::move(location));
+    }
+}
+
+fs::path TierManager::pack_path(const std::string& pack) const {
+    fs::path path(pack);
+    return path.is_absolute() ? path : store_.root() / path;
+}
+
+std::string TierManager::pack_key(const fs::path& path) const {
+    auto relative = path.lexically_relative(store_.root());
+    return !relative.empty() && *relative.begin() != ".." ? relative.generic_string() : path.generic_string();
+}
+
+Result<std::string> TierManager::write_pack_locked(const std::vector<PackSource>& sources,
+                                                   std::vector<ColdLocation>& locations) {
+    std::error_code ec;
+    fs::create_directories(cold_dir_, ec);
+
+    // Number packs after the highest one present so names are never reused
+    uint64_t number = 0;
+    for (fs::directory_iterator it(cold_dir_, ec), end; !ec && it != end; it.increment(ec)) {
+        auto stem = it->path().stem().string();
+        unsigned long long parsed = 0;
+        if (std::sscanf(stem.c_str(), "pack-%llu", &parsed) == 1) {
+            number = std::max<uint64_t>(number, parsed);
+        }
+    }
+    char name[32];
+    std::snprintf(name, sizeof(name), "pack-%08llu", static_cast<unsigned long long>(number + 1));
+    auto path = cold_dir_ / (std::string(name) + PACK_EXTENSION);
+    auto temp_path = fs::path(path.string() + ".tmp");
+
+    auto pack = pack_key(path);
+
+    locations.clear();
+    {
+        std::ofstream output(temp_path, std::ios::binary | std::ios::trunc);
+        uint64_t offset = 0;
+        for (const auto& source : sources) {
+            std::ifstream input(source.path, std::ios::binary);
+            if (!input || !copy_range(input, source.offset, source.length, output)) {
+                output.close();
+                fs::remove(temp_path, ec);
+                return Result<std::string>(ErrorCode::FILE_ACCESS_ERROR, "Failed to copy " + source.path.string() + " into a pack");
+            }
+            locations.push_back({pack, offset, source.length});
+            offset += source.length;
+        }
+        output.close();
+        if (!output) {
+            fs::remove(temp_path, ec);
+            return Result<std::string>(ErrorCode::FILE_ACCESS_ERROR, "Failed to write pack: " + temp_path.string());
+        }
+    }
+    if (!sync_path(temp_path)) {
+        fs::remove(temp_path, ec);
+        return Result<std::string>(ErrorCode::FILE_ACCESS_ERROR, "Failed to sync pack: " + temp_path.string());
+    }
+    fs::rename(temp_path, path, ec);
+    if (ec) {
+        fs::remove(temp_path, ec);
+        return Result<std::string>(ErrorCode::FILE_ACCESS_ERROR, "Failed to publish pack: " + path.string());
+    }
+    sync_path(cold_dir_);
+    return Result<std::string>(pack);
+}
+
+Result<void> TierManager::demote_locked(const std::vector<std::string>& capsule_ids) {
+    std::vector<PackSource> sources;
+    std::vector<std::string> ids;
+    for (const auto& id : capsule_ids) {
+        if (cold_.count(id) != 0) {
+            continue;
+        }
+        std::error_code ec;
+        auto path = store_.capsule_path(id);
+        auto size = fs::file_size(path, ec);
+        if (ec) {
+            return Result<void>(ErrorCode::FileNotFound, "Capsule is not in the hot tier: " + id);
+        }
+        sources.push_back({path, 0, size});
+        ids.push_back(id);
+    }
+    if (ids.empty()) {
+        return Result<void>();
+    }
+
+    std::vector<ColdLocation> locations;
+    auto pack = write_pack_locked(sources, locations);
+    if (!pack) {
+        return Result<void>(pack.error(), pack.error_message());
+    }
+
+    std::vector<nlohmann::json> records;
+    for (size_t i = 0; i < ids.size(); ++i) {
+        records.push_back(cold_record(ids[i], locations[i]));
+    }
+    auto appended = append_locked(std::move(records));
+    if (!appended) {
+        return appended;
+    }
+
+    // Only now is the cold copy durable and referenced
+    for (const auto& id : ids) {
+        std::error_code ec;
+        fs::remove(store_.capsule_path(id), ec);
+    }
+    sync_path(store_.root());
+    log("Demoted " + std::to_string(ids.size()) + " capsule(s) to " + pack.value());
+    return Result<void>();
+}
+
+Result<void> TierManager::promote_locked(const std::string& capsule_id) {
+    auto it = cold_.find(capsule_id);
+    if (it == cold_.end()) {
+        return Result<void>(ErrorCode::FileNotFound, "Capsule is not in the cold tier: " + capsule_id);
+    }
+    auto location = it->second;
+    auto path = store_.capsule_path(capsule_id);
+    auto temp_path = fs::path(path.string() + ".tmp");
+    std::error_code ec;
+
+    if (!fs::exists(path)) {
+        {
+            std::ifstream input(pack_path(location.pack), std::ios::binary);
+            std::ofstream output(temp_path, std::ios::binary | std::ios::trunc);
+            bool copied = input && copy_range(input, location.offset, location.length, output);
+            output.close();
+            if (!copied || !output) {
+                fs::remove(temp_path, ec);
+                return Result<void>(ErrorCode::FILE_ACCESS_ERROR, "Failed to copy " + capsule_id + " out of " + location.pack);
+            }
+        }
+        if (!sync_path(temp_path)) {
+            fs::remove(temp_path, ec);
+            return Result<void>(ErrorCode::FILE_ACCESS_ERROR, "Failed to sync promoted capsule: " + capsule_id);
+        }
+        fs::rename(temp_path, path, ec);
+        if (ec) {
+            fs::remove(temp_path, ec);
+            return Result<void>(ErrorCode::FILE_ACCESS_ERROR, "Failed to restore capsule: " + path.string());
+        }
+        sync_path(store_.root());
+    }
+
+    auto appended = append_locked({record("hot", capsule_id)});
+    if (!appended) {
+        return appended;
+    }
+    delete_pack_if_empty_locked(location.pack);
+    return Result<void>();
+}
+
+Result<size_t> TierManager::compact_locked(const std::optional<TimePoint>& now) {
+    std::vector<std::string> sparse;
+    for (const auto& [pack, live] : pack_live_bytes_) {
+        std::error_code ec;
+        auto size = fs::file_size(pack_path(pack), ec);
+        if (!ec && size > 0 && live > 0 && static_cast<double>(live) < options_.compact_below * static_cast<double>(size)) {
+            sparse.push_back(pack);
+        }
+    }
+
+    size_t compacted = 0;
+    for (const auto& pack : sparse) {
+        if (now && !budget_.try_consume(pack_live_bytes_[pack], *now)) {
+            break;
+        }
+
+        std::vector<std::string> ids;
+        std::vector<PackSource> sources;
+        for (const auto& [id, location] : cold_) {
+            if (location.pack == pack) {
+                ids.push_back(id);
+                sources.push_back({pack_path(pack), location.offset, location.length});
+            }
+        }
+
+        std::vector<ColdLocation> locations;
+        auto written = write_pack_locked(sources, locations);
+        if (!written) {
+            return Result<size_t>(written.error(), written.error_message());
+        }
+        std::vector<nlohmann::json> records;
+        for (size_t i = 0; i < ids.size(); ++i) {
+            records.push_back(cold_record(ids[i], locations[i]));
+        }
+        auto appended = append_locked(std::move(records));
+        if (!appended) {
+            return Result<size_t>(appended.error(), appended.error_message());
+        }
+        delete_pack_if_empty_locked(pack);
+        ++compacted;
+    }
+    return Result<size_t>(compacted);
+}
+
+void TierManager::delete_pack_if_empty_locked(const std::string& pack) {
+    auto it = pack_live_bytes_.find(pack);
+    if (it == pack_live_bytes_.end() || it->second != 0) {
+        return;
+    }
+    std::error_code ec;
+    fs::remove(pack_path(pack), ec);
+    pack_live_bytes_.erase(it);
+}
+
+void TierManager::log(const std::string& message) const {
+    if (options_.log) {
+        options_.log(message);
+    }
+}
+
+} // namespace tcfs
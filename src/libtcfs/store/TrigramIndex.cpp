@@ -0,0 +1,271 @@
+#include "tcfs/TrigramIndex.hpp"
+#include <algorithm>
+#include <cctype>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace tcfs {
+
+namespace {
+
+std::string lowercase(const std::string& text) {
+    std::string result(text);
+    std::transform(result.begin(), result.end(), result.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return result;
+}
+
+// Match one glob element at p (literal, '?' or class) against c; next is the element after it
+bool element_matches(const std::string& pattern, size_t p, char c, size_t& next) {
+    if (pattern[p] == '?') {
+        next = p + 1;
+        return true;
+    }
+    if (pattern[p] == '[') {
+        auto close = pattern.find(']', p + 2);
+        if (close != std::string::npos) {
+            size_t i = p + 1;
+            bool negate = pattern[i] == '!' || pattern[i] == '^';
+            i += negate ? 1 : 0;
+            bool found = false;
+            for (; i < close; ++i) {
+                if (i + 2 < close && pattern[i + 1] == '-') {
+                    found = found || (c >= pattern[i] && c <= pattern[i + 2]);
+                    i += 2;
+                } else {
+                    found = found || c == pattern[i];
+                }
+            }
+            next = close + 1;
+            return found != negate;
+        }
+    }
+    if (pattern[p] == '\\' && p + 1 < pattern.size()) {
+        next = p + 2;
+        return pattern[p + 1] == c;
+    }
+    next = p + 1;
+    return pattern[p] == c;
+}
+
+} // namespace
+
+uint32_t TrigramIndex::key(const std::string& text, size_t at) {
+    return static_cast<uint32_t>(static_cast<unsigned char>(text[at])) << 16 |
+           static_cast<uint32_t>(static_cast<unsigned char>(text[at + 1])) << 8 |
+           static_cast<uint32_t>(static_cast<unsigned char>(text[at + 2]));
+}
+
+void TrigramIndex::append(Postings& postings, uint32_t slot) {
+    // The first delta is the slot itself
+    uint32_t delta = postings.count == 0 ? slot : slot - postings.last;
+    while (delta >= 0x80) {
+        postings.bytes.push_back(static_cast<uint8_t>(delta | 0x80));
+        delta >>= 7;
+    }
+    postings.bytes.push_back(static_cast<uint8_t>(delta));
+    postings.last = slot;
+    ++postings.count;
+}
+
+std::vector<uint32_t> TrigramIndex::decode(const Postings& postings) {
+    std::vector<uint32_t> slots;
+    slots.reserve(postings.count + postings.pending.size());
+    uint32_t value = 0;
+    uint32_t delta = 0;
+    int shift = 0;
+    for (uint8_t byte : postings.bytes) {
+        delta |= static_cast<uint32_t>(byte & 0x7f) << shift;
+        if (byte & 0x80) {
+            shift += 7;
+            continue;
+        }
+        value = slots.empty() ? delta : value + delta;
+        slots.push_back(value);
+        delta = 0;
+        shift = 0;
+    }
+    if (!postings.pending.empty()) {
+        auto middle = slots.size();
+        slots.insert(slots.end(), postings.pending.begin(), postings.pending.end());
+        std::sort(slots.begin() + static_cast<std::ptrdiff_t>(middle), slots.end());
+        std::inplace_merge(slots.begin(), slots.begin() + static_cast<std::ptrdiff_t>(middle), slots.end());
+        slots.erase(std::unique(slots.begin(), slots.end()), slots.end());
+    }
+    return slots;
+}
+
+void TrigramIndex::encode(Postings& postings, const std::vector<uint32_t>& slots) {
+    postings.bytes.clear();
+    postings.count = 0;
+    postings.last = 0;
+    postings.pending.clear();
+    for (uint32_t slot : slots) {
+        append(postings, slot);
+    }
+    postings.bytes.shrink_to_fit();
+}
+
+void TrigramIndex::add(uint32_t slot, const std::string& text) {
+    if (text.size() < GRAM) {
+        return;
+    }
+    auto lowered = lowercase(text);
+    std::vector<uint32_t> keys;
+    keys.reserve(lowered.size() - GRAM + 1);
+    for (size_t i = 0; i + GRAM <= lowered.size(); ++i) {
+        keys.push_back(key(lowered, i));
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+    for (uint32_t trigram : keys) {
+        auto& postings = postings_[trigram];
+        if (postings.count == 0 || slot > postings.last) {
+            append(postings, slot);
+        } else if (slot != postings.last) {
+            postings.pending.push_back(slot);
+            if (postings.pending.size() > PENDING_LIMIT) {
+                encode(postings, decode(postings));
+            }
+        }
+    }
+}
+
+std::vector<uint32_t> TrigramIndex::candidates(const std::string& needle) const {
+    std::vector<uint32_t> result;
+    if (needle.size() < GRAM) {
+        return result;
+    }
+    auto lowered = lowercase(needle);
+    std::vector<const Postings*> lists;
+    for (size_t i = 0; i + GRAM <= lowered.size(); ++i) {
+        auto it = postings_.find(key(lowered, i));
+        if (it == postings_.end()) {
+            return result;
+        }
+        lists.push_back(&it->second);
+    }
+    std::sort(lists.begin(), lists.end(), [](const Postings* a, const Postings* b) {
+        return a->count + a->pending.size() < b->count + b->pending.size();
+    });
+    lists.erase(std::unique(lists.begin(), lists.end()), lists.end());
+
+    // Shortest first keeps every intermediate result as small as possible
+    result = decode(*lists.front());
+    for (size_t i = 1; i < lists.size() && !result.empty(); ++i) {
+        result = intersect(result, decode(*lists[i]));
+    }
+    return result;
+}
+
+size_t TrigramIndex::compressed_bytes() const {
+    size_t total = 0;
+    for (const auto& [trigram, postings] : postings_) {
+        total += postings.bytes.size() + postings.pending.size() * sizeof(uint32_t);
+    }
+    return total;
+}
+
+std::vector<uint32_t> TrigramIndex::intersect(const std::vector<uint32_t>& a, const std::vector<uint32_t>& b) {
+    const auto& small = a.size() <= b.size() ? a : b;
+    const auto& large = a.size() <= b.size() ? b : a;
+    std::vector<uint32_t> result;
+    result.reserve(small.size());
+    size_t j = 0;
+    for (uint32_t value : small) {
+#if defined(__SSE2__)
+        // Skip whole blocks of four below value, then test the block with one compare
+        const __m128i wanted = _mm_set1_epi32(static_cast<int>(value));
+        while (j + 4 <= large.size()) {
+            if (large[j + 3] < value) {
+                j += 4;
+                continue;
+            }
+            const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(large.data() + j));
+            if (_mm_movemask_epi8(_mm_cmpeq_epi32(block, wanted)) != 0) {
+                result.push_back(value);
+            }
+            break;
+        }
+        if (j + 4 <= large.size()) {
+            // Advance to the first slot not below value inside the block
+            while (large[j] < value) {
+                ++j;
+            }
+            continue;
+        }
+#endif
+        while (j < large.size() && large[j] < value) {
+            ++j;
+        }
+        if (j < large.size() && large[j] == value) {
+            result.push_back(value);
+        }
+    }
+    return result;
+}
+
+std::vector<std::string> TrigramIndex::glob_literals(const std::string& pattern) {
+    std::vector<std::string> literals;
+    std::string current;
+    for (size_t i = 0; i < pattern.size(); ++i) {
+        char c = pattern[i];
+        if (c == '*' || c == '?' || c == '[') {
+            if (!current.empty()) {
+                literals.push_back(current);
+                current.clear();
+            }
+            if (c == '[') {
+                auto close = pattern.find(']', i + 2);
+                if (close == std::string::npos) {
+                    break; // Unterminated class: keep what came before
+                }
+                i = close;
+            }
+            continue;
+        }
+        if (c == '\\' && i + 1 < pattern.size()) {
+            c = pattern[++i];
+        }
+        current.push_back(c);
+    }
+    if (!current.empty()) {
+        literals.push_back(current);
+    }
+    return literals;
+}
+
+bool TrigramIndex::glob_match(const std::string& pattern, const std::string& text) {
+    // Iterative matcher that backtracks only to the last '*'
+    size_t p = 0;
+    size_t t = 0;
+    size_t star = std::string::npos;
+    size_t star_text = 0;
+    while (t < text.size()) {
+        size_t next = 0;
+        if (p < pattern.size() && pattern[p] == '*') {
+            star = p++;
+            star_text = t;
+            continue;
+        }
+        if (p < pattern.size() && element_matches(pattern, p, text[t], next)) {
+            p = next;
+            ++t;
+            continue;
+        }
+        if (star == std::string::npos) {
+            return false;
+        }
+        p = star + 1;
+        t = ++star_text;
+    }
+    while (p < pattern.size() && pattern[p] == '*') {
+        ++p;
+    }
+    return p == pattern.size();
+}
+
+} // namespace tcfs
@@ -0,0 +1,149 @@
+#include <gtest/gtest.h>
+#include <tcfs/BlindIndex.hpp>
+#include <tcfs/Catalog.hpp>
+#include <tcfs/CatalogSnapshot.hpp>
+#include <tcfs/Store.hpp>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+
+using namespace tcfs;
+namespace fs = std::filesystem;
+
+namespace {
+
+class BlindIndexTest : public ::testing::Test {
+protected:
+    fs::path dir;
+    std::unique_ptr<CryptoProvider> crypto = createCryptoProvider();
+
+    void SetUp() override {
+        dir = fs::temp_directory_path() /
+              ("tcfs_blind_index_" + std::string(::testing::UnitTest::GetInstance()->current_test_info()->name()));
+        fs::remove_all(dir);
+        fs::create_directories(dir / "input");
+    }
+
+    void TearDown() override {
+        fs::remove_all(dir);
+    }
+
+    fs::path write_input(const std::string& name, const std::string& content) {
+        auto path = dir / "input" / name;
+        std::ofstream(path, std::ios::binary) << content;
+        return path;
+    }
+
+    static std::string read_file(const fs::path& path) {
+        std::ifstream in(path, std::ios::binary);
+        return std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    }
+
+    static Policy policy_labelled(const std::string& label) {
+        Policy policy;
+        policy.set_unlock_time("2030-01-01T00:00:00Z");
+        policy.set_owner("test@example.com");
+        policy.set_label(label);
+        policy.set_notes("board minutes, do not circulate");
+        return policy;
+    }
+
+    static bool holds(const std::vector<uint64_t>& tokens, const std::vector<uint64_t>& query) {
+        return std::includes(tokens.begin(), tokens.end(), query.begin(), query.end());
+    }
+};
+
+} // namespace
+
+TEST_F(BlindIndexTest, QueriesAreSubsetsOfTheValueTokens) {
+    BlindIndex index(*crypto, crypto->generateKey());
+    auto tokens = index.tokens("label", "Quarterly-Report");
+    EXPECT_TRUE(std::is_sorted(tokens.begin(), tokens.end()));
+
+    EXPECT_TRUE(holds(tokens, index.query("label", "quarterly-report", BlindMatch::Exact).value()));
+    EXPECT_TRUE(holds(tokens, index.query("label", "QUARTER", BlindMatch::Prefix).value()));
+    EXPECT_TRUE(holds(tokens, index.query("label", "rly-rep", BlindMatch::Contains).value()));
+    EXPECT_FALSE(holds(tokens, index.query("label", "quarterly", BlindMatch::Exact).value()));
+    EXPECT_FALSE(holds(tokens, index.query("notes", "quarterly-report", BlindMatch::Exact).value()));
+    EXPECT_FALSE(index.query("label", "qu", BlindMatch::Contains).isSuccess());
+
+    // Another key gives unrelated tokens
+    BlindIndex other(*crypto, crypto->generateKey());
+    EXPECT_FALSE(holds(tokens, other.query("label", "quarterly-report", BlindMatch::Exact).value()));
+}
+
+TEST_F(BlindIndexTest, CatalogIndexFollowsPutsRemovesAndSnapshots) {
+    auto journal = dir / Catalog::JOURNAL_FILENAME;
+    Catalog catalog;
+    ASSERT_TRUE(catalog.load(journal).isSuccess());
+    CatalogEntry a;
+    a.id = "a";
+    a.unlock_at = 1900000000;
+    a.blind_tokens = {1, 5, 9};
+    CatalogEntry b = a;
+    b.id = "b";
+    b.blind_tokens = {5, 7};
+    ASSERT_TRUE(catalog.put_all({a, b}).isSuccess());
+
+    EXPECT_EQ(catalog.find_by_tokens({5}), (std::vector<std::string>{"a", "b"}));
+    EXPECT_EQ(catalog.find_by_tokens({5, 9}), (std::vector<std::string>{"a"}));
+    EXPECT_TRUE(catalog.find_by_tokens({2}).empty());
+
+    b.blind_tokens = {7};
+    ASSERT_TRUE(catalog.put(b).isSuccess());
+    ASSERT_TRUE(catalog.remove("a").isSuccess());
+    EXPECT_TRUE(catalog.find_by_tokens({5}).empty());
+    EXPECT_EQ(catalog.find_by_tokens({7}), (std::vector<std::string>{"b"}));
+
+    Catalog replayed;
+    ASSERT_TRUE(replayed.load(journal).isSuccess());
+    EXPECT_EQ(replayed.find_by_tokens({7}), (std::vector<std::string>{"b"}));
+
+    auto snapshot = dir / "catalog.snapshot";
+    ASSERT_TRUE(CatalogSnapshot::save(snapshot, catalog.image(), UnlockScheduler(), journal).isSuccess());
+    auto contents = CatalogSnapshot::load(snapshot, journal);
+    ASSERT_TRUE(contents.isSuccess()) << contents.error_message();
+    Catalog restored;
+    ASSERT_TRUE(restored.restore(journal, std::move(contents.value().catalog)).isSuccess());
+    EXPECT_EQ(restored.find_by_tokens({7}), (std::vector<std::string>{"b"}));
+    EXPECT_EQ(restored.find("b")->blind_tokens, (std::vector<uint64_t>{7}));
+}
+
+TEST_F(BlindIndexTest, PrivateMetadataIsSearchableWithoutPlaintext) {
+    Store store(dir / "store");
+    ASSERT_TRUE(store.init("test@example.com", "pbkdf2").isSuccess());
+    store.set_private_metadata(true);
+    auto id = store.lock(write_input("merger-plan.pdf", "secret"), policy_labelled("Project Falcon"));
+    ASSERT_TRUE(id.isSuccess()) << id.error_message();
+    store.set_private_metadata(false);
+    auto plain = store.lock(write_input("falcon-notes.txt", "public"), policy_labelled("Project Falconry"));
+    ASSERT_TRUE(plain.isSuccess());
+
+    auto metadata = read_file(store.metadata_path(id.value()));
+    EXPECT_EQ(metadata.find("merger"), std::string::npos);
+    EXPECT_EQ(metadata.find("Falcon"), std::string::npos);
+    EXPECT_EQ(metadata.find("board minutes"), std::string::npos);
+    EXPECT_NE(id.value(), "merger-plan.pdf");
+    EXPECT_EQ(store.resolve("merger-plan.pdf").value(), id.value());
+    EXPECT_TRUE(store.catalog().value()->find(id.value())->label.empty());
+
+    auto description = store.describe(id.value());
+    ASSERT_TRUE(description.isSuccess()) << description.error_message();
+    EXPECT_TRUE(description.value().encrypted);
+    EXPECT_EQ(description.value().label, "Project Falcon");
+    EXPECT_EQ(description.value().original_filename, "merger-plan.pdf");
+
+    EXPECT_EQ(store.search("label", "project falcon", BlindMatch::Exact).value(), (std::vector<std::string>{id.value()}));
+    auto prefixed = store.search("label", "Project F", BlindMatch::Prefix).value();
+    std::sort(prefixed.begin(), prefixed.end());
+    auto both = std::vector<std::string>{id.value(), plain.value()};
+    std::sort(both.begin(), both.end());
+    EXPECT_EQ(prefixed, both);
+    EXPECT_EQ(store.search("filename", "plan.p", BlindMatch::Contains).value(), (std::vector<std::string>{id.value()}));
+    EXPECT_TRUE(store.search("filename", "plan.txt", BlindMatch::Contains).value().empty());
+    EXPECT_FALSE(store.search("owner", "x", BlindMatch::Exact).isSuccess());
+
+    // Tokens come back when the catalog is rebuilt from metadata
+    ASSERT_TRUE(store.rebuild_catalog().isSuccess());
+    EXPECT_EQ(store.search("notes", "minutes", BlindMatch::Contains).value().size(), 2u);
+}
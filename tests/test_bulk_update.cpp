@@ -0,0 +1,205 @@
+#include <gtest/gtest.h>
+#include <tcfs/CatalogQuery.hpp>
+#include <tcfs/Store.hpp>
+#include <filesystem>
+#include <fstream>
+
+using namespace tcfs;
+namespace fs = std::filesystem;
+
+namespace {
+
+class BulkUpdateTest : public ::testing::Test {
+protected:
+    fs::path dir;
+
+    void SetUp() override {
+        dir = fs::temp_directory_path() /
+              ("tcfs_bulk_update_" + std::string(::testing::UnitTest::GetInstance()->current_test_info()->name()));
+        fs::remove_all(dir);
+        fs::create_directories(dir / "input");
+    }
+
+    void TearDown() override {
+        fs::remove_all(dir);
+    }
+
+    fs::path write_input(const std::string& name, const std::string& content) {
+        auto path = dir / "input" / name;
+        std::ofstream(path, std::ios::binary) << content;
+        return path;
+    }
+
+    static std::string read_file(const fs::path& path) {
+        std::ifstream in(path, std::ios::binary);
+        return std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    }
+
+    static Policy policy_at(const std::string& unlock_at, const std::string& label) {
+        Policy policy;
+        policy.set_unlock_time(unlock_at);
+        policy.set_owner("test@example.com");
+        policy.set_label(label);
+        return policy;
+    }
+
+    static int64_t seconds(const std::string& rfc3339) {
+        return static_cast<int64_t>(std::chrono::system_clock::to_time_t(time_utils::parse_rfc3339(rfc3339).value()));
+    }
+
+    static std::vector<std::string> ids_of(const std::vector<const CatalogEntry*>& entries) {
+        std::vector<std::string> ids;
+        for (const auto* entry : entries) {
+            ids.push_back(entry->id);
+        }
+        return ids;
+    }
+};
+
+} // namespace
+
+TEST_F(BulkUpdateTest, QueryMatchesCatalogFields) {
+    Store store(dir / "store");
+    ASSERT_TRUE(store.init("test@example.com", "pbkdf2").isSuccess());
+    ASSERT_TRUE(store.lock(write_input("w2.pdf", "a"), policy_at("2030-01-01T00:00:00Z", "Taxes 2024")).isSuccess());
+    ASSERT_TRUE(store.lock(write_input("w2.txt", "b"), policy_at("2035-01-01T00:00:00Z", "Taxes 2025")).isSuccess());
+    ASSERT_TRUE(store.lock(write_input("letter.pdf", "c"), policy_at("2020-01-01T00:00:00Z", "Letter")).isSuccess());
+    ASSERT_TRUE(store.mark_released("letter.pdf").isSuccess());
+    auto& catalog = *store.catalog().value();
+
+    auto select = [&](const std::string& text) {
+        auto query = CatalogQuery::parse(text);
+        EXPECT_TRUE(query.isSuccess()) << text << ": " << query.error_message();
+        return ids_of(query.value().select(catalog));
+    };
+    EXPECT_EQ(select("label~taxes"), (std::vector<std::string>{"w2.pdf", "w2.txt"}));
+    EXPECT_EQ(select("label~taxes,unlock<2031-01-01T00:00:00Z"), (std::vector<std::string>{"w2.pdf"}));
+    EXPECT_EQ(select("name=*.pdf"), (std::vector<std::string>{"w2.pdf", "letter.pdf"}));
+    EXPECT_EQ(select("name=*.pdf, state=locked"), (std::vector<std::string>{"w2.pdf"}));
+    EXPECT_EQ(select("label!=Letter,unlock>=2035-01-01T00:00:00Z"), (std::vector<std::string>{"w2.txt"}));
+    EXPECT_EQ(select("owner=test@example.com").size(), 3u);
+    EXPECT_TRUE(select("expire<2040-01-01T00:00:00Z").empty()); // None of them expire
+    EXPECT_TRUE(CatalogQuery::parse("").value().empty());
+
+    EXPECT_FALSE(CatalogQuery::parse("colour=red").isSuccess());
+    EXPECT_FALSE(CatalogQuery::parse("label<x").isSuccess());
+    EXPECT_FALSE(CatalogQuery::parse("unlock~2030").isSuccess());
+    EXPECT_FALSE(CatalogQuery::parse("unlock<tomorrow").isSuccess());
+    EXPECT_FALSE(CatalogQuery::parse("state=lost").isSuccess());
+    EXPECT_FALSE(CatalogQuery::parse("label").isSuccess());
+}
+
+TEST_F(BulkUpdateTest, ExtendCommitsOneRecordAndOnlyMovesLater) {
+    Store store(dir / "store");
+    ASSERT_TRUE(store.init("test@example.com", "pbkdf2").isSuccess());
+    auto policy = policy_at("2030-01-01T00:00:00Z", "Taxes");
+    policy.set_expire_at(time_utils::parse_rfc3339("2031-01-01T00:00:00Z").value());
+    ChunkedCapsule::StageSpec later{"rest", policy_at("2032-01-01T00:00:00Z", "Taxes"), 2};
+    ASSERT_TRUE(store.lock(write_input("a.txt", "first"), policy, {later}).isSuccess());
+    ASSERT_TRUE(store.lock(write_input("b.txt", "second"), policy_at("2040-01-01T00:00:00Z", "Taxes")).isSuccess());
+    ASSERT_TRUE(store.lock(write_input("c.txt", "third"), policy_at("2030-01-01T00:00:00Z", "Other")).isSuccess());
+    ASSERT_TRUE(store.create_group("scans", policy_at("2030-01-01T00:00:00Z", "Taxes")).isSuccess());
+    ASSERT_TRUE(store.lock_group("scans", {write_input("d.txt", "fourth")}).isSuccess());
+    auto journal_path = store.catalog().value()->journal_path();
+    auto journal_before = read_file(journal_path);
+
+    auto query = CatalogQuery::parse("label~taxes").value();
+    UnlockExtension extension;
+    extension.to = time_utils::parse_rfc3339("2035-01-01T00:00:00Z").value();
+    auto updated = store.extend(query, extension);
+    ASSERT_TRUE(updated.isSuccess()) << updated.error_message();
+    EXPECT_EQ(updated.value().updated, (std::vector<std::string>{"a.txt"}));
+    ASSERT_EQ(updated.value().skipped.size(), 2u); // b.txt already unlocks later; d.txt follows its group
+    EXPECT_TRUE(updated.value().failed.empty());
+
+    // One journal line for the whole update
+    auto appended = read_file(journal_path).substr(journal_before.size());
+    EXPECT_EQ(std::count(appended.begin(), appended.end(), '\n'), 1);
+    EXPECT_NE(appended.find("\"txn\""), std::string::npos);
+
+    // Expiry and the later stage move by the same 1826 days
+    auto read = store.read_policy("a.txt");
+    ASSERT_TRUE(read.isSuccess()) << read.error_message();
+    EXPECT_EQ(read.value().unlock_time_rfc3339(), "2035-01-01T00:00:00Z");
+    EXPECT_EQ(time_utils::format_rfc3339(*read.value().expire_at()), "2036-01-01T00:00:00Z");
+    auto layout = store.read_layout("a.txt");
+    ASSERT_TRUE(layout.isSuccess()) << layout.error_message();
+    EXPECT_EQ(time_utils::format_rfc3339(layout.value().stages[1].policy.unlock_time()), "2036-12-31T00:00:00Z");
+    auto plaintext = store.decrypt("a.txt");
+    ASSERT_TRUE(plaintext.isSuccess()) << plaintext.error_message();
+    EXPECT_EQ(std::string(plaintext.value().begin(), plaintext.value().end()), "first");
+
+    // A fresh process replays the transaction into the same entries
+    Store reopened(dir / "store");
+    const auto* entry = reopened.catalog().value()->find("a.txt");
+    ASSERT_NE(entry, nullptr);
+    EXPECT_EQ(entry->unlock_at, seconds("2035-01-01T00:00:00Z"));
+    EXPECT_EQ(entry->expire_at, seconds("2036-01-01T00:00:00Z"));
+    EXPECT_EQ(reopened.catalog().value()->find("c.txt")->unlock_at, seconds("2030-01-01T00:00:00Z"));
+
+    // Rerunning with the same target is a no-op; extensions must be positive
+    auto again = store.extend(query, extension);
+    ASSERT_TRUE(again.isSuccess());
+    EXPECT_TRUE(again.value().updated.empty());
+    EXPECT_FALSE(store.extend(query, UnlockExtension{std::chrono::seconds(-60)}).isSuccess());
+
+    auto by_month = store.extend(CatalogQuery::parse("name=c.*").value(), UnlockExtension{std::chrono::hours(24 * 30)});
+    ASSERT_TRUE(by_month.isSuccess()) << by_month.error_message();
+    EXPECT_EQ(by_month.value().updated, (std::vector<std::string>{"c.txt"}));
+    EXPECT_EQ(store.read_policy("c.txt").value().unlock_time_rfc3339(), "2030-01-31T00:00:00Z");
+}
+
+TEST_F(BulkUpdateTest, ExtendLeavesCatalogAloneWhenMetadataCannotBeWritten) {
+    Store store(dir / "store");
+    ASSERT_TRUE(store.init("test@example.com", "pbkdf2").isSuccess());
+    ASSERT_TRUE(store.lock(write_input("a.txt", "first"), policy_at("2030-01-01T00:00:00Z", "Taxes")).isSuccess());
+    ASSERT_TRUE(store.lock(write_input("b.txt", "second"), policy_at("2030-01-01T00:00:00Z", "Taxes")).isSuccess());
+
+    // A directory where b.txt's temporary metadata goes makes its rewrite fail
+    auto blocker = store.metadata_path("b.txt");
+    blocker += ".tmp";
+    fs::create_directories(blocker);
+
+    auto query = CatalogQuery::parse("label~taxes").value();
+    UnlockExtension extension;
+    extension.to = time_utils::parse_rfc3339("2035-01-01T00:00:00Z").value();
+    auto updated = store.extend(query, extension);
+    ASSERT_TRUE(updated.isSuccess()) << updated.error_message();
+    EXPECT_EQ(updated.value().updated, (std::vector<std::string>{"a.txt"}));
+    ASSERT_EQ(updated.value().failed.size(), 1u);
+    EXPECT_EQ(updated.value().failed[0].first, "b.txt");
+
+    // Neither the catalog nor the metadata of b.txt moved
+    Store reopened(dir / "store");
+    EXPECT_EQ(reopened.catalog().value()->find("a.txt")->unlock_at, seconds("2035-01-01T00:00:00Z"));
+    EXPECT_EQ(reopened.catalog().value()->find("b.txt")->unlock_at, seconds("2030-01-01T00:00:00Z"));
+    EXPECT_EQ(reopened.read_policy("b.txt").value().unlock_time_rfc3339(), "2030-01-01T00:00:00Z");
+
+    fs::remove_all(blocker);
+    auto again = store.extend(query, extension);
+    ASSERT_TRUE(again.isSuccess()) << again.error_message();
+    EXPECT_EQ(again.value().updated, (std::vector<std::string>{"b.txt"}));
+    EXPECT_EQ(store.read_policy("b.txt").value().unlock_time_rfc3339(), "2035-01-01T00:00:00Z");
+}
+
+TEST_F(BulkUpdateTest, ExtendRerunCatchesTheCatalogUpWithMetadata) {
+    Store store(dir / "store");
+    ASSERT_TRUE(store.init("test@example.com", "pbkdf2").isSuccess());
+    ASSERT_TRUE(store.lock(write_input("a.txt", "first"), policy_at("2030-01-01T00:00:00Z", "Taxes")).isSuccess());
+
+    // As left by an update interrupted between the metadata rewrite and the catalog commit
+    auto metadata = store.read_metadata("a.txt").value();
+    metadata["policy"]["unlock_at"] = "2035-01-01T00:00:00Z";
+    ASSERT_TRUE(store.write_metadata("a.txt", metadata).isSuccess());
+    EXPECT_EQ(store.catalog().value()->find("a.txt")->unlock_at, seconds("2030-01-01T00:00:00Z"));
+
+    UnlockExtension extension;
+    extension.to = time_utils::parse_rfc3339("2035-01-01T00:00:00Z").value();
+    auto again = store.extend(CatalogQuery::parse("label~taxes").value(), extension);
+    ASSERT_TRUE(again.isSuccess()) << again.error_message();
+    EXPECT_TRUE(again.value().updated.empty());
+    EXPECT_EQ(again.value().skipped.size(), 1u);
+
+    Store reopened(dir / "store");
+    EXPECT_EQ(reopened.catalog().value()->find("a.txt")->unlock_at, seconds("2035-01-01T00:00:00Z"));
+}
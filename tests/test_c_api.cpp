@@ -0,0 +1,189 @@
+#include <gtest/gtest.h>
+#include <tcfs/Store.hpp>
+#include <tcfs/tcfs.h>
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+using namespace tcfs;
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr size_t SEGMENT = ChunkedCapsule::DEFAULT_SEGMENT_SIZE;
+
+class CApiTest : public ::testing::Test {
+protected:
+    fs::path dir;
+    tcfs_store* store = nullptr;
+
+    void SetUp() override {
+        dir = fs::temp_directory_path() /
+              ("tcfs_c_api_" + std::string(::testing::UnitTest::GetInstance()->current_test_info()->name()));
+        fs::remove_all(dir);
+        ASSERT_TRUE(Store(dir / "store").init("test@example.com", "pbkdf2").isSuccess());
+        ASSERT_EQ(tcfs_store_open((dir / "store").string().c_str(), &store), TCFS_OK) << tcfs_last_error(nullptr);
+    }
+
+    void TearDown() override {
+        tcfs_store_close(store);
+        fs::remove_all(dir);
+    }
+
+    static std::string pattern(size_t size) {
+        std::string data(size, '\0');
+        for (size_t i = 0; i < size; ++i) {
+            data[i] = static_cast<char>('a' + (i * 13) % 26);
+        }
+        return data;
+    }
+
+    std::string unlock(const char* id, const char* stage, uint64_t offset, size_t size) {
+        std::string buffer(size, '\0');
+        size_t written = 0;
+        EXPECT_EQ(tcfs_unlock_range(store, id, stage, offset, buffer.data(), buffer.size(), &written), TCFS_OK)
+            << tcfs_last_error(store);
+        buffer.resize(written);
+        return buffer;
+    }
+
+    struct Chunks {
+        const std::string* data;
+        size_t position = 0;
+        bool fail = false;
+    };
+
+    // Hands out at most 1000 bytes per call, so reads straddle segment boundaries
+    static int64_t read_chunks(void* context, void* buffer, size_t size) {
+        auto* chunks = static_cast<Chunks*>(context);
+        if (chunks->fail && chunks->position > SEGMENT) {
+            return -1;
+        }
+        auto count = std::min({size, size_t{1000}, chunks->data->size() - chunks->position});
+        std::memcpy(buffer, chunks->data->data() + chunks->position, count);
+        chunks->position += count;
+        return static_cast<int64_t>(count);
+    }
+};
+
+} // namespace
+
+TEST_F(CApiTest, LocksFromMemoryAndUnlocksRanges) {
+    EXPECT_EQ(tcfs_abi_version(), static_cast<uint32_t>(TCFS_ABI_VERSION));
+    auto content = pattern(2 * SEGMENT + 500);
+    char id[64];
+    ASSERT_EQ(tcfs_lock_buffer(store, "report.bin", "2020-01-01T00:00:00Z", content.data(), content.size(), id,
+                               sizeof(id)),
+              TCFS_OK)
+        << tcfs_last_error(store);
+    EXPECT_STREQ(id, "report.bin");
+
+    uint64_t size = 0;
+    ASSERT_EQ(tcfs_capsule_size(store, id, nullptr, &size), TCFS_OK);
+    EXPECT_EQ(size, content.size());
+    EXPECT_EQ(unlock(id, nullptr, SEGMENT - 10, 20), content.substr(SEGMENT - 10, 20));
+    EXPECT_EQ(unlock(id, nullptr, 2 * SEGMENT, 4096), content.substr(2 * SEGMENT));
+    EXPECT_EQ(unlock(id, "part1", 0, content.size() + 1), content);
+
+    size_t written = 1;
+    char byte;
+    EXPECT_EQ(tcfs_unlock_range(store, id, nullptr, size + 1, &byte, 1, &written), TCFS_ERR_INVALID_ARGUMENT);
+    EXPECT_EQ(tcfs_unlock_range(store, "missing.bin", nullptr, 0, &byte, 1, &written), TCFS_ERR_NOT_FOUND);
+    EXPECT_NE(std::string(tcfs_last_error(store)), "");
+
+    // An id that would not fit is refused before anything is locked
+    char small[4];
+    EXPECT_EQ(tcfs_lock_buffer(store, "other.bin", "2020-01-01T00:00:00Z", "x", 1, small, sizeof(small)),
+              TCFS_ERR_BUFFER_TOO_SMALL);
+    EXPECT_EQ(tcfs_capsule_size(store, "other.bin", nullptr, &size), TCFS_ERR_NOT_FOUND);
+    EXPECT_EQ(tcfs_lock_buffer(store, "../escape.bin", "2020-01-01T00:00:00Z", "x", 1, id, sizeof(id)),
+              TCFS_ERR_INVALID_ARGUMENT);
+    EXPECT_EQ(tcfs_lock_buffer(store, "late.bin", "not a time", "x", 1, id, sizeof(id)), TCFS_ERR_INVALID_ARGUMENT);
+}
+
+TEST_F(CApiTest, RefusesRangesOfLockedStages) {
+    auto content = pattern(3000);
+    auto input = dir / "staged.txt";
+    std::ofstream(input, std::ios::binary) << content;
+    Policy open;
+    open.set_unlock_time("2020-01-01T00:00:00Z");
+    Policy closed;
+    closed.set_unlock_time("2200-01-01T00:00:00Z");
+    ASSERT_TRUE(Store(dir / "store").lock(input, open, {{"later", closed, 1000}}).isSuccess());
+
+    uint64_t size = 0;
+    ASSERT_EQ(tcfs_capsule_size(store, "staged.txt", "later", &size), TCFS_OK);
+    EXPECT_EQ(size, 2000u);
+    EXPECT_EQ(unlock("staged.txt", "part1", 100, 5000), content.substr(100, 900));
+    EXPECT_EQ(unlock("staged.txt", nullptr, 0, 1000), content.substr(0, 1000));
+
+    char buffer[64];
+    size_t written = 0;
+    EXPECT_EQ(tcfs_unlock_range(store, "staged.txt", nullptr, 990, buffer, sizeof(buffer), &written), TCFS_ERR_LOCKED);
+    EXPECT_NE(std::string(tcfs_last_error(store)).find("later"), std::string::npos);
+    EXPECT_EQ(written, 0u);
+    EXPECT_EQ(tcfs_unlock_range(store, "staged.txt", "later", 0, buffer, sizeof(buffer), &written), TCFS_ERR_LOCKED);
+
+    char id[64];
+    ASSERT_EQ(tcfs_lock_buffer(store, "future.bin", "2200-01-01T00:00:00Z", "secret", 6, id, sizeof(id)), TCFS_OK);
+    EXPECT_EQ(tcfs_unlock_range(store, id, nullptr, 0, buffer, sizeof(buffer), &written), TCFS_ERR_LOCKED);
+}
+
+TEST_F(CApiTest, LocksThroughTheReadCallback) {
+    auto content = pattern(2 * SEGMENT + 77);
+    Chunks chunks{&content};
+    char id[64];
+    ASSERT_EQ(tcfs_lock_stream(store, "stream.bin", "2020-01-01T00:00:00Z", read_chunks, &chunks, content.size(), id,
+                               sizeof(id)),
+              TCFS_OK)
+        << tcfs_last_error(store);
+    EXPECT_EQ(unlock(id, nullptr, 0, content.size()), content);
+
+    Chunks failing{&content, 0, true};
+    EXPECT_EQ(tcfs_lock_stream(store, "broken.bin", "2020-01-01T00:00:00Z", read_chunks, &failing, content.size(), id,
+                               sizeof(id)),
+              TCFS_ERR_IO);
+    Chunks short_input{&content};
+    EXPECT_NE(tcfs_lock_stream(store, "short.bin", "2020-01-01T00:00:00Z", read_chunks, &short_input,
+                               content.size() + 1, id, sizeof(id)),
+              TCFS_OK);
+
+    tcfs_store* missing = nullptr;
+    EXPECT_EQ(tcfs_store_open((dir / "nowhere").string().c_str(), &missing), TCFS_ERR_NOT_FOUND);
+    EXPECT_EQ(missing, nullptr);
+    EXPECT_NE(std::string(tcfs_last_error(nullptr)).find("nowhere"), std::string::npos);
+}
+
+TEST_F(CApiTest, MarkReleasedChecksTheSameRulesAsUnlocking) {
+    char id[64];
+    ASSERT_EQ(tcfs_lock_buffer(store, "a.txt", "2200-01-01T00:00:00Z", "first", 5, id, sizeof(id)), TCFS_OK);
+    auto input = dir / "b.txt";
+    std::ofstream(input, std::ios::binary) << "secret";
+    Policy open;
+    open.set_unlock_time("2020-01-01T00:00:00Z");
+    open.set_depends_on({"a.txt"});
+    ASSERT_TRUE(Store(dir / "store").lock(input, open).isSuccess());
+
+    // Neither a locked capsule nor one waiting on it can be released early
+    EXPECT_EQ(tcfs_mark_released(store, "a.txt"), TCFS_ERR_LOCKED);
+    EXPECT_EQ(tcfs_mark_released(store, "b.txt"), TCFS_ERR_LOCKED);
+    char buffer[16];
+    size_t written = 0;
+    EXPECT_EQ(tcfs_unlock_range(store, "b.txt", nullptr, 0, buffer, sizeof(buffer), &written), TCFS_ERR_LOCKED);
+    EXPECT_EQ(Store(dir / "store").catalog().value()->find("a.txt")->state, CapsuleState::Locked);
+
+    // Nor a staged capsule whose later stage is still closed
+    auto staged = dir / "staged.txt";
+    std::ofstream(staged, std::ios::binary) << pattern(3000);
+    Policy closed;
+    closed.set_unlock_time("2200-01-01T00:00:00Z");
+    Policy first;
+    first.set_unlock_time("2020-01-01T00:00:00Z");
+    ASSERT_TRUE(Store(dir / "store").lock(staged, first, {{"later", closed, 1000}}).isSuccess());
+    EXPECT_EQ(tcfs_mark_released(store, "staged.txt"), TCFS_ERR_LOCKED);
+    EXPECT_NE(std::string(tcfs_last_error(store)).find("later"), std::string::npos);
+
+    ASSERT_EQ(tcfs_lock_buffer(store, "c.txt", "2020-01-01T00:00:00Z", "open", 4, id, sizeof(id)), TCFS_OK);
+    EXPECT_EQ(tcfs_mark_released(store, "c.txt"), TCFS_OK);
+}
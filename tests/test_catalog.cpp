@@ -0,0 +1,131 @@
+#include <gtest/gtest.h>
+#include <tcfs/Catalog.hpp>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+
+using namespace tcfs;
+namespace fs = std::filesystem;
+
+namespace {
+
+class CatalogTest : public ::testing::Test {
+protected:
+    fs::path dir;
+    fs::path journal;
+
+    void SetUp() override {
+        dir = fs::temp_directory_path() /
+              ("tcfs_catalog_" + std::string(::testing::UnitTest::GetInstance()->current_test_info()->name()));
+        fs::remove_all(dir);
+        fs::create_directories(dir);
+        journal = dir / Catalog::JOURNAL_FILENAME;
+    }
+
+    void TearDown() override {
+        fs::remove_all(dir);
+    }
+
+    static CatalogEntry entry(const std::string& id, std::vector<std::string> depends_on = {}) {
+        CatalogEntry e;
+        e.id = id;
+        e.original_filename = id;
+        e.unlock_at = 1900000000;
+        e.depends_on = std::move(depends_on);
+        return e;
+    }
+};
+
+} // namespace
+
+TEST_F(CatalogTest, ReleasePropagatesToReadyDependents) {
+    Catalog catalog;
+    ASSERT_TRUE(catalog.load(journal).isSuccess());
+
+    // a -> b -> d, a -> c -> d
+    ASSERT_TRUE(catalog.put(entry("a")).isSuccess());
+    ASSERT_TRUE(catalog.put(entry("b", {"a"})).isSuccess());
+    ASSERT_TRUE(catalog.put(entry("c", {"a"})).isSuccess());
+    ASSERT_TRUE(catalog.put(entry("d", {"b", "c"})).isSuccess());
+
+    EXPECT_TRUE(catalog.dependencies_ready("a"));
+    EXPECT_FALSE(catalog.dependencies_ready("b"));
+
+    auto ready = catalog.mark_released("a");
+    ASSERT_TRUE(ready.isSuccess());
+    auto ids = ready.value();
+    std::sort(ids.begin(), ids.end());
+    EXPECT_EQ(ids, (std::vector<std::string>{"b", "c"}));
+
+    ready = catalog.mark_released("b");
+    ASSERT_TRUE(ready.isSuccess());
+    EXPECT_TRUE(ready.value().empty());
+    EXPECT_FALSE(catalog.dependencies_ready("d"));
+
+    ready = catalog.mark_released("c");
+    ASSERT_TRUE(ready.isSuccess());
+    EXPECT_EQ(ready.value(), std::vector<std::string>{"d"});
+    EXPECT_EQ(catalog.find("a")->state, CapsuleState::Released);
+}
+
+TEST_F(CatalogTest, RejectsUnknownDependenciesAndCycles) {
+    Catalog catalog;
+    ASSERT_TRUE(catalog.load(journal).isSuccess());
+
+    EXPECT_FALSE(catalog.put(entry("a", {"missing"})).isSuccess());
+    EXPECT_FALSE(catalog.put(entry("a", {"a"})).isSuccess());
+
+    ASSERT_TRUE(catalog.put(entry("a")).isSuccess());
+    ASSERT_TRUE(catalog.put(entry("b", {"a"})).isSuccess());
+    // Re-pointing a at b would close the loop a -> b -> a
+    auto cyclic = catalog.put(entry("a", {"b"}));
+    EXPECT_FALSE(cyclic.isSuccess());
+    EXPECT_EQ(cyclic.error(), ErrorCode::InvalidPolicy);
+    EXPECT_TRUE(catalog.find("a")->depends_on.empty());
+}
+
+TEST_F(CatalogTest, RemoveUnblocksDependents) {
+    Catalog catalog;
+    ASSERT_TRUE(catalog.load(journal).isSuccess());
+    ASSERT_TRUE(catalog.put(entry("a")).isSuccess());
+    ASSERT_TRUE(catalog.put(entry("b", {"a"})).isSuccess());
+
+    auto ready = catalog.remove("a");
+    ASSERT_TRUE(ready.isSuccess());
+    EXPECT_EQ(ready.value(), std::vector<std::string>{"b"});
+    EXPECT_FALSE(catalog.contains("a"));
+    EXPECT_TRUE(catalog.dependencies_ready("b"));
+}
+
+TEST_F(CatalogTest, JournalReplayAndRefresh) {
+    Catalog writer;
+    ASSERT_TRUE(writer.load(journal).isSuccess());
+    ASSERT_TRUE(writer.put(entry("a")).isSuccess());
+
+    Catalog reader;
+    ASSERT_TRUE(reader.load(journal).isSuccess());
+    EXPECT_TRUE(reader.contains("a"));
+    EXPECT_EQ(reader.last_sequence(), writer.last_sequence());
+
+    ASSERT_TRUE(writer.put(entry("b", {"a"})).isSuccess());
+    ASSERT_TRUE(writer.mark_released("a").isSuccess());
+
+    auto changes = reader.refresh();
+    ASSERT_TRUE(changes.isSuccess());
+    EXPECT_EQ(changes.value().ready, std::vector<std::string>{"b"});
+    EXPECT_TRUE(reader.dependencies_ready("b"));
+
+    // A torn trailing record (crash mid-append) is ignored until completed
+    {
+        std::ofstream out(journal, std::ios::app);
+        out << R"({"op":"rel)";
+    }
+    changes = reader.refresh();
+    ASSERT_TRUE(changes.isSuccess());
+    EXPECT_TRUE(changes.value().touched.empty());
+
+    Catalog replayed;
+    ASSERT_TRUE(replayed.load(journal).isSuccess());
+    EXPECT_EQ(replayed.size(), 2u);
+    EXPECT_EQ(replayed.find("a")->state, CapsuleState::Released);
+}
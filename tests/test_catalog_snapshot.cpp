@@ -0,0 +1,144 @@
+#include <gtest/gtest.h>
+#include <tcfs/CatalogSnapshot.hpp>
+#include <tcfs/Daemon.hpp>
+#include <tcfs/Store.hpp>
+#include <filesystem>
+#include <fstream>
+
+using namespace tcfs;
+namespace fs = std::filesystem;
+
+namespace {
+
+class CatalogSnapshotTest : public ::testing::Test {
+protected:
+    fs::path dir;
+    std::unique_ptr<Store> store;
+
+    void SetUp() override {
+        dir = fs::temp_directory_path() /
+              ("tcfs_snapshot_" + std::string(::testing::UnitTest::GetInstance()->current_test_info()->name()));
+        fs::remove_all(dir);
+        fs::create_directories(dir / "input");
+        store = std::make_unique<Store>(dir / "store");
+        ASSERT_TRUE(store->init("test@example.com", "pbkdf2").isSuccess());
+    }
+
+    void TearDown() override {
+        store.reset();
+        fs::remove_all(dir);
+    }
+
+    std::string lock(Store& target, const std::string& name, const std::string& unlock_at,
+                     const std::vector<std::string>& after = {}) {
+        auto input = dir / "input" / name;
+        std::ofstream(input, std::ios::binary) << "content of " << name;
+        Policy policy;
+        policy.set_unlock_time(unlock_at);
+        policy.set_owner("test@example.com");
+        policy.set_label("snap");
+        policy.set_depends_on(after);
+        auto id = target.lock(input, policy);
+        EXPECT_TRUE(id.isSuccess()) << id.error_message();
+        return id.value();
+    }
+
+    DaemonOptions options() const {
+        DaemonOptions result;
+        result.snapshot.path = dir / "daemon.snapshot";
+        return result;
+    }
+
+    // A daemon on a fresh Store, as after a process restart
+    std::unique_ptr<Daemon> restart(std::unique_ptr<Store>& fresh) {
+        fresh = std::make_unique<Store>(dir / "store");
+        auto daemon = std::make_unique<Daemon>(*fresh, options());
+        EXPECT_TRUE(daemon->start().isSuccess());
+        return daemon;
+    }
+};
+
+} // namespace
+
+TEST_F(CatalogSnapshotTest, ImageRestoresDependencyState) {
+    auto a = lock(*store, "a.txt", "2030-01-01T00:00:00Z");
+    auto b = lock(*store, "b.txt", "2030-01-01T00:00:00Z", {a});
+    auto gone = lock(*store, "gone.txt", "2030-01-01T00:00:00Z");
+    ASSERT_TRUE(store->destroy(gone, "test").isSuccess());
+    auto catalog = store->catalog().value();
+
+    Catalog restored;
+    ASSERT_TRUE(restored.restore(catalog->journal_path(), catalog->image()).isSuccess());
+    EXPECT_EQ(restored.size(), 2u);
+    EXPECT_EQ(restored.last_sequence(), catalog->last_sequence());
+    EXPECT_FALSE(restored.contains(gone));
+    EXPECT_FALSE(restored.dependencies_ready(b));
+    EXPECT_EQ(restored.dependents(a), std::vector<std::string>{b});
+
+    auto ready = restored.mark_released(a);
+    ASSERT_TRUE(ready.isSuccess());
+    EXPECT_EQ(ready.value(), std::vector<std::string>{b});
+}
+
+TEST_F(CatalogSnapshotTest, DaemonRestartsFromSnapshotAndReplaysTheJournalTail) {
+    auto a = lock(*store, "a.txt", "2030-01-01T00:00:00Z");
+    lock(*store, "b.txt", "2031-01-01T00:00:00Z", {a});
+    {
+        Daemon daemon(*store, options());
+        ASSERT_TRUE(daemon.start().isSuccess());
+        EXPECT_FALSE(daemon.restored_from_snapshot());
+        ASSERT_TRUE(daemon.save_snapshot().isSuccess());
+    }
+
+    // Written by another process after the snapshot
+    auto c = lock(*store, "c.txt", "2029-01-01T00:00:00Z");
+
+    std::unique_ptr<Store> fresh;
+    auto daemon = restart(fresh);
+    EXPECT_TRUE(daemon->restored_from_snapshot());
+    EXPECT_EQ(fresh->catalog().value()->size(), 3u);
+    EXPECT_EQ(daemon->scheduler().size(), 2u); // b waits on a
+    EXPECT_EQ(daemon->scheduler().peek_until(time_utils::parse_rfc3339("2040-01-01T00:00:00Z").value()).front().capsule_id, c);
+
+    // The restored daemon behaves like a rebuilt one
+    EXPECT_EQ(daemon->tick(time_utils::parse_rfc3339("2031-06-01T00:00:00Z").value()), 3u);
+}
+
+TEST_F(CatalogSnapshotTest, CorruptOrStaleSnapshotsFallBackToTheJournal) {
+    lock(*store, "a.txt", "2030-01-01T00:00:00Z");
+    {
+        Daemon daemon(*store, options());
+        ASSERT_TRUE(daemon.start().isSuccess());
+        ASSERT_TRUE(daemon.save_snapshot().isSuccess());
+    }
+    auto snapshot = dir / "daemon.snapshot";
+    auto journal = store->catalog_journal_path();
+    EXPECT_TRUE(CatalogSnapshot::load(snapshot, journal).isSuccess());
+
+    // One flipped byte in the payload
+    {
+        std::fstream file(snapshot, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekg(-3, std::ios::end);
+        char byte = 0;
+        file.get(byte);
+        file.seekp(-3, std::ios::end);
+        file.put(static_cast<char>(byte ^ 0x5a));
+    }
+    EXPECT_FALSE(CatalogSnapshot::load(snapshot, journal).isSuccess());
+    std::unique_ptr<Store> fresh;
+    auto daemon = restart(fresh);
+    EXPECT_FALSE(daemon->restored_from_snapshot());
+    EXPECT_EQ(daemon->scheduler().size(), 1u);
+
+    // A journal rewritten since the snapshot was taken: the rebuild drops the history of x
+    auto x = lock(*fresh, "x.txt", "2030-01-01T00:00:00Z");
+    ASSERT_TRUE(fresh->destroy(x, "test").isSuccess());
+    ASSERT_TRUE(daemon->save_snapshot().isSuccess());
+    ASSERT_TRUE(fresh->rebuild_catalog().isSuccess());
+    lock(*fresh, "b.txt", "2030-01-01T00:00:00Z");
+    EXPECT_FALSE(CatalogSnapshot::load(snapshot, journal).isSuccess());
+    daemon.reset();
+    daemon = restart(fresh);
+    EXPECT_FALSE(daemon->restored_from_snapshot());
+    EXPECT_EQ(daemon->scheduler().size(), 2u);
+}
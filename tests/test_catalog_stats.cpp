@@ -0,0 +1,121 @@
+#include <gtest/gtest.h>
+#include <tcfs/CatalogStats.hpp>
+#include <filesystem>
+
+using namespace tcfs;
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr int64_t DAY = 86400;
+constexpr int64_t MIDNIGHT = 1900022400; // 2030-03-17T00:00:00Z
+
+class CatalogStatsTest : public ::testing::Test {
+protected:
+    fs::path dir;
+    fs::path journal;
+
+    void SetUp() override {
+        dir = fs::temp_directory_path() /
+              ("tcfs_catalog_stats_" + std::string(::testing::UnitTest::GetInstance()->current_test_info()->name()));
+        fs::remove_all(dir);
+        fs::create_directories(dir);
+        journal = dir / Catalog::JOURNAL_FILENAME;
+    }
+
+    void TearDown() override {
+        fs::remove_all(dir);
+    }
+
+    static CatalogEntry entry(const std::string& id, int64_t unlock_at, uint64_t size, const std::string& label,
+                              const std::string& owner = "alice") {
+        CatalogEntry e;
+        e.id = id;
+        e.original_filename = id;
+        e.unlock_at = unlock_at;
+        e.size = size;
+        e.label = label;
+        e.owner = owner;
+        return e;
+    }
+};
+
+} // namespace
+
+TEST_F(CatalogStatsTest, AggregatesLiveColumns) {
+    Catalog catalog;
+    ASSERT_TRUE(catalog.load(journal).isSuccess());
+    ASSERT_TRUE(catalog.put(entry("a", MIDNIGHT + 3600, 100, "taxes")).isSuccess());
+    ASSERT_TRUE(catalog.put(entry("b", MIDNIGHT + DAY + 10, 200, "taxes", "bob")).isSuccess());
+    ASSERT_TRUE(catalog.put(entry("c", MIDNIGHT + 2 * DAY, 400, "")).isSuccess());
+    ASSERT_TRUE(catalog.put(entry("old", MIDNIGHT - DAY, 800, "letters")).isSuccess());
+    ASSERT_TRUE(catalog.put(entry("far", MIDNIGHT + 900 * DAY, 1600, "letters")).isSuccess());
+    ASSERT_TRUE(catalog.put(entry("gone", MIDNIGHT + DAY, 3200, "photos")).isSuccess());
+    ASSERT_TRUE(catalog.remove("gone").isSuccess());
+    ASSERT_TRUE(catalog.put(entry("open", MIDNIGHT, 6400, "letters")).isSuccess());
+    ASSERT_TRUE(catalog.mark_released("open").isSuccess());
+
+    // The timeline rounds noon down to midnight; due counts from noon itself
+    auto stats = CatalogStats::compute(catalog.columns(), MIDNIGHT + DAY / 2, MIDNIGHT + 3 * DAY, DAY);
+    EXPECT_EQ(stats.live().capsules, 6u);
+    EXPECT_EQ(stats.live().bytes, 9500u);
+    EXPECT_EQ(stats.locked().capsules, 5u);
+    EXPECT_EQ(stats.locked().bytes, 3100u);
+    EXPECT_EQ(stats.due().capsules, 2u);
+    EXPECT_EQ(stats.due().bytes, 900u);
+
+    ASSERT_EQ(stats.timeline().size(), 3u);
+    EXPECT_EQ(stats.timeline()[0].start, MIDNIGHT);
+    EXPECT_EQ(stats.timeline()[0].bytes, 100u);
+    EXPECT_EQ(stats.timeline()[1].capsules, 1u);
+    EXPECT_EQ(stats.timeline()[1].bytes, 200u);
+    EXPECT_EQ(stats.timeline()[2].start, MIDNIGHT + 2 * DAY);
+    EXPECT_EQ(stats.timeline()[2].bytes, 400u);
+
+    ASSERT_EQ(stats.by_label().size(), 3u);
+    EXPECT_EQ(stats.by_label()[0].key, "letters");
+    EXPECT_EQ(stats.by_label()[0].bytes, 8800u);
+    EXPECT_EQ(stats.by_label()[1].key, "");
+    EXPECT_EQ(stats.by_label()[2].key, "taxes");
+    EXPECT_EQ(stats.by_label()[2].capsules, 2u);
+    ASSERT_EQ(stats.by_owner().size(), 2u);
+    EXPECT_EQ(stats.by_owner()[1].key, "bob");
+    EXPECT_EQ(stats.by_owner()[1].bytes, 200u);
+
+    EXPECT_TRUE(CatalogStats::compute(catalog.columns()).timeline().empty());
+    EXPECT_EQ(CatalogStats::bucket_seconds("week").value(), 7 * DAY);
+    EXPECT_FALSE(CatalogStats::bucket_seconds("fortnight").isSuccess());
+}
+
+TEST_F(CatalogStatsTest, ColumnsFollowGroupsTransactionsAndRestores) {
+    Catalog catalog;
+    ASSERT_TRUE(catalog.load(journal).isSuccess());
+    GroupEntry group;
+    group.name = "scans";
+    group.unlock_at = MIDNIGHT;
+    ASSERT_TRUE(catalog.put_group(group).isSuccess());
+    auto member = entry("m", 0, 10, "scan");
+    member.group = "scans";
+    ASSERT_TRUE(catalog.put(member).isSuccess());
+    ASSERT_TRUE(catalog.put(entry("x", MIDNIGHT, 20, "other")).isSuccess());
+
+    group.unlock_at = MIDNIGHT + 5 * DAY;
+    ASSERT_TRUE(catalog.put_group(group).isSuccess());
+    ASSERT_TRUE(catalog.put_transaction({entry("x", MIDNIGHT + 5 * DAY, 20, "other")}).isSuccess());
+
+    auto stats = CatalogStats::compute(catalog.columns(), MIDNIGHT, MIDNIGHT + 10 * DAY, DAY);
+    EXPECT_EQ(stats.timeline()[0].capsules, 0u);
+    EXPECT_EQ(stats.timeline()[5].capsules, 2u);
+    EXPECT_EQ(stats.timeline()[5].bytes, 30u);
+
+    // Replaying the journal and restoring an image rebuild the same columns
+    Catalog replayed;
+    ASSERT_TRUE(replayed.load(journal).isSuccess());
+    Catalog restored;
+    ASSERT_TRUE(restored.restore(journal, catalog.image()).isSuccess());
+    for (const auto* copy : {&replayed, &restored}) {
+        auto again = CatalogStats::compute(copy->columns(), MIDNIGHT, MIDNIGHT + 10 * DAY, DAY);
+        EXPECT_EQ(again.timeline()[5].bytes, 30u);
+        EXPECT_EQ(again.by_label().size(), 2u);
+    }
+}
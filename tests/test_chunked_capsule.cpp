@@ -0,0 +1,130 @@
+#include <gtest/gtest.h>
+#include <tcfs/ChunkedCapsule.hpp>
+#include <sstream>
+
+using namespace tcfs;
+
+namespace {
+
+class ChunkedCapsuleTest : public ::testing::Test {
+protected:
+    std::unique_ptr<CryptoProvider> crypto = createCryptoProvider();
+    std::string plaintext;
+    std::stringstream capsule;
+
+    void SetUp() override {
+        for (int i = 0; i < 1000; ++i) {
+            plaintext.push_back(static_cast<char>('a' + i % 26));
+        }
+    }
+
+    static Policy policy_at(const std::string& unlock_at) {
+        Policy policy;
+        policy.set_unlock_time(unlock_at);
+        policy.set_owner("test@example.com");
+        return policy;
+    }
+
+    ChunkedLayout write(const std::vector<ChunkedCapsule::StageSpec>& stages, uint32_t segment_size) {
+        std::istringstream input(plaintext);
+        auto layout = ChunkedCapsule::write(*crypto, input, plaintext.size(), capsule, stages, segment_size);
+        EXPECT_TRUE(layout.isSuccess()) << layout.error_message();
+        return layout.value();
+    }
+
+    static std::string str(const std::vector<uint8_t>& bytes) {
+        return std::string(bytes.begin(), bytes.end());
+    }
+};
+
+} // namespace
+
+TEST_F(ChunkedCapsuleTest, StagesCoverTheirRanges) {
+    auto layout = write({{"part1", policy_at("2026-01-01T00:00:00Z"), 0},
+                         {"part2", policy_at("2027-01-01T00:00:00Z"), 300}},
+                        128);
+
+    ASSERT_EQ(layout.stages.size(), 2u);
+    EXPECT_EQ(layout.stages[0].segment_count, 3u); // 300 bytes in 128-byte segments
+    EXPECT_EQ(layout.stages[1].first_segment, 3u);
+    EXPECT_EQ(layout.stages[1].length, 700u);
+    EXPECT_EQ(capsule.str().size(), ChunkedCapsule::HEADER_SIZE + plaintext.size() +
+                                        (3 + 6) * CryptoProvider::AES_GCM_TAG_SIZE);
+
+    auto first = ChunkedCapsule::read_stage(*crypto, capsule, layout, 0);
+    ASSERT_TRUE(first.isSuccess());
+    EXPECT_EQ(str(first.value()), plaintext.substr(0, 300));
+
+    auto second = ChunkedCapsule::read_stage(*crypto, capsule, layout, 1);
+    ASSERT_TRUE(second.isSuccess());
+    EXPECT_EQ(str(second.value()), plaintext.substr(300));
+
+    // Each stage has its own key
+    EXPECT_NE(layout.stages[0].key, layout.stages[1].key);
+    EXPECT_EQ(layout.open_stages(time_utils::parse_rfc3339("2026-06-01T00:00:00Z").value()),
+              std::vector<size_t>{0});
+}
+
+TEST_F(ChunkedCapsuleTest, RandomAccessAcrossSegmentBoundaries) {
+    auto layout = write({{"part1", policy_at("2026-01-01T00:00:00Z"), 0}}, 64);
+
+    auto range = ChunkedCapsule::read(*crypto, capsule, layout, 0, 60, 200);
+    ASSERT_TRUE(range.isSuccess());
+    EXPECT_EQ(str(range.value()), plaintext.substr(60, 200));
+
+    auto tail = ChunkedCapsule::read(*crypto, capsule, layout, 0, 990, 10);
+    ASSERT_TRUE(tail.isSuccess());
+    EXPECT_EQ(str(tail.value()), plaintext.substr(990));
+
+    EXPECT_FALSE(ChunkedCapsule::read(*crypto, capsule, layout, 0, 995, 10).isSuccess());
+    EXPECT_FALSE(ChunkedCapsule::read(*crypto, capsule, layout, 1, 0, 1).isSuccess());
+}
+
+#ifdef TCFS_HAS_OPENSSL
+TEST_F(ChunkedCapsuleTest, TamperedOrReorderedSegmentsFailAuthentication) {
+    auto layout = write({{"part1", policy_at("2026-01-01T00:00:00Z"), 0}}, 64);
+    const auto stride = 64 + CryptoProvider::AES_GCM_TAG_SIZE;
+    auto original = capsule.str();
+
+    auto tampered = original;
+    tampered[ChunkedCapsule::HEADER_SIZE + stride + 5] ^= 0x01;
+    std::stringstream tampered_stream(tampered);
+    EXPECT_FALSE(ChunkedCapsule::read(*crypto, tampered_stream, layout, 0, 64, 64).isSuccess());
+    // Segments other than the damaged one are still readable
+    EXPECT_TRUE(ChunkedCapsule::read(*crypto, tampered_stream, layout, 0, 0, 64).isSuccess());
+
+    auto swapped = original;
+    std::swap_ranges(swapped.begin() + ChunkedCapsule::HEADER_SIZE,
+                     swapped.begin() + static_cast<std::ptrdiff_t>(ChunkedCapsule::HEADER_SIZE + stride),
+                     swapped.begin() + static_cast<std::ptrdiff_t>(ChunkedCapsule::HEADER_SIZE + stride));
+    std::stringstream swapped_stream(swapped);
+    EXPECT_FALSE(ChunkedCapsule::read(*crypto, swapped_stream, layout, 0, 0, 64).isSuccess());
+}
+#endif
+
+TEST_F(ChunkedCapsuleTest, LayoutJSONRoundTripAndValidation) {
+    auto layout = write({{"part1", policy_at("2026-01-01T00:00:00Z"), 0},
+                         {"part2", policy_at("2027-01-01T00:00:00Z"), 500}},
+                        100);
+
+    auto json = layout.to_json(*crypto);
+    auto parsed = ChunkedLayout::from_json(json, *crypto);
+    ASSERT_TRUE(parsed.isSuccess()) << parsed.error_message();
+    EXPECT_EQ(parsed.value().find_stage("part2"), std::optional<size_t>(1));
+    EXPECT_EQ(parsed.value().stages[1].policy.unlock_time_rfc3339(), "2027-01-01T00:00:00Z");
+
+    auto read = ChunkedCapsule::read_stage(*crypto, capsule, parsed.value(), 1);
+    ASSERT_TRUE(read.isSuccess());
+    EXPECT_EQ(str(read.value()), plaintext.substr(500));
+
+    auto broken = json;
+    broken["stages"][1]["file_offset"] = 0;
+    EXPECT_FALSE(ChunkedLayout::from_json(broken, *crypto).isSuccess());
+
+    std::istringstream input(plaintext);
+    std::stringstream sink;
+    EXPECT_FALSE(ChunkedCapsule::write(*crypto, input, plaintext.size(), sink,
+                                       {{"part1", policy_at("2026-01-01T00:00:00Z"), 0},
+                                        {"part2", policy_at("2027-01-01T00:00:00Z"), 2000}})
+                     .isSuccess());
+}
@@ -0,0 +1,95 @@
+#include <gtest/gtest.h>
+#include <tcfs/Condition.hpp>
+#include <tcfs/Policy.hpp>
+#include <chrono>
+
+using namespace tcfs;
+
+namespace {
+
+ConditionContext at(const std::string& rfc3339, const std::string& label = "") {
+    auto time = time_utils::parse_rfc3339(rfc3339);
+    return ConditionContext::make(time.value(), label);
+}
+
+Condition compile(const char* json_text) {
+    auto result = Condition::from_json(nlohmann::json::parse(json_text));
+    EXPECT_TRUE(result.isSuccess()) << result.getErrorMessage();
+    return result.value();
+}
+
+} // namespace
+
+TEST(ConditionTest, EmptyConditionIsSatisfied) {
+    Condition condition;
+    EXPECT_TRUE(condition.empty());
+    EXPECT_TRUE(condition.evaluate(at("2030-01-01T00:00:00Z")));
+}
+
+TEST(ConditionTest, AfterAndBefore) {
+    auto condition = compile(R"({"all": [{"after": "2030-01-01T00:00:00Z"}, {"before": "2030-02-01T00:00:00Z"}]})");
+    EXPECT_EQ(condition.program().size(), 3u);
+    EXPECT_FALSE(condition.evaluate(at("2029-12-31T23:59:59Z")));
+    EXPECT_TRUE(condition.evaluate(at("2030-01-01T00:00:00Z")));
+    EXPECT_TRUE(condition.evaluate(at("2030-01-31T23:59:59Z")));
+    EXPECT_FALSE(condition.evaluate(at("2030-02-01T00:00:00Z")));
+}
+
+TEST(ConditionTest, CompoundWithLabel) {
+    // after T1 AND (before T2 OR label = X)
+    auto condition = compile(R"({"all": [
+        {"after": "2030-01-01T00:00:00Z"},
+        {"any": [{"before": "2030-06-01T00:00:00Z"}, {"label": "archive"}]}
+    ]})");
+    EXPECT_FALSE(condition.evaluate(at("2029-06-01T00:00:00Z", "archive")));
+    EXPECT_TRUE(condition.evaluate(at("2030-03-01T00:00:00Z", "other")));
+    EXPECT_FALSE(condition.evaluate(at("2030-07-01T00:00:00Z", "other")));
+    EXPECT_TRUE(condition.evaluate(at("2030-07-01T00:00:00Z", "archive")));
+}
+
+TEST(ConditionTest, WeekdaysAndTimeOfDay) {
+    auto condition = compile(R"({"all": [
+        {"weekdays": ["mon", "tue", "wed", "thu", "fri"]},
+        {"time_of_day": {"from": "09:00", "to": "17:00"}}
+    ]})");
+    // 2030-01-07 is a Monday, 2030-01-05 a Saturday
+    EXPECT_TRUE(condition.evaluate(at("2030-01-07T10:00:00Z")));
+    EXPECT_FALSE(condition.evaluate(at("2030-01-07T17:00:00Z")));
+    EXPECT_FALSE(condition.evaluate(at("2030-01-05T10:00:00Z")));
+
+    auto overnight = compile(R"({"time_of_day": {"from": "22:00", "to": "02:00"}})");
+    EXPECT_TRUE(overnight.evaluate(at("2030-01-07T23:30:00Z")));
+    EXPECT_TRUE(overnight.evaluate(at("2030-01-07T01:00:00Z")));
+    EXPECT_FALSE(overnight.evaluate(at("2030-01-07T12:00:00Z")));
+}
+
+TEST(ConditionTest, WindowAndNot) {
+    auto condition = compile(R"({"not": {"window": {"from": "2030-01-01T00:00:00Z", "to": "2030-01-02T00:00:00Z"}}})");
+    EXPECT_TRUE(condition.evaluate(at("2029-12-31T12:00:00Z")));
+    EXPECT_FALSE(condition.evaluate(at("2030-01-01T12:00:00Z")));
+    EXPECT_TRUE(condition.evaluate(at("2030-01-02T00:00:00Z")));
+}
+
+TEST(ConditionTest, InvalidExpressionsAreRejected) {
+    EXPECT_TRUE(Condition::from_json(nlohmann::json::parse(R"({"sometime": 1})")).isError());
+    EXPECT_TRUE(Condition::from_json(nlohmann::json::parse(R"({"after": "tomorrow"})")).isError());
+    EXPECT_TRUE(Condition::from_json(nlohmann::json::parse(R"({"weekdays": ["funday"]})")).isError());
+    EXPECT_TRUE(Condition::from_json(nlohmann::json::parse(R"({"all": {"label": "x"}})")).isError());
+}
+
+TEST(ConditionTest, PolicyRoundTripAndUnlockCheck) {
+    Policy policy;
+    policy.setOwner("test_user");
+    policy.setLabel("archive");
+    policy.setUnlockTime(std::chrono::system_clock::now() - std::chrono::hours(1));
+    policy.set_condition(compile(R"({"label": "archive"})"));
+    EXPECT_TRUE(policy.is_unlock_allowed());
+
+    auto restored = Policy::from_json(policy.to_json(), true);
+    ASSERT_TRUE(restored.isSuccess());
+    EXPECT_TRUE(restored.value().has_condition());
+    EXPECT_TRUE(restored.value().is_unlock_allowed());
+
+    policy.setLabel("other");
+    EXPECT_FALSE(policy.is_unlock_allowed());
+}
@@ -0,0 +1,131 @@
+#include <gtest/gtest.h>
+#include <tcfs/DirectIO.hpp>
+#include <tcfs/Store.hpp>
+#include <filesystem>
+#include <fstream>
+#include <numeric>
+
+using namespace tcfs;
+namespace fs = std::filesystem;
+
+namespace {
+
+class DirectIOTest : public ::testing::Test {
+protected:
+    fs::path dir;
+
+    void SetUp() override {
+        dir = fs::temp_directory_path() /
+              ("tcfs_direct_io_" + std::string(::testing::UnitTest::GetInstance()->current_test_info()->name()));
+        fs::remove_all(dir);
+        fs::create_directories(dir);
+    }
+
+    void TearDown() override {
+        fs::remove_all(dir);
+    }
+
+    static std::string pattern(size_t size) {
+        std::string data(size, '\0');
+        for (size_t i = 0; i < size; ++i) {
+            data[i] = static_cast<char>('a' + (i * 7) % 26);
+        }
+        return data;
+    }
+};
+
+} // namespace
+
+TEST_F(DirectIOTest, PoolHandsOutAlignedWipedBuffers) {
+    BufferPool pool(5000, 1);
+    EXPECT_EQ(pool.buffer_size(), 2 * BufferPool::ALIGNMENT);
+    uint8_t* kept = nullptr;
+    {
+        auto first = pool.acquire();
+        auto second = pool.acquire();
+        EXPECT_NE(second.data(), first.data());
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(second.data()) % BufferPool::ALIGNMENT, 0u);
+        EXPECT_EQ(pool.allocated(), 2u);
+        std::fill_n(second.data(), second.size(), uint8_t{0xAB});
+        kept = second.data();
+    }
+    // The first buffer returned is kept for reuse, wiped; the other goes back to the allocator
+    EXPECT_EQ(pool.allocated(), 1u);
+    auto reused = pool.acquire();
+    EXPECT_EQ(reused.data(), kept);
+    EXPECT_EQ(std::accumulate(reused.data(), reused.data() + reused.size(), 0u), 0u);
+
+    BufferPool huge(1, 1, true);
+    EXPECT_EQ(huge.buffer_size(), BufferPool::HUGE_PAGE_SIZE);
+    auto mapped = huge.acquire();
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(mapped.data()) % BufferPool::ALIGNMENT, 0u);
+    mapped.data()[mapped.size() - 1] = 1;
+}
+
+TEST_F(DirectIOTest, WritesAndSeeksWithAndWithoutODirect) {
+    BufferPool pool(2 * BufferPool::ALIGNMENT);
+    const auto data = pattern(5 * BufferPool::ALIGNMENT + 123);
+    for (bool direct : {true, false}) {
+        auto path = dir / (direct ? "direct.bin" : "fadvise.bin");
+        {
+            auto file = DirectFile::open(path, DirectFile::Mode::Write, pool, direct);
+            ASSERT_TRUE(file.isSuccess()) << file.error_message();
+            std::ostream output(file.value().get());
+            output.write(data.data(), 100);
+            output.write(data.data() + 100, static_cast<std::streamsize>(data.size() - 100));
+            EXPECT_EQ(static_cast<size_t>(output.tellp()), data.size());
+            ASSERT_TRUE(file.value()->close().isSuccess());
+        }
+        ASSERT_EQ(fs::file_size(path), data.size()) << direct;
+
+        auto file = DirectFile::open(path, DirectFile::Mode::Read, pool, direct);
+        ASSERT_TRUE(file.isSuccess()) << file.error_message();
+        std::istream input(file.value().get());
+        std::string read_back(data.size(), '\0');
+        input.read(read_back.data(), static_cast<std::streamsize>(read_back.size()));
+        EXPECT_EQ(static_cast<size_t>(input.gcount()), data.size());
+        EXPECT_EQ(read_back, data);
+
+        // Back into an earlier buffer, then an unaligned offset near the end
+        std::string part(10, '\0');
+        input.clear();
+        input.seekg(5);
+        input.read(part.data(), 10);
+        EXPECT_EQ(part, data.substr(5, 10));
+        input.seekg(static_cast<std::streamoff>(data.size() - 10));
+        input.read(part.data(), 10);
+        EXPECT_EQ(part, data.substr(data.size() - 10));
+        EXPECT_EQ(input.get(), std::char_traits<char>::eof());
+    }
+}
+
+TEST_F(DirectIOTest, StoreLocksAndReadsThroughThePool) {
+    Store store(dir / "store");
+    ASSERT_TRUE(store.init("test@example.com", "pbkdf2").isSuccess());
+    auto pool = std::make_shared<BufferPool>(64 * 1024);
+    store.set_direct_io(pool);
+
+    const auto content = pattern(3 * ChunkedCapsule::DEFAULT_SEGMENT_SIZE + 999);
+    auto input = dir / "large.bin";
+    std::ofstream(input, std::ios::binary) << content;
+    Policy policy;
+    policy.set_unlock_time("2020-01-01T00:00:00Z");
+    policy.set_owner("test@example.com");
+    auto id = store.lock(input, policy);
+    ASSERT_TRUE(id.isSuccess()) << id.error_message();
+
+    auto plaintext = store.decrypt(id.value());
+    ASSERT_TRUE(plaintext.isSuccess()) << plaintext.error_message();
+    EXPECT_EQ(std::string(plaintext.value().begin(), plaintext.value().end()), content);
+    auto range = store.read_range(id.value(), 0, ChunkedCapsule::DEFAULT_SEGMENT_SIZE - 5, 10);
+    ASSERT_TRUE(range.isSuccess()) << range.error_message();
+    EXPECT_EQ(std::string(range.value().begin(), range.value().end()),
+              content.substr(ChunkedCapsule::DEFAULT_SEGMENT_SIZE - 5, 10));
+
+    // The capsule reads the same without the pool
+    store.set_direct_io(nullptr);
+    plaintext = store.decrypt(id.value());
+    ASSERT_TRUE(plaintext.isSuccess()) << plaintext.error_message();
+    EXPECT_EQ(plaintext.value().size(), content.size());
+    EXPECT_LE(pool->allocated(), 2u);
+}
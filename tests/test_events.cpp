@@ -0,0 +1,246 @@
+#include <gtest/gtest.h>
+#include <tcfs/Daemon.hpp>
+#include <tcfs/EventServer.hpp>
+#include <tcfs/Store.hpp>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <thread>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace tcfs;
+namespace fs = std::filesystem;
+
+namespace {
+
+CapsuleEvent event(const std::string& type, const std::string& id, const std::string& label = "",
+                   const std::string& owner = "test@example.com") {
+    CapsuleEvent result;
+    result.type = type;
+    result.capsule_id = id;
+    result.label = label;
+    result.owner = owner;
+    return result;
+}
+
+std::vector<std::string> ids(const EventDelivery& delivery) {
+    std::vector<std::string> result;
+    for (const auto& item : delivery.events) {
+        result.push_back(item.capsule_id);
+    }
+    return result;
+}
+
+class EventTest : public ::testing::Test {
+protected:
+    fs::path dir;
+
+    void SetUp() override {
+        // Kept short: Unix socket paths are limited to ~100 bytes
+        dir = fs::temp_directory_path() /
+              ("tcfs_ev_" + std::string(::testing::UnitTest::GetInstance()->current_test_info()->name()).substr(0, 16));
+        fs::remove_all(dir);
+        fs::create_directories(dir);
+    }
+
+    void TearDown() override {
+        fs::remove_all(dir);
+    }
+};
+
+} // namespace
+
+TEST_F(EventTest, FiltersSelectByTypeLabelOwnerAndId) {
+    EventBus bus;
+    EventFilter by_label;
+    by_label.labels = {"reports"};
+    EventFilter by_id_and_type;
+    by_id_and_type.capsule_ids = {"b.txt"};
+    by_id_and_type.types = {"released"};
+    auto reports = bus.subscribe(by_label);
+    auto releases = bus.subscribe(by_id_and_type);
+    auto everything = bus.subscribe({});
+
+    auto first = bus.publish(event("locked", "a.txt", "reports"));
+    bus.publish(event("locked", "b.txt"));
+    auto last = bus.publish(event("released", "b.txt"));
+    EXPECT_LT(first, last);
+
+    EXPECT_EQ(ids(bus.take(reports, 10)), std::vector<std::string>{"a.txt"});
+    auto delivery = bus.take(releases, 10);
+    ASSERT_EQ(delivery.events.size(), 1u);
+    EXPECT_EQ(delivery.events[0].seq, last);
+    EXPECT_EQ(bus.take(everything, 2).events.size(), 2u);
+    EXPECT_EQ(bus.pending(everything), 1u);
+
+    // Filters round-trip through the wire format
+    auto parsed = EventFilter::from_json(by_id_and_type.to_json());
+    ASSERT_TRUE(parsed.isSuccess());
+    EXPECT_EQ(parsed.value().capsule_ids, by_id_and_type.capsule_ids);
+    EXPECT_TRUE(parsed.value().labels.empty());
+    EXPECT_FALSE(EventFilter::from_json(nlohmann::json::parse(R"({"labels": "not a list"})")).isSuccess());
+}
+
+TEST_F(EventTest, SlowConsumersAreCoalescedOrDropped) {
+    EventBus coalescing(2, SlowConsumerPolicy::Coalesce);
+    auto slow = coalescing.subscribe({});
+    for (int i = 0; i < 5; ++i) {
+        coalescing.publish(event("locked", std::to_string(i) + ".txt"));
+    }
+    auto delivery = coalescing.take(slow, 10);
+    EXPECT_EQ(delivery.skipped, 3u);
+    EXPECT_EQ(ids(delivery), (std::vector<std::string>{"3.txt", "4.txt"}));
+    EXPECT_EQ(coalescing.take(slow, 10).skipped, 0u);
+
+    EventBus strict(2, SlowConsumerPolicy::Disconnect);
+    auto dropped = strict.subscribe({});
+    auto keeping_up = strict.subscribe({});
+    for (int i = 0; i < 3; ++i) {
+        strict.publish(event("locked", std::to_string(i) + ".txt"));
+        strict.take(keeping_up, 10);
+    }
+    EXPECT_TRUE(strict.take(dropped, 10).disconnected);
+    strict.publish(event("locked", "late"));
+    EXPECT_EQ(strict.pending(dropped), 0u);
+    EXPECT_EQ(ids(strict.take(keeping_up, 10)), std::vector<std::string>{"late"});
+}
+
+TEST_F(EventTest, ServerStreamsMatchingEventsToSocketSubscribers) {
+    auto socket = dir / "events.sock";
+    std::ofstream(socket) << "left over from a crash";
+
+    EventOptions options;
+    options.socket = socket;
+    EventBus bus;
+    EventServer server(bus, options);
+    ASSERT_TRUE(server.start().isSuccess());
+    EventServer second(bus, options);
+    EXPECT_FALSE(second.start().isSuccess());
+
+    std::promise<void> subscribed;
+    std::vector<nlohmann::json> received;
+    EventFilter filter;
+    filter.labels = {"reports"};
+    auto client = std::async(std::launch::async, [&] {
+        return subscribe_events(socket, filter, [&](const nlohmann::json& line) {
+            if (line.value("type", "") == "subscribed") {
+                subscribed.set_value();
+                return true;
+            }
+            received.push_back(line);
+            return received.size() < 2;
+        });
+    });
+    ASSERT_EQ(subscribed.get_future().wait_for(std::chrono::seconds(5)), std::future_status::ready);
+    EXPECT_EQ(server.connections(), 1u);
+
+    bus.publish(event("locked", "a.txt", "reports"));
+    bus.publish(event("locked", "b.txt", "other"));
+    bus.publish(event("released", "a.txt", "reports"));
+    ASSERT_EQ(client.wait_for(std::chrono::seconds(5)), std::future_status::ready);
+    ASSERT_TRUE(client.get().isSuccess());
+    ASSERT_EQ(received.size(), 2u);
+    EXPECT_EQ(received[0]["type"], "locked");
+    EXPECT_EQ(received[1]["type"], "released");
+    EXPECT_EQ(received[1]["id"], "a.txt");
+
+    // The hung-up client is unsubscribed; stopping removes the socket
+    for (int i = 0; i < 50 && bus.subscribers() != 0; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_EQ(bus.subscribers(), 0u);
+    server.stop();
+    EXPECT_FALSE(fs::exists(socket));
+}
+
+TEST_F(EventTest, ServerDropsClientsThatNeverReadTheirReplies) {
+    EventOptions options;
+    options.socket = dir / "events.sock";
+    options.max_pending_bytes = 4096;
+    EventBus bus;
+    EventServer server(bus, options);
+    ASSERT_TRUE(server.start().isSuccess());
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    ASSERT_GE(fd, 0);
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, options.socket.c_str(), sizeof(address.sun_path) - 1);
+    ASSERT_EQ(::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)), 0);
+
+    // Far more replies than the socket buffer and the limit together hold
+    std::string requests;
+    for (int i = 0; i < 20000; ++i) {
+        requests += "{\"subscribe\": {}}\n";
+    }
+    for (size_t sent = 0; sent < requests.size();) {
+        auto written = ::send(fd, requests.data() + sent, requests.size() - sent, MSG_NOSIGNAL);
+        if (written <= 0) {
+            break; // Disconnected while still sending
+        }
+        sent += static_cast<size_t>(written);
+    }
+    for (int i = 0; i < 500 && server.connections() != 0; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_EQ(server.connections(), 0u);
+    EXPECT_EQ(bus.subscribers(), 0u);
+    ::close(fd);
+    server.stop();
+}
+
+TEST_F(EventTest, DaemonPublishesLocksReleasesAndDestructions) {
+    Store store(dir / "store");
+    ASSERT_TRUE(store.init("test@example.com", "pbkdf2").isSuccess());
+    auto lock = [&](const std::string& name, const std::string& unlock_at, const std::string& expire_at = "") {
+        std::ofstream(dir / name) << "content of " << name;
+        Policy policy;
+        policy.set_unlock_time(unlock_at);
+        policy.set_owner("test@example.com");
+        policy.set_label("reports");
+        if (!expire_at.empty()) {
+            policy.set_expire_at(time_utils::parse_rfc3339(expire_at).value());
+        }
+        ASSERT_TRUE(store.lock(dir / name, policy).isSuccess());
+    };
+    lock("a.txt", "2030-01-01T00:00:00Z");
+    lock("b.txt", "2031-01-01T00:00:00Z", "2030-06-01T00:00:00Z");
+
+    DaemonOptions options;
+    options.events.socket = dir / "daemon.sock";
+    Daemon daemon(store, options);
+    ASSERT_TRUE(daemon.start().isSuccess());
+    EXPECT_TRUE(daemon.event_server().is_running());
+    auto subscriber = daemon.events().subscribe({});
+
+    // A capsule locked by another process shows up on the next refresh
+    Store other(dir / "store");
+    std::ofstream(dir / "c.txt") << "content";
+    Policy policy;
+    policy.set_unlock_time("2040-01-01T00:00:00Z");
+    policy.set_owner("test@example.com");
+    ASSERT_TRUE(other.lock(dir / "c.txt", policy).isSuccess());
+    auto now = time_utils::parse_rfc3339("2030-07-01T00:00:00Z").value();
+    ASSERT_TRUE(daemon.refresh(now).isSuccess());
+    EXPECT_EQ(daemon.tick(now), 1u);
+
+    auto delivery = daemon.events().take(subscriber, 10);
+    ASSERT_EQ(delivery.events.size(), 3u);
+    EXPECT_EQ(delivery.events[0].type, "locked");
+    EXPECT_EQ(delivery.events[0].capsule_id, "c.txt");
+    EXPECT_EQ(delivery.events[1].type, "destroyed");
+    EXPECT_EQ(delivery.events[1].label, "reports");
+    EXPECT_EQ(delivery.events[2].type, "released");
+    EXPECT_EQ(delivery.events[2].capsule_id, "a.txt");
+
+    // Relocking a known capsule is an update, not a new lock
+    policy.set_unlock_time("2041-01-01T00:00:00Z");
+    ASSERT_TRUE(other.lock(dir / "c.txt", policy).isSuccess());
+    ASSERT_TRUE(daemon.refresh(now).isSuccess());
+    delivery = daemon.events().take(subscriber, 10);
+    ASSERT_EQ(delivery.events.size(), 1u);
+    EXPECT_EQ(delivery.events[0].type, "updated");
+    EXPECT_EQ(delivery.events[0].capsule_id, "c.txt");
+}
@@ -0,0 +1,100 @@
+#include <gtest/gtest.h>
+#include <tcfs/CatalogStats.hpp>
+#include <tcfs/Federation.hpp>
+#include <filesystem>
+#include <fstream>
+
+using namespace tcfs;
+namespace fs = std::filesystem;
+
+namespace {
+
+class FederationTest : public ::testing::Test {
+protected:
+    fs::path dir;
+
+    void SetUp() override {
+        dir = fs::temp_directory_path() /
+              ("tcfs_federation_" + std::string(::testing::UnitTest::GetInstance()->current_test_info()->name()));
+        fs::remove_all(dir);
+        fs::create_directories(dir);
+    }
+
+    void TearDown() override {
+        fs::remove_all(dir);
+    }
+};
+
+} // namespace
+
+TEST_F(FederationTest, ResolvesListsAndConfigFiles) {
+    EXPECT_EQ(Federation::resolve("/mnt/a").value(), (std::vector<fs::path>{"/mnt/a"}));
+    EXPECT_EQ(Federation::resolve("/mnt/a:/mnt/b:").value(), (std::vector<fs::path>{"/mnt/a", "/mnt/b"}));
+    EXPECT_FALSE(Federation::resolve(":").isSuccess());
+
+    // A drive letter is part of its path, not a separator
+    EXPECT_EQ(Federation::resolve("C:\\caps").value(), (std::vector<fs::path>{"C:\\caps"}));
+    auto drives = std::string("C:\\caps") + Federation::SEPARATOR + "D:/more" + Federation::SEPARATOR + "E:\\x";
+    EXPECT_EQ(Federation::resolve(drives).value(), (std::vector<fs::path>{"C:\\caps", "D:/more", "E:\\x"}));
+
+    auto config = dir / "stores.json";
+    std::ofstream(config) << R"({"stores": ["team-a", "/mnt/disk2/tcfs"]})";
+    auto roots = Federation::resolve(config.string());
+    ASSERT_TRUE(roots.isSuccess()) << roots.error_message();
+    EXPECT_EQ(roots.value(), (std::vector<fs::path>{dir / "team-a", "/mnt/disk2/tcfs"}));
+
+    std::ofstream(config) << R"({"stores": []})";
+    EXPECT_FALSE(Federation::resolve(config.string()).isSuccess());
+    std::ofstream(config) << "not json";
+    EXPECT_FALSE(Federation::resolve(config.string()).isSuccess());
+}
+
+TEST_F(FederationTest, FansOutAndMergesUnderAGlobalLimit) {
+    std::vector<fs::path> roots{"a", "b", "c"};
+    auto lengths = Federation::fan_out(roots, [](const fs::path& root) { return root.string().size() * 10; });
+    EXPECT_EQ(lengths, (std::vector<size_t>{10, 10, 10}));
+    EXPECT_THROW(Federation::fan_out(roots,
+                                     [](const fs::path& root) {
+                                         if (root == "b") {
+                                             throw std::runtime_error("store b is offline");
+                                         }
+                                         return 0;
+                                     }),
+                 std::runtime_error);
+
+    std::vector<std::vector<int>> runs{{1, 4, 9}, {}, {2, 4, 5, 11}};
+    auto merged = Federation::merge(runs, std::less<int>());
+    ASSERT_EQ(merged.size(), 7u);
+    std::vector<int> values;
+    for (const auto& [run, value] : merged) {
+        values.push_back(value);
+    }
+    EXPECT_EQ(values, (std::vector<int>{1, 2, 4, 4, 5, 9, 11}));
+    EXPECT_EQ(merged[2].first, 0u); // Ties keep store order
+    EXPECT_EQ(merged[3].first, 2u);
+
+    auto top = Federation::merge(runs, std::less<int>(), 3);
+    ASSERT_EQ(top.size(), 3u);
+    EXPECT_EQ(top.back().second, 4);
+
+    // Per-store stats over the same timeline sum bucket by bucket
+    CatalogColumns first;
+    first.labels.push_back("taxes");
+    first.unlock_at = {100, 200};
+    first.size = {10, 20};
+    first.label = {1, 0};
+    first.owner = {0, 0};
+    first.flags = {CatalogColumns::LIVE | CatalogColumns::LOCKED, CatalogColumns::LIVE | CatalogColumns::LOCKED};
+    CatalogColumns second = first;
+    second.flags[1] = CatalogColumns::LIVE;
+    auto combined = CatalogStats::combine(
+        {CatalogStats::compute(first, 0, 300, 100), CatalogStats::compute(second, 0, 300, 100)});
+    EXPECT_EQ(combined.live().bytes, 60u);
+    EXPECT_EQ(combined.locked().bytes, 40u);
+    ASSERT_EQ(combined.timeline().size(), 3u);
+    EXPECT_EQ(combined.timeline()[1].bytes, 20u);
+    EXPECT_EQ(combined.timeline()[2].bytes, 20u);
+    ASSERT_EQ(combined.by_label().size(), 2u);
+    EXPECT_EQ(combined.by_label()[0].key, "");
+    EXPECT_EQ(combined.by_label()[0].bytes, 40u);
+}
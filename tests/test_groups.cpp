@@ -0,0 +1,216 @@
+#include <gtest/gtest.h>
+#include <tcfs/CatalogSnapshot.hpp>
+#include <tcfs/Daemon.hpp>
+#include <tcfs/Store.hpp>
+#include <filesystem>
+#include <fstream>
+
+using namespace tcfs;
+namespace fs = std::filesystem;
+
+namespace {
+
+class GroupTest : public ::testing::Test {
+protected:
+    fs::path dir;
+
+    void SetUp() override {
+        dir = fs::temp_directory_path() /
+              ("tcfs_groups_" + std::string(::testing::UnitTest::GetInstance()->current_test_info()->name()));
+        fs::remove_all(dir);
+        fs::create_directories(dir / "input");
+    }
+
+    void TearDown() override {
+        fs::remove_all(dir);
+    }
+
+    fs::path write_input(const std::string& name, const std::string& content) {
+        auto path = dir / "input" / name;
+        std::ofstream(path, std::ios::binary) << content;
+        return path;
+    }
+
+    static std::string read_file(const fs::path& path) {
+        std::ifstream in(path, std::ios::binary);
+        return std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    }
+
+    static Policy policy_at(const std::string& unlock_at) {
+        Policy policy;
+        policy.set_unlock_time(unlock_at);
+        policy.set_owner("test@example.com");
+        policy.set_label("archive");
+        return policy;
+    }
+
+    static int64_t seconds(const std::string& rfc3339) {
+        return static_cast<int64_t>(std::chrono::system_clock::to_time_t(time_utils::parse_rfc3339(rfc3339).value()));
+    }
+};
+
+} // namespace
+
+TEST_F(GroupTest, MembersShareOnePolicyRecord) {
+    Store store(dir / "store");
+    ASSERT_TRUE(store.init("test@example.com", "pbkdf2").isSuccess());
+    ASSERT_TRUE(store.create_group("scans", policy_at("2020-01-01T00:00:00Z")).isSuccess());
+    EXPECT_FALSE(store.create_group("scans", policy_at("2030-01-01T00:00:00Z")).isSuccess());
+    EXPECT_FALSE(store.create_group("../escape", policy_at("2030-01-01T00:00:00Z")).isSuccess());
+
+    auto batch = store.lock_group("scans", {write_input("a.txt", "first"), write_input("b.txt", "second"),
+                                            write_input("c.txt", "third")});
+    ASSERT_TRUE(batch.isSuccess()) << batch.error_message();
+    ASSERT_EQ(batch.value().locked.size(), 3u);
+    EXPECT_FALSE(store.lock_group("missing", {write_input("d.txt", "fourth")}).isSuccess());
+
+    // Neither the header nor the stage table carries a copy of the policy
+    auto metadata = nlohmann::json::parse(read_file(store.metadata_path("b.txt")));
+    EXPECT_EQ(metadata.at(Store::GROUP_FIELD), "scans");
+    EXPECT_FALSE(metadata.contains("policy"));
+    EXPECT_FALSE(metadata.at("chunked").at("stages").at(0).contains("policy"));
+
+    auto policy = store.read_policy("b.txt");
+    ASSERT_TRUE(policy.isSuccess()) << policy.error_message();
+    EXPECT_EQ(policy.value().label(), "archive");
+    auto layout = store.read_layout("b.txt");
+    ASSERT_TRUE(layout.isSuccess()) << layout.error_message();
+    EXPECT_EQ(layout.value().stages[0].policy.unlock_time(), policy.value().unlock_time());
+    auto plaintext = store.decrypt("b.txt");
+    ASSERT_TRUE(plaintext.isSuccess()) << plaintext.error_message();
+    EXPECT_EQ(std::string(plaintext.value().begin(), plaintext.value().end()), "second");
+
+    // Sealing a member rewrites its metadata without bringing the policy back
+    ASSERT_TRUE(store.add_recipient("c.txt", "alice", "alice-pass", 1000).isSuccess());
+    EXPECT_FALSE(nlohmann::json::parse(read_file(store.metadata_path("c.txt"))).contains("policy"));
+    store.set_credential(RecipientCredential{"alice", "alice-pass"});
+    EXPECT_TRUE(store.decrypt("c.txt").isSuccess());
+
+    auto catalog = store.catalog();
+    ASSERT_TRUE(catalog.isSuccess());
+    EXPECT_EQ(catalog.value()->group_size("scans"), 3u);
+    EXPECT_EQ(catalog.value()->group_members("scans"), (std::vector<std::string>{"a.txt", "b.txt", "c.txt"}));
+    ASSERT_EQ(catalog.value()->groups().size(), 1u);
+    EXPECT_EQ(catalog.value()->groups()[0]->label, "archive");
+
+    ASSERT_TRUE(store.rebuild_catalog().isSuccess());
+    EXPECT_EQ(store.catalog().value()->group_size("scans"), 3u);
+    EXPECT_EQ(store.catalog().value()->find("a.txt")->group, "scans");
+}
+
+TEST_F(GroupTest, ExtendingMovesEveryMemberWithOneRecord) {
+    Store store(dir / "store");
+    ASSERT_TRUE(store.init("test@example.com", "pbkdf2").isSuccess());
+    auto policy = policy_at("2030-01-01T00:00:00Z");
+    policy.set_expire_at(time_utils::parse_rfc3339("2030-02-01T00:00:00Z").value());
+    ASSERT_TRUE(store.create_group("tax", policy).isSuccess());
+    ASSERT_TRUE(store.lock_group("tax", {write_input("a.txt", "first"), write_input("b.txt", "second")}).isSuccess());
+    auto member_metadata = read_file(store.metadata_path("a.txt"));
+    auto journal_size = fs::file_size(store.catalog_journal_path());
+
+    auto later = time_utils::parse_rfc3339("2031-01-01T00:00:00Z").value();
+    ASSERT_TRUE(store.extend_group("tax", later).isSuccess());
+    EXPECT_FALSE(store.extend_group("tax", time_utils::parse_rfc3339("2030-06-01T00:00:00Z").value()).isSuccess());
+
+    // One group file rewrite and one journal record; member metadata untouched
+    EXPECT_EQ(read_file(store.metadata_path("a.txt")), member_metadata);
+    auto journal = read_file(store.catalog_journal_path()).substr(journal_size);
+    EXPECT_EQ(std::count(journal.begin(), journal.end(), '\n'), 1);
+    EXPECT_EQ(store.read_policy("a.txt").value().unlock_time(), later);
+    EXPECT_EQ(*store.read_policy("b.txt").value().expire_at(), time_utils::parse_rfc3339("2031-02-01T00:00:00Z").value());
+
+    auto* catalog = store.catalog().value();
+    EXPECT_EQ(catalog->find("b.txt")->unlock_at, seconds("2031-01-01T00:00:00Z"));
+    EXPECT_EQ(catalog->find("b.txt")->expire_at, seconds("2031-02-01T00:00:00Z"));
+
+    // Replaying the journal and restoring a snapshot both give members the group's schedule
+    Catalog replayed;
+    ASSERT_TRUE(replayed.load(store.catalog_journal_path()).isSuccess());
+    EXPECT_EQ(replayed.find("a.txt")->unlock_at, seconds("2031-01-01T00:00:00Z"));
+
+    UnlockScheduler scheduler;
+    auto snapshot_path = dir / "catalog.snapshot";
+    ASSERT_TRUE(CatalogSnapshot::save(snapshot_path, catalog->image(), scheduler, store.catalog_journal_path()).isSuccess());
+    auto loaded = CatalogSnapshot::load(snapshot_path, store.catalog_journal_path());
+    ASSERT_TRUE(loaded.isSuccess()) << loaded.error_message();
+    Catalog restored;
+    ASSERT_TRUE(restored.restore(store.catalog_journal_path(), std::move(loaded).value().catalog).isSuccess());
+    ASSERT_NE(restored.find_group("tax"), nullptr);
+    EXPECT_EQ(restored.find_group("tax")->unlock_at, seconds("2031-01-01T00:00:00Z"));
+    EXPECT_EQ(restored.group_size("tax"), 2u);
+}
+
+TEST_F(GroupTest, EditedGroupFilesAreRefused) {
+    Store store(dir / "store");
+    ASSERT_TRUE(store.init("test@example.com", "pbkdf2").isSuccess());
+    ASSERT_TRUE(store.create_group("will", policy_at("2030-01-01T00:00:00Z")).isSuccess());
+    ASSERT_TRUE(store.lock_group("will", {write_input("a.txt", "first")}).isSuccess());
+    ASSERT_TRUE(store.read_group("will").value().contains(Store::SIGNATURE_FIELD));
+    ASSERT_TRUE(store.extend_group("will", time_utils::parse_rfc3339("2031-01-01T00:00:00Z").value()).isSuccess());
+    EXPECT_TRUE(store.read_policy("a.txt").isSuccess()); // Re-signed on every rewrite
+
+    // Moving the unlock time earlier by hand breaks the signature
+    auto record = store.read_group("will").value();
+    record["policy"]["unlock_at"] = "2020-01-01T00:00:00Z";
+    std::ofstream(store.group_path("will"), std::ios::trunc) << record.dump(2);
+    EXPECT_FALSE(Store(dir / "store").group_policy("will").isSuccess());
+    EXPECT_FALSE(Store(dir / "store").read_policy("a.txt").isSuccess());
+
+    // So does dropping it
+    record.erase(Store::SIGNATURE_FIELD);
+    std::ofstream(store.group_path("will"), std::ios::trunc) << record.dump(2);
+    EXPECT_FALSE(Store(dir / "store").group_policy("will").isSuccess());
+}
+
+TEST_F(GroupTest, RetriesFinishUpdatesInterruptedBeforeTheCatalogCommit) {
+    auto root = dir / "store";
+    auto journal_path = root / Catalog::JOURNAL_FILENAME;
+    {
+        Store store(root);
+        ASSERT_TRUE(store.init("test@example.com", "pbkdf2").isSuccess());
+        ASSERT_TRUE(store.catalog().isSuccess());
+    }
+
+    // The group file was written, but the catalog record was lost
+    auto journal = read_file(journal_path);
+    {
+        Store store(root);
+        ASSERT_TRUE(store.create_group("tax", policy_at("2030-01-01T00:00:00Z")).isSuccess());
+    }
+    std::ofstream(journal_path, std::ios::binary | std::ios::trunc) << journal;
+    {
+        Store store(root);
+        ASSERT_EQ(store.catalog().value()->find_group("tax"), nullptr);
+        EXPECT_FALSE(store.create_group("tax", policy_at("2031-01-01T00:00:00Z")).isSuccess());
+        auto created = store.create_group("tax", policy_at("2030-01-01T00:00:00Z"));
+        ASSERT_TRUE(created.isSuccess()) << created.error_message();
+        ASSERT_NE(store.catalog().value()->find_group("tax"), nullptr);
+        ASSERT_TRUE(store.lock_group("tax", {write_input("a.txt", "first")}).isSuccess());
+    }
+
+    journal = read_file(journal_path);
+    auto later = time_utils::parse_rfc3339("2035-01-01T00:00:00Z").value();
+    {
+        Store store(root);
+        ASSERT_TRUE(store.extend_group("tax", later).isSuccess());
+    }
+    std::ofstream(journal_path, std::ios::binary | std::ios::trunc) << journal;
+    {
+        Store store(root);
+        EXPECT_EQ(store.catalog().value()->find("a.txt")->unlock_at, seconds("2030-01-01T00:00:00Z"));
+        EXPECT_EQ(store.read_policy("a.txt").value().unlock_time(), later);
+
+        // The daemon goes by the group file, not the lagging catalog
+        Daemon daemon(store, DaemonOptions{});
+        ASSERT_TRUE(daemon.start().isSuccess());
+        EXPECT_EQ(daemon.tick(time_utils::parse_rfc3339("2031-01-01T00:00:00Z").value()), 0u);
+        EXPECT_EQ(daemon.scheduler().due_time("a.txt"), later);
+
+        auto retried = store.extend_group("tax", later);
+        ASSERT_TRUE(retried.isSuccess()) << retried.error_message();
+        EXPECT_EQ(store.catalog().value()->find("a.txt")->unlock_at, seconds("2035-01-01T00:00:00Z"));
+        auto size = fs::file_size(journal_path);
+        EXPECT_TRUE(store.extend_group("tax", later).isSuccess());
+        EXPECT_EQ(fs::file_size(journal_path), size); // Nothing left to commit
+    }
+}
@@ -0,0 +1,150 @@
+#include <gtest/gtest.h>
+#include <tcfs/Daemon.hpp>
+#include <tcfs/InboxWatcher.hpp>
+#include <tcfs/Store.hpp>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+
+using namespace tcfs;
+namespace fs = std::filesystem;
+
+namespace {
+
+class InboxTest : public ::testing::Test {
+protected:
+    fs::path dir;
+    std::unique_ptr<Store> store;
+
+    void SetUp() override {
+        dir = fs::temp_directory_path() /
+              ("tcfs_inbox_" + std::string(::testing::UnitTest::GetInstance()->current_test_info()->name()));
+        fs::remove_all(dir);
+        fs::create_directories(dir / "inbox");
+        store = std::make_unique<Store>(dir / "store");
+        ASSERT_TRUE(store->init("test@example.com", "pbkdf2").isSuccess());
+    }
+
+    void TearDown() override {
+        store.reset();
+        fs::remove_all(dir);
+    }
+
+    fs::path drop(const std::string& name, const std::string& content = "") {
+        auto path = dir / "inbox" / name;
+        std::ofstream(path, std::ios::binary) << (content.empty() ? "content of " + name : content);
+        return path;
+    }
+
+    static std::vector<std::string> names(const std::vector<fs::path>& paths) {
+        std::vector<std::string> result;
+        for (const auto& path : paths) {
+            result.push_back(path.filename().string());
+        }
+        std::sort(result.begin(), result.end());
+        return result;
+    }
+
+    static Policy policy_at(const std::string& unlock_at) {
+        Policy policy;
+        policy.set_unlock_time(unlock_at);
+        policy.set_owner("test@example.com");
+        return policy;
+    }
+};
+
+} // namespace
+
+TEST_F(InboxTest, WatcherReportsFinishedFilesOnceAndSkipsHiddenOnes) {
+    drop("before.txt");
+    drop(".partial");
+
+    InboxWatcher watcher(dir / "inbox");
+    ASSERT_TRUE(watcher.start().isSuccess());
+    EXPECT_EQ(names(watcher.take(10)), std::vector<std::string>{"before.txt"});
+
+    // Two writes to the same file coalesce into one entry
+    drop("new.txt", "first");
+    drop("new.txt", "second");
+    drop("other.txt");
+    for (int i = 0; i < 3 && watcher.pending() < 2; ++i) {
+        watcher.wait(std::chrono::milliseconds(100));
+    }
+    EXPECT_EQ(names(watcher.take(10)), (std::vector<std::string>{"new.txt", "other.txt"}));
+    EXPECT_EQ(watcher.pending(), 0u);
+
+    // take() honours its limit and keeps the rest queued
+    drop("a.txt");
+    drop("b.txt");
+    for (int i = 0; i < 3 && watcher.pending() < 2; ++i) {
+        watcher.wait(std::chrono::milliseconds(100));
+    }
+    EXPECT_EQ(watcher.take(1).size(), 1u);
+    EXPECT_EQ(watcher.pending(), 1u);
+}
+
+TEST_F(InboxTest, LockBatchCommitsGoodFilesAndReportsBadOnes) {
+    std::vector<fs::path> inputs;
+    for (int i = 0; i < 20; ++i) {
+        inputs.push_back(drop("file" + std::to_string(i) + ".txt"));
+    }
+    inputs.push_back(dir / "inbox" / "missing.txt");
+    fs::create_directories(dir / "elsewhere");
+    std::ofstream(dir / "elsewhere" / "file0.txt") << "same name";
+    inputs.push_back(dir / "elsewhere" / "file0.txt");
+
+    auto result = store->lock_batch(inputs, policy_at("2030-01-01T00:00:00Z"), 4);
+    ASSERT_TRUE(result.isSuccess()) << result.error_message();
+    EXPECT_EQ(result.value().locked.size(), 20u);
+    EXPECT_EQ(result.value().locked.front(), "file0.txt");
+    ASSERT_EQ(result.value().failed.size(), 2u);
+
+    // The batch went to the journal in input order and survives a reload
+    Store reopened(dir / "store");
+    EXPECT_EQ(reopened.catalog().value()->size(), 20u);
+    auto decrypted = reopened.decrypt("file7.txt");
+    ASSERT_TRUE(decrypted.isSuccess());
+    EXPECT_EQ(std::string(decrypted.value().begin(), decrypted.value().end()), "content of file7.txt");
+}
+
+TEST_F(InboxTest, PutAllWritesNothingWhenAnyEntryIsInvalid) {
+    auto catalog = store->catalog().value();
+    CatalogEntry good;
+    good.id = "good";
+    CatalogEntry bad;
+    bad.id = "bad";
+    bad.depends_on = {"unknown"};
+
+    EXPECT_FALSE(catalog->put_all({good, bad}).isSuccess());
+    EXPECT_FALSE(catalog->contains("good"));
+    ASSERT_TRUE(catalog->put_all({good}).isSuccess());
+    EXPECT_TRUE(catalog->contains("good"));
+}
+
+TEST_F(InboxTest, DaemonLocksInboxFilesAndSchedulesThem) {
+    ASSERT_TRUE(store->lock(drop("taken.txt"), policy_at("2031-01-01T00:00:00Z")).isSuccess());
+    drop("taken.txt", "would overwrite");
+    drop("report.pdf");
+    drop("photo.jpg");
+
+    DaemonOptions options;
+    options.inbox.dir = dir / "inbox";
+    options.inbox.lock_for = std::chrono::hours(24);
+    options.inbox.label = "inbox";
+    Daemon daemon(*store, options);
+    ASSERT_TRUE(daemon.start().isSuccess());
+
+    auto now = time_utils::parse_rfc3339("2030-06-01T00:00:00Z").value();
+    EXPECT_EQ(daemon.ingest(now), 2u);
+    EXPECT_FALSE(fs::exists(dir / "inbox" / "report.pdf"));
+    EXPECT_FALSE(fs::exists(dir / "inbox" / "photo.jpg"));
+    EXPECT_TRUE(fs::exists(dir / "inbox" / "taken.txt"));
+
+    const auto* entry = store->catalog().value()->find("report.pdf");
+    ASSERT_NE(entry, nullptr);
+    EXPECT_EQ(entry->label, "inbox");
+    EXPECT_EQ(*daemon.scheduler().next_due(), now + std::chrono::hours(24));
+
+    // A day later they are released like any other capsule
+    EXPECT_EQ(daemon.tick(now + std::chrono::hours(24)), 2u);
+}
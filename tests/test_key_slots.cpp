@@ -0,0 +1,187 @@
+#include <gtest/gtest.h>
+#include <tcfs/KeySlots.hpp>
+#include <tcfs/Store.hpp>
+#include <filesystem>
+#include <fstream>
+
+using namespace tcfs;
+namespace fs = std::filesystem;
+
+namespace {
+
+// Few iterations keep the tests fast; the KDF itself is OpenSSL's
+constexpr uint32_t TEST_ITERATIONS = 1000;
+
+class KeySlotsTest : public ::testing::Test {
+protected:
+    fs::path dir;
+    std::unique_ptr<CryptoProvider> crypto = createCryptoProvider();
+
+    void SetUp() override {
+        dir = fs::temp_directory_path() /
+              ("tcfs_key_slots_" + std::string(::testing::UnitTest::GetInstance()->current_test_info()->name()));
+        fs::remove_all(dir);
+        fs::create_directories(dir / "input");
+    }
+
+    void TearDown() override {
+        fs::remove_all(dir);
+    }
+
+    fs::path write_input(const std::string& name, const std::string& content) {
+        auto path = dir / "input" / name;
+        std::ofstream(path, std::ios::binary) << content;
+        return path;
+    }
+
+    static std::string read_file(const fs::path& path) {
+        std::ifstream in(path, std::ios::binary);
+        return std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    }
+
+    static Policy policy_at(const std::string& unlock_at) {
+        Policy policy;
+        policy.set_unlock_time(unlock_at);
+        policy.set_owner("test@example.com");
+        return policy;
+    }
+};
+
+} // namespace
+
+TEST_F(KeySlotsTest, SlotsWrapOneMasterKeyPerRecipient) {
+    auto master = crypto->generateKey();
+    KeySlots slots;
+    ASSERT_TRUE(slots.add(*crypto, "alice", "correct horse", master, TEST_ITERATIONS).isSuccess());
+    ASSERT_TRUE(slots.add(*crypto, "bob", "battery staple", master, TEST_ITERATIONS).isSuccess());
+    EXPECT_EQ(slots.recipients(), (std::vector<std::string>{"alice", "bob"}));
+
+    auto parsed = KeySlots::from_json(slots.to_json(*crypto), *crypto);
+    ASSERT_TRUE(parsed.isSuccess()) << parsed.error_message();
+
+    auto opened = parsed.value().open(*crypto, {"bob", "battery staple"});
+    ASSERT_TRUE(opened.isSuccess()) << opened.error_message();
+    EXPECT_EQ(opened.value().data, master.data);
+
+    auto wrong = parsed.value().open(*crypto, {"alice", "battery staple"});
+    EXPECT_FALSE(wrong.isSuccess());
+    EXPECT_EQ(wrong.error(), ErrorCode::InvalidKey);
+    EXPECT_EQ(parsed.value().open(*crypto, {"mallory", "correct horse"}).error(), ErrorCode::InvalidKey);
+
+    EXPECT_TRUE(parsed.value().remove("alice"));
+    EXPECT_FALSE(parsed.value().remove("alice"));
+    EXPECT_FALSE(parsed.value().contains("alice"));
+}
+
+TEST_F(KeySlotsTest, SealedCapsuleOpensOnlyForRecipients) {
+    Store store(dir / "store");
+    ASSERT_TRUE(store.init("test@example.com", "pbkdf2").isSuccess());
+    auto id = store.lock(write_input("plan.txt", "shared secret plan"), policy_at("2020-01-01T00:00:00Z"));
+    ASSERT_TRUE(id.isSuccess()) << id.error_message();
+    auto ciphertext = read_file(store.capsule_path(id.value()));
+
+    ASSERT_TRUE(store.add_recipient(id.value(), "alice", "alice-pass", TEST_ITERATIONS).isSuccess());
+    EXPECT_EQ(read_file(store.capsule_path(id.value())), ciphertext);
+    EXPECT_EQ(read_file(store.metadata_path(id.value())).find("data_key_encrypted"), std::string::npos);
+
+    // Without a credential the stage table still loads, but nothing decrypts
+    auto layout = store.read_layout(id.value());
+    ASSERT_TRUE(layout.isSuccess());
+    EXPECT_TRUE(layout.value().sealed);
+    auto locked_out = store.decrypt(id.value());
+    ASSERT_FALSE(locked_out.isSuccess());
+    EXPECT_EQ(locked_out.error(), ErrorCode::InvalidKey);
+
+    // Adding a second recipient needs an existing one
+    EXPECT_FALSE(store.add_recipient(id.value(), "bob", "bob-pass", TEST_ITERATIONS).isSuccess());
+    store.set_credential(RecipientCredential{"alice", "alice-pass"});
+    ASSERT_TRUE(store.add_recipient(id.value(), "bob", "bob-pass", TEST_ITERATIONS).isSuccess());
+    auto plaintext = store.decrypt(id.value());
+    ASSERT_TRUE(plaintext.isSuccess()) << plaintext.error_message();
+    EXPECT_EQ(std::string(plaintext.value().begin(), plaintext.value().end()), "shared secret plan");
+
+    store.set_credential(RecipientCredential{"alice", "not-alice-pass"});
+    EXPECT_EQ(store.decrypt(id.value()).error(), ErrorCode::InvalidKey);
+
+    auto recipients = store.recipients(id.value());
+    ASSERT_TRUE(recipients.isSuccess());
+    EXPECT_EQ(recipients.value(), (std::vector<std::string>{"alice", "bob"}));
+}
+
+TEST_F(KeySlotsTest, RemovingARecipientRewritesOnlyMetadata) {
+    Store store(dir / "store");
+    ASSERT_TRUE(store.init("test@example.com", "pbkdf2").isSuccess());
+    auto id = store.lock(write_input("plan.txt", "shared secret plan"), policy_at("2020-01-01T00:00:00Z"));
+    ASSERT_TRUE(id.isSuccess());
+    ASSERT_TRUE(store.add_recipient(id.value(), "alice", "alice-pass", TEST_ITERATIONS).isSuccess());
+    store.set_credential(RecipientCredential{"alice", "alice-pass"});
+    ASSERT_TRUE(store.add_recipient(id.value(), "bob", "bob-pass", TEST_ITERATIONS).isSuccess());
+    auto ciphertext = read_file(store.capsule_path(id.value()));
+
+    ASSERT_TRUE(store.remove_recipient(id.value(), "alice").isSuccess());
+    EXPECT_EQ(read_file(store.capsule_path(id.value())), ciphertext);
+    EXPECT_FALSE(store.decrypt(id.value()).isSuccess());
+
+    store.set_credential(RecipientCredential{"bob", "bob-pass"});
+    auto plaintext = store.decrypt(id.value());
+    ASSERT_TRUE(plaintext.isSuccess()) << plaintext.error_message();
+    EXPECT_EQ(std::string(plaintext.value().begin(), plaintext.value().end()), "shared secret plan");
+
+    EXPECT_FALSE(store.remove_recipient(id.value(), "bob").isSuccess());
+    EXPECT_FALSE(store.remove_recipient(id.value(), "alice").isSuccess());
+}
+
+TEST_F(KeySlotsTest, SealContextWrapsForThePrivateKeyHolder) {
+    auto alice = crypto->generateX25519PrivateKey();
+    auto bob = crypto->generateX25519PrivateKey();
+    EXPECT_EQ(crypto->x25519(alice, crypto->x25519PublicKey(bob)).data,
+              crypto->x25519(bob, crypto->x25519PublicKey(alice)).data);
+
+    auto context = SealContext::create(*crypto, {"alice", crypto->x25519PublicKey(alice)});
+    ASSERT_TRUE(context.isSuccess()) << context.error_message();
+    auto master = crypto->generateKey();
+    KeySlots slots;
+    ASSERT_TRUE(slots.add_sealed(*crypto, context.value(), master).isSuccess());
+
+    auto parsed = KeySlots::from_json(slots.to_json(*crypto), *crypto);
+    ASSERT_TRUE(parsed.isSuccess()) << parsed.error_message();
+    auto opened = parsed.value().open(*crypto, {"alice", "", alice.data});
+    ASSERT_TRUE(opened.isSuccess()) << opened.error_message();
+    EXPECT_EQ(opened.value().data, master.data);
+    EXPECT_EQ(parsed.value().open(*crypto, {"alice", "", bob.data}).error(), ErrorCode::InvalidKey);
+
+    EXPECT_FALSE(SealContext::create(*crypto, {"alice", {1, 2, 3}}).isSuccess());
+}
+
+TEST_F(KeySlotsTest, BatchSharesOneKeyAgreementPerRecipient) {
+    auto alice = crypto->generateX25519PrivateKey();
+    Store store(dir / "store");
+    ASSERT_TRUE(store.init("test@example.com", "pbkdf2").isSuccess());
+    store.set_seal_recipients({{"alice", crypto->x25519PublicKey(alice)}});
+
+    auto batch = store.lock_batch({write_input("a.txt", "first"), write_input("b.txt", "second")},
+                                  policy_at("2020-01-01T00:00:00Z"), 2);
+    ASSERT_TRUE(batch.isSuccess()) << batch.error_message();
+    ASSERT_EQ(batch.value().locked.size(), 2u);
+    auto single = store.lock(write_input("c.txt", "third"), policy_at("2020-01-01T00:00:00Z"));
+    ASSERT_TRUE(single.isSuccess()) << single.error_message();
+
+    auto ephemeral_of = [&](const std::string& id) {
+        auto metadata = nlohmann::json::parse(read_file(store.metadata_path(id)));
+        return metadata.at("key_slots").at("slots").at("alice").at("ephemeral").get<std::string>();
+    };
+    EXPECT_EQ(ephemeral_of(batch.value().locked[0]), ephemeral_of(batch.value().locked[1]));
+    EXPECT_NE(ephemeral_of(batch.value().locked[0]), ephemeral_of(single.value()));
+
+    EXPECT_EQ(store.decrypt(batch.value().locked[1]).error(), ErrorCode::InvalidKey);
+    store.set_credential(RecipientCredential{"alice", "", crypto->generateX25519PrivateKey().data});
+    EXPECT_EQ(store.decrypt(batch.value().locked[1]).error(), ErrorCode::InvalidKey);
+
+    store.set_credential(RecipientCredential{"alice", "", alice.data});
+    auto plaintext = store.decrypt(batch.value().locked[1]);
+    ASSERT_TRUE(plaintext.isSuccess()) << plaintext.error_message();
+    EXPECT_EQ(std::string(plaintext.value().begin(), plaintext.value().end()), "second");
+    auto recipients = store.recipients(single.value());
+    ASSERT_TRUE(recipients.isSuccess());
+    EXPECT_EQ(recipients.value(), (std::vector<std::string>{"alice"}));
+}
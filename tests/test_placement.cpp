@@ -0,0 +1,133 @@
+#include <gtest/gtest.h>
+#include <tcfs/PlacementRing.hpp>
+#include <tcfs/Store.hpp>
+#include <filesystem>
+#include <fstream>
+#include <map>
+
+using namespace tcfs;
+namespace fs = std::filesystem;
+
+namespace {
+
+class PlacementTest : public ::testing::Test {
+protected:
+    fs::path dir;
+
+    void SetUp() override {
+        dir = fs::temp_directory_path() /
+              ("tcfs_placement_" + std::string(::testing::UnitTest::GetInstance()->current_test_info()->name()));
+        fs::remove_all(dir);
+        fs::create_directories(dir / "input");
+    }
+
+    void TearDown() override {
+        fs::remove_all(dir);
+    }
+
+    std::vector<std::string> lock_files(Store& store, size_t count) {
+        Policy policy;
+        policy.set_unlock_time("2020-01-01T00:00:00Z");
+        policy.set_owner("test@example.com");
+        std::vector<std::string> ids;
+        for (size_t i = 0; i < count; ++i) {
+            auto input = dir / "input" / ("file" + std::to_string(i) + ".txt");
+            std::ofstream(input, std::ios::binary) << "content " << i;
+            auto id = store.lock(input, policy);
+            EXPECT_TRUE(id.isSuccess()) << id.error_message();
+            ids.push_back(id.value());
+        }
+        return ids;
+    }
+
+    static size_t copies_of(const std::string& id, const std::vector<fs::path>& dirs) {
+        size_t copies = 0;
+        for (const auto& data_dir : dirs) {
+            copies += fs::exists(data_dir / (id + Store::CAPSULE_EXTENSION)) ? 1u : 0u;
+        }
+        return copies;
+    }
+};
+
+} // namespace
+
+TEST_F(PlacementTest, AddingAMemberMovesOnlyItsShare) {
+    PlacementRing three({"a", "b", "c"});
+    PlacementRing four({"a", "b", "c", "d"});
+    constexpr size_t KEYS = 20000;
+    std::map<std::string, size_t> load;
+    size_t moved = 0;
+    for (size_t i = 0; i < KEYS; ++i) {
+        auto key = "capsule-" + std::to_string(i);
+        const auto& before = three.locate(key);
+        const auto& after = four.locate(key);
+        if (before != after) {
+            EXPECT_EQ(after, "d");
+            ++moved;
+        }
+        ++load[after];
+    }
+    EXPECT_GT(moved, KEYS / 4 - KEYS / 10);
+    EXPECT_LT(moved, KEYS / 4 + KEYS / 10);
+    for (const auto& [member, keys] : load) {
+        EXPECT_GT(keys, KEYS / 8) << member;
+    }
+    EXPECT_EQ(PlacementRing({"c", "a", "b"}).locate("x"), three.locate("x"));
+}
+
+TEST_F(PlacementTest, AddingADataDirMovesCapsulesThatStillDecrypt) {
+    Store store(dir / "store");
+    ASSERT_TRUE(store.init("test@example.com", "pbkdf2").isSuccess());
+    auto ids = lock_files(store, 24);
+
+    auto added = store.add_data_dir(dir / "disk2", 2);
+    ASSERT_TRUE(added.isSuccess()) << added.error_message();
+    EXPECT_TRUE(added.value().failed.empty());
+    EXPECT_GT(added.value().moved, 0u);
+    EXPECT_LT(added.value().moved, ids.size());
+    EXPECT_EQ(store.data_dirs(), (std::vector<fs::path>{dir / "store", dir / "disk2"}));
+    EXPECT_FALSE(store.add_data_dir(dir / "disk2").isSuccess());
+
+    // A fresh handle reads the layout from the config; every capsule has exactly one copy
+    Store reopened(dir / "store");
+    size_t on_disk2 = 0;
+    for (size_t i = 0; i < ids.size(); ++i) {
+        EXPECT_EQ(copies_of(ids[i], {dir / "store", dir / "disk2"}), 1u);
+        on_disk2 += reopened.capsule_path(ids[i]).parent_path() == dir / "disk2" ? 1u : 0u;
+        auto plaintext = reopened.decrypt(ids[i]);
+        ASSERT_TRUE(plaintext.isSuccess()) << plaintext.error_message();
+        EXPECT_EQ(std::string(plaintext.value().begin(), plaintext.value().end()), "content " + std::to_string(i));
+    }
+    EXPECT_EQ(on_disk2, added.value().moved);
+
+    // New capsules land on their ring position directly
+    auto more = lock_files(reopened, 1);
+    EXPECT_TRUE(fs::exists(reopened.capsule_path(more.front())));
+}
+
+TEST_F(PlacementTest, RebalanceFinishesAnInterruptedMove) {
+    Store store(dir / "store");
+    ASSERT_TRUE(store.init("test@example.com", "pbkdf2").isSuccess());
+    auto ids = lock_files(store, 16);
+    ASSERT_TRUE(store.add_data_dir(dir / "disk2").isSuccess());
+    ASSERT_TRUE(store.add_data_dir(dir / "disk3").isSuccess());
+    std::vector<fs::path> dirs{dir / "store", dir / "disk2", dir / "disk3"};
+
+    // One capsule left behind in the wrong directory, one with a stale extra copy
+    auto misplaced = store.capsule_path(ids[0]);
+    auto elsewhere = (misplaced.parent_path() == dir / "disk3" ? dir / "disk2" : dir / "disk3") /
+                     misplaced.filename();
+    fs::rename(misplaced, elsewhere);
+    auto duplicated = store.capsule_path(ids[1]);
+    fs::copy_file(duplicated, (duplicated.parent_path() == dir / "store" ? dir / "disk2" : dir / "store") /
+                                  duplicated.filename());
+
+    auto rebalanced = store.rebalance();
+    ASSERT_TRUE(rebalanced.isSuccess()) << rebalanced.error_message();
+    EXPECT_EQ(rebalanced.value().moved, 1u);
+    for (const auto& id : ids) {
+        EXPECT_EQ(copies_of(id, dirs), 1u) << id;
+        EXPECT_TRUE(fs::exists(store.capsule_path(id)));
+    }
+    EXPECT_TRUE(store.decrypt(ids[0]).isSuccess());
+}
@@ -120,4 +120,24 @@ TEST_F(PolicyTest, Validation) {
     auto past_time = std::chrono::system_clock::now() - std::chrono::hours(1);
     policy->setUnlockTime(past_time);
     EXPECT_FALSE(policy->isValid());
-}
\ No newline at end of file
+}
+
+TEST_F(PolicyTest, ExpiryBlocksUnlockAndRoundTrips) {
+    policy->set_unlock_time("2030-01-01T00:00:00Z");
+    policy->set_owner("test_user");
+    policy->set_expire_at(time_utils::parse_rfc3339("2030-02-01T00:00:00Z").value());
+    EXPECT_TRUE(policy->isValid());
+
+    EXPECT_TRUE(policy->is_unlock_allowed(time_utils::parse_rfc3339("2030-01-15T00:00:00Z").value()));
+    EXPECT_FALSE(policy->is_unlock_allowed(time_utils::parse_rfc3339("2030-02-01T00:00:00Z").value()));
+    EXPECT_FALSE(policy->next_unlock_time(time_utils::parse_rfc3339("2030-03-01T00:00:00Z").value()).has_value());
+
+    auto parsed = Policy::from_json(policy->to_json());
+    ASSERT_TRUE(parsed.isSuccess());
+    ASSERT_TRUE(parsed.value().expire_at().has_value());
+    EXPECT_EQ(time_utils::format_rfc3339(*parsed.value().expire_at()), "2030-02-01T00:00:00Z");
+
+    // Expiring before the unlock time is rejected
+    policy->set_expire_at(time_utils::parse_rfc3339("2029-12-31T00:00:00Z").value());
+    EXPECT_FALSE(policy->isValid());
+}
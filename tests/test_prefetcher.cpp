@@ -0,0 +1,210 @@
+#include <gtest/gtest.h>
+#include <tcfs/Daemon.hpp>
+#include <tcfs/PageCache.hpp>
+#include <tcfs/Prefetcher.hpp>
+#include <filesystem>
+#include <fstream>
+
+using namespace tcfs;
+namespace fs = std::filesystem;
+
+namespace {
+
+class PrefetcherTest : public ::testing::Test {
+protected:
+    fs::path dir;
+    std::unique_ptr<Store> store;
+
+    void SetUp() override {
+        dir = fs::temp_directory_path() /
+              ("tcfs_prefetch_" + std::string(::testing::UnitTest::GetInstance()->current_test_info()->name()));
+        fs::remove_all(dir);
+        fs::create_directories(dir / "input");
+        store = std::make_unique<Store>(dir / "store");
+        ASSERT_TRUE(store->init("test@example.com", "pbkdf2").isSuccess());
+    }
+
+    void TearDown() override {
+        store.reset();
+        fs::remove_all(dir);
+    }
+
+    std::string lock(const std::string& name, const std::string& unlock_at, size_t size = 1024) {
+        auto input = dir / "input" / name;
+        std::ofstream(input, std::ios::binary) << std::string(size, 'x');
+        Policy policy;
+        policy.set_unlock_time(unlock_at);
+        policy.set_owner("test@example.com");
+        auto id = store->lock(input, policy);
+        EXPECT_TRUE(id.isSuccess());
+        return id.value();
+    }
+
+    static Policy::TimePoint t(const std::string& rfc3339) {
+        return time_utils::parse_rfc3339(rfc3339).value();
+    }
+};
+
+} // namespace
+
+TEST(PageCacheTest, AdvisesExistingFilesAndRejectsMissingOnes) {
+    auto path = fs::temp_directory_path() / "tcfs_page_cache_advice";
+    std::ofstream(path, std::ios::binary) << std::string(8192, 'p');
+    EXPECT_TRUE(advise_willneed(path).isSuccess());
+    EXPECT_TRUE(advise_willneed(path, 4096, 1024).isSuccess());
+    EXPECT_TRUE(advise_dontneed(path).isSuccess());
+    fs::remove(path);
+    EXPECT_FALSE(advise_willneed(path).isSuccess());
+}
+
+TEST_F(PrefetcherTest, PrefetchesOnlyCapsulesWithinTheHorizon) {
+    auto soon = lock("soon.txt", "2030-01-01T00:05:00Z");
+    auto later = lock("later.txt", "2030-01-01T02:00:00Z");
+
+    UnlockScheduler scheduler;
+    scheduler.schedule_at(soon, t("2030-01-01T00:05:00Z"));
+    scheduler.schedule_at(later, t("2030-01-01T02:00:00Z"));
+
+    PrefetchOptions options;
+    options.horizon = std::chrono::minutes(10);
+    Prefetcher prefetcher(*store, options);
+
+    auto now = t("2030-01-01T00:00:00Z");
+    EXPECT_EQ(prefetcher.prefetch(scheduler, now), 1u);
+    EXPECT_TRUE(prefetcher.is_prefetched(soon));
+    EXPECT_FALSE(prefetcher.is_prefetched(later));
+    EXPECT_EQ(prefetcher.resident_bytes(), fs::file_size(store->capsule_path(soon)));
+
+    // Nothing new enters the horizon until the later capsule is 10 minutes out
+    EXPECT_EQ(prefetcher.prefetch(scheduler, now), 0u);
+    EXPECT_EQ(*prefetcher.next_wake(scheduler, now), t("2030-01-01T01:50:00Z"));
+    EXPECT_EQ(prefetcher.prefetch(scheduler, t("2030-01-01T01:50:00Z")), 1u);
+    EXPECT_FALSE(prefetcher.next_wake(scheduler, t("2030-01-01T01:50:00Z")).has_value());
+
+    prefetcher.release(soon);
+    EXPECT_FALSE(prefetcher.is_prefetched(soon));
+    EXPECT_EQ(prefetcher.resident_bytes(), fs::file_size(store->capsule_path(later)));
+    prefetcher.forget(later);
+    EXPECT_EQ(prefetcher.resident_bytes(), 0u);
+}
+
+TEST_F(PrefetcherTest, ByteBudgetAndResidentCapThrottleReadahead) {
+    auto a = lock("a.txt", "2030-01-01T00:01:00Z", 4096);
+    auto b = lock("b.txt", "2030-01-01T00:02:00Z", 4096);
+    auto c = lock("c.txt", "2030-01-01T00:03:00Z", 4096);
+
+    UnlockScheduler scheduler;
+    scheduler.schedule_at(a, t("2030-01-01T00:01:00Z"));
+    scheduler.schedule_at(b, t("2030-01-01T00:02:00Z"));
+    scheduler.schedule_at(c, t("2030-01-01T00:03:00Z"));
+    auto capsule_size = fs::file_size(store->capsule_path(a));
+
+    PrefetchOptions options;
+    options.horizon = std::chrono::minutes(10);
+    options.bytes_per_second = capsule_size;
+    options.max_resident_bytes = 2 * capsule_size;
+    Prefetcher prefetcher(*store, options);
+
+    // One capsule's worth of budget per second
+    auto now = t("2030-01-01T00:00:00Z");
+    EXPECT_EQ(prefetcher.prefetch(scheduler, now), 1u);
+    EXPECT_EQ(prefetcher.prefetch(scheduler, now), 0u);
+    EXPECT_EQ(prefetcher.prefetch(scheduler, now + std::chrono::seconds(1)), 1u);
+
+    // The resident cap holds the third back until a release hands pages back
+    EXPECT_EQ(prefetcher.prefetch(scheduler, now + std::chrono::seconds(2)), 0u);
+    EXPECT_FALSE(prefetcher.is_prefetched(c));
+    scheduler.remove(a);
+    prefetcher.release(a);
+    EXPECT_EQ(prefetcher.prefetch(scheduler, now + std::chrono::seconds(3)), 1u);
+    EXPECT_TRUE(prefetcher.is_prefetched(c));
+}
+
+TEST_F(PrefetcherTest, DaemonPrefetchesAheadAndReleasesAfterUnlock) {
+    auto id = lock("soon.txt", "2030-01-01T00:05:00Z");
+
+    DaemonOptions options;
+    options.prefetch.horizon = std::chrono::minutes(10);
+    Daemon daemon(*store, options);
+    ASSERT_TRUE(daemon.start().isSuccess());
+
+    EXPECT_EQ(daemon.tick(t("2030-01-01T00:00:00Z")), 0u);
+    EXPECT_TRUE(daemon.prefetcher().is_prefetched(id));
+    EXPECT_EQ(daemon.tick(t("2030-01-01T00:05:00Z")), 1u);
+    EXPECT_FALSE(daemon.prefetcher().is_prefetched(id));
+    EXPECT_EQ(daemon.prefetcher().resident_bytes(), 0u);
+}
+
+TEST_F(PrefetcherTest, DaemonForgetsCapsulesExtendedPastTheHorizon) {
+    auto id = lock("soon.txt", "2030-01-01T00:05:00Z");
+    auto other = lock("other.txt", "2030-01-01T00:08:00Z");
+    auto capsule_size = fs::file_size(store->capsule_path(id));
+
+    DaemonOptions options;
+    options.prefetch.horizon = std::chrono::minutes(10);
+    options.prefetch.max_resident_bytes = capsule_size;
+    Daemon daemon(*store, options);
+    ASSERT_TRUE(daemon.start().isSuccess());
+
+    auto now = t("2030-01-01T00:00:00Z");
+    EXPECT_EQ(daemon.tick(now), 0u);
+    EXPECT_TRUE(daemon.prefetcher().is_prefetched(id));
+    EXPECT_FALSE(daemon.prefetcher().is_prefetched(other));
+
+    // Extended by another process: the daemon hands its pages back and makes room for the next capsule
+    Store writer(dir / "store");
+    UnlockExtension extension;
+    extension.to = t("2030-01-02T00:00:00Z");
+    ASSERT_TRUE(writer.extend(CatalogQuery::parse("name=soon.txt").value(), extension).isSuccess());
+    ASSERT_TRUE(daemon.refresh(now).isSuccess());
+    EXPECT_FALSE(daemon.prefetcher().is_prefetched(id));
+    EXPECT_EQ(daemon.prefetcher().resident_bytes(), 0u);
+
+    EXPECT_EQ(daemon.tick(now + std::chrono::seconds(1)), 0u);
+    EXPECT_TRUE(daemon.prefetcher().is_prefetched(other));
+}
+
+TEST(UnlockSchedulerTest, NextDueAfterSkipsEntriesAtOrBeforeTime) {
+    UnlockScheduler scheduler;
+    auto base = time_utils::parse_rfc3339("2030-01-01T00:00:00Z").value();
+    scheduler.schedule_at("a", base);
+    scheduler.schedule_at("b", base + std::chrono::hours(1));
+    EXPECT_EQ(*scheduler.next_due_after(base - std::chrono::seconds(1)), base);
+    EXPECT_EQ(*scheduler.next_due_after(base), base + std::chrono::hours(1));
+    EXPECT_FALSE(scheduler.next_due_after(base + std::chrono::hours(1)).has_value());
+}
+
+TEST(UnlockSchedulerTest, LoadedEntriesMergeWithLaterChanges) {
+    UnlockScheduler scheduler;
+    auto base = time_utils::parse_rfc3339("2030-01-01T00:00:00Z").value();
+    auto at = [&](int hours) { return base + std::chrono::hours(hours); };
+    scheduler.load({{"d", at(4)}, {"a", at(1)}, {"c", at(3)}, {"b", at(2)}, {"a", at(5)}, {"e", at(5)}});
+    EXPECT_EQ(scheduler.size(), 5u);
+    EXPECT_EQ(*scheduler.due_time("a"), at(1)); // The earliest entry for an id wins
+    EXPECT_EQ(*scheduler.next_due(), at(1));
+
+    // Moving, removing and adding capsules leaves the index ordered
+    scheduler.schedule_at("c", at(0));
+    scheduler.remove("a");
+    scheduler.schedule_at("f", at(2));
+    EXPECT_FALSE(scheduler.contains("a"));
+    EXPECT_EQ(*scheduler.due_time("c"), at(0));
+    EXPECT_EQ(*scheduler.next_due_after(at(2)), at(4));
+    auto ahead = scheduler.peek_until(at(4));
+    ASSERT_EQ(ahead.size(), 4u);
+    EXPECT_EQ(ahead[0].capsule_id, "c");
+    EXPECT_EQ(ahead[1].capsule_id, "b"); // Loaded before f was scheduled at the same time
+    EXPECT_EQ(ahead[2].capsule_id, "f");
+    EXPECT_EQ(ahead[3].capsule_id, "d");
+
+    auto due = scheduler.pop_due(at(2));
+    ASSERT_EQ(due.size(), 3u);
+    EXPECT_EQ(due[2].capsule_id, "f");
+    EXPECT_EQ(scheduler.size(), 2u);
+    EXPECT_FALSE(scheduler.contains("b"));
+    EXPECT_EQ(*scheduler.next_due(), at(4));
+    scheduler.schedule_at("b", at(6));
+    EXPECT_EQ(scheduler.pop_due(at(10)).size(), 3u);
+    EXPECT_TRUE(scheduler.empty());
+    EXPECT_FALSE(scheduler.next_due().has_value());
+}
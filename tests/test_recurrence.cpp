@@ -0,0 +1,104 @@
+#include <gtest/gtest.h>
+#include <tcfs/Recurrence.hpp>
+#include <tcfs/UnlockScheduler.hpp>
+#include <chrono>
+
+using namespace tcfs;
+
+namespace {
+
+Policy::TimePoint t(const std::string& rfc3339) {
+    return time_utils::parse_rfc3339(rfc3339).value();
+}
+
+std::string fmt(const std::optional<Policy::TimePoint>& time) {
+    return time ? time_utils::format_rfc3339(*time) : "never";
+}
+
+} // namespace
+
+TEST(RecurrenceTest, FixedPeriodWindows) {
+    // Every day, open for one hour starting 09:00
+    Recurrence daily(t("2030-01-01T09:00:00Z"), 1, RecurrenceUnit::Days, std::chrono::hours(1));
+    ASSERT_TRUE(daily.validate().isSuccess());
+
+    EXPECT_FALSE(daily.is_open(t("2029-12-31T09:30:00Z")));
+    EXPECT_TRUE(daily.is_open(t("2030-01-05T09:30:00Z")));
+    EXPECT_FALSE(daily.is_open(t("2030-01-05T10:00:00Z")));
+
+    EXPECT_EQ(fmt(daily.next_open(t("2029-06-01T00:00:00Z"))), "2030-01-01T09:00:00Z");
+    EXPECT_EQ(fmt(daily.next_open(t("2030-01-05T09:30:00Z"))), "2030-01-05T09:30:00Z");
+    EXPECT_EQ(fmt(daily.next_open(t("2030-01-05T10:00:00Z"))), "2030-01-06T09:00:00Z");
+}
+
+TEST(RecurrenceTest, QuarterlyCalendarWindows) {
+    // First 7 days of every quarter
+    Recurrence quarterly(t("2030-01-01T00:00:00Z"), 3, RecurrenceUnit::Months, std::chrono::hours(24 * 7));
+    ASSERT_TRUE(quarterly.validate().isSuccess());
+
+    EXPECT_TRUE(quarterly.is_open(t("2030-04-03T12:00:00Z")));
+    EXPECT_FALSE(quarterly.is_open(t("2030-05-03T12:00:00Z")));
+    EXPECT_EQ(fmt(quarterly.next_open(t("2030-05-03T12:00:00Z"))), "2030-07-01T00:00:00Z");
+    // Far in the future: still closed-form
+    EXPECT_EQ(fmt(quarterly.next_open(t("2199-11-15T00:00:00Z"))), "2200-01-01T00:00:00Z");
+}
+
+TEST(RecurrenceTest, MonthEndIsClamped) {
+    Recurrence monthly(t("2030-01-31T00:00:00Z"), 1, RecurrenceUnit::Months, std::chrono::hours(1));
+    EXPECT_EQ(fmt(monthly.next_open(t("2030-02-01T00:00:00Z"))), "2030-02-28T00:00:00Z");
+    EXPECT_EQ(fmt(monthly.next_open(t("2030-03-01T00:00:00Z"))), "2030-03-31T00:00:00Z");
+}
+
+TEST(RecurrenceTest, UntilEndsTheRule) {
+    Recurrence weekly(t("2030-01-01T00:00:00Z"), 1, RecurrenceUnit::Weeks, std::chrono::hours(1),
+                      t("2030-01-10T00:00:00Z"));
+    EXPECT_EQ(fmt(weekly.next_open(t("2030-01-02T00:00:00Z"))), "2030-01-08T00:00:00Z");
+    EXPECT_EQ(fmt(weekly.next_open(t("2030-01-09T00:00:00Z"))), "never");
+}
+
+TEST(RecurrenceTest, JSONRoundTripAndValidation) {
+    auto parsed = Recurrence::from_json(nlohmann::json::parse(
+        R"({"start": "2030-01-01T00:00:00Z", "every": 3, "unit": "months", "duration_seconds": 86400})"));
+    ASSERT_TRUE(parsed.isSuccess()) << parsed.getErrorMessage();
+    auto again = Recurrence::from_json(parsed.value().to_json());
+    ASSERT_TRUE(again.isSuccess());
+    EXPECT_EQ(again.value().every(), 3u);
+    EXPECT_EQ(again.value().unit(), RecurrenceUnit::Months);
+
+    // Window longer than the period
+    EXPECT_TRUE(Recurrence::from_json(nlohmann::json::parse(
+        R"({"start": "2030-01-01T00:00:00Z", "unit": "days", "duration_seconds": 90000})")).isError());
+}
+
+TEST(UnlockSchedulerTest, OrdersByNextOpenTime) {
+    auto now = t("2030-01-01T00:00:00Z");
+
+    Policy early;
+    early.setUnlockTime(t("2030-01-02T00:00:00Z"));
+    Policy late;
+    late.setUnlockTime(t("2030-03-01T00:00:00Z"));
+    Policy recurring;
+    recurring.setUnlockTime(t("2030-01-01T00:00:00Z"));
+    recurring.set_recurrence(Recurrence(t("2030-01-01T12:00:00Z"), 1, RecurrenceUnit::Days, std::chrono::hours(1)));
+
+    UnlockScheduler scheduler;
+    scheduler.schedule("late", late, now);
+    scheduler.schedule("early", early, now);
+    scheduler.schedule("recurring", recurring, now);
+    EXPECT_EQ(scheduler.size(), 3u);
+    EXPECT_EQ(fmt(scheduler.next_due()), "2030-01-01T12:00:00Z");
+
+    auto due = scheduler.pop_due(t("2030-01-02T00:00:00Z"));
+    ASSERT_EQ(due.size(), 2u);
+    EXPECT_EQ(due[0].capsule_id, "recurring");
+    EXPECT_EQ(due[1].capsule_id, "early");
+    EXPECT_EQ(scheduler.size(), 1u);
+
+    // Reschedule the recurring capsule after its window closed
+    scheduler.schedule("recurring", recurring, t("2030-01-01T13:00:00Z"));
+    EXPECT_EQ(fmt(scheduler.due_time("recurring")), "2030-01-02T12:00:00Z");
+
+    scheduler.remove("late");
+    EXPECT_FALSE(scheduler.contains("late"));
+    EXPECT_EQ(scheduler.peek_until(t("2031-01-01T00:00:00Z")).size(), 1u);
+}
@@ -0,0 +1,161 @@
+#include <gtest/gtest.h>
+#include <tcfs/Daemon.hpp>
+#include <tcfs/ReleaseQueue.hpp>
+#include <filesystem>
+#include <fstream>
+#include <set>
+
+using namespace tcfs;
+namespace fs = std::filesystem;
+
+namespace {
+
+Policy::TimePoint t(const std::string& rfc3339) {
+    return time_utils::parse_rfc3339(rfc3339).value();
+}
+
+CatalogEntry entry(const std::string& id, uint64_t size = 1024, const std::string& label = "") {
+    CatalogEntry e;
+    e.id = id;
+    e.size = size;
+    e.label = label;
+    return e;
+}
+
+std::vector<std::string> ids(const std::vector<ReleaseQueue::Request>& batch) {
+    std::vector<std::string> result;
+    for (const auto& request : batch) {
+        result.push_back(request.capsule_id);
+    }
+    return result;
+}
+
+} // namespace
+
+TEST(TokenBucketTest, RefillsAtRateUpToBurst) {
+    auto start = t("2030-01-01T00:00:00Z");
+    TokenBucket bucket(100, 200);
+    EXPECT_TRUE(bucket.try_consume(150, start));
+    EXPECT_FALSE(bucket.try_consume(100, start));
+    EXPECT_EQ(bucket.ready_at(100, start), start + std::chrono::milliseconds(500));
+    EXPECT_TRUE(bucket.try_consume(100, start + std::chrono::milliseconds(500)));
+
+    // Oversized requests pass once the bucket is full instead of starving
+    EXPECT_TRUE(bucket.try_consume(1000, start + std::chrono::seconds(10)));
+    EXPECT_FALSE(bucket.try_consume(1, start + std::chrono::seconds(10)));
+}
+
+TEST(ReleaseQueueTest, BatchesAreBoundedAndServedByPriority) {
+    ReleaseQueueOptions options;
+    options.max_concurrency = 2;
+    options.high_priority_labels = {"urgent"};
+    options.bulk_size_bytes = 1 << 20;
+    ReleaseQueue queue(options);
+
+    auto now = t("2030-01-01T00:00:00Z");
+    queue.push(entry("big", 4 << 20), now);
+    queue.push(entry("normal1"), now);
+    queue.push(entry("normal2"), now);
+    queue.push(entry("vip", 1024, "urgent"), now);
+    EXPECT_FALSE(queue.push(entry("vip", 1024, "urgent"), now));
+    EXPECT_EQ(queue.classify(entry("big", 4 << 20)), ReleasePriority::Bulk);
+
+    EXPECT_EQ(ids(queue.take_batch(now)), (std::vector<std::string>{"vip", "normal1"}));
+    EXPECT_EQ(ids(queue.take_batch(now)), (std::vector<std::string>{"normal2", "big"}));
+    EXPECT_TRUE(queue.take_batch(now).empty());
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST(ReleaseQueueTest, JitterSpreadsSimultaneousReleasesDeterministically) {
+    ReleaseQueueOptions options;
+    options.max_concurrency = 1000;
+    options.max_jitter = std::chrono::seconds(60);
+    ReleaseQueue queue(options);
+    ReleaseQueue same(options);
+
+    auto midnight = t("2030-01-01T00:00:00Z");
+    for (int i = 0; i < 500; ++i) {
+        queue.push(entry("capsule" + std::to_string(i)), midnight);
+        same.push(entry("capsule" + std::to_string(i)), midnight);
+    }
+
+    auto first_half = queue.take_batch(midnight + std::chrono::seconds(30));
+    EXPECT_GT(first_half.size(), 150u);
+    EXPECT_LT(first_half.size(), 350u);
+    EXPECT_EQ(ids(first_half), ids(same.take_batch(midnight + std::chrono::seconds(30))));
+    for (const auto& request : first_half) {
+        EXPECT_LE(request.not_before, midnight + std::chrono::seconds(30));
+    }
+
+    EXPECT_EQ(queue.take_batch(midnight + std::chrono::seconds(60)).size(), 500u - first_half.size());
+}
+
+TEST(ReleaseQueueTest, IOBudgetHoldsBackReleases) {
+    ReleaseQueueOptions options;
+    options.max_concurrency = 10;
+    options.io_bytes_per_second = 1000;
+    options.io_burst_bytes = 1000;
+    ReleaseQueue queue(options);
+
+    auto now = t("2030-01-01T00:00:00Z");
+    for (int i = 0; i < 5; ++i) {
+        queue.push(entry("capsule" + std::to_string(i), 400), now);
+    }
+    EXPECT_EQ(queue.take_batch(now).size(), 2u);
+    EXPECT_TRUE(queue.take_batch(now).empty());
+    auto next = queue.next_eligible(now);
+    ASSERT_TRUE(next.has_value());
+    EXPECT_EQ(*next, now + std::chrono::milliseconds(200));
+    EXPECT_EQ(queue.take_batch(*next).size(), 1u);
+}
+
+TEST(ReleaseQueueTest, LagPercentiles) {
+    ReleaseQueue queue;
+    auto due = t("2030-01-01T00:00:00Z");
+    for (int i = 1; i <= 100; ++i) {
+        ReleaseQueue::Request request;
+        request.due = due;
+        queue.record_completion(request, due + std::chrono::milliseconds(i * 10));
+    }
+    auto lag = queue.lag();
+    EXPECT_EQ(lag.count, 100u);
+    EXPECT_EQ(lag.p50, std::chrono::milliseconds(500));
+    EXPECT_EQ(lag.p99, std::chrono::milliseconds(990));
+    EXPECT_EQ(lag.max, std::chrono::milliseconds(1000));
+}
+
+TEST(ReleaseQueueTest, DaemonDrainsMassUnlockWithBoundedConcurrency) {
+    auto dir = fs::temp_directory_path() / "tcfs_release_queue_mass_unlock";
+    fs::remove_all(dir);
+    fs::create_directories(dir / "input");
+    {
+        Store store(dir / "store");
+        ASSERT_TRUE(store.init("test@example.com", "pbkdf2").isSuccess());
+        for (int i = 0; i < 20; ++i) {
+            auto name = "note" + std::to_string(i) + ".txt";
+            std::ofstream(dir / "input" / name) << "note " << i;
+            Policy policy;
+            policy.set_unlock_time("2030-01-01T00:00:00Z");
+            policy.set_owner("test@example.com");
+            policy.set_label(i == 19 ? "urgent" : "");
+            ASSERT_TRUE(store.lock(dir / "input" / name, policy).isSuccess());
+        }
+
+        DaemonOptions options;
+        options.release_dir = dir / "released";
+        options.release.max_concurrency = 3;
+        options.release.high_priority_labels = {"urgent"};
+        Daemon daemon(store, options);
+        ASSERT_TRUE(daemon.start().isSuccess());
+
+        std::vector<std::string> order;
+        daemon.set_release_listener([&](const std::string& id) { order.push_back(id); });
+        EXPECT_EQ(daemon.tick(t("2030-01-01T00:00:00Z")), 20u);
+        ASSERT_EQ(order.size(), 20u);
+        EXPECT_EQ(order.front(), "note19.txt");
+        EXPECT_EQ(std::set<std::string>(order.begin(), order.end()).size(), 20u);
+        EXPECT_EQ(daemon.release_queue().lag().count, 20u);
+        EXPECT_TRUE(fs::exists(dir / "released" / "note7.txt"));
+    }
+    fs::remove_all(dir);
+}
@@ -0,0 +1,191 @@
+#include <gtest/gtest.h>
+#include <tcfs/DirectIO.hpp>
+#include <tcfs/ProgressJournal.hpp>
+#include <tcfs/Store.hpp>
+#include <filesystem>
+#include <fstream>
+
+using namespace tcfs;
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr uint64_t SEGMENT = ChunkedCapsule::DEFAULT_SEGMENT_SIZE;
+
+class ResumeTest : public ::testing::Test {
+protected:
+    fs::path dir;
+
+    void SetUp() override {
+        dir = fs::temp_directory_path() /
+              ("tcfs_resume_" + std::string(::testing::UnitTest::GetInstance()->current_test_info()->name()));
+        fs::remove_all(dir);
+        fs::create_directories(dir / "input");
+    }
+
+    void TearDown() override {
+        fs::remove_all(dir);
+    }
+
+    static std::string pattern(size_t size) {
+        std::string data(size, '\0');
+        for (size_t i = 0; i < size; ++i) {
+            data[i] = static_cast<char>('a' + (i * 11) % 26);
+        }
+        return data;
+    }
+
+    static std::string read_file(const fs::path& path) {
+        std::ifstream in(path, std::ios::binary);
+        return std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    }
+
+    static Policy open_policy() {
+        Policy policy;
+        policy.set_unlock_time("2020-01-01T00:00:00Z");
+        policy.set_owner("test@example.com");
+        return policy;
+    }
+
+    // Leaves a lock interrupted after its capsule file is written: the metadata cannot replace a directory
+    std::string interrupted_lock(Store& store, const fs::path& input) {
+        auto id = store.id_for(input).value();
+        fs::create_directories(store.metadata_path(id) / "blocker");
+        store.set_checkpoint_options({1, false});
+        EXPECT_FALSE(store.lock(input, open_policy()).isSuccess());
+        EXPECT_TRUE(fs::exists(store.progress_path(id, "lock")));
+        fs::remove_all(store.metadata_path(id));
+        return id;
+    }
+};
+
+} // namespace
+
+TEST_F(ResumeTest, InterruptedLockContinuesWithTheCheckpointedKeys) {
+    Store store(dir / "store");
+    ASSERT_TRUE(store.init("test@example.com", "pbkdf2").isSuccess());
+    auto content = pattern(3 * SEGMENT + 1000);
+    auto input = dir / "input" / "big.bin";
+    std::ofstream(input, std::ios::binary) << content;
+
+    auto id = interrupted_lock(store, input);
+    auto journal = ProgressJournal::load(store.progress_path(id, "lock"));
+    ASSERT_TRUE(journal.isSuccess()) << journal.error_message();
+    EXPECT_EQ(journal.value().done, 3u);
+    auto partial = read_file(store.capsule_path(id));
+
+    // Only the last segment is encrypted again, under the same key and nonce
+    store.set_checkpoint_options({1, true});
+    auto locked = store.lock(input, open_policy());
+    ASSERT_TRUE(locked.isSuccess()) << locked.error_message();
+    EXPECT_EQ(read_file(store.capsule_path(id)), partial);
+    EXPECT_FALSE(fs::exists(store.progress_path(id, "lock")));
+
+    auto plaintext = store.decrypt(id);
+    ASSERT_TRUE(plaintext.isSuccess()) << plaintext.error_message();
+    EXPECT_EQ(std::string(plaintext.value().begin(), plaintext.value().end()), content);
+}
+
+TEST_F(ResumeTest, LockStartsOverWhenTheCheckpointDoesNotHold) {
+    Store store(dir / "store");
+    ASSERT_TRUE(store.init("test@example.com", "pbkdf2").isSuccess());
+    auto content = pattern(2 * SEGMENT + 10);
+    auto input = dir / "input" / "big.bin";
+    std::ofstream(input, std::ios::binary) << content;
+
+    auto id = interrupted_lock(store, input);
+    auto partial = read_file(store.capsule_path(id));
+    // A flipped byte in the last committed segment fails its tag
+    {
+        std::fstream capsule(store.capsule_path(id), std::ios::binary | std::ios::in | std::ios::out);
+        capsule.seekp(static_cast<std::streamoff>(ChunkedCapsule::HEADER_SIZE + SEGMENT + SEGMENT / 2));
+        capsule.put(static_cast<char>(partial[ChunkedCapsule::HEADER_SIZE + SEGMENT + SEGMENT / 2] ^ 1));
+    }
+
+    store.set_checkpoint_options({1, true});
+    auto locked = store.lock(input, open_policy());
+    ASSERT_TRUE(locked.isSuccess()) << locked.error_message();
+    EXPECT_NE(read_file(store.capsule_path(id)).substr(0, 100), partial.substr(0, 100));
+    auto plaintext = store.decrypt(id);
+    ASSERT_TRUE(plaintext.isSuccess()) << plaintext.error_message();
+    EXPECT_EQ(std::string(plaintext.value().begin(), plaintext.value().end()), content);
+
+    // Without --resume a stale checkpoint is ignored and replaced
+    ProgressJournal stale;
+    stale.operation = "lock";
+    ASSERT_TRUE(stale.save(store.progress_path(id, "lock")).isSuccess());
+    store.set_checkpoint_options({1, false});
+    ASSERT_TRUE(store.lock(input, open_policy()).isSuccess());
+    EXPECT_FALSE(fs::exists(store.progress_path(id, "lock")));
+}
+
+TEST_F(ResumeTest, UnlockContinuesAfterTheCheckpointedBytes) {
+    Store store(dir / "store");
+    ASSERT_TRUE(store.init("test@example.com", "pbkdf2").isSuccess());
+    auto content = pattern(3 * SEGMENT + 123);
+    auto input = dir / "input" / "big.bin";
+    std::ofstream(input, std::ios::binary) << content;
+    auto id = store.lock(input, open_policy());
+    ASSERT_TRUE(id.isSuccess()) << id.error_message();
+
+    store.set_checkpoint_options({1, false});
+    auto output = dir / "out.bin";
+    auto written = store.unlock_to(id.value(), output);
+    ASSERT_TRUE(written.isSuccess()) << written.error_message();
+    EXPECT_EQ(written.value(), content.size());
+    EXPECT_EQ(read_file(output), content);
+    EXPECT_FALSE(fs::exists(store.progress_path(id.value(), "unlock")));
+
+    // Bytes already written are kept as they are, with and without the buffer pool
+    for (bool pooled : {false, true}) {
+        std::string prefix(SEGMENT + 100, 'x');
+        std::ofstream(output, std::ios::binary | std::ios::trunc) << prefix << "leftover";
+        ProgressJournal journal;
+        journal.operation = "unlock";
+        journal.source = id.value();
+        journal.source_size = content.size();
+        journal.output = fs::absolute(output).lexically_normal().string();
+        journal.instance = ProgressJournal::capsule_instance(store.read_layout(id.value()).value());
+        journal.done = prefix.size();
+        ASSERT_TRUE(journal.save(store.progress_path(id.value(), "unlock")).isSuccess());
+
+        store.set_direct_io(pooled ? std::make_shared<BufferPool>() : nullptr);
+        store.set_checkpoint_options({1, true});
+        ASSERT_TRUE(store.unlock_to(id.value(), output).isSuccess());
+        EXPECT_EQ(read_file(output), prefix + content.substr(prefix.size())) << "pooled " << pooled;
+        EXPECT_FALSE(fs::exists(store.progress_path(id.value(), "unlock")));
+    }
+}
+
+TEST_F(ResumeTest, UnlockStartsOverForACapsuleLockedAgain) {
+    Store store(dir / "store");
+    ASSERT_TRUE(store.init("test@example.com", "pbkdf2").isSuccess());
+    auto input = dir / "input" / "big.bin";
+    std::ofstream(input, std::ios::binary) << pattern(2 * SEGMENT + 10);
+    auto id = store.lock(input, open_policy());
+    ASSERT_TRUE(id.isSuccess()) << id.error_message();
+
+    auto output = dir / "out.bin";
+    std::string prefix(SEGMENT, 'x');
+    std::ofstream(output, std::ios::binary) << prefix;
+    ProgressJournal journal;
+    journal.operation = "unlock";
+    journal.source = id.value();
+    journal.source_size = 2 * SEGMENT + 10;
+    journal.output = fs::absolute(output).lexically_normal().string();
+    journal.instance = ProgressJournal::capsule_instance(store.read_layout(id.value()).value());
+    journal.done = prefix.size();
+    ASSERT_TRUE(journal.save(store.progress_path(id.value(), "unlock")).isSuccess());
+
+    // Same name and size, new content: the old prefix must not survive
+    auto content = std::string(2 * SEGMENT + 10, 'n');
+    std::ofstream(input, std::ios::binary | std::ios::trunc) << content;
+    ASSERT_TRUE(store.lock(input, open_policy()).isSuccess());
+
+    store.set_checkpoint_options({1, true});
+    auto written = store.unlock_to(id.value(), output);
+    ASSERT_TRUE(written.isSuccess()) << written.error_message();
+    EXPECT_EQ(written.value(), content.size());
+    EXPECT_EQ(read_file(output), content);
+    EXPECT_FALSE(fs::exists(store.progress_path(id.value(), "unlock")));
+}
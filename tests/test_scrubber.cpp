@@ -0,0 +1,149 @@
+#include <gtest/gtest.h>
+#include <tcfs/Scrubber.hpp>
+#include <tcfs/Store.hpp>
+#include <filesystem>
+#include <fstream>
+
+using namespace tcfs;
+namespace fs = std::filesystem;
+
+namespace {
+
+class ScrubberTest : public ::testing::Test {
+protected:
+    fs::path dir;
+    std::unique_ptr<Store> store;
+
+    void SetUp() override {
+        dir = fs::temp_directory_path() /
+              ("tcfs_scrubber_" + std::string(::testing::UnitTest::GetInstance()->current_test_info()->name()));
+        fs::remove_all(dir);
+        fs::create_directories(dir / "input");
+        store = std::make_unique<Store>(dir / "store");
+        ASSERT_TRUE(store->init("test@example.com", "pbkdf2").isSuccess());
+    }
+
+    void TearDown() override {
+        store.reset();
+        fs::remove_all(dir);
+    }
+
+    std::vector<std::string> lock_files(size_t count) {
+        std::vector<fs::path> inputs;
+        for (size_t i = 0; i < count; ++i) {
+            inputs.push_back(dir / "input" / ("file" + std::to_string(i) + ".txt"));
+            std::ofstream(inputs.back(), std::ios::binary) << std::to_string(i) + " secret";
+        }
+        Policy policy;
+        policy.set_unlock_time("2030-01-01T00:00:00Z");
+        policy.set_owner("test@example.com");
+        auto batch = store->lock_batch(inputs, policy, 4);
+        EXPECT_TRUE(batch.isSuccess());
+        return batch.value().locked;
+    }
+
+    void edit_metadata(const std::string& id, const std::function<void(nlohmann::json&)>& edit) {
+        auto path = store->metadata_path(id);
+        nlohmann::json metadata;
+        std::ifstream(path) >> metadata;
+        edit(metadata);
+        std::ofstream(path, std::ios::trunc) << metadata.dump(2);
+    }
+};
+
+} // namespace
+
+TEST_F(ScrubberTest, BatchVerificationFlagsOnlyBadSignatures) {
+    auto& crypto = store->crypto();
+    auto key = crypto.generateEd25519PrivateKey();
+    auto public_key = crypto.ed25519PublicKey(key);
+    std::vector<std::vector<uint8_t>> messages{{1, 2, 3}, {4, 5}, {}};
+    std::vector<std::vector<uint8_t>> signatures;
+    for (const auto& message : messages) {
+        signatures.push_back(crypto.ed25519Sign(key, message));
+    }
+    signatures[1][0] ^= 0x01;
+
+    EXPECT_EQ(crypto.ed25519VerifyBatch(public_key, messages, signatures), (std::vector<bool>{true, false, true}));
+    EXPECT_TRUE(crypto.ed25519Verify(public_key, messages[2], signatures[2]));
+    EXPECT_FALSE(crypto.ed25519Verify(public_key, messages[0], signatures[2]));
+    auto other = crypto.ed25519PublicKey(crypto.generateEd25519PrivateKey());
+    EXPECT_EQ(crypto.ed25519VerifyBatch(other, messages, signatures), (std::vector<bool>{false, false, false}));
+}
+
+TEST_F(ScrubberTest, SignedHeadersVerifyAcrossWorkers) {
+    auto ids = lock_files(20);
+    ASSERT_EQ(ids.size(), 20u);
+
+    ScrubberOptions options;
+    options.workers = 3;
+    options.batch_size = 4;
+    Scrubber scrubber(*store, options);
+    auto report = scrubber.scrub_all();
+    ASSERT_TRUE(report.isSuccess()) << report.error_message();
+    EXPECT_EQ(report.value().verified, 20u);
+    EXPECT_TRUE(report.value().unsigned_ids.empty());
+    EXPECT_TRUE(report.value().clean());
+
+    // Rewriting the metadata re-signs it
+    ASSERT_TRUE(store->add_recipient(ids[0], "alice", "alice-pass", 1000).isSuccess());
+    auto again = scrubber.scrub({ids[0]});
+    ASSERT_TRUE(again.isSuccess());
+    EXPECT_EQ(again.value().verified, 1u);
+}
+
+TEST_F(ScrubberTest, TamperedUnsignedAndForeignHeadersAreReported) {
+    auto ids = lock_files(4);
+    ASSERT_EQ(ids.size(), 4u);
+    edit_metadata(ids[0], [](nlohmann::json& metadata) { metadata["policy"]["unlock_at"] = "2020-01-01T00:00:00Z"; });
+    edit_metadata(ids[1], [](nlohmann::json& metadata) { metadata.erase(Store::SIGNATURE_FIELD); });
+
+    Scrubber scrubber(*store);
+    auto report = scrubber.scrub(ids);
+    ASSERT_TRUE(report.isSuccess());
+    EXPECT_EQ(report.value().verified, 2u);
+    EXPECT_EQ(report.value().unsigned_ids, (std::vector<std::string>{ids[1]}));
+    ASSERT_EQ(report.value().failed.size(), 1u);
+    EXPECT_EQ(report.value().failed[0].first, ids[0]);
+
+    ScrubberOptions strict;
+    strict.require_signatures = true;
+    auto strict_report = Scrubber(*store, strict).scrub(ids);
+    ASSERT_TRUE(strict_report.isSuccess());
+    EXPECT_EQ(strict_report.value().failed.size(), 2u);
+
+    // Signatures by the store's own key mean nothing to a verifier that trusts another host
+    ScrubberOptions foreign;
+    foreign.trusted_signers.push_back(store->crypto().ed25519PublicKey(store->crypto().generateEd25519PrivateKey()));
+    auto foreign_report = Scrubber(*store, foreign).scrub(ids);
+    ASSERT_TRUE(foreign_report.isSuccess());
+    EXPECT_EQ(foreign_report.value().verified, 0u);
+    EXPECT_EQ(foreign_report.value().failed.size(), 3u);
+}
+
+TEST_F(ScrubberTest, MembersOfAnEditedGroupFail) {
+    Policy policy;
+    policy.set_unlock_time("2030-01-01T00:00:00Z");
+    policy.set_owner("test@example.com");
+    ASSERT_TRUE(store->create_group("will", policy).isSuccess());
+    auto input = dir / "input" / "member.txt";
+    std::ofstream(input, std::ios::binary) << "member";
+    auto members = store->lock_group("will", {input});
+    ASSERT_TRUE(members.isSuccess());
+    auto ids = lock_files(1);
+    ids.push_back(members.value().locked.at(0));
+
+    auto clean = Scrubber(*store).scrub(ids);
+    ASSERT_TRUE(clean.isSuccess());
+    EXPECT_EQ(clean.value().verified, 2u);
+
+    auto record = store->read_group("will").value();
+    record["policy"]["unlock_at"] = "2020-01-01T00:00:00Z";
+    std::ofstream(store->group_path("will"), std::ios::trunc) << record.dump(2);
+    auto report = Scrubber(*store).scrub(ids);
+    ASSERT_TRUE(report.isSuccess());
+    EXPECT_EQ(report.value().verified, 1u);
+    ASSERT_EQ(report.value().failed.size(), 1u);
+    EXPECT_EQ(report.value().failed[0].first, ids[1]);
+    EXPECT_NE(report.value().failed[0].second.find("will"), std::string::npos);
+}
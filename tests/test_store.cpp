@@ -0,0 +1,210 @@
+#include <gtest/gtest.h>
+#include <tcfs/Daemon.hpp>
+#include <tcfs/Store.hpp>
+#include <filesystem>
+#include <fstream>
+
+using namespace tcfs;
+namespace fs = std::filesystem;
+
+namespace {
+
+class StoreTest : public ::testing::Test {
+protected:
+    fs::path dir;
+
+    void SetUp() override {
+        dir = fs::temp_directory_path() /
+              ("tcfs_store_" + std::string(::testing::UnitTest::GetInstance()->current_test_info()->name()));
+        fs::remove_all(dir);
+        fs::create_directories(dir / "input");
+    }
+
+    void TearDown() override {
+        fs::remove_all(dir);
+    }
+
+    fs::path write_input(const std::string& name, const std::string& content) {
+        auto path = dir / "input" / name;
+        std::ofstream(path, std::ios::binary) << content;
+        return path;
+    }
+
+    static std::string read_file(const fs::path& path) {
+        std::ifstream in(path, std::ios::binary);
+        return std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    }
+
+    static Policy policy_at(const std::string& unlock_at, std::vector<std::string> depends_on = {}) {
+        Policy policy;
+        policy.set_unlock_time(unlock_at);
+        policy.set_owner("test@example.com");
+        policy.set_depends_on(std::move(depends_on));
+        return policy;
+    }
+};
+
+} // namespace
+
+TEST_F(StoreTest, LockAndDecryptRoundTrip) {
+    Store store(dir / "store");
+    ASSERT_TRUE(store.init("test@example.com", "pbkdf2").isSuccess());
+    EXPECT_EQ(store.default_owner(), "test@example.com");
+
+    auto id = store.lock(write_input("note.txt", "hello capsule"), policy_at("2030-01-01T00:00:00Z"));
+    ASSERT_TRUE(id.isSuccess()) << id.error_message();
+    EXPECT_EQ(id.value(), "note.txt");
+    EXPECT_TRUE(fs::exists(store.capsule_path("note.txt")));
+
+    auto resolved = store.resolve("note.txt.tcfs");
+    ASSERT_TRUE(resolved.isSuccess());
+    EXPECT_EQ(resolved.value(), "note.txt");
+
+    auto plaintext = store.decrypt("note.txt");
+    ASSERT_TRUE(plaintext.isSuccess());
+    EXPECT_EQ(std::string(plaintext.value().begin(), plaintext.value().end()), "hello capsule");
+}
+
+TEST_F(StoreTest, LockRejectsUnknownDependency) {
+    Store store(dir / "store");
+    ASSERT_TRUE(store.init("test@example.com", "pbkdf2").isSuccess());
+    auto id = store.lock(write_input("b.txt", "b"), policy_at("2030-01-01T00:00:00Z", {"a.txt"}));
+    EXPECT_FALSE(id.isSuccess());
+    EXPECT_FALSE(fs::exists(store.capsule_path("b.txt")));
+}
+
+TEST_F(StoreTest, RebuildCatalogFromMetadata) {
+    Store store(dir / "store");
+    ASSERT_TRUE(store.init("test@example.com", "pbkdf2").isSuccess());
+    ASSERT_TRUE(store.lock(write_input("a.txt", "a"), policy_at("2030-01-01T00:00:00Z")).isSuccess());
+    ASSERT_TRUE(store.lock(write_input("b.txt", "b"), policy_at("2030-01-01T00:00:00Z", {"a.txt"})).isSuccess());
+
+    fs::remove(dir / "store" / Catalog::JOURNAL_FILENAME);
+
+    Store reopened(dir / "store");
+    auto catalog = reopened.catalog();
+    ASSERT_TRUE(catalog.isSuccess());
+    EXPECT_EQ(catalog.value()->size(), 2u);
+    EXPECT_EQ(catalog.value()->find("b.txt")->depends_on, std::vector<std::string>{"a.txt"});
+    EXPECT_FALSE(catalog.value()->dependencies_ready("b.txt"));
+}
+
+TEST_F(StoreTest, DaemonReleasesDependentsInSamePass) {
+    Store store(dir / "store");
+    ASSERT_TRUE(store.init("test@example.com", "pbkdf2").isSuccess());
+    ASSERT_TRUE(store.lock(write_input("a.txt", "first"), policy_at("2030-01-01T00:00:00Z")).isSuccess());
+    ASSERT_TRUE(store.lock(write_input("b.txt", "second"), policy_at("2029-01-01T00:00:00Z", {"a.txt"})).isSuccess());
+    ASSERT_TRUE(store.lock(write_input("c.txt", "third"), policy_at("2031-01-01T00:00:00Z", {"a.txt"})).isSuccess());
+
+    DaemonOptions options;
+    options.release_dir = dir / "released";
+    Daemon daemon(store, options);
+    ASSERT_TRUE(daemon.start().isSuccess());
+    // Only a is schedulable; b and c wait on it
+    EXPECT_EQ(daemon.scheduler().size(), 1u);
+
+    std::vector<std::string> released;
+    daemon.set_release_listener([&](const std::string& id) { released.push_back(id); });
+
+    EXPECT_EQ(daemon.tick(time_utils::parse_rfc3339("2029-06-01T00:00:00Z").value()), 0u);
+    EXPECT_EQ(daemon.tick(time_utils::parse_rfc3339("2030-06-01T00:00:00Z").value()), 2u);
+    EXPECT_EQ(released, (std::vector<std::string>{"a.txt", "b.txt"}));
+    EXPECT_EQ(read_file(dir / "released" / "b.txt"), "second");
+
+    // c is not due yet and has been handed to the scheduler
+    EXPECT_TRUE(daemon.scheduler().contains("c.txt"));
+    EXPECT_FALSE(fs::exists(dir / "released" / "c.txt"));
+}
+
+TEST_F(StoreTest, DaemonSchedulesDependentsReleasedByAnotherProcess) {
+    Store store(dir / "store");
+    ASSERT_TRUE(store.init("test@example.com", "pbkdf2").isSuccess());
+    ASSERT_TRUE(store.lock(write_input("a.txt", "first"), policy_at("2030-01-01T00:00:00Z")).isSuccess());
+    ASSERT_TRUE(store.lock(write_input("b.txt", "second"), policy_at("2029-01-01T00:00:00Z", {"a.txt"})).isSuccess());
+    ASSERT_TRUE(store.lock(write_input("c.txt", "third"), policy_at("2029-01-01T00:00:00Z", {"a.txt"})).isSuccess());
+
+    DaemonOptions options;
+    options.release_dir = dir / "released";
+    Daemon daemon(store, options);
+    ASSERT_TRUE(daemon.start().isSuccess());
+    EXPECT_FALSE(daemon.scheduler().contains("b.txt"));
+
+    // a is released by tcfs unlock in another process
+    Store other(dir / "store");
+    ASSERT_TRUE(other.mark_released("a.txt").isSuccess());
+    auto now = time_utils::parse_rfc3339("2029-06-01T00:00:00Z").value();
+    ASSERT_TRUE(daemon.refresh(now).isSuccess());
+    EXPECT_TRUE(daemon.scheduler().contains("b.txt"));
+    EXPECT_TRUE(daemon.scheduler().contains("c.txt"));
+    EXPECT_EQ(daemon.tick(now), 2u);
+    EXPECT_EQ(read_file(dir / "released" / "b.txt"), "second");
+    EXPECT_EQ(store.catalog().value()->find("b.txt")->state, CapsuleState::Released);
+}
+
+TEST_F(StoreTest, DaemonHoldsCapsulesWhoseMetadataIsLaterThanTheCatalog) {
+    Store store(dir / "store");
+    ASSERT_TRUE(store.init("test@example.com", "pbkdf2").isSuccess());
+    ASSERT_TRUE(store.lock(write_input("a.txt", "first"), policy_at("2030-01-01T00:00:00Z")).isSuccess());
+
+    // An extend interrupted after rewriting the metadata but before its catalog commit
+    auto metadata = store.read_metadata("a.txt").value();
+    metadata["policy"]["unlock_at"] = "2035-01-01T00:00:00Z";
+    ASSERT_TRUE(store.write_metadata("a.txt", metadata).isSuccess());
+
+    DaemonOptions options;
+    options.release_dir = dir / "released";
+    Daemon daemon(store, options);
+    ASSERT_TRUE(daemon.start().isSuccess());
+    EXPECT_EQ(daemon.tick(time_utils::parse_rfc3339("2031-01-01T00:00:00Z").value()), 0u);
+    EXPECT_FALSE(fs::exists(dir / "released" / "a.txt"));
+    EXPECT_EQ(daemon.scheduler().due_time("a.txt"), time_utils::parse_rfc3339("2035-01-01T00:00:00Z").value());
+}
+
+TEST_F(StoreTest, StagedCapsuleReleasesOnlyOpenStages) {
+    Store store(dir / "store");
+    ASSERT_TRUE(store.init("test@example.com", "pbkdf2").isSuccess());
+
+    auto later = policy_at("2031-01-01T00:00:00Z");
+    auto id = store.lock(write_input("book.txt", "chapter one|chapter two"), policy_at("2030-01-01T00:00:00Z"),
+                         {{"part2", later, 12}});
+    ASSERT_TRUE(id.isSuccess()) << id.error_message();
+
+    auto layout = store.read_layout("book.txt");
+    ASSERT_TRUE(layout.isSuccess());
+    ASSERT_EQ(layout.value().stages.size(), 2u);
+    EXPECT_EQ(layout.value().stages[0].name, Store::FIRST_STAGE_NAME);
+
+    auto part2 = store.read_stage("book.txt", 1);
+    ASSERT_TRUE(part2.isSuccess());
+    EXPECT_EQ(std::string(part2.value().begin(), part2.value().end()), "chapter two");
+
+    auto range = store.read_range("book.txt", 0, 8, 3);
+    ASSERT_TRUE(range.isSuccess());
+    EXPECT_EQ(std::string(range.value().begin(), range.value().end()), "one");
+
+    auto whole = store.decrypt("book.txt");
+    ASSERT_TRUE(whole.isSuccess());
+    EXPECT_EQ(std::string(whole.value().begin(), whole.value().end()), "chapter one|chapter two");
+
+    DaemonOptions options;
+    options.release_dir = dir / "released";
+    Daemon daemon(store, options);
+    ASSERT_TRUE(daemon.start().isSuccess());
+    EXPECT_EQ(daemon.tick(time_utils::parse_rfc3339("2030-06-01T00:00:00Z").value()), 1u);
+    EXPECT_EQ(read_file(dir / "released" / "book.txt.part1"), "chapter one|");
+    EXPECT_FALSE(fs::exists(dir / "released" / "book.txt.part2"));
+    EXPECT_FALSE(fs::exists(dir / "released" / "book.txt"));
+
+    // The capsule stays locked and comes back when part2 opens
+    EXPECT_EQ(store.catalog().value()->find("book.txt")->state, CapsuleState::Locked);
+    ASSERT_TRUE(daemon.scheduler().contains("book.txt"));
+    EXPECT_EQ(daemon.scheduler().due_time("book.txt"), later.unlock_time());
+    fs::remove(dir / "released" / "book.txt.part1");
+
+    EXPECT_EQ(daemon.tick(time_utils::parse_rfc3339("2031-06-01T00:00:00Z").value()), 1u);
+    EXPECT_EQ(read_file(dir / "released" / "book.txt.part2"), "chapter two");
+    EXPECT_FALSE(fs::exists(dir / "released" / "book.txt.part1"));
+    EXPECT_FALSE(fs::exists(dir / "released" / "book.txt"));
+    EXPECT_EQ(store.catalog().value()->find("book.txt")->state, CapsuleState::Released);
+    EXPECT_FALSE(daemon.scheduler().contains("book.txt"));
+}
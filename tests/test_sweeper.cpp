@@ -0,0 +1,142 @@
+#include <gtest/gtest.h>
+#include <tcfs/AuditLog.hpp>
+#include <tcfs/Daemon.hpp>
+#include <tcfs/Sweeper.hpp>
+#include <filesystem>
+#include <fstream>
+
+using namespace tcfs;
+namespace fs = std::filesystem;
+
+namespace {
+
+class SweeperTest : public ::testing::Test {
+protected:
+    fs::path dir;
+    std::unique_ptr<Store> store;
+
+    void SetUp() override {
+        dir = fs::temp_directory_path() /
+              ("tcfs_sweeper_" + std::string(::testing::UnitTest::GetInstance()->current_test_info()->name()));
+        fs::remove_all(dir);
+        fs::create_directories(dir / "input");
+        store = std::make_unique<Store>(dir / "store");
+        ASSERT_TRUE(store->init("test@example.com", "pbkdf2").isSuccess());
+    }
+
+    void TearDown() override {
+        store.reset();
+        fs::remove_all(dir);
+    }
+
+    void lock(const std::string& name, const std::string& expire_at, std::vector<std::string> depends_on = {}) {
+        auto input = dir / "input" / name;
+        std::ofstream(input, std::ios::binary) << "content of " << name;
+        Policy policy;
+        policy.set_unlock_time("2030-01-01T00:00:00Z");
+        policy.set_owner("test@example.com");
+        policy.set_depends_on(std::move(depends_on));
+        if (!expire_at.empty()) {
+            policy.set_expire_at(time_utils::parse_rfc3339(expire_at).value());
+        }
+        ASSERT_TRUE(store->lock(input, policy).isSuccess());
+    }
+
+    static Policy::TimePoint t(const std::string& rfc3339) {
+        return time_utils::parse_rfc3339(rfc3339).value();
+    }
+};
+
+} // namespace
+
+TEST_F(SweeperTest, DestroysOnlyExpiredCapsulesInBatches) {
+    lock("a.txt", "2030-02-01T00:00:00Z");
+    lock("b.txt", "2030-03-01T00:00:00Z");
+    lock("c.txt", "2030-04-01T00:00:00Z");
+    lock("keep.txt", "");
+
+    SweeperOptions options;
+    options.batch_size = 1;
+    options.batch_pause = std::chrono::milliseconds(0);
+    Sweeper sweeper(*store, options);
+    ASSERT_TRUE(sweeper.start().isSuccess());
+    EXPECT_EQ(sweeper.size(), 3u);
+    EXPECT_EQ(time_utils::format_rfc3339(*sweeper.next_expiry()), "2030-02-01T00:00:00Z");
+
+    auto now = t("2030-03-15T00:00:00Z");
+    auto batch = sweeper.sweep_batch(now);
+    EXPECT_EQ(batch.destroyed, std::vector<std::string>{"a.txt"});
+    EXPECT_TRUE(sweeper.has_expired(now));
+
+    auto rest = sweeper.sweep(now);
+    EXPECT_EQ(rest.destroyed, std::vector<std::string>{"b.txt"});
+    EXPECT_FALSE(sweeper.has_expired(now));
+
+    EXPECT_FALSE(fs::exists(store->capsule_path("a.txt")));
+    EXPECT_FALSE(fs::exists(store->metadata_path("b.txt")));
+    EXPECT_TRUE(fs::exists(store->capsule_path("c.txt")));
+    EXPECT_TRUE(fs::exists(store->capsule_path("keep.txt")));
+
+    auto catalog = store->catalog();
+    ASSERT_TRUE(catalog.isSuccess());
+    EXPECT_FALSE(catalog.value()->contains("a.txt"));
+    EXPECT_TRUE(catalog.value()->contains("c.txt"));
+
+    auto audit = store->audit_log();
+    ASSERT_TRUE(audit.isSuccess());
+    auto records = audit.value()->read_all();
+    ASSERT_TRUE(records.isSuccess());
+    ASSERT_EQ(records.value().size(), 2u);
+    EXPECT_EQ(records.value()[0].action, "destroy");
+    EXPECT_EQ(records.value()[0].capsule_id, "a.txt");
+    EXPECT_EQ(records.value()[1].details["reason"], "expired");
+}
+
+TEST_F(SweeperTest, AuditChainDetectsTampering) {
+    auto crypto = createCryptoProvider();
+    auto path = dir / AuditLog::FILENAME;
+    {
+        AuditLog log(*crypto);
+        ASSERT_TRUE(log.open(path).isSuccess());
+        ASSERT_TRUE(log.append("destroy", "a.txt").isSuccess());
+        ASSERT_TRUE(log.append("destroy", "b.txt").isSuccess());
+    }
+
+    // Reopening continues the chain from the last record
+    AuditLog reopened(*crypto);
+    ASSERT_TRUE(reopened.open(path).isSuccess());
+    EXPECT_EQ(reopened.last_sequence(), 2u);
+    ASSERT_TRUE(reopened.append("destroy", "c.txt").isSuccess());
+    auto records = reopened.read_all();
+    ASSERT_TRUE(records.isSuccess());
+    EXPECT_EQ(records.value().size(), 3u);
+
+    std::string content;
+    {
+        std::ifstream in(path, std::ios::binary);
+        content.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    auto pos = content.find("b.txt");
+    ASSERT_NE(pos, std::string::npos);
+    content.replace(pos, 5, "x.txt");
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << content;
+
+    auto tampered = reopened.read_all();
+    EXPECT_FALSE(tampered.isSuccess());
+    EXPECT_EQ(tampered.error(), ErrorCode::HashChainBroken);
+}
+
+TEST_F(SweeperTest, DaemonDestroysBeforeReleasingAndUnblocksDependents) {
+    lock("a.txt", "2030-02-01T00:00:00Z");
+    lock("b.txt", "", {"a.txt"});
+
+    DaemonOptions options;
+    options.release_dir = dir / "released";
+    Daemon daemon(*store, options);
+    ASSERT_TRUE(daemon.start().isSuccess());
+
+    // The daemon was down past a's unlock and expiry: a is destroyed unreleased, b goes out
+    EXPECT_EQ(daemon.tick(t("2030-03-01T00:00:00Z")), 1u);
+    EXPECT_FALSE(fs::exists(dir / "released" / "a.txt"));
+    EXPECT_TRUE(fs::exists(dir / "released" / "b.txt"));
+}
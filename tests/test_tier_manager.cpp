@@ -0,0 +1,196 @@
+#include <gtest/gtest.h>
+#include <tcfs/Store.hpp>
+#include <tcfs/TierManager.hpp>
+#include <filesystem>
+#include <fstream>
+
+using namespace tcfs;
+namespace fs = std::filesystem;
+
+namespace {
+
+class TierManagerTest : public ::testing::Test {
+protected:
+    fs::path dir;
+    std::unique_ptr<Store> store;
+
+    void SetUp() override {
+        dir = fs::temp_directory_path() /
+              ("tcfs_tier_" + std::string(::testing::UnitTest::GetInstance()->current_test_info()->name()));
+        fs::remove_all(dir);
+        fs::create_directories(dir / "input");
+        store = std::make_unique<Store>(dir / "store");
+        ASSERT_TRUE(store->init("test@example.com", "pbkdf2").isSuccess());
+    }
+
+    void TearDown() override {
+        store.reset();
+        fs::remove_all(dir);
+    }
+
+    std::string lock(const std::string& name, const std::string& unlock_at, const std::string& content = "") {
+        auto input = dir / "input" / name;
+        std::ofstream(input, std::ios::binary) << (content.empty() ? "content of " + name : content);
+        Policy policy;
+        policy.set_unlock_time(unlock_at);
+        policy.set_owner("test@example.com");
+        auto id = store->lock(input, policy);
+        EXPECT_TRUE(id.isSuccess());
+        return id.value();
+    }
+
+    std::string plaintext(const std::string& id) {
+        auto decrypted = store->decrypt(id);
+        EXPECT_TRUE(decrypted.isSuccess()) << decrypted.error_message();
+        return std::string(decrypted.value().begin(), decrypted.value().end());
+    }
+
+    TierManager& tiers() { return *store->tiers().value(); }
+
+    size_t pack_count() const {
+        size_t count = 0;
+        std::error_code ec;
+        for (fs::directory_iterator it(dir / "store" / TierManager::COLD_DIRNAME, ec), end; !ec && it != end; it.increment(ec)) {
+            if (it->path().extension() == TierManager::PACK_EXTENSION) {
+                ++count;
+            }
+        }
+        return count;
+    }
+
+    static Policy::TimePoint t(const std::string& rfc3339) {
+        return time_utils::parse_rfc3339(rfc3339).value();
+    }
+};
+
+} // namespace
+
+TEST_F(TierManagerTest, DemotedCapsulesShareAPackAndReadBackTransparently) {
+    auto a = lock("a.txt", "2040-01-01T00:00:00Z");
+    auto b = lock("b.txt", "2041-01-01T00:00:00Z");
+
+    ASSERT_TRUE(tiers().demote({a, b}).isSuccess());
+    EXPECT_FALSE(fs::exists(store->capsule_path(a)));
+    EXPECT_FALSE(fs::exists(store->capsule_path(b)));
+    EXPECT_EQ(tiers().cold_count(), 2u);
+    EXPECT_EQ(pack_count(), 1u);
+    EXPECT_EQ(tiers().location(a)->pack, tiers().location(b)->pack);
+
+    // Cold capsules still resolve and show up in a catalog rebuild
+    EXPECT_TRUE(store->resolve("a.txt.tcfs").isSuccess());
+    ASSERT_TRUE(store->rebuild_catalog().isSuccess());
+    EXPECT_EQ(store->catalog().value()->size(), 2u);
+    EXPECT_NE(store->catalog().value()->find(a)->size, 0u);
+
+    // A fresh process sees the same state from the journal
+    Store reopened(dir / "store");
+    EXPECT_TRUE(reopened.tiers().value()->is_cold(a));
+
+    // Reading promotes; the pack goes away once nothing references it
+    EXPECT_EQ(plaintext(a), "content of a.txt");
+    EXPECT_TRUE(fs::exists(store->capsule_path(a)));
+    EXPECT_FALSE(tiers().is_cold(a));
+    EXPECT_EQ(plaintext(b), "content of b.txt");
+    EXPECT_EQ(pack_count(), 0u);
+}
+
+TEST_F(TierManagerTest, MigrateDemotesFarFutureAndPromotesApproachingCapsules) {
+    auto soon = lock("soon.txt", "2030-01-02T00:00:00Z");
+    auto far = lock("far.txt", "2040-01-01T00:00:00Z");
+
+    TierOptions options;
+    options.demote_after = std::chrono::hours(24 * 365);
+    options.promote_before = std::chrono::hours(24 * 30);
+    options.bytes_per_second = 0;
+    store->set_tier_options(options);
+
+    auto pass = tiers().migrate(t("2030-01-01T00:00:00Z"));
+    EXPECT_EQ(pass.demoted, std::vector<std::string>{far});
+    EXPECT_TRUE(pass.promoted.empty());
+    EXPECT_FALSE(tiers().is_cold(soon));
+    EXPECT_TRUE(tiers().is_cold(far));
+
+    // Nothing moves while the capsule is between the two thresholds
+    pass = tiers().migrate(t("2039-06-01T00:00:00Z"));
+    EXPECT_TRUE(pass.demoted.empty());
+    EXPECT_TRUE(pass.promoted.empty());
+
+    pass = tiers().migrate(t("2039-12-15T00:00:00Z"));
+    EXPECT_EQ(pass.promoted, std::vector<std::string>{far});
+    EXPECT_TRUE(fs::exists(store->capsule_path(far)));
+    EXPECT_EQ(plaintext(far), "content of far.txt");
+}
+
+TEST_F(TierManagerTest, MigrationIsRateLimited) {
+    auto a = lock("a.txt", "2040-01-01T00:00:00Z", std::string(4096, 'a'));
+    auto b = lock("b.txt", "2041-01-01T00:00:00Z", std::string(4096, 'b'));
+    auto capsule_size = fs::file_size(store->capsule_path(a));
+
+    TierOptions options;
+    options.demote_after = std::chrono::hours(24 * 365);
+    options.bytes_per_second = capsule_size;
+    store->set_tier_options(options);
+
+    auto now = t("2030-01-01T00:00:00Z");
+    EXPECT_EQ(tiers().migrate(now).demoted, std::vector<std::string>{b}); // Furthest unlock first
+    EXPECT_TRUE(tiers().migrate(now).demoted.empty());
+    EXPECT_EQ(tiers().migrate(now + std::chrono::seconds(1)).demoted, std::vector<std::string>{a});
+}
+
+TEST_F(TierManagerTest, RecoverySettlesInterruptedMigrations) {
+    auto a = lock("a.txt", "2040-01-01T00:00:00Z");
+    auto b = lock("b.txt", "2040-01-01T00:00:00Z");
+    auto saved = dir / "a.saved";
+    fs::copy_file(store->capsule_path(a), saved);
+    ASSERT_TRUE(tiers().demote({a, b}).isSuccess());
+
+    // Crash between journaling and unlinking the hot file, plus leftovers of an unfinished demotion
+    fs::copy_file(saved, store->capsule_path(a));
+    auto cold_dir = tiers().cold_dir();
+    std::ofstream(cold_dir / "pack-00000009.pack") << "orphan";
+    std::ofstream(cold_dir / "pack-00000010.pack.tmp") << "partial";
+
+    Store restarted(dir / "store");
+    auto manager = restarted.tiers().value();
+    ASSERT_TRUE(manager->recover().isSuccess());
+    EXPECT_FALSE(manager->is_cold(a));
+    EXPECT_TRUE(manager->is_cold(b));
+    EXPECT_FALSE(fs::exists(cold_dir / "pack-00000009.pack"));
+    EXPECT_FALSE(fs::exists(cold_dir / "pack-00000010.pack.tmp"));
+    EXPECT_EQ(pack_count(), 1u);
+
+    auto decrypted = restarted.decrypt(b);
+    ASSERT_TRUE(decrypted.isSuccess());
+    EXPECT_EQ(std::string(decrypted.value().begin(), decrypted.value().end()), "content of b.txt");
+}
+
+TEST_F(TierManagerTest, CompactionRewritesSparsePacks) {
+    auto a = lock("a.txt", "2040-01-01T00:00:00Z", std::string(4096, 'a'));
+    auto b = lock("b.txt", "2040-01-01T00:00:00Z", std::string(4096, 'b'));
+    auto c = lock("c.txt", "2040-01-01T00:00:00Z", std::string(4096, 'c'));
+    ASSERT_TRUE(tiers().demote({a, b, c}).isSuccess());
+    auto old_pack = tiers().location(c)->pack;
+
+    ASSERT_TRUE(tiers().promote(a).isSuccess());
+    ASSERT_TRUE(tiers().promote(b).isSuccess());
+    auto compacted = tiers().compact();
+    ASSERT_TRUE(compacted.isSuccess());
+    EXPECT_EQ(compacted.value(), 1u);
+    EXPECT_NE(tiers().location(c)->pack, old_pack);
+    EXPECT_FALSE(fs::exists(store->root() / old_pack));
+    EXPECT_EQ(fs::file_size(store->root() / tiers().location(c)->pack), tiers().location(c)->length);
+    EXPECT_EQ(plaintext(c), std::string(4096, 'c'));
+}
+
+TEST_F(TierManagerTest, DestroyingAColdCapsuleRemovesItFromItsPack) {
+    auto a = lock("a.txt", "2040-01-01T00:00:00Z");
+    auto b = lock("b.txt", "2040-01-01T00:00:00Z");
+    ASSERT_TRUE(tiers().demote({a, b}).isSuccess());
+
+    ASSERT_TRUE(store->destroy(a, "expired").isSuccess());
+    EXPECT_FALSE(tiers().is_cold(a));
+    EXPECT_EQ(pack_count(), 1u);
+    ASSERT_TRUE(store->destroy(b, "expired").isSuccess());
+    EXPECT_EQ(pack_count(), 0u);
+    EXPECT_EQ(tiers().cold_bytes(), 0u);
+}
@@ -0,0 +1,127 @@
+#include <gtest/gtest.h>
+#include <tcfs/Catalog.hpp>
+#include <tcfs/CatalogSnapshot.hpp>
+#include <tcfs/TrigramIndex.hpp>
+#include <filesystem>
+
+using namespace tcfs;
+namespace fs = std::filesystem;
+
+namespace {
+
+class TrigramIndexTest : public ::testing::Test {
+protected:
+    fs::path dir;
+    fs::path journal;
+
+    void SetUp() override {
+        dir = fs::temp_directory_path() /
+              ("tcfs_trigram_" + std::string(::testing::UnitTest::GetInstance()->current_test_info()->name()));
+        fs::remove_all(dir);
+        fs::create_directories(dir);
+        journal = dir / Catalog::JOURNAL_FILENAME;
+    }
+
+    void TearDown() override {
+        fs::remove_all(dir);
+    }
+
+    static CatalogEntry entry(const std::string& id, const std::string& filename, const std::string& label,
+                              const std::string& notes = "") {
+        CatalogEntry e;
+        e.id = id;
+        e.original_filename = filename;
+        e.label = label;
+        e.notes = notes;
+        e.unlock_at = 1900000000;
+        return e;
+    }
+};
+
+} // namespace
+
+TEST_F(TrigramIndexTest, PostingsSurviveOutOfOrderSlotsAndIntersect) {
+    TrigramIndex index;
+    // Large gaps need multi-byte varints; slots below the last go through the side list
+    for (uint32_t slot = 0; slot < 1000; ++slot) {
+        index.add(slot * 997, slot % 2 == 0 ? "even report" : "odd report");
+    }
+    for (uint32_t slot = 0; slot < 200; ++slot) {
+        index.add(slot * 997 + 1, "late report");
+    }
+
+    auto reports = index.candidates("REPORT");
+    ASSERT_EQ(reports.size(), 1200u);
+    EXPECT_TRUE(std::is_sorted(reports.begin(), reports.end()));
+    EXPECT_EQ(index.candidates("even").size(), 500u);
+    EXPECT_EQ(index.candidates("late rep").size(), 200u);
+    EXPECT_TRUE(index.candidates("missing").empty());
+    EXPECT_LT(index.compressed_bytes(), 1200u * 4 * index.trigram_count());
+
+    std::vector<uint32_t> a;
+    std::vector<uint32_t> b;
+    std::vector<uint32_t> expected;
+    for (uint32_t i = 0; i < 500; ++i) {
+        a.push_back(i * 3);
+        b.push_back(i * 5);
+        if (i * 3 % 5 == 0) {
+            expected.push_back(i * 3);
+        }
+    }
+    expected.erase(std::remove_if(expected.begin(), expected.end(), [](uint32_t v) { return v > 499 * 5; }),
+                   expected.end());
+    EXPECT_EQ(TrigramIndex::intersect(a, b), expected);
+    EXPECT_EQ(TrigramIndex::intersect(b, a), expected);
+    EXPECT_TRUE(TrigramIndex::intersect(a, {}).empty());
+}
+
+TEST_F(TrigramIndexTest, GlobMatchesShellPatterns) {
+    EXPECT_TRUE(TrigramIndex::glob_match("*.pdf", "tax-2025.pdf"));
+    EXPECT_FALSE(TrigramIndex::glob_match("*.pdf", "tax-2025.pdf.bak"));
+    EXPECT_TRUE(TrigramIndex::glob_match("tax-20[0-9][0-9].*", "tax-2025.pdf"));
+    EXPECT_FALSE(TrigramIndex::glob_match("tax-20[!2]?.*", "tax-2025.pdf"));
+    EXPECT_TRUE(TrigramIndex::glob_match("a*b*c", "aXXbYYbc"));
+    EXPECT_TRUE(TrigramIndex::glob_match("report\\*", "report*"));
+    EXPECT_FALSE(TrigramIndex::glob_match("report\\*", "report1"));
+    EXPECT_TRUE(TrigramIndex::glob_match("*", ""));
+
+    EXPECT_EQ(TrigramIndex::glob_literals("tax-20[0-9]?.pdf"), (std::vector<std::string>{"tax-20", ".pdf"}));
+    EXPECT_EQ(TrigramIndex::glob_literals("*"), std::vector<std::string>{});
+}
+
+TEST_F(TrigramIndexTest, CatalogFindsTextWithoutMetadata) {
+    Catalog catalog;
+    ASSERT_TRUE(catalog.load(journal).isSuccess());
+    ASSERT_TRUE(catalog.put(entry("a", "tax-2025.pdf", "Taxes", "for the accountant")).isSuccess());
+    ASSERT_TRUE(catalog.put(entry("b", "photos.zip", "Holiday", "Account of the trip")).isSuccess());
+    ASSERT_TRUE(catalog.put(entry("c", "letter.pdf", "For Grandma")).isSuccess());
+
+    EXPECT_EQ(catalog.find_text("ACCOUNT"), (std::vector<std::string>{"a", "b"}));
+    EXPECT_EQ(catalog.find_text("grandma"), std::vector<std::string>{"c"});
+    EXPECT_EQ(catalog.find_text("zip"), std::vector<std::string>{"b"});
+    EXPECT_EQ(catalog.find_text("of"), std::vector<std::string>{"b"}); // Too short for a trigram: full scan
+    EXPECT_EQ(catalog.find_glob("*.pdf"), (std::vector<std::string>{"a", "c"}));
+    EXPECT_EQ(catalog.find_glob("tax-*.pdf"), std::vector<std::string>{"a"});
+
+    // Replaced and removed entries drop out even though their postings linger
+    ASSERT_TRUE(catalog.put(entry("a", "tax-2025.pdf", "Taxes", "filed")).isSuccess());
+    ASSERT_TRUE(catalog.remove("c").isSuccess());
+    EXPECT_EQ(catalog.find_text("account"), std::vector<std::string>{"b"});
+    EXPECT_TRUE(catalog.find_text("grandma").empty());
+    EXPECT_EQ(catalog.find_text("filed"), std::vector<std::string>{"a"});
+
+    // Notes travel through the journal and snapshots, so the index can be rebuilt from either
+    Catalog replayed;
+    ASSERT_TRUE(replayed.load(journal).isSuccess());
+    EXPECT_EQ(replayed.find_text("trip"), std::vector<std::string>{"b"});
+
+    UnlockScheduler scheduler;
+    auto snapshot_path = dir / "catalog.snapshot";
+    ASSERT_TRUE(CatalogSnapshot::save(snapshot_path, catalog.image(), scheduler, journal).isSuccess());
+    auto loaded = CatalogSnapshot::load(snapshot_path, journal);
+    ASSERT_TRUE(loaded.isSuccess()) << loaded.error_message();
+    Catalog restored;
+    ASSERT_TRUE(restored.restore(journal, std::move(loaded).value().catalog).isSuccess());
+    EXPECT_EQ(restored.find_text("trip"), std::vector<std::string>{"b"});
+    EXPECT_EQ(restored.find_glob("*.pdf"), std::vector<std::string>{"a"});
+}